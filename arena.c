@@ -0,0 +1,256 @@
+/*--------------------------------------------------------------------*/
+/* arena.c                                                            */
+/* Author: Ahmed Farah                                                */
+/* Implements the Arena allocator, compliant with the interface in    */
+/* arena.h                                                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <string.h>
+#include "arena.h"
+
+/* The number of nodes in the first slab. Each later slab holds twice
+as many nodes as the one before, up to MAX_SLAB_NODES */
+enum {FIRST_SLAB_NODES = 8, MAX_SLAB_NODES = 65536};
+
+/* The number of bytes in the first key chunk. Each later chunk is
+twice as large as the one before, up to MAX_KEY_CHUNK_BYTES */
+enum {FIRST_KEY_CHUNK_BYTES = 256, MAX_KEY_CHUNK_BYTES = 1048576};
+
+/* A union whose size and alignment are those of the most demanding
+type a node is likely to contain */
+union Align {
+  void *pv;
+  size_t u;
+  long l;
+  double d;
+};
+
+/* A Chunk is the header of a block of memory obtained from malloc.
+Chunks are strung together in a singly-linked list so that Arena_free
+can release them all. The memory handed out follows the header, which
+is padded by aligner so that this memory is suitably aligned */
+union Chunk {
+  /* The next chunk in the list */
+  union Chunk *psNextChunk;
+  /* Only here for its size and alignment */
+  union Align aligner;
+};
+
+/* A FreeNode is what a node given back by Arena_freeNode holds: a
+pointer to the next node in the list of nodes that can be reused */
+struct FreeNode {
+  /* The next reusable node */
+  struct FreeNode *psNextFreeNode;
+};
+
+/* An Arena has 2 parts. The first hands out nodes: it keeps the slabs
+in psSlabs, carves new nodes off the end of the newest slab, and keeps
+the nodes given back in the list psFreeNodes. The second hands out key
+copies by bumping pcNextKey through the newest chunk in psKeyChunks. */
+struct Arena {
+  /* The size of a node, rounded up to a multiple of union Align */
+  size_t nodeSize;
+  /* The number of nodes the next slab will hold */
+  size_t nextSlabNodes;
+  /* The slabs that nodes are carved from, newest first */
+  union Chunk *psSlabs;
+  /* The first node of the newest slab that was never handed out */
+  char *pcNextNode;
+  /* The number of nodes left at pcNextNode */
+  size_t nodesLeft;
+  /* The nodes given back by Arena_freeNode */
+  struct FreeNode *psFreeNodes;
+  /* The size in bytes of the next key chunk */
+  size_t nextKeyChunkBytes;
+  /* The chunks that key copies are carved from, newest first */
+  union Chunk *psKeyChunks;
+  /* The first free byte of the newest key chunk */
+  char *pcNextKey;
+  /* The number of bytes left at pcNextKey */
+  size_t keyBytesLeft;
+};
+
+/* The Arena constructor */
+Arena_T Arena_new(size_t uNodeSize) {
+  Arena_T oArena;
+  oArena = (Arena_T) malloc(sizeof(struct Arena));
+  if (oArena == NULL) {
+    return NULL;
+  }
+  /* A node must be able to hold a struct FreeNode once it is freed */
+  if (uNodeSize < sizeof(struct FreeNode)) {
+    uNodeSize = sizeof(struct FreeNode);
+  }
+  oArena->nodeSize = (uNodeSize + sizeof(union Align) - 1) /
+    sizeof(union Align) * sizeof(union Align);
+  oArena->nextSlabNodes = FIRST_SLAB_NODES;
+  oArena->psSlabs = NULL;
+  oArena->pcNextNode = NULL;
+  oArena->nodesLeft = 0;
+  oArena->psFreeNodes = NULL;
+  oArena->nextKeyChunkBytes = FIRST_KEY_CHUNK_BYTES;
+  oArena->psKeyChunks = NULL;
+  oArena->pcNextKey = NULL;
+  oArena->keyBytesLeft = 0;
+  return oArena;
+}
+
+/* A helper function which frees every chunk in the list that starts at
+psChunk. It is called by Arena_free */
+static void Arena_freeChunks(union Chunk *psChunk) {
+  union Chunk *psNextChunk;
+  for (; psChunk != NULL; psChunk = psNextChunk) {
+    psNextChunk = psChunk->psNextChunk;
+    free(psChunk);
+  }
+}
+
+/* The Arena deconstructor */
+void Arena_free(Arena_T oArena) {
+  assert(oArena != NULL);
+  Arena_freeChunks(oArena->psSlabs);
+  Arena_freeChunks(oArena->psKeyChunks);
+  free(oArena);
+}
+
+/* implements the Arena_allocNode() function */
+void *Arena_allocNode(Arena_T oArena) {
+  union Chunk *psSlab;
+  void *pvNode;
+  assert(oArena != NULL);
+
+  /* Nodes that were given back are reused first */
+  if (oArena->psFreeNodes != NULL) {
+    pvNode = oArena->psFreeNodes;
+    oArena->psFreeNodes = oArena->psFreeNodes->psNextFreeNode;
+    return pvNode;
+  }
+
+  /* If the newest slab is used up, we allocate a larger one */
+  if (oArena->nodesLeft == 0) {
+    psSlab = (union Chunk *) malloc(sizeof(union Chunk) +
+      oArena->nextSlabNodes * oArena->nodeSize);
+    if (psSlab == NULL) {
+      return NULL;
+    }
+    psSlab->psNextChunk = oArena->psSlabs;
+    oArena->psSlabs = psSlab;
+    oArena->pcNextNode = (char *) (psSlab + 1);
+    oArena->nodesLeft = oArena->nextSlabNodes;
+    if (oArena->nextSlabNodes < MAX_SLAB_NODES) {
+      oArena->nextSlabNodes *= 2;
+    }
+  }
+
+  pvNode = oArena->pcNextNode;
+  oArena->pcNextNode += oArena->nodeSize;
+  oArena->nodesLeft--;
+  return pvNode;
+}
+
+/* implements the Arena_freeNode() function */
+void Arena_freeNode(Arena_T oArena, void *pvNode) {
+  struct FreeNode *psFreeNode;
+  assert(oArena != NULL);
+  assert(pvNode != NULL);
+
+  psFreeNode = (struct FreeNode *) pvNode;
+  psFreeNode->psNextFreeNode = oArena->psFreeNodes;
+  oArena->psFreeNodes = psFreeNode;
+}
+
+/* implements the Arena_copyKey() function */
+char *Arena_copyKey(Arena_T oArena, const char *pcKey, size_t uLength) {
+  union Chunk *psChunk;
+  size_t uChunkBytes;
+  char *pcCopy;
+  assert(oArena != NULL);
+  assert(pcKey != NULL);
+
+  /* A key that doesn't fit in what's left of the newest chunk, but is
+  longer than a whole chunk, gets a chunk of its own. The newest chunk
+  stays the one we bump through */
+  if (uLength >= oArena->keyBytesLeft &&
+    uLength >= oArena->nextKeyChunkBytes) {
+    psChunk = (union Chunk *) malloc(sizeof(union Chunk) + uLength + 1);
+    if (psChunk == NULL) {
+      return NULL;
+    }
+    psChunk->psNextChunk = oArena->psKeyChunks;
+    oArena->psKeyChunks = psChunk;
+    pcCopy = (char *) (psChunk + 1);
+    memcpy(pcCopy, pcKey, uLength);
+    pcCopy[uLength] = '\0';
+    return pcCopy;
+  }
+
+  /* If the key doesn't fit in what's left of the newest chunk, we
+  allocate a new one. Whatever was left of the old chunk is wasted */
+  if (uLength >= oArena->keyBytesLeft) {
+    uChunkBytes = oArena->nextKeyChunkBytes;
+    psChunk = (union Chunk *) malloc(sizeof(union Chunk) + uChunkBytes);
+    if (psChunk == NULL) {
+      return NULL;
+    }
+    psChunk->psNextChunk = oArena->psKeyChunks;
+    oArena->psKeyChunks = psChunk;
+    oArena->pcNextKey = (char *) (psChunk + 1);
+    oArena->keyBytesLeft = uChunkBytes;
+    if (oArena->nextKeyChunkBytes < MAX_KEY_CHUNK_BYTES) {
+      oArena->nextKeyChunkBytes *= 2;
+    }
+  }
+
+  pcCopy = oArena->pcNextKey;
+  memcpy(pcCopy, pcKey, uLength);
+  pcCopy[uLength] = '\0';
+  oArena->pcNextKey += uLength + 1;
+  oArena->keyBytesLeft -= uLength + 1;
+  return pcCopy;
+}
+
+/* implements the Arena_reserve() function. Whatever was left of the
+newest slab or chunk, if it is too small, is wasted */
+int Arena_reserve(Arena_T oArena, size_t uNodes, size_t uKeyBytes) {
+  union Chunk *psSlab = NULL;
+  union Chunk *psChunk = NULL;
+  assert(oArena != NULL);
+
+  if (uNodes > oArena->nodesLeft) {
+    if (uNodes > ((size_t) -1 - sizeof(union Chunk)) / oArena->nodeSize) {
+      return 0;
+    }
+    psSlab = (union Chunk *) malloc(sizeof(union Chunk) +
+      uNodes * oArena->nodeSize);
+    if (psSlab == NULL) {
+      return 0;
+    }
+  }
+  if (uKeyBytes > oArena->keyBytesLeft) {
+    if (uKeyBytes > (size_t) -1 - sizeof(union Chunk)) {
+      free(psSlab);
+      return 0;
+    }
+    psChunk = (union Chunk *) malloc(sizeof(union Chunk) + uKeyBytes);
+    if (psChunk == NULL) {
+      free(psSlab);
+      return 0;
+    }
+  }
+
+  /* Only once both are allocated do we start using them */
+  if (psSlab != NULL) {
+    psSlab->psNextChunk = oArena->psSlabs;
+    oArena->psSlabs = psSlab;
+    oArena->pcNextNode = (char *) (psSlab + 1);
+    oArena->nodesLeft = uNodes;
+  }
+  if (psChunk != NULL) {
+    psChunk->psNextChunk = oArena->psKeyChunks;
+    oArena->psKeyChunks = psChunk;
+    oArena->pcNextKey = (char *) (psChunk + 1);
+    oArena->keyBytesLeft = uKeyBytes;
+  }
+  return 1;
+}
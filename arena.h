@@ -0,0 +1,63 @@
+/*--------------------------------------------------------------------*/
+/* arena.h                                                            */
+/* Author: Ahmed Farah                                                */
+/* Interface for an Arena, the per-table allocator that the Symbol    */
+/* Table implementations use for bindings and key copies              */
+/*--------------------------------------------------------------------*/
+
+/* To prevent double inclusions */
+#ifndef ARENA_INCLUDED
+#define ARENA_INCLUDED
+
+/* allows us to use size_t */
+#include <stdlib.h>
+
+/* defines an alias for struct Arena * */
+typedef struct Arena * Arena_T;
+
+/* The constructor. It takes in uNodeSize, the size in bytes of the
+fixed-size nodes that Arena_allocNode will hand out (which may be 0 if
+the arena is only used for keys), and returns an empty Arena_T, or NULL
+if it can't allocate memory.
+An arena hands out two kinds of memory: nodes, which come from slabs
+of many nodes each and can be given back one at a time for reuse, and
+key copies, which are bump-allocated from larger chunks and are only
+reclaimed when the whole arena is freed. */
+Arena_T Arena_new(size_t uNodeSize);
+
+/* The deconstructor. Takes in an Arena_T called oArena and frees all
+memory associated with it, including every node and key copy it ever
+handed out. Doesn't return anything. Runs in time proportional to the
+number of slabs and chunks, not to the number of nodes or keys */
+void Arena_free(Arena_T oArena);
+
+/* Takes in an Arena_T called oArena and returns a pointer to an
+uninitialized node of the size given to Arena_new, suitably aligned for
+any type. It reuses a node given back by Arena_freeNode when there is
+one. It returns NULL if it can't allocate memory. */
+void *Arena_allocNode(Arena_T oArena);
+
+/* Takes in an Arena_T called oArena and pvNode, a node that
+Arena_allocNode returned for oArena, and makes it available to later
+calls of Arena_allocNode. The memory is not returned to the system
+until oArena is freed. Doesn't return anything. */
+void Arena_freeNode(Arena_T oArena, void *pvNode);
+
+/* Takes in an Arena_T called oArena, a string pcKey and uLength, the
+number of characters of pcKey to copy. It returns a copy of those
+uLength characters followed by a '\0', or NULL if it can't allocate
+memory. The copy lives until oArena is freed. */
+char *Arena_copyKey(Arena_T oArena, const char *pcKey, size_t uLength);
+
+/* Takes in an Arena_T called oArena, uNodes, a number of nodes, and
+uKeyBytes, a number of bytes of key copies, each copy counting its
+'\0'. It makes sure that the next uNodes nodes that Arena_allocNode
+hands out, and the next key copies that Arena_copyKey hands out, up to
+uKeyBytes bytes of them, are carved from one slab and one chunk that
+are already allocated, so they lie together and can't fail. Nodes given
+back by Arena_freeNode are still reused first. It returns 1 if it
+succeeds and 0, leaving oArena as it was, if it can't allocate memory.
+It is meant to be called once, before a known number of puts */
+int Arena_reserve(Arena_T oArena, size_t uNodes, size_t uKeyBytes);
+
+#endif
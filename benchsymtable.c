@@ -0,0 +1,452 @@
+/*--------------------------------------------------------------------*/
+/* benchsymtable.c                                                    */
+/* Author: Ahmed Farah                                                */
+/* A benchmark client for the Symbol Table implementations. Unlike    */
+/* testsymtable.c it doesn't test corner cases: it times each kind of */
+/* operation in a phase of its own and writes one line of CSV per     */
+/* phase. The table can be made with any SymTable_newWithFlags flags  */
+/*--------------------------------------------------------------------*/
+
+/* clock_gettime and CLOCK_MONOTONIC are POSIX, not ANSI C */
+#define _POSIX_C_SOURCE 199309L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "symtable.h"
+
+/* The size of the buffer each key is formatted into, and the common
+prefix of the keys of the "long" distribution, which makes every key
+comparison read past it */
+enum {KEY_SIZE = 64};
+static const char LONG_PREFIX[] =
+  "benchsymtable-long-key-with-a-shared-prefix-";
+
+/* The seed of the generator that shuffles the keys, so that every run
+does the same operations in the same order */
+enum {SHUFFLE_SEED = 217};
+
+/* The number of times the map and iter phases walk the table */
+enum {MAP_PASSES = 5};
+
+/* The number of keys in each SymTable_getBatch call of the get-batch
+phase */
+enum {BATCH_KEYS = 256};
+
+/* The get-skewed phase sends SKEW_HOT_PERCENT of its gets to the
+SKEW_HOT_KEYS_PERCENT of the keys that were put first, and the rest to
+keys picked uniformly, the way a few names dominate the lookups of a
+real program */
+enum {SKEW_HOT_PERCENT = 90, SKEW_HOT_KEYS_PERCENT = 1};
+
+/* The phases, in the order they run and are reported */
+enum {PHASE_CLOCK, PHASE_PUT, PHASE_GET_HIT, PHASE_GET_MISS,
+  PHASE_GET_BATCH, PHASE_GET_SKEWED, PHASE_REPLACE, PHASE_MAP,
+  PHASE_ITER, PHASE_REMOVE, PHASE_COUNT};
+
+/* A Phase names one kind of operation, and holds the latency in
+nanoseconds of each of its ops operations, as well as the wall time of
+the whole phase */
+struct Phase {
+  /* The name written in the phase column */
+  const char *pcName;
+  /* The latency of each operation, sorted once the phase is over */
+  unsigned long *pulLatencies;
+  /* The number of operations timed */
+  size_t ops;
+  /* The wall time of the whole phase, in nanoseconds */
+  double totalNs;
+};
+
+/* A helper function which returns the current time of the monotonic
+clock, in nanoseconds */
+static double Bench_now(void) {
+  struct timespec sNow;
+  clock_gettime(CLOCK_MONOTONIC, &sNow);
+  return (double) sNow.tv_sec * 1e9 + (double) sNow.tv_nsec;
+}
+
+/* A helper function which returns the next number of the generator
+whose state is *pulState. It is a plain LCG, which is good enough to
+shuffle keys and the same on every platform */
+static unsigned long Bench_random(unsigned long *pulState) {
+  assert(pulState != NULL);
+  *pulState = (*pulState * 1103515245UL + 12345UL) & 0x7fffffffUL;
+  return *pulState;
+}
+
+/* A helper function which fills pcKeys, an array of uCount keys of
+KEY_SIZE chars each, with distinct keys following the distribution
+named pcDistribution. A miss key is formatted with pcMissTag in front,
+so that no miss ever matches a hit. It returns 1 if pcDistribution is
+known, and 0 otherwise */
+static int Bench_makeKeys(char *pcKeys, size_t uCount,
+const char *pcDistribution, const char *pcMissTag) {
+  unsigned long ulState = SHUFFLE_SEED;
+  char acTemp[KEY_SIZE];
+  const char *pcPrefix;
+  size_t u;
+  size_t uOther;
+  assert(pcKeys != NULL);
+  assert(pcDistribution != NULL);
+  assert(pcMissTag != NULL);
+
+  if (strcmp(pcDistribution, "sequential") == 0 ||
+    strcmp(pcDistribution, "shuffled") == 0) {
+    pcPrefix = "";
+  }
+  else if (strcmp(pcDistribution, "long") == 0) {
+    pcPrefix = LONG_PREFIX;
+  }
+  else {
+    return 0;
+  }
+
+  for (u = 0; u < uCount; u++) {
+    sprintf(pcKeys + u * KEY_SIZE, "%s%s%lu", pcMissTag, pcPrefix,
+      (unsigned long) u);
+  }
+
+  /* A Fisher-Yates shuffle, so that the keys aren't visited in the
+  order they were made in */
+  if (strcmp(pcDistribution, "sequential") != 0) {
+    for (u = uCount; u > 1; u--) {
+      uOther = Bench_random(&ulState) % u;
+      memcpy(acTemp, pcKeys + (u - 1) * KEY_SIZE, KEY_SIZE);
+      memcpy(pcKeys + (u - 1) * KEY_SIZE, pcKeys + uOther * KEY_SIZE,
+        KEY_SIZE);
+      memcpy(pcKeys + uOther * KEY_SIZE, acTemp, KEY_SIZE);
+    }
+  }
+  return 1;
+}
+
+/* A helper function which fills pcSkewedKeys, an array of uCount keys
+of KEY_SIZE chars each, with keys of pcKeys, which has as many, picked
+as SKEW_HOT_PERCENT and SKEW_HOT_KEYS_PERCENT describe. The hot keys
+are the first ones of pcKeys, which are put first */
+static void Bench_makeSkewedKeys(char *pcSkewedKeys,
+const char *pcKeys, size_t uCount) {
+  unsigned long ulState = SHUFFLE_SEED;
+  size_t uHotCount;
+  size_t uKey;
+  size_t u;
+  assert(pcSkewedKeys != NULL);
+  assert(pcKeys != NULL);
+
+  uHotCount = uCount / (100 / SKEW_HOT_KEYS_PERCENT);
+  if (uHotCount == 0) {
+    uHotCount = 1;
+  }
+  for (u = 0; u < uCount; u++) {
+    if (Bench_random(&ulState) % 100 < SKEW_HOT_PERCENT) {
+      uKey = Bench_random(&ulState) % uHotCount;
+    }
+    else {
+      uKey = Bench_random(&ulState) % uCount;
+    }
+    memcpy(pcSkewedKeys + u * KEY_SIZE, pcKeys + uKey * KEY_SIZE,
+      KEY_SIZE);
+  }
+}
+
+/* A helper function which compares the latencies that pv1 and pv2
+point to, for qsort */
+static int Bench_compare(const void *pv1, const void *pv2) {
+  unsigned long ul1 = *(const unsigned long *) pv1;
+  unsigned long ul2 = *(const unsigned long *) pv2;
+  return (ul1 > ul2) - (ul1 < ul2);
+}
+
+/* A helper function which returns the latency below which a fraction
+dQuantile of the sorted latencies of psPhase lie */
+static unsigned long Bench_quantile(struct Phase *psPhase,
+double dQuantile) {
+  assert(psPhase != NULL);
+  assert(psPhase->ops > 0);
+  return psPhase->pulLatencies[(size_t)
+    (dQuantile * (double) (psPhase->ops - 1))];
+}
+
+/* A helper function which writes the CSV line of psPhase, for the
+program pcProgram run with pcDistribution, the flags uFlags and uCount
+bindings. A phase with no latencies (such as map) leaves the quantile
+columns empty */
+static void Bench_report(struct Phase *psPhase, const char *pcProgram,
+const char *pcDistribution, unsigned int uFlags, size_t uCount) {
+  assert(psPhase != NULL);
+
+  printf("%s,%s,%u,%lu,%s,%lu,%.1f", pcProgram, pcDistribution, uFlags,
+    (unsigned long) uCount, psPhase->pcName,
+    (unsigned long) psPhase->ops,
+    psPhase->ops == 0 ? 0.0 : psPhase->totalNs / (double) psPhase->ops);
+  if (psPhase->pulLatencies == NULL || psPhase->ops == 0) {
+    printf(",,,\n");
+    return;
+  }
+  qsort(psPhase->pulLatencies, psPhase->ops, sizeof(unsigned long),
+    Bench_compare);
+  printf(",%lu,%lu,%lu\n", Bench_quantile(psPhase, 0.5),
+    Bench_quantile(psPhase, 0.99), Bench_quantile(psPhase, 0.999));
+}
+
+/* A helper function used as the pfApply of the map phase. It counts
+the bindings visited in the size_t that pvExtra points to */
+static void Bench_visit(const char *pcKey, void *pvValue,
+void *pvExtra) {
+  assert(pcKey != NULL);
+  assert(pvExtra != NULL);
+  (void) pvValue;
+  (*(size_t *) pvExtra)++;
+}
+
+/* The operations a timed phase can do to every key */
+enum Op {OP_PUT, OP_GET, OP_REPLACE, OP_REMOVE};
+
+/* A helper function which applies eOp to oSymTable for each of the
+uCount keys in pcKeys, with the value pvValue, timing every operation
+into psPhase. It returns the number of operations that found or added
+their key, which the caller can check against what it expected */
+static size_t Bench_run(struct Phase *psPhase, SymTable_T oSymTable,
+enum Op eOp, const char *pcKeys, size_t uCount, const void *pvValue) {
+  double dStart;
+  double dBefore;
+  double dAfter;
+  size_t uHits = 0;
+  size_t u;
+  assert(psPhase != NULL);
+  assert(oSymTable != NULL);
+  assert(pcKeys != NULL);
+
+  dStart = Bench_now();
+  for (u = 0; u < uCount; u++) {
+    const char *pcKey = pcKeys + u * KEY_SIZE;
+    dBefore = Bench_now();
+    switch (eOp) {
+      case OP_PUT:
+        uHits += (size_t) SymTable_put(oSymTable, pcKey, pvValue);
+        break;
+      case OP_GET:
+        uHits += (size_t) (SymTable_get(oSymTable, pcKey) != NULL);
+        break;
+      case OP_REPLACE:
+        uHits += (size_t)
+          (SymTable_replace(oSymTable, pcKey, pvValue) != NULL);
+        break;
+      case OP_REMOVE:
+        uHits += (size_t) (SymTable_remove(oSymTable, pcKey) != NULL);
+        break;
+    }
+    dAfter = Bench_now();
+    psPhase->pulLatencies[u] = (unsigned long) (dAfter - dBefore);
+  }
+  psPhase->totalNs = Bench_now() - dStart;
+  psPhase->ops = uCount;
+  return uHits;
+}
+
+/* A helper function which gets the uCount keys in pcKeys from
+oSymTable with SymTable_getBatch, BATCH_KEYS at a time, timing every
+batch into psPhase. The latency of each key is that of its batch
+divided by the size of the batch. ppcBatch has room for uCount key
+pointers. It returns the number of keys found */
+static size_t Bench_runBatches(struct Phase *psPhase,
+SymTable_T oSymTable, const char *pcKeys, size_t uCount,
+const char **ppcBatch) {
+  void *apvFound[BATCH_KEYS];
+  double dStart;
+  double dBefore;
+  unsigned long ulLatency;
+  size_t uHits = 0;
+  size_t uStart;
+  size_t uSize;
+  size_t u;
+  assert(psPhase != NULL);
+  assert(oSymTable != NULL);
+  assert(pcKeys != NULL);
+  assert(ppcBatch != NULL);
+
+  for (u = 0; u < uCount; u++) {
+    ppcBatch[u] = pcKeys + u * KEY_SIZE;
+  }
+  dStart = Bench_now();
+  for (uStart = 0; uStart < uCount; uStart += uSize) {
+    uSize = (uCount - uStart > BATCH_KEYS) ? BATCH_KEYS :
+      uCount - uStart;
+    dBefore = Bench_now();
+    SymTable_getBatch(oSymTable, ppcBatch + uStart, uSize, apvFound);
+    ulLatency = (unsigned long) ((Bench_now() - dBefore) /
+      (double) uSize);
+    for (u = 0; u < uSize; u++) {
+      uHits += (size_t) (apvFound[u] != NULL);
+      psPhase->pulLatencies[uStart + u] = ulLatency;
+    }
+  }
+  psPhase->totalNs = Bench_now() - dStart;
+  psPhase->ops = uCount;
+  return uHits;
+}
+
+/* Takes in a binding count, optionally a key distribution, which is
+one of "sequential" (the default), "shuffled" and "long", and
+optionally the flags to make the table with, as the number that
+SymTable_newWithFlags takes (0 by default). It times put, get-hit,
+get-miss, get-batch, get-skewed, replace, map, iter and remove phases
+over that many bindings, and writes them to stdout as CSV with a header
+line. Each latency includes the cost of reading the clock, which is
+reported as the clock phase. It returns 0, or EXIT_FAILURE if its
+arguments are bad, it runs out of memory, or an operation doesn't do
+what was expected */
+int main(int argc, char *argv[]) {
+  static const char *apcNames[PHASE_COUNT] = {"clock", "put",
+    "get-hit", "get-miss", "get-batch", "get-skewed", "replace", "map",
+    "iter", "remove"};
+  struct Phase asPhases[PHASE_COUNT];
+  const char *pcDistribution = "sequential";
+  const char *pcProgram;
+  SymTable_T oSymTable;
+  SymTable_Iter sIter;
+  char *pcKeys;
+  char *pcMissKeys;
+  char *pcSkewedKeys;
+  const char **ppcBatch;
+  unsigned long *pulLatencies;
+  int iBindingCount;
+  int iPass;
+  int iStatus = 0;
+  unsigned int uFlags = 0;
+  size_t uCount;
+  size_t uVisited;
+  size_t u;
+  double dStart;
+  double dBefore;
+
+  if (argc < 2 || argc > 4) {
+    fprintf(stderr, "Usage: %s bindingcount "
+      "[sequential|shuffled|long [flags]]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (sscanf(argv[1], "%d", &iBindingCount) != 1 ||
+    iBindingCount <= 0) {
+    fprintf(stderr, "bindingcount must be a positive number\n");
+    return EXIT_FAILURE;
+  }
+  if (argc >= 3) {
+    pcDistribution = argv[2];
+  }
+  if (argc == 4 && sscanf(argv[3], "%u", &uFlags) != 1) {
+    fprintf(stderr, "flags must be a number\n");
+    return EXIT_FAILURE;
+  }
+  uCount = (size_t) iBindingCount;
+
+  /* Only the name of the program, which names the backend */
+  pcProgram = strrchr(argv[0], '/');
+  pcProgram = (pcProgram == NULL) ? argv[0] : pcProgram + 1;
+
+  pcKeys = (char *) malloc(uCount * KEY_SIZE);
+  pcMissKeys = (char *) malloc(uCount * KEY_SIZE);
+  pcSkewedKeys = (char *) malloc(uCount * KEY_SIZE);
+  ppcBatch = (const char **) malloc(uCount * sizeof(const char *));
+  pulLatencies = (unsigned long *)
+    malloc(PHASE_COUNT * uCount * sizeof(unsigned long));
+  oSymTable = SymTable_newWithFlags(uFlags);
+  if (pcKeys == NULL || pcMissKeys == NULL || pcSkewedKeys == NULL ||
+    ppcBatch == NULL || pulLatencies == NULL || oSymTable == NULL) {
+    fprintf(stderr, "%s: out of memory\n", pcProgram);
+    return EXIT_FAILURE;
+  }
+  if (! Bench_makeKeys(pcKeys, uCount, pcDistribution, "") ||
+    ! Bench_makeKeys(pcMissKeys, uCount, pcDistribution, "miss-")) {
+    fprintf(stderr, "%s: unknown distribution %s\n", pcProgram,
+      pcDistribution);
+    return EXIT_FAILURE;
+  }
+  Bench_makeSkewedKeys(pcSkewedKeys, pcKeys, uCount);
+
+  for (u = 0; u < PHASE_COUNT; u++) {
+    asPhases[u].pcName = apcNames[u];
+    asPhases[u].pulLatencies = pulLatencies + u * uCount;
+    asPhases[u].ops = 0;
+    asPhases[u].totalNs = 0.0;
+  }
+
+  /* What reading the clock twice costs, with nothing in between */
+  dStart = Bench_now();
+  for (u = 0; u < uCount; u++) {
+    dBefore = Bench_now();
+    asPhases[PHASE_CLOCK].pulLatencies[u] =
+      (unsigned long) (Bench_now() - dBefore);
+  }
+  asPhases[PHASE_CLOCK].totalNs = Bench_now() - dStart;
+  asPhases[PHASE_CLOCK].ops = uCount;
+
+  /* The keys are visited in the same order by every phase but
+  get-skewed */
+  if (Bench_run(&asPhases[PHASE_PUT], oSymTable, OP_PUT, pcKeys, uCount,
+    pcKeys) != uCount ||
+    Bench_run(&asPhases[PHASE_GET_HIT], oSymTable, OP_GET, pcKeys,
+    uCount, NULL) != uCount ||
+    Bench_run(&asPhases[PHASE_GET_MISS], oSymTable, OP_GET, pcMissKeys,
+    uCount, NULL) != 0 ||
+    Bench_runBatches(&asPhases[PHASE_GET_BATCH], oSymTable, pcKeys,
+    uCount, ppcBatch) != uCount ||
+    Bench_run(&asPhases[PHASE_GET_SKEWED], oSymTable, OP_GET,
+    pcSkewedKeys, uCount, NULL) != uCount ||
+    Bench_run(&asPhases[PHASE_REPLACE], oSymTable, OP_REPLACE, pcKeys,
+    uCount, pcMissKeys) != uCount) {
+    fprintf(stderr, "%s: an operation failed\n", pcProgram);
+    iStatus = EXIT_FAILURE;
+  }
+
+  /* A single call walks the whole table, so there is no per-operation
+  latency: ns/op is per binding visited */
+  uVisited = 0;
+  dStart = Bench_now();
+  for (iPass = 0; iPass < MAP_PASSES; iPass++) {
+    SymTable_map(oSymTable, Bench_visit, &uVisited);
+  }
+  asPhases[PHASE_MAP].totalNs = Bench_now() - dStart;
+  asPhases[PHASE_MAP].ops = uVisited;
+  asPhases[PHASE_MAP].pulLatencies = NULL;
+
+  /* The same walk with a SymTable_Iter, whose loop body needs no call
+  through a function pointer */
+  uVisited = 0;
+  dStart = Bench_now();
+  for (iPass = 0; iPass < MAP_PASSES; iPass++) {
+    for (SymTable_begin(oSymTable, &sIter); SymTable_next(&sIter); ) {
+      uVisited++;
+    }
+  }
+  asPhases[PHASE_ITER].totalNs = Bench_now() - dStart;
+  asPhases[PHASE_ITER].ops = uVisited;
+  asPhases[PHASE_ITER].pulLatencies = NULL;
+  if (uVisited != MAP_PASSES * uCount) {
+    fprintf(stderr, "%s: an operation failed\n", pcProgram);
+    iStatus = EXIT_FAILURE;
+  }
+
+  if (Bench_run(&asPhases[PHASE_REMOVE], oSymTable, OP_REMOVE, pcKeys,
+    uCount, NULL) != uCount || SymTable_getLength(oSymTable) != 0) {
+    fprintf(stderr, "%s: an operation failed\n", pcProgram);
+    iStatus = EXIT_FAILURE;
+  }
+
+  printf("program,distribution,flags,bindings,phase,ops,ns_per_op,"
+    "p50_ns,p99_ns,p999_ns\n");
+  for (u = 0; u < PHASE_COUNT; u++) {
+    Bench_report(&asPhases[u], pcProgram, pcDistribution, uFlags,
+      uCount);
+  }
+
+  SymTable_free(oSymTable);
+  free(pulLatencies);
+  free(ppcBatch);
+  free(pcSkewedKeys);
+  free(pcMissKeys);
+  free(pcKeys);
+  return iStatus;
+}
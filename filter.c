@@ -0,0 +1,88 @@
+/*--------------------------------------------------------------------*/
+/* filter.c                                                           */
+/* Author: Ahmed Farah                                                */
+/* Implements the key filters, compliant with the interface in        */
+/* filter.h                                                           */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <string.h>
+#include "filter.h"
+
+/* A Filter is the extra that Filter_mapRange and Filter_mapPrefix pass
+to SymTable_map: the keys to keep, and the function to apply to
+their bindings, with its own extra */
+struct Filter {
+  /* The first key to keep, or NULL */
+  const char *pcLow;
+  /* The key to stop before, or NULL */
+  const char *pcHigh;
+  /* The start of every key to keep, or NULL */
+  const char *pcPrefix;
+  /* The length of pcPrefix */
+  size_t uPrefixLength;
+  /* The function to apply to the bindings kept */
+  void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra);
+  /* The extra parameter of pfApply */
+  const void *pvExtra;
+};
+
+/* A helper function which applies the function of the Filter that
+pvExtra points to to the binding of pcKey and pvValue, if the filter
+keeps pcKey. It is called by SymTable_map for Filter_mapRange and
+Filter_mapPrefix */
+static void Filter_apply(const char *pcKey, void *pvValue,
+void *pvExtra) {
+  const struct Filter *psFilter = (const struct Filter *) pvExtra;
+  assert(pcKey != NULL);
+  assert(psFilter != NULL);
+
+  if (psFilter->pcLow != NULL && strcmp(pcKey, psFilter->pcLow) < 0) {
+    return;
+  }
+  if (psFilter->pcHigh != NULL &&
+    strcmp(pcKey, psFilter->pcHigh) >= 0) {
+    return;
+  }
+  if (psFilter->pcPrefix != NULL && strncmp(pcKey, psFilter->pcPrefix,
+    psFilter->uPrefixLength) != 0) {
+    return;
+  }
+  psFilter->pfApply(pcKey, pvValue, (void *) psFilter->pvExtra);
+}
+
+/* Implements the Filter_mapRange() function */
+void Filter_mapRange(SymTable_T oSymTable, const char *pcLow,
+const char *pcHigh,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  struct Filter sFilter;
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  sFilter.pcLow = pcLow;
+  sFilter.pcHigh = pcHigh;
+  sFilter.pcPrefix = NULL;
+  sFilter.uPrefixLength = 0;
+  sFilter.pfApply = pfApply;
+  sFilter.pvExtra = pvExtra;
+  SymTable_map(oSymTable, Filter_apply, &sFilter);
+}
+
+/* Implements the Filter_mapPrefix() function */
+void Filter_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  struct Filter sFilter;
+  assert(oSymTable != NULL);
+  assert(pcPrefix != NULL);
+  assert(pfApply != NULL);
+
+  sFilter.pcLow = NULL;
+  sFilter.pcHigh = NULL;
+  sFilter.pcPrefix = pcPrefix;
+  sFilter.uPrefixLength = strlen(pcPrefix);
+  sFilter.pfApply = pfApply;
+  sFilter.pvExtra = pvExtra;
+  SymTable_map(oSymTable, Filter_apply, &sFilter);
+}
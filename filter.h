@@ -0,0 +1,31 @@
+/*--------------------------------------------------------------------*/
+/* filter.h                                                           */
+/* Author: Ahmed Farah                                                */
+/* Interface for the key filters that the unordered Symbol Table      */
+/* implementations use for SymTable_mapRange and SymTable_mapPrefix   */
+/*--------------------------------------------------------------------*/
+
+/* To prevent double inclusions */
+#ifndef FILTER_INCLUDED
+#define FILTER_INCLUDED
+
+#include "symtable.h"
+
+/* Takes in the same parameters as SymTable_mapRange, and does what it
+does by calling SymTable_map on oSymTable with a function that checks
+every key against pcLow and pcHigh and applies pfApply, with pvExtra,
+to the bindings of the keys that pass. It suits implementations whose
+bindings aren't kept in key order, and so can't do better than check
+them all */
+void Filter_mapRange(SymTable_T oSymTable, const char *pcLow,
+const char *pcHigh,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra);
+
+/* Works as Filter_mapRange, for SymTable_mapPrefix: it applies pfApply
+to the bindings of the keys that start with pcPrefix */
+void Filter_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra);
+
+#endif
@@ -0,0 +1,213 @@
+/*--------------------------------------------------------------------*/
+/* hashfn.c                                                           */
+/* Author: Ahmed Farah                                                */
+/* Implements the hash functions in hashfn.h                          */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+#include "hashfn.h"
+
+/* The odd multipliers and the shift that HashFn_words mixes with. They
+are the ones of the 64-bit MurmurHash2 and of its 32-bit variant. We
+assume that size_t is as wide as unsigned long */
+#if ULONG_MAX > 0xffffffffUL
+#define HASHFN_MULTIPLIER_1 0xc6a4a7935bd1e995UL
+#define HASHFN_MULTIPLIER_2 0x9e3779b97f4a7c15UL
+#define HASHFN_SHIFT 47
+#else
+#define HASHFN_MULTIPLIER_1 0x5bd1e995UL
+#define HASHFN_MULTIPLIER_2 0x9e3779b9UL
+#define HASHFN_SHIFT 24
+#endif
+
+/* The constants of HashFn_sip: the 4 that its state starts out as,
+before the key goes in, and the 6 rotations of a round. A 64-bit size_t
+gets SipHash, and a 32-bit one HalfSipHash, its variant for 32-bit
+words */
+#if ULONG_MAX > 0xffffffffUL
+#define HASHFN_SIP_V0 0x736f6d6570736575UL
+#define HASHFN_SIP_V1 0x646f72616e646f6dUL
+#define HASHFN_SIP_V2 0x6c7967656e657261UL
+#define HASHFN_SIP_V3 0x7465646279746573UL
+#define HASHFN_SIP_R1 13
+#define HASHFN_SIP_R2 32
+#define HASHFN_SIP_R3 16
+#define HASHFN_SIP_R4 21
+#define HASHFN_SIP_R5 17
+#define HASHFN_SIP_R6 32
+#else
+#define HASHFN_SIP_V0 0UL
+#define HASHFN_SIP_V1 0UL
+#define HASHFN_SIP_V2 0x6c796765UL
+#define HASHFN_SIP_V3 0x74656462UL
+#define HASHFN_SIP_R1 5
+#define HASHFN_SIP_R2 16
+#define HASHFN_SIP_R3 8
+#define HASHFN_SIP_R4 7
+#define HASHFN_SIP_R5 13
+#define HASHFN_SIP_R6 16
+#endif
+
+/* Rotates the size_t uWord left by uBits, which must be between 1 and
+the number of bits of a size_t less 1 */
+#define HASHFN_ROTATE(uWord, uBits) (((uWord) << (uBits)) | \
+  ((uWord) >> (sizeof(size_t) * CHAR_BIT - (uBits))))
+
+/* The number of rounds HashFn_sip does per word of the key, and at
+the end: those of SipHash-1-3, the variant that hash tables use */
+enum {HASHFN_SIP_ROUNDS = 1, HASHFN_SIP_FINAL_ROUNDS = 3};
+
+/* implements the HashFn_multiplicative() function */
+size_t HashFn_multiplicative(const char *pcKey, size_t uLength) {
+  const size_t HASH_MULTIPLIER = 65599;
+  size_t u;
+  size_t uHash = 0;
+  assert(pcKey != NULL);
+
+  for (u = 0; u < uLength; u++) {
+    uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+  }
+  return uHash;
+}
+
+/* implements the HashFn_words() function, which is HashFn_seeded
+with a seed of 0 */
+size_t HashFn_words(const char *pcKey, size_t uLength) {
+  assert(pcKey != NULL);
+  return HashFn_seeded(pcKey, uLength, 0);
+}
+
+/* implements the HashFn_seeded() function. The seed only changes the
+state that the words of the key are mixed into */
+size_t HashFn_seeded(const char *pcKey, size_t uLength, size_t uSeed) {
+  size_t uHash;
+  size_t uWord;
+  assert(pcKey != NULL);
+
+  uHash = (uLength ^ uSeed) * (size_t) HASHFN_MULTIPLIER_2;
+
+  /* We read whole words with memcpy, which compilers turn into a single
+  load, since pcKey needn't be aligned */
+  for (; uLength >= sizeof(size_t); uLength -= sizeof(size_t)) {
+    memcpy(&uWord, pcKey, sizeof(size_t));
+    pcKey += sizeof(size_t);
+    uWord *= (size_t) HASHFN_MULTIPLIER_1;
+    uWord ^= uWord >> HASHFN_SHIFT;
+    uWord *= (size_t) HASHFN_MULTIPLIER_1;
+    uHash ^= uWord;
+    uHash *= (size_t) HASHFN_MULTIPLIER_1;
+  }
+
+  /* The last few characters make up a partial word */
+  if (uLength > 0) {
+    uWord = 0;
+    memcpy(&uWord, pcKey, uLength);
+    uHash ^= uWord;
+    uHash *= (size_t) HASHFN_MULTIPLIER_1;
+  }
+
+  /* A final mix, so that the low-order bits that pick a bucket depend
+  on the high-order bits too */
+  uHash ^= uHash >> HASHFN_SHIFT;
+  uHash *= (size_t) HASHFN_MULTIPLIER_2;
+  uHash ^= uHash >> HASHFN_SHIFT;
+  return uHash;
+}
+
+/* implements the HashFn_mix() function, with the final mix of
+HashFn_words applied twice, the seed going in first */
+size_t HashFn_mix(size_t uHash, size_t uSeed) {
+  uHash ^= uSeed * (size_t) HASHFN_MULTIPLIER_2;
+  uHash ^= uHash >> HASHFN_SHIFT;
+  uHash *= (size_t) HASHFN_MULTIPLIER_1;
+  uHash ^= uHash >> HASHFN_SHIFT;
+  uHash *= (size_t) HASHFN_MULTIPLIER_2;
+  uHash ^= uHash >> HASHFN_SHIFT;
+  return uHash;
+}
+
+/* A helper function which takes in the 4 words of the state of
+HashFn_sip that pv points to, and applies one round of SipHash to them.
+It is called by HashFn_sip */
+static void HashFn_sipRound(size_t *pv) {
+  assert(pv != NULL);
+  pv[0] += pv[1];
+  pv[1] = HASHFN_ROTATE(pv[1], HASHFN_SIP_R1);
+  pv[1] ^= pv[0];
+  pv[0] = HASHFN_ROTATE(pv[0], HASHFN_SIP_R2);
+  pv[2] += pv[3];
+  pv[3] = HASHFN_ROTATE(pv[3], HASHFN_SIP_R3);
+  pv[3] ^= pv[2];
+  pv[0] += pv[3];
+  pv[3] = HASHFN_ROTATE(pv[3], HASHFN_SIP_R4);
+  pv[3] ^= pv[0];
+  pv[2] += pv[1];
+  pv[1] = HASHFN_ROTATE(pv[1], HASHFN_SIP_R5);
+  pv[1] ^= pv[2];
+  pv[2] = HASHFN_ROTATE(pv[2], HASHFN_SIP_R6);
+}
+
+/* implements the HashFn_sip() function. The key of SipHash is uSeed
+and its complement. Its words are read with memcpy, as in
+HashFn_seeded, so the codes match those of the reference SipHash on
+little-endian machines only */
+size_t HashFn_sip(const char *pcKey, size_t uLength, size_t uSeed) {
+  size_t av[4];
+  size_t uWord;
+  size_t uLeft;
+  int i;
+  assert(pcKey != NULL);
+
+  av[0] = uSeed ^ (size_t) HASHFN_SIP_V0;
+  av[1] = ~uSeed ^ (size_t) HASHFN_SIP_V1;
+  av[2] = uSeed ^ (size_t) HASHFN_SIP_V2;
+  av[3] = ~uSeed ^ (size_t) HASHFN_SIP_V3;
+
+  for (uLeft = uLength; uLeft >= sizeof(size_t);
+    uLeft -= sizeof(size_t)) {
+    memcpy(&uWord, pcKey, sizeof(size_t));
+    pcKey += sizeof(size_t);
+    av[3] ^= uWord;
+    for (i = 0; i < HASHFN_SIP_ROUNDS; i++) {
+      HashFn_sipRound(av);
+    }
+    av[0] ^= uWord;
+  }
+
+  /* The last word holds the rest of the key, and the length of it all
+  in its top byte */
+  uWord = 0;
+  memcpy(&uWord, pcKey, uLeft);
+  uWord |= uLength << ((sizeof(size_t) - 1) * CHAR_BIT);
+  av[3] ^= uWord;
+  for (i = 0; i < HASHFN_SIP_ROUNDS; i++) {
+    HashFn_sipRound(av);
+  }
+  av[0] ^= uWord;
+
+  av[2] ^= 0xff;
+  for (i = 0; i < HASHFN_SIP_FINAL_ROUNDS; i++) {
+    HashFn_sipRound(av);
+  }
+#if ULONG_MAX > 0xffffffffUL
+  return av[0] ^ av[1] ^ av[2] ^ av[3];
+#else
+  return av[1] ^ av[3];
+#endif
+}
+
+/* implements the HashFn_address() function */
+size_t HashFn_address(const char *pcKey, size_t uLength) {
+  size_t uHash;
+  assert(pcKey != NULL);
+  (void) uLength;
+
+  /* The low-order bits of an address are mostly alignment, so we mix
+  the high-order ones down into them */
+  uHash = (size_t) pcKey;
+  uHash *= (size_t) HASHFN_MULTIPLIER_2;
+  uHash ^= uHash >> HASHFN_SHIFT;
+  return uHash;
+}
@@ -0,0 +1,59 @@
+/*--------------------------------------------------------------------*/
+/* hashfn.h                                                           */
+/* Author: Ahmed Farah                                                */
+/* Interface for the hash functions that the Symbol Table             */
+/* implementations can use. Each one has the SymTable_HashFn          */
+/* signature from symtable.h, so it can be given to                   */
+/* SymTable_newWithHash                                               */
+/*--------------------------------------------------------------------*/
+
+/* To prevent double inclusions */
+#ifndef HASHFN_INCLUDED
+#define HASHFN_INCLUDED
+
+/* allows us to use size_t */
+#include <stdlib.h>
+
+/* The hash function from the assignment specification. Takes in a
+string pcKey of length uLength and returns its hash code as a size_t.
+It reads pcKey one character at a time, multiplying by 65599 at every
+step. It is the default hash of the hash table implementations. */
+size_t HashFn_multiplicative(const char *pcKey, size_t uLength);
+
+/* Takes in a string pcKey of length uLength and returns its hash code
+as a size_t. It reads pcKey a whole size_t at a time and mixes every
+bit of each word into every bit of the result, so it is faster on long
+keys and spreads out keys that only differ in a few characters, such
+as "1", "2", "3"... The result depends on the byte order of the
+machine, so it must not be stored where another machine could read
+it back. */
+size_t HashFn_words(const char *pcKey, size_t uLength);
+
+/* Works as HashFn_words, with a seed uSeed: each seed gives a different
+hash function, and a seed of 0 gives HashFn_words itself. It has 3
+parameters, so it can't be given to SymTable_newWithHash, but a table
+can use it to keep its hash codes from being known in advance. */
+size_t HashFn_seeded(const char *pcKey, size_t uLength, size_t uSeed);
+
+/* Takes in a string pcKey of length uLength and a seed uSeed, and
+returns the SipHash-1-3 code of pcKey under the key that uSeed makes
+(HalfSipHash-1-3 where size_t has 32 bits). It is slower than
+HashFn_seeded, but it is a keyed pseudorandom function: without the
+seed, no one can find keys that collide more often than chance would
+have them, however many they try. */
+size_t HashFn_sip(const char *pcKey, size_t uLength, size_t uSeed);
+
+/* Takes in a hash code uHash and a seed uSeed, and returns another
+hash code, into every bit of which every bit of both is mixed. Each
+seed gives a different function of uHash, so a caller that needs a
+hash without collisions among a given set of codes, such as a perfect
+hash, can try one seed after another without rereading any key. */
+size_t HashFn_mix(size_t uHash, size_t uSeed);
+
+/* Takes in a key pcKey and returns a hash code of its address, not of
+its characters, so uLength is ignored. Only keys that are the same
+pointer get the same code, so it suits tables whose keys are compared
+by address, such as those made with SYMTABLE_INTERNED. */
+size_t HashFn_address(const char *pcKey, size_t uLength);
+
+#endif
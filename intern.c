@@ -0,0 +1,94 @@
+/*--------------------------------------------------------------------*/
+/* intern.c                                                           */
+/* Author: Ahmed Farah                                                */
+/* Implements the Intern pool, compliant with the interface in        */
+/* intern.h                                                           */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <string.h>
+#include "arena.h"
+#include "intern.h"
+#include "symtable.h"
+
+/* An Intern pool is a symbol table, strings, that binds the canonical
+copy of every string to itself, and arena, where those copies live.
+strings borrows its keys from arena, so each string is stored once and
+SymTable_getLen finds the canonical copy of any string equal to it. */
+struct Intern {
+  /* Binds every canonical string to itself */
+  SymTable_T strings;
+  /* Where the canonical strings are allocated */
+  Arena_T arena;
+};
+
+/* The Intern constructor */
+Intern_T Intern_new(void) {
+  Intern_T oIntern;
+  oIntern = (Intern_T) malloc(sizeof(struct Intern));
+  if (oIntern == NULL) {
+    return NULL;
+  }
+  /* The arena never hands out nodes, only key copies */
+  oIntern->arena = Arena_new(0);
+  if (oIntern->arena == NULL) {
+    free(oIntern);
+    return NULL;
+  }
+  oIntern->strings = SymTable_newWithFlags(SYMTABLE_BORROWED);
+  if (oIntern->strings == NULL) {
+    Arena_free(oIntern->arena);
+    free(oIntern);
+    return NULL;
+  }
+  return oIntern;
+}
+
+/* The Intern deconstructor */
+void Intern_free(Intern_T oIntern) {
+  assert(oIntern != NULL);
+
+  /* The table borrows its keys, so they must outlive it */
+  SymTable_free(oIntern->strings);
+  Arena_free(oIntern->arena);
+  free(oIntern);
+}
+
+/* implements the Intern_string() function */
+const char *Intern_string(Intern_T oIntern, const char *pcString) {
+  assert(oIntern != NULL);
+  assert(pcString != NULL);
+  return Intern_stringLen(oIntern, pcString, strlen(pcString));
+}
+
+/* implements the Intern_stringLen() function */
+const char *Intern_stringLen(Intern_T oIntern, const char *pcString,
+size_t uLength) {
+  const char *pcCanonical;
+  char *pcCopy;
+  assert(oIntern != NULL);
+  assert(pcString != NULL);
+
+  pcCanonical = (const char *) SymTable_getLen(oIntern->strings,
+    pcString, uLength);
+  if (pcCanonical != NULL) {
+    return pcCanonical;
+  }
+
+  /* The copy ends in a '\0', as SYMTABLE_BORROWED requires. If the
+  put fails it stays in the arena until the pool is freed */
+  pcCopy = Arena_copyKey(oIntern->arena, pcString, uLength);
+  if (pcCopy == NULL) {
+    return NULL;
+  }
+  if (! SymTable_putLen(oIntern->strings, pcCopy, uLength, pcCopy)) {
+    return NULL;
+  }
+  return pcCopy;
+}
+
+/* implements the Intern_getLength() function */
+size_t Intern_getLength(Intern_T oIntern) {
+  assert(oIntern != NULL);
+  return SymTable_getLength(oIntern->strings);
+}
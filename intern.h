@@ -0,0 +1,47 @@
+/*--------------------------------------------------------------------*/
+/* intern.h                                                           */
+/* Author: Ahmed Farah                                                */
+/* Interface for an Intern pool, which gives every distinct string    */
+/* one canonical copy, so that equal strings can be compared and      */
+/* looked up by address in tables made with SYMTABLE_INTERNED         */
+/*--------------------------------------------------------------------*/
+
+/* To prevent double inclusions */
+#ifndef INTERN_INCLUDED
+#define INTERN_INCLUDED
+
+/* allows us to use size_t */
+#include <stdlib.h>
+
+/* defines an alias for struct Intern * */
+typedef struct Intern * Intern_T;
+
+/* The constructor. It takes in no parameters and returns an empty
+Intern_T, or NULL if it can't allocate memory. Any number of tables
+can share the strings of one pool, but a pool isn't safe to use from
+several threads at once. */
+Intern_T Intern_new(void);
+
+/* The deconstructor. Takes in an Intern_T called oIntern and frees all
+memory associated with it, including every canonical string it ever
+returned, so no table may still hold them. Doesn't return anything */
+void Intern_free(Intern_T oIntern);
+
+/* Takes in an Intern_T called oIntern and a string pcString, and
+returns the canonical copy of pcString: the same pointer for every
+string equal to it, for as long as oIntern lives. The first time it
+sees a string it copies it. It returns NULL if it can't allocate
+memory. */
+const char *Intern_string(Intern_T oIntern, const char *pcString);
+
+/* Works as Intern_string, for the string made of the first uLength
+characters of pcString, which may be followed by anything. pcString
+must have no '\0' among them. */
+const char *Intern_stringLen(Intern_T oIntern, const char *pcString,
+size_t uLength);
+
+/* Takes in an Intern_T called oIntern and returns the number of
+distinct strings it holds as a size_t */
+size_t Intern_getLength(Intern_T oIntern);
+
+#endif
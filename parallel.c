@@ -0,0 +1,143 @@
+/*--------------------------------------------------------------------*/
+/* parallel.c                                                         */
+/* Author: Ahmed Farah                                                */
+/* Implements the worker pool, compliant with the interface in        */
+/* parallel.h                                                         */
+/*--------------------------------------------------------------------*/
+
+/* pthreads are POSIX, not ANSI C */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <pthread.h>
+#include "parallel.h"
+
+/* The fewest units in a chunk, so that taking a chunk, which needs the
+lock of the pool, costs little next to walking it */
+enum {MIN_CHUNK = 256};
+
+/* The number of chunks each worker gets if the units split evenly.
+Having several lets a worker that finishes early take on chunks that a
+slower one would otherwise have been left with */
+enum {CHUNKS_PER_WORKER = 8};
+
+/* A Pool is what every worker of one Parallel_map shares: the table
+and how to walk it, and uNext, the first unit of the next chunk, which
+is the only thing they change, under lock */
+struct Pool {
+  /* Guards uNext */
+  pthread_mutex_t lock;
+  /* The first unit that no worker has taken yet */
+  size_t uNext;
+  /* The number of units of the table */
+  size_t uUnits;
+  /* The number of units in a chunk */
+  size_t uChunk;
+  /* The table being walked */
+  void *pvTable;
+  /* Walks a range of units of pvTable */
+  Parallel_RangeFn pfRange;
+  /* What pfRange applies to every binding */
+  Parallel_ApplyFn pfApply;
+};
+
+/* A Worker is a Pool and the extra that one worker passes to pfApply */
+struct Worker {
+  /* The pool shared by every worker */
+  struct Pool *psPool;
+  /* The pvExtra of the worker */
+  void *pvExtra;
+};
+
+/* The body of a worker. pvWorker is its struct Worker. It takes chunks
+from the pool and walks them until there are none left, and returns
+NULL */
+static void *Parallel_work(void *pvWorker) {
+  struct Worker *psWorker = (struct Worker *) pvWorker;
+  struct Pool *psPool;
+  size_t uStart;
+  size_t uEnd;
+  assert(psWorker != NULL);
+
+  psPool = psWorker->psPool;
+  for (;;) {
+    pthread_mutex_lock(&psPool->lock);
+    uStart = psPool->uNext;
+    uEnd = (psPool->uUnits - uStart > psPool->uChunk) ?
+      uStart + psPool->uChunk : psPool->uUnits;
+    psPool->uNext = uEnd;
+    pthread_mutex_unlock(&psPool->lock);
+    if (uStart == uEnd) {
+      return NULL;
+    }
+    psPool->pfRange(psPool->pvTable, uStart, uEnd, psPool->pfApply,
+      psWorker->pvExtra);
+  }
+}
+
+/* implements the Parallel_map() function */
+void Parallel_map(void *pvTable, size_t uUnits,
+Parallel_RangeFn pfRange, Parallel_ApplyFn pfApply,
+void * const *ppvExtras, size_t uThreads) {
+  struct Pool sPool;
+  struct Worker *psWorkers;
+  pthread_t *pThreads;
+  size_t uStarted;
+  size_t u;
+  assert(pvTable != NULL);
+  assert(pfRange != NULL);
+  assert(uThreads > 0);
+
+  sPool.uNext = 0;
+  sPool.uUnits = uUnits;
+  sPool.uChunk = uUnits / uThreads / CHUNKS_PER_WORKER;
+  if (sPool.uChunk < MIN_CHUNK) {
+    sPool.uChunk = MIN_CHUNK;
+  }
+  sPool.pvTable = pvTable;
+  sPool.pfRange = pfRange;
+  sPool.pfApply = pfApply;
+
+  /* There is no point in more workers than chunks */
+  if (uThreads > (uUnits + sPool.uChunk - 1) / sPool.uChunk) {
+    uThreads = (uUnits + sPool.uChunk - 1) / sPool.uChunk;
+  }
+  if (uThreads <= 1) {
+    pfRange(pvTable, 0, uUnits, pfApply,
+      ppvExtras == NULL ? NULL : ppvExtras[0]);
+    return;
+  }
+
+  /* If there is no memory for the workers, the calling thread does it
+  all by itself */
+  psWorkers =
+    (struct Worker *) malloc(uThreads * sizeof(struct Worker));
+  pThreads = (pthread_t *) malloc(uThreads * sizeof(pthread_t));
+  if (psWorkers == NULL || pThreads == NULL) {
+    free(psWorkers);
+    free(pThreads);
+    pfRange(pvTable, 0, uUnits, pfApply,
+      ppvExtras == NULL ? NULL : ppvExtras[0]);
+    return;
+  }
+  pthread_mutex_init(&sPool.lock, NULL);
+  for (u = 0; u < uThreads; u++) {
+    psWorkers[u].psPool = &sPool;
+    psWorkers[u].pvExtra = (ppvExtras == NULL) ? NULL : ppvExtras[u];
+  }
+
+  /* Worker 0 is the calling thread, which starts the others first */
+  for (uStarted = 1; uStarted < uThreads; uStarted++) {
+    if (pthread_create(&pThreads[uStarted], NULL, Parallel_work,
+      &psWorkers[uStarted]) != 0) {
+      break;
+    }
+  }
+  Parallel_work(&psWorkers[0]);
+  for (u = 1; u < uStarted; u++) {
+    pthread_join(pThreads[u], NULL);
+  }
+  pthread_mutex_destroy(&sPool.lock);
+  free(pThreads);
+  free(psWorkers);
+}
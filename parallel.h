@@ -0,0 +1,43 @@
+/*--------------------------------------------------------------------*/
+/* parallel.h                                                         */
+/* Author: Ahmed Farah                                                */
+/* Interface for the worker pool that the Symbol Table                */
+/* implementations use to spread SymTable_mapParallel over threads    */
+/*--------------------------------------------------------------------*/
+
+/* To prevent double inclusions */
+#ifndef PARALLEL_INCLUDED
+#define PARALLEL_INCLUDED
+
+/* allows us to use size_t */
+#include <stdlib.h>
+
+/* The signature of the pfApply that SymTable_map and
+SymTable_mapParallel take */
+typedef void (*Parallel_ApplyFn)(const char *pcKey, void *pvValue,
+void *pvExtra);
+
+/* The signature of the function that a symbol table gives Parallel_map
+to walk part of itself. It takes in the table as pvTable, and applies
+pfApply, with pvExtra, to every binding held in the units from uStart
+up to but not including uEnd, whatever a unit (a bucket, a slot...) is
+to that table */
+typedef void (*Parallel_RangeFn)(void *pvTable, size_t uStart,
+size_t uEnd, Parallel_ApplyFn pfApply, void *pvExtra);
+
+/* Takes in a table pvTable of uUnits units, the function pfRange that
+walks a range of them, pfApply, which is only passed on to pfRange and
+may be NULL if pfRange has no use for it, ppvExtras, which is NULL or
+an array of uThreads pointers, and uThreads, which must be positive. It
+splits the units into chunks, and runs up to uThreads workers, the
+calling thread being one of them, that each take the next chunk nobody
+has taken yet and walk it with pfRange, until there are none left. The
+i-th worker passes ppvExtras[i] (or NULL) to pfApply, so a worker that
+keeps to its own extra shares nothing with the others. A worker that
+can't be started just leaves its chunks to the others. It returns once
+every unit has been walked exactly once */
+void Parallel_map(void *pvTable, size_t uUnits,
+Parallel_RangeFn pfRange, Parallel_ApplyFn pfApply,
+void * const *ppvExtras, size_t uThreads);
+
+#endif
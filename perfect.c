@@ -0,0 +1,225 @@
+/*--------------------------------------------------------------------*/
+/* perfect.c                                                          */
+/* Author: Ahmed Farah                                                */
+/* Implements the minimal perfect hash, compliant with the interface  */
+/* in perfect.h                                                       */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <limits.h>
+#include "hashfn.h"
+#include "perfect.h"
+
+/* The most seeds Perfect_build tries for the keys of one bucket before
+it gives up, which it only does when two keys have the same hash code,
+so that no seed can separate them, and the number of keys per bucket
+that the first level aims for */
+enum {PERFECT_MAX_SEED = 1 << 16, PERFECT_BUCKET_SIZE = 4};
+
+/* A helper function which takes in a hash code uHash and a number
+uRange, and returns a number less than uRange that the high-order bits
+of uHash pick: the upper half of uHash times uRange, shifted down by
+half the bits of a size_t. It takes a multiply where % takes a divide,
+but it needs uRange to fit in half a size_t, so where size_t only has
+32 bits it uses % instead. It is called by Perfect_build and
+Perfect_slot */
+static size_t Perfect_reduce(size_t uHash, size_t uRange) {
+#if ULONG_MAX > 0xffffffffUL
+  return ((uHash >> 32) * uRange) >> 32;
+#else
+  return uHash % uRange;
+#endif
+}
+
+/* implements the Perfect_bucketCount() function */
+size_t Perfect_bucketCount(size_t uCount) {
+  size_t uBucketCount = 1;
+  if (uCount > UINT_MAX / 2) {
+    return 0;
+  }
+  while (uBucketCount <= uCount / PERFECT_BUCKET_SIZE) {
+    uBucketCount *= 2;
+  }
+  return uBucketCount;
+}
+
+/* A helper function which takes in the hash codes puHashes of uCount
+keys, puOrder, which holds the indices in puHashes of the uSize codes
+of one bucket, and pucTaken, which flags the slots that are taken
+already, and looks for a seed that sends those codes to free slots that
+differ. It returns the seed, and stores the slot of each code in
+puBucketSlots, or returns 0 if no seed up to PERFECT_MAX_SEED does.
+It is called by Perfect_build */
+static size_t Perfect_seedBucket(const size_t *puHashes,
+const size_t *puOrder, size_t uSize, size_t uCount,
+const unsigned char *pucTaken, size_t *puBucketSlots) {
+  size_t uSeed;
+  size_t v;
+  size_t w;
+  assert(puHashes != NULL);
+  assert(puOrder != NULL);
+  assert(pucTaken != NULL);
+  assert(puBucketSlots != NULL);
+
+  for (uSeed = 1; uSeed <= PERFECT_MAX_SEED; uSeed++) {
+    for (v = 0; v < uSize; v++) {
+      puBucketSlots[v] = Perfect_reduce(HashFn_mix(puHashes[puOrder[v]],
+        uSeed), uCount);
+      if (pucTaken[puBucketSlots[v]]) {
+        break;
+      }
+      for (w = 0; w < v && puBucketSlots[w] != puBucketSlots[v]; w++) {
+      }
+      if (w < v) {
+        break;
+      }
+    }
+    if (v == uSize) {
+      return uSeed;
+    }
+  }
+  return 0;
+}
+
+/* implements the Perfect_build() function. The first level of the
+hash splits the codes into the buckets by their high-order bits; the
+buckets are then placed largest first, each with the first seed that
+sends all its codes to free slots, and the buckets of one code go
+straight to the slots that are left */
+int Perfect_build(const size_t *puHashes, size_t uCount,
+size_t uBucketCount, unsigned int *Displacements, size_t *puSlots) {
+  size_t *puStarts;
+  size_t *puOrder;
+  size_t *puBuckets;
+  size_t *puSizeStarts;
+  size_t *puBucketSlots;
+  unsigned char *pucTaken;
+  size_t uMaxSize = 0;
+  size_t uBucket;
+  size_t uSize;
+  size_t uSeed;
+  size_t uFree = 0;
+  size_t u;
+  size_t v;
+  int iSuccessful = 1;
+  assert(puHashes != NULL || uCount == 0);
+  assert(Displacements != NULL);
+  assert(puSlots != NULL || uCount == 0);
+  assert(uBucketCount > 0);
+  assert((uBucketCount & (uBucketCount - 1)) == 0);
+
+  if (uCount == 0) {
+    return 1;
+  }
+  if (uCount > UINT_MAX / 2) {
+    return 0;
+  }
+
+  /* Every code is counted in the bucket after its own, so that the
+  counts sum up into the start of each bucket */
+  puStarts = (size_t *) calloc(uBucketCount + 1, sizeof(size_t));
+  if (puStarts == NULL) {
+    return 0;
+  }
+  for (u = 0; u < uCount; u++) {
+    uBucket = Perfect_reduce(puHashes[u], uBucketCount);
+    puStarts[uBucket + 1]++;
+    if (puStarts[uBucket + 1] > uMaxSize) {
+      uMaxSize = puStarts[uBucket + 1];
+    }
+  }
+
+  puOrder = (size_t *) malloc(uCount * sizeof(size_t));
+  puBuckets = (size_t *) malloc(uBucketCount * sizeof(size_t));
+  puSizeStarts = (size_t *) calloc(uMaxSize + 2, sizeof(size_t));
+  puBucketSlots = (size_t *) malloc(uMaxSize * sizeof(size_t));
+  pucTaken = (unsigned char *) calloc(uCount, 1);
+  if (puOrder == NULL || puBuckets == NULL || puSizeStarts == NULL ||
+    puBucketSlots == NULL || pucTaken == NULL) {
+    free(puStarts);
+    free(puOrder);
+    free(puBuckets);
+    free(puSizeStarts);
+    free(puBucketSlots);
+    free(pucTaken);
+    return 0;
+  }
+
+  /* The buckets, sorted by size with a counting sort, largest first */
+  for (u = 0; u < uBucketCount; u++) {
+    puSizeStarts[uMaxSize - puStarts[u + 1] + 1]++;
+  }
+  for (u = 0; u <= uMaxSize; u++) {
+    puSizeStarts[u + 1] += puSizeStarts[u];
+  }
+  for (u = 0; u < uBucketCount; u++) {
+    puBuckets[puSizeStarts[uMaxSize - puStarts[u + 1]]++] = u;
+  }
+
+  /* The codes, sorted by bucket in the same way. Each start moves to
+  the end of its bucket on the way, so they are moved back after */
+  for (u = 0; u < uBucketCount; u++) {
+    puStarts[u + 1] += puStarts[u];
+  }
+  for (u = 0; u < uCount; u++) {
+    uBucket = Perfect_reduce(puHashes[u], uBucketCount);
+    puOrder[puStarts[uBucket]++] = u;
+  }
+  for (u = uBucketCount; u > 0; u--) {
+    puStarts[u] = puStarts[u - 1];
+  }
+  puStarts[0] = 0;
+
+  for (u = 0; u < uBucketCount; u++) {
+    uBucket = puBuckets[u];
+    uSize = puStarts[uBucket + 1] - puStarts[uBucket];
+    if (uSize == 0) {
+      break;
+    }
+
+    /* A bucket of one code takes the next free slot */
+    if (uSize == 1) {
+      while (pucTaken[uFree]) {
+        uFree++;
+      }
+      Displacements[uBucket] = (unsigned int) ((uFree << 1) | 1);
+      puBucketSlots[0] = uFree;
+    }
+    else {
+      uSeed = Perfect_seedBucket(puHashes, &puOrder[puStarts[uBucket]],
+        uSize, uCount, pucTaken, puBucketSlots);
+      if (uSeed == 0) {
+        iSuccessful = 0;
+        break;
+      }
+      Displacements[uBucket] = (unsigned int) (uSeed << 1);
+    }
+
+    for (v = 0; v < uSize; v++) {
+      pucTaken[puBucketSlots[v]] = 1;
+      puSlots[puOrder[puStarts[uBucket] + v]] = puBucketSlots[v];
+    }
+  }
+
+  free(puStarts);
+  free(puOrder);
+  free(puBuckets);
+  free(puSizeStarts);
+  free(puBucketSlots);
+  free(pucTaken);
+  return iSuccessful;
+}
+
+/* implements the Perfect_slot() function */
+size_t Perfect_slot(size_t uHash, const unsigned int *Displacements,
+size_t uBucketCount, size_t uCount) {
+  unsigned int uDisplacement;
+  assert(Displacements != NULL);
+  assert(uCount > 0);
+
+  uDisplacement = Displacements[Perfect_reduce(uHash, uBucketCount)];
+  if (uDisplacement & 1) {
+    return (size_t) (uDisplacement >> 1);
+  }
+  return Perfect_reduce(HashFn_mix(uHash, uDisplacement >> 1), uCount);
+}
@@ -0,0 +1,47 @@
+/*--------------------------------------------------------------------*/
+/* perfect.h                                                          */
+/* Author: Ahmed Farah                                                */
+/* Interface for the minimal perfect hash that frozen symbol tables   */
+/* and Snapshot images are laid out by                                */
+/*--------------------------------------------------------------------*/
+
+/* To prevent double inclusions */
+#ifndef PERFECT_INCLUDED
+#define PERFECT_INCLUDED
+
+/* allows us to use size_t */
+#include <stdlib.h>
+
+/* Takes in uCount, a number of keys, and returns the number of buckets
+that the first level of their perfect hash should have: a power of 2,
+about one for every few keys. It returns 0 if there are too many keys
+for a perfect hash, whose slots must fit in an unsigned int shifted
+left by 1 */
+size_t Perfect_bucketCount(size_t uCount);
+
+/* Takes in the hash codes of uCount keys, puHashes, which must all
+differ and have every bit of their keys mixed into their high-order
+bits, and uBucketCount, which Perfect_bucketCount gave for uCount. It
+builds a minimal perfect hash of them, which sends every code to its
+own slot from 0 to uCount - 1. It stores the slot of puHashes[u] in
+puSlots[u], and fills Displacements, an array of uBucketCount unsigned
+ints that must all be 0 to start with: an odd one is the slot of the
+only key of its bucket, shifted left by 1, and an even one the seed,
+shifted the same way, that spreads the keys of its bucket over free
+slots. It returns 1 if it succeeds, and 0 if it can't allocate memory
+or can't separate some keys, which only happens when their codes are
+the same */
+int Perfect_build(const size_t *puHashes, size_t uCount,
+size_t uBucketCount, unsigned int *Displacements, size_t *puSlots);
+
+/* Takes in a hash code uHash, and the Displacements, uBucketCount and
+uCount, which must be positive, of a perfect hash that Perfect_build
+made, and returns the slot of uHash. If uHash is one of the codes the
+hash was built from, that is its slot; if not, it is the only slot
+where uHash could be. The slot is less than uCount unless Displacements
+were changed after they were built. It reads one element of
+Displacements, and mixes uHash at most once */
+size_t Perfect_slot(size_t uHash, const unsigned int *Displacements,
+size_t uBucketCount, size_t uCount);
+
+#endif
@@ -0,0 +1,212 @@
+/*--------------------------------------------------------------------*/
+/* scope.c                                                            */
+/* Author: Ahmed Farah                                                */
+/* Implements the Scope table, compliant with the interface in        */
+/* scope.h                                                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <string.h>
+#include "arena.h"
+#include "scope.h"
+#include "symtable.h"
+
+/* A Record is one binding of a Scope table, made at depth. psShadowed
+is the binding of the same key in an outer scope that it hides, or
+NULL, and psPrevious is the binding made just before it, in any scope,
+so that the Records of a table form its undo log, newest first. All
+the Records of a key share one copy of it, which the outermost one
+owns. The outermost one also keeps psInnermost, the Record of its key
+that is visible, which may be itself. */
+struct Record {
+  /* The key of the binding */
+  const char *Key;
+  /* The value of the binding */
+  const void *Value;
+  /* The depth of the scope the binding was made in */
+  size_t depth;
+  /* The binding of Key that this one shadows, or NULL */
+  struct Record *psShadowed;
+  /* The binding made before this one, or NULL */
+  struct Record *psPrevious;
+  /* The visible binding of Key, if this is the outermost one */
+  struct Record *psInnermost;
+};
+
+/* A Scope table is a symbol table, index, that binds every visible
+key to its outermost Record, which stays put while inner scopes shadow
+it, so that a declaration is a single SymTable_putOrGet and a lookup a
+single SymTable_get whatever the nesting. psLog is the newest Record, and the Records of
+the current scope are the ones at the front of the log whose depth is
+depth; exiting it pops just those. index borrows its keys from the
+Records, whose nodes come from arena, so that popped ones are reused
+rather than freed one by one. */
+struct Scope {
+  /* Binds every visible key to its innermost Record */
+  SymTable_T index;
+  /* Where the Records are allocated */
+  Arena_T arena;
+  /* The newest Record, or NULL */
+  struct Record *psLog;
+  /* The depth of the current scope */
+  size_t depth;
+};
+
+/* The Scope constructor */
+Scope_T Scope_new(void) {
+  Scope_T oScope;
+  oScope = (Scope_T) malloc(sizeof(struct Scope));
+  if (oScope == NULL) {
+    return NULL;
+  }
+  oScope->arena = Arena_new(sizeof(struct Record));
+  if (oScope->arena == NULL) {
+    free(oScope);
+    return NULL;
+  }
+  oScope->index = SymTable_newWithFlags(SYMTABLE_BORROWED);
+  if (oScope->index == NULL) {
+    Arena_free(oScope->arena);
+    free(oScope);
+    return NULL;
+  }
+  oScope->psLog = NULL;
+  oScope->depth = 0;
+  return oScope;
+}
+
+/* The Scope deconstructor */
+void Scope_free(Scope_T oScope) {
+  struct Record *psRecord;
+  assert(oScope != NULL);
+
+  /* The index borrows the key copies, so it goes before them */
+  SymTable_free(oScope->index);
+  for (psRecord = oScope->psLog; psRecord != NULL;
+    psRecord = psRecord->psPrevious) {
+    if (psRecord->psShadowed == NULL) {
+      free((void *) psRecord->Key);
+    }
+  }
+  Arena_free(oScope->arena);
+  free(oScope);
+}
+
+/* implements the Scope_enter() function */
+void Scope_enter(Scope_T oScope) {
+  assert(oScope != NULL);
+  oScope->depth++;
+}
+
+/* implements the Scope_exit() function. Each popped Record either
+makes the one it shadowed visible again or, if it was the only one,
+takes the key out of the index and frees it */
+void Scope_exit(Scope_T oScope) {
+  struct Record *psRecord;
+  struct Record *psOutermost;
+  assert(oScope != NULL);
+  assert(oScope->depth > 0);
+
+  while (oScope->psLog != NULL &&
+    oScope->psLog->depth == oScope->depth) {
+    psRecord = oScope->psLog;
+    oScope->psLog = psRecord->psPrevious;
+    if (psRecord->psShadowed != NULL) {
+      psOutermost = (struct Record *) SymTable_get(oScope->index,
+        psRecord->Key);
+      assert(psOutermost != NULL);
+      psOutermost->psInnermost = psRecord->psShadowed;
+    }
+    else {
+      (void) SymTable_remove(oScope->index, psRecord->Key);
+      free((void *) psRecord->Key);
+    }
+    Arena_freeNode(oScope->arena, psRecord);
+  }
+  oScope->depth--;
+}
+
+/* implements the Scope_getDepth() function */
+size_t Scope_getDepth(Scope_T oScope) {
+  assert(oScope != NULL);
+  return oScope->depth;
+}
+
+/* implements the Scope_put() function. The index borrows its keys, so
+the key is copied before the one lookup that tells whether it is new;
+the copy is only kept if it is */
+int Scope_put(Scope_T oScope, const char *pcKey, const void *pvValue) {
+  struct Record *psOutermost;
+  struct Record *psRecord;
+  char *pcCopy;
+  size_t uLength;
+  void *pvOutermost;
+  int iStatus;
+  assert(oScope != NULL);
+  assert(pcKey != NULL);
+
+  psRecord = (struct Record *) Arena_allocNode(oScope->arena);
+  if (psRecord == NULL) {
+    return 0;
+  }
+  uLength = strlen(pcKey);
+  pcCopy = (char *) malloc(uLength + 1);
+  if (pcCopy == NULL) {
+    Arena_freeNode(oScope->arena, psRecord);
+    return 0;
+  }
+  memcpy(pcCopy, pcKey, uLength + 1);
+  psRecord->Key = pcCopy;
+  psRecord->Value = pvValue;
+  psRecord->depth = oScope->depth;
+  psRecord->psShadowed = NULL;
+  psRecord->psInnermost = psRecord;
+
+  iStatus = SymTable_putOrGet(oScope->index, pcCopy, psRecord,
+    &pvOutermost);
+  if (iStatus != 1) {
+    free(pcCopy);
+  }
+  if (iStatus < 0) {
+    Arena_freeNode(oScope->arena, psRecord);
+    return 0;
+  }
+
+  /* A shadowing binding shares the key of the one it hides, and only
+  has to become the visible one of the key's outermost Record */
+  if (iStatus == 0) {
+    psOutermost = (struct Record *) pvOutermost;
+    if (psOutermost->psInnermost->depth == oScope->depth) {
+      Arena_freeNode(oScope->arena, psRecord);
+      return 0;
+    }
+    psRecord->Key = psOutermost->Key;
+    psRecord->psShadowed = psOutermost->psInnermost;
+    psOutermost->psInnermost = psRecord;
+  }
+
+  psRecord->psPrevious = oScope->psLog;
+  oScope->psLog = psRecord;
+  return 1;
+}
+
+/* implements the Scope_contains() function */
+int Scope_contains(Scope_T oScope, const char *pcKey) {
+  assert(oScope != NULL);
+  assert(pcKey != NULL);
+  return SymTable_contains(oScope->index, pcKey);
+}
+
+/* implements the Scope_get() function */
+void *Scope_get(Scope_T oScope, const char *pcKey) {
+  struct Record *psRecord;
+  assert(oScope != NULL);
+  assert(pcKey != NULL);
+
+  psRecord = (struct Record *) SymTable_get(oScope->index, pcKey);
+  if (psRecord == NULL) {
+    return NULL;
+  }
+  /* Here we have to "cast away the constness" */
+  return (void *) psRecord->psInnermost->Value;
+}
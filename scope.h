@@ -0,0 +1,60 @@
+/*--------------------------------------------------------------------*/
+/* scope.h                                                            */
+/* Author: Ahmed Farah                                                */
+/* Interface for a Scope table, a symbol table with nested lexical    */
+/* scopes, in which a binding shadows the bindings of the same key in */
+/* outer scopes until its own scope is exited                         */
+/*--------------------------------------------------------------------*/
+
+/* To prevent double inclusions */
+#ifndef SCOPE_INCLUDED
+#define SCOPE_INCLUDED
+
+/* allows us to use size_t */
+#include <stdlib.h>
+
+/* defines an alias for struct Scope * */
+typedef struct Scope * Scope_T;
+
+/* The constructor. It takes in no parameters and returns an empty
+Scope_T, or NULL if it can't allocate memory. The new table is in its
+outermost scope, at depth 0, which can't be exited. */
+Scope_T Scope_new(void);
+
+/* The deconstructor. Takes in a Scope_T called oScope and frees all
+memory associated with it, whatever scope it is in. Doesn't return
+anything */
+void Scope_free(Scope_T oScope);
+
+/* Takes in a Scope_T called oScope and enters a new scope inside the
+current one, one deeper. It allocates nothing and returns nothing */
+void Scope_enter(Scope_T oScope);
+
+/* Takes in a Scope_T called oScope, which must not be in its
+outermost scope, and exits the current scope: its bindings are removed,
+and the outer bindings they shadowed are visible again. It returns
+nothing. Its cost is proportional to the number of bindings made in
+the scope, whatever the size of the table */
+void Scope_exit(Scope_T oScope);
+
+/* Takes in a Scope_T called oScope and returns the depth of its
+current scope as a size_t, 0 for the outermost one */
+size_t Scope_getDepth(Scope_T oScope);
+
+/* Takes in a Scope_T called oScope, a key pcKey and a value pvValue,
+and binds pcKey to pvValue in the current scope, shadowing any binding
+of pcKey in an outer one. It returns 1 if it succeeds, and 0 if pcKey
+is already bound in the current scope or it can't allocate memory. The
+key is copied, as SymTable_put does. */
+int Scope_put(Scope_T oScope, const char *pcKey, const void *pvValue);
+
+/* Takes in a Scope_T called oScope and a key pcKey, and returns 1 if
+pcKey is bound in the current scope or one around it, and 0 otherwise */
+int Scope_contains(Scope_T oScope, const char *pcKey);
+
+/* Takes in a Scope_T called oScope and a key pcKey, and returns the
+value of the innermost binding of pcKey, or NULL if there is none. It
+looks the key up once, however deep the scopes are nested */
+void *Scope_get(Scope_T oScope, const char *pcKey);
+
+#endif
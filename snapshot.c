@@ -0,0 +1,477 @@
+/*--------------------------------------------------------------------*/
+/* snapshot.c                                                         */
+/* Author: Ahmed Farah                                                */
+/* Implements the Snapshot, compliant with the interface in           */
+/* snapshot.h                                                         */
+/*--------------------------------------------------------------------*/
+
+/* open, fstat and mmap are POSIX, not ANSI C */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "hashfn.h"
+#include "perfect.h"
+#include "snapshot.h"
+
+/* What every image starts with, which tells it from any other file */
+static const char acMagic[8] = {'S', 'Y', 'M', 'S', 'N', 'A', 'P', '2'};
+
+/* A value that reads the same only on a machine of the same byte order
+as the one that wrote it */
+enum {BYTE_ORDER_MARK = 0x01020304};
+
+/* The most seeds Snapshot_save tries before it gives up on building a
+perfect hash of the keys. Another seed is only needed if two keys have
+the same hash code under the first one */
+enum {SNAPSHOT_MAX_SEEDS = 8};
+
+/* An image is laid out as SymTable_freeze lays out a frozen table: a
+Header, then the bucketCount Displacements of the minimal perfect hash
+that perfect.h builds, padded to a multiple of the size of a size_t,
+then count Entries, each in the slot that the hash gives its key, then
+the keys, each followed by a '\0'. The keys are hashed with
+HashFn_seeded under uSeed, so a lookup reads one displacement and one
+entry, and compares one key. Everything is found by its offset from the
+start of the file, so the image works wherever it is mapped. */
+struct Header {
+  /* acMagic */
+  char acMagic[8];
+  /* BYTE_ORDER_MARK, as written */
+  size_t uByteOrder;
+  /* The size of a size_t, in bytes */
+  size_t uWordSize;
+  /* The size of the whole file, in bytes */
+  size_t uFileSize;
+  /* The number of bindings */
+  size_t count;
+  /* The number of buckets of the first level of the hash, a power of
+  two */
+  size_t bucketCount;
+  /* The seed the keys are hashed under */
+  size_t uSeed;
+};
+
+/* An Entry is one binding of an image */
+struct Entry {
+  /* The hash of the key */
+  size_t uHash;
+  /* The offset of the key from the start of the file */
+  size_t uKeyOffset;
+  /* The length of the key */
+  size_t uKeyLength;
+  /* The value that Snapshot_save stored */
+  size_t uValue;
+};
+
+/* A Snapshot is a mapped image: pcBase, the start of the mapping,
+which is uSize bytes long, and the arrays in it */
+struct Snapshot {
+  /* The start of the mapped file */
+  const char *pcBase;
+  /* The size of the mapped file, in bytes */
+  size_t uSize;
+  /* The header at pcBase */
+  const struct Header *psHeader;
+  /* The displacements, which follow the header */
+  const unsigned int *Displacements;
+  /* The entries, which follow the displacements */
+  const struct Entry *Entries;
+};
+
+/* A Gather is what Snapshot_save passes to SymTable_map as its extra,
+to collect the bindings of a table into Entries, with the keys they
+point to in ppcKeys */
+struct Gather {
+  /* The entries collected so far */
+  struct Entry *Entries;
+  /* The key of each entry */
+  const char **ppcKeys;
+  /* The number of entries collected so far */
+  size_t count;
+  /* The offset the next key will be written at */
+  size_t uKeyOffset;
+  /* Turns values into what the image stores, or NULL */
+  size_t (*pfEncode)(const char *pcKey, void *pvValue, void *pvExtra);
+  /* The extra parameter of pfEncode */
+  const void *pvExtra;
+};
+
+/* A helper function which returns the number of bytes that the
+displacements of uBucketCount buckets take up in an image, padding
+included. It is called by Snapshot_save, Snapshot_isValid and
+Snapshot_open */
+static size_t Snapshot_displacementSize(size_t uBucketCount) {
+  size_t uBytes = uBucketCount * sizeof(unsigned int);
+  return (uBytes + sizeof(size_t) - 1) / sizeof(size_t) *
+    sizeof(size_t);
+}
+
+/* A helper function which adds the binding of pcKey and pvValue to the
+Gather that pvExtra points to. The hash code of the entry is left for
+Snapshot_hash, which knows the seed. It is called by SymTable_map for
+Snapshot_save */
+static void Snapshot_gather(const char *pcKey, void *pvValue,
+void *pvExtra) {
+  struct Gather *psGather = (struct Gather *) pvExtra;
+  struct Entry *psEntry;
+  assert(pcKey != NULL);
+  assert(psGather != NULL);
+
+  psEntry = &psGather->Entries[psGather->count];
+  psEntry->uKeyLength = strlen(pcKey);
+  psEntry->uKeyOffset = psGather->uKeyOffset;
+  if (psGather->pfEncode != NULL) {
+    psEntry->uValue = psGather->pfEncode(pcKey, pvValue,
+      (void *) psGather->pvExtra);
+  }
+  else {
+    psEntry->uValue = (size_t) pvValue;
+  }
+  psGather->ppcKeys[psGather->count] = pcKey;
+  psGather->count++;
+  psGather->uKeyOffset += psEntry->uKeyLength + 1;
+}
+
+/* A helper function which builds the perfect hash of the uCount
+entries of psGather, into Displacements, an array of uBucketCount
+unsigned ints, and puSlots, the slot of each entry, and sets the uHash
+of every entry. It tries one seed after another until the keys have
+different hash codes, and returns the seed, or SNAPSHOT_MAX_SEEDS if
+it can't allocate memory or no seed separates the keys. It is called
+by Snapshot_save */
+static size_t Snapshot_hash(const struct Gather *psGather,
+size_t uBucketCount, unsigned int *Displacements, size_t *puSlots) {
+  size_t *puHashes;
+  size_t uCount = psGather->count;
+  size_t uSeed;
+  size_t u;
+  assert(psGather != NULL);
+  assert(Displacements != NULL);
+  assert(puSlots != NULL);
+
+  puHashes = (size_t *) malloc((uCount + 1) * sizeof(size_t));
+  if (puHashes == NULL) {
+    return SNAPSHOT_MAX_SEEDS;
+  }
+  for (uSeed = 0; uSeed < SNAPSHOT_MAX_SEEDS; uSeed++) {
+    for (u = 0; u < uCount; u++) {
+      puHashes[u] = HashFn_seeded(psGather->ppcKeys[u],
+        psGather->Entries[u].uKeyLength, uSeed);
+    }
+    memset(Displacements, 0, uBucketCount * sizeof(unsigned int));
+    if (Perfect_build(puHashes, uCount, uBucketCount, Displacements,
+      puSlots)) {
+      break;
+    }
+  }
+  for (u = 0; uSeed < SNAPSHOT_MAX_SEEDS && u < uCount; u++) {
+    psGather->Entries[u].uHash = puHashes[u];
+  }
+  free(puHashes);
+  return uSeed;
+}
+
+/* A helper function which writes the image of the uCount entries of
+psGather, whose keys are in its ppcKeys, to psFile, with the
+uBucketCount displacements of their perfect hash and each entry in its
+slot. It returns 1 if it succeeds, and 0 if it can't allocate memory,
+build the hash or write psFile. It is called by Snapshot_save */
+static int Snapshot_write(FILE *psFile, const struct Gather *psGather,
+size_t uBucketCount) {
+  struct Header sHeader;
+  unsigned int *Displacements;
+  size_t *puSlots;
+  size_t *puOrder;
+  size_t uCount = psGather->count;
+  size_t uDisplacementSize;
+  size_t uSeed;
+  size_t u;
+  int iSuccessful = 1;
+  assert(psFile != NULL);
+  assert(psGather != NULL);
+
+  /* The displacements are padded with 0s, so they are allocated with
+  their padding */
+  uDisplacementSize = Snapshot_displacementSize(uBucketCount);
+  Displacements = (unsigned int *) calloc(uDisplacementSize, 1);
+  puSlots = (size_t *) malloc((uCount + 1) * sizeof(size_t));
+  puOrder = (size_t *) malloc((uCount + 1) * sizeof(size_t));
+  if (Displacements == NULL || puSlots == NULL || puOrder == NULL) {
+    iSuccessful = 0;
+  }
+  if (iSuccessful) {
+    uSeed = Snapshot_hash(psGather, uBucketCount, Displacements,
+      puSlots);
+    if (uSeed == SNAPSHOT_MAX_SEEDS) {
+      iSuccessful = 0;
+    }
+  }
+  /* puOrder[s] is the entry whose slot is s */
+  for (u = 0; iSuccessful && u < uCount; u++) {
+    puOrder[puSlots[u]] = u;
+  }
+
+  if (iSuccessful) {
+    memset(&sHeader, 0, sizeof(sHeader));
+    memcpy(sHeader.acMagic, acMagic, sizeof(acMagic));
+    sHeader.uByteOrder = BYTE_ORDER_MARK;
+    sHeader.uWordSize = sizeof(size_t);
+    sHeader.uFileSize = psGather->uKeyOffset;
+    sHeader.count = uCount;
+    sHeader.bucketCount = uBucketCount;
+    sHeader.uSeed = uSeed;
+    if (fwrite(&sHeader, sizeof(sHeader), 1, psFile) != 1 ||
+      fwrite(Displacements, 1, uDisplacementSize, psFile) !=
+      uDisplacementSize) {
+      iSuccessful = 0;
+    }
+  }
+  for (u = 0; iSuccessful && u < uCount; u++) {
+    if (fwrite(&psGather->Entries[puOrder[u]], sizeof(struct Entry), 1,
+      psFile) != 1) {
+      iSuccessful = 0;
+    }
+  }
+  /* The keys go in the order they were gathered, which is the order of
+  their offsets */
+  for (u = 0; iSuccessful && u < uCount; u++) {
+    if (fwrite(psGather->ppcKeys[u], 1,
+      psGather->Entries[u].uKeyLength + 1, psFile) !=
+      psGather->Entries[u].uKeyLength + 1) {
+      iSuccessful = 0;
+    }
+  }
+
+  free(Displacements);
+  free(puSlots);
+  free(puOrder);
+  return iSuccessful;
+}
+
+/* implements the Snapshot_save() function */
+int Snapshot_save(SymTable_T oSymTable, const char *pcPath,
+size_t (*pfEncode)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  struct Gather sGather;
+  FILE *psFile;
+  size_t uCount;
+  size_t uBucketCount;
+  int iSuccessful;
+  assert(oSymTable != NULL);
+  assert(pcPath != NULL);
+
+  uCount = SymTable_getLength(oSymTable);
+  uBucketCount = Perfect_bucketCount(uCount);
+  if (uBucketCount == 0) {
+    return 0;
+  }
+  sGather.Entries = (struct Entry *) malloc((uCount + 1) *
+    sizeof(struct Entry));
+  sGather.ppcKeys = (const char **) malloc((uCount + 1) *
+    sizeof(const char *));
+  if (sGather.Entries == NULL || sGather.ppcKeys == NULL) {
+    free(sGather.Entries);
+    free((void *) sGather.ppcKeys);
+    return 0;
+  }
+  sGather.count = 0;
+  sGather.uKeyOffset = sizeof(struct Header) +
+    Snapshot_displacementSize(uBucketCount) +
+    uCount * sizeof(struct Entry);
+  sGather.pfEncode = pfEncode;
+  sGather.pvExtra = pvExtra;
+  SymTable_map(oSymTable, Snapshot_gather, &sGather);
+  assert(sGather.count == uCount);
+
+  psFile = fopen(pcPath, "wb");
+  if (psFile == NULL) {
+    iSuccessful = 0;
+  }
+  else {
+    iSuccessful = Snapshot_write(psFile, &sGather, uBucketCount);
+    if (fclose(psFile) != 0) {
+      iSuccessful = 0;
+    }
+  }
+
+  free(sGather.Entries);
+  free((void *) sGather.ppcKeys);
+  return iSuccessful;
+}
+
+/* A helper function which returns 1 if the uSize bytes at pcBase start
+with a header that this machine can read, whose arrays fit in them, and
+0 otherwise. The displacements and the entries aren't checked, so that
+opening doesn't depend on the size of the table; Snapshot_get and
+Snapshot_map check the ones they read instead. It is called by
+Snapshot_open */
+static int Snapshot_isValid(const char *pcBase, size_t uSize) {
+  struct Header sHeader;
+  size_t uArrays;
+  assert(pcBase != NULL);
+
+  if (uSize < sizeof(struct Header)) {
+    return 0;
+  }
+  memcpy(&sHeader, pcBase, sizeof(sHeader));
+  if (memcmp(sHeader.acMagic, acMagic, sizeof(acMagic)) != 0 ||
+    sHeader.uByteOrder != BYTE_ORDER_MARK ||
+    sHeader.uWordSize != sizeof(size_t) ||
+    sHeader.uFileSize != uSize) {
+    return 0;
+  }
+  /* The bucket count is a power of two, and the counts are small
+  enough that the sizes of the arrays can't overflow */
+  if (sHeader.bucketCount == 0 ||
+    (sHeader.bucketCount & (sHeader.bucketCount - 1)) != 0 ||
+    sHeader.bucketCount > uSize / sizeof(unsigned int) ||
+    sHeader.count > uSize / sizeof(struct Entry)) {
+    return 0;
+  }
+  uArrays = Snapshot_displacementSize(sHeader.bucketCount) +
+    sHeader.count * sizeof(struct Entry);
+  return (uArrays <= uSize - sizeof(struct Header));
+}
+
+/* implements the Snapshot_open() function */
+Snapshot_T Snapshot_open(const char *pcPath) {
+  Snapshot_T oSnapshot;
+  struct stat sStat;
+  void *pvBase;
+  int iFd;
+  assert(pcPath != NULL);
+
+  iFd = open(pcPath, O_RDONLY);
+  if (iFd < 0) {
+    return NULL;
+  }
+  if (fstat(iFd, &sStat) != 0 || sStat.st_size <= 0) {
+    close(iFd);
+    return NULL;
+  }
+  pvBase = mmap(NULL, (size_t) sStat.st_size, PROT_READ, MAP_PRIVATE,
+    iFd, 0);
+  /* The mapping stays valid once the descriptor is closed */
+  close(iFd);
+  if (pvBase == MAP_FAILED) {
+    return NULL;
+  }
+  if (! Snapshot_isValid((const char *) pvBase,
+    (size_t) sStat.st_size)) {
+    munmap(pvBase, (size_t) sStat.st_size);
+    return NULL;
+  }
+
+  oSnapshot = (Snapshot_T) malloc(sizeof(struct Snapshot));
+  if (oSnapshot == NULL) {
+    munmap(pvBase, (size_t) sStat.st_size);
+    return NULL;
+  }
+  /* mmap returns page-aligned memory, and the arrays are laid out at
+  multiples of sizeof(size_t), so they can be read in place */
+  oSnapshot->pcBase = (const char *) pvBase;
+  oSnapshot->uSize = (size_t) sStat.st_size;
+  oSnapshot->psHeader = (const struct Header *) pvBase;
+  oSnapshot->Displacements = (const unsigned int *)
+    (oSnapshot->pcBase + sizeof(struct Header));
+  oSnapshot->Entries = (const struct Entry *) (oSnapshot->pcBase +
+    sizeof(struct Header) +
+    Snapshot_displacementSize(oSnapshot->psHeader->bucketCount));
+  return oSnapshot;
+}
+
+/* implements the Snapshot_close() function */
+void Snapshot_close(Snapshot_T oSnapshot) {
+  assert(oSnapshot != NULL);
+  munmap((void *) oSnapshot->pcBase, oSnapshot->uSize);
+  free(oSnapshot);
+}
+
+/* implements the Snapshot_getLength() function */
+size_t Snapshot_getLength(Snapshot_T oSnapshot) {
+  assert(oSnapshot != NULL);
+  return oSnapshot->psHeader->count;
+}
+
+/* A helper function which returns the key of the entry psEntry of
+oSnapshot, or NULL if the entry doesn't point to uKeyLength characters
+and a '\0' inside the file. It is called by Snapshot_get and
+Snapshot_map */
+static const char *Snapshot_key(Snapshot_T oSnapshot,
+const struct Entry *psEntry) {
+  assert(oSnapshot != NULL);
+  assert(psEntry != NULL);
+
+  if (psEntry->uKeyOffset >= oSnapshot->uSize ||
+    psEntry->uKeyLength >= oSnapshot->uSize - psEntry->uKeyOffset ||
+    oSnapshot->pcBase[psEntry->uKeyOffset + psEntry->uKeyLength] !=
+    '\0') {
+    return NULL;
+  }
+  return oSnapshot->pcBase + psEntry->uKeyOffset;
+}
+
+/* implements the Snapshot_get() function. The perfect hash gives the
+only entry that can hold pcKey, whose hash is compared first.
+Snapshot_open doesn't read the displacements or the entries, so they
+are checked here: the slot must be one of the entries, and the key must
+lie inside the file */
+int Snapshot_get(Snapshot_T oSnapshot, const char *pcKey,
+size_t *puValue) {
+  const struct Entry *psEntry;
+  const char *pcEntryKey;
+  size_t uHash;
+  size_t uLength;
+  size_t uSlot;
+  assert(oSnapshot != NULL);
+  assert(pcKey != NULL);
+
+  if (oSnapshot->psHeader->count == 0) {
+    return 0;
+  }
+  uLength = strlen(pcKey);
+  uHash = HashFn_seeded(pcKey, uLength, oSnapshot->psHeader->uSeed);
+  uSlot = Perfect_slot(uHash, oSnapshot->Displacements,
+    oSnapshot->psHeader->bucketCount, oSnapshot->psHeader->count);
+  if (uSlot >= oSnapshot->psHeader->count) {
+    return 0;
+  }
+  psEntry = &oSnapshot->Entries[uSlot];
+  if (psEntry->uHash != uHash || psEntry->uKeyLength != uLength) {
+    return 0;
+  }
+  pcEntryKey = Snapshot_key(oSnapshot, psEntry);
+  if (pcEntryKey == NULL || memcmp(pcEntryKey, pcKey, uLength) != 0) {
+    return 0;
+  }
+  if (puValue != NULL) {
+    *puValue = psEntry->uValue;
+  }
+  return 1;
+}
+
+/* implements the Snapshot_map() function. An entry whose key doesn't
+lie inside the file is skipped */
+void Snapshot_map(Snapshot_T oSnapshot,
+void (*pfApply)(const char *pcKey, size_t uValue, void *pvExtra),
+const void *pvExtra) {
+  const struct Entry *psEntry;
+  const char *pcKey;
+  const struct Entry *psEnd;
+  assert(oSnapshot != NULL);
+  assert(pfApply != NULL);
+
+  psEnd = oSnapshot->Entries + oSnapshot->psHeader->count;
+  for (psEntry = oSnapshot->Entries; psEntry < psEnd; psEntry++) {
+    pcKey = Snapshot_key(oSnapshot, psEntry);
+    if (pcKey != NULL) {
+      pfApply(pcKey, psEntry->uValue, (void *) pvExtra);
+    }
+  }
+}
@@ -0,0 +1,71 @@
+/*--------------------------------------------------------------------*/
+/* snapshot.h                                                         */
+/* Author: Ahmed Farah                                                */
+/* Interface for a Snapshot, a read-only image of a symbol table that */
+/* is saved to a file once and then mapped into memory, so a process  */
+/* can start with the table ready instead of rebuilding it            */
+/*--------------------------------------------------------------------*/
+
+/* To prevent double inclusions */
+#ifndef SNAPSHOT_INCLUDED
+#define SNAPSHOT_INCLUDED
+
+/* allows us to use size_t */
+#include <stdlib.h>
+#include "symtable.h"
+
+/* defines an alias for struct Snapshot * */
+typedef struct Snapshot * Snapshot_T;
+
+/* Takes in a SymTable_T called oSymTable and writes an image of it to
+the file named pcPath, replacing anything there. A value is a pointer,
+which means nothing to another process, so the image stores a size_t in
+its place: what pfEncode returns for the key, the value and pvExtra,
+such as the offset of the value in a file of the caller's, or, if
+pfEncode is NULL, the pointer itself converted to a size_t, for tables
+whose values are small integers cast to void *. It returns 1 if it
+succeeds, and 0 if it can't allocate memory or write the file. The
+image is laid out by a minimal perfect hash of its keys, as a frozen
+table of symtablehash.c is, so that a lookup reads one entry and
+compares one key. It is offset-based, so it doesn't matter where it is
+mapped, but it has the byte order and the size_t of the machine that
+wrote it. */
+int Snapshot_save(SymTable_T oSymTable, const char *pcPath,
+size_t (*pfEncode)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra);
+
+/* Takes in the name pcPath of a file that Snapshot_save wrote, maps it
+read-only into memory and returns a Snapshot_T of it, or NULL if it
+can't open or map the file, or the file isn't an image this machine can
+read. Opening takes the same time whatever the size of the table: no
+binding is read, copied or allocated until it is looked up. So an image
+that was damaged after it was written may still open; reading it never
+goes outside the file, but the bindings whose entries were damaged may
+not be found, and Snapshot_map skips those whose keys are lost. */
+Snapshot_T Snapshot_open(const char *pcPath);
+
+/* The deconstructor. Takes in a Snapshot_T called oSnapshot and unmaps
+its file, after which the keys it handed out are no longer valid.
+Doesn't return anything */
+void Snapshot_close(Snapshot_T oSnapshot);
+
+/* Takes in a Snapshot_T called oSnapshot and returns the number of
+bindings in it as a size_t */
+size_t Snapshot_getLength(Snapshot_T oSnapshot);
+
+/* Takes in a Snapshot_T called oSnapshot and a key pcKey. If pcKey is
+bound in oSnapshot, it stores the size_t saved for its value in
+*puValue and returns 1; otherwise it leaves *puValue alone and returns
+0. puValue may be NULL, to just ask whether pcKey is bound. */
+int Snapshot_get(Snapshot_T oSnapshot, const char *pcKey,
+size_t *puValue);
+
+/* Takes in a Snapshot_T called oSnapshot, a function pfApply and an
+extra parameter pvExtra, and applies pfApply to the key and the saved
+value of every binding of oSnapshot, with pvExtra, in no particular
+order. The keys are in the mapped file itself. It returns nothing */
+void Snapshot_map(Snapshot_T oSnapshot,
+void (*pfApply)(const char *pcKey, size_t uValue, void *pvExtra),
+const void *pvExtra);
+
+#endif
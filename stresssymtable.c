@@ -0,0 +1,314 @@
+/*--------------------------------------------------------------------*/
+/* stresssymtable.c                                                   */
+/* Author: Ahmed Farah                                                */
+/* A multi-threaded client for a Symbol Table implementation that is  */
+/* safe to share between threads, such as symtableconcurrent.c. It    */
+/* checks that concurrent puts, gets, replaces, removes and maps      */
+/* don't lose or corrupt bindings, then measures how get throughput   */
+/* scales with the number of threads                                  */
+/*--------------------------------------------------------------------*/
+
+/* clock_gettime and pthreads are POSIX, not ANSI C */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "symtable.h"
+
+/* The size of the buffer each key is formatted into */
+enum {KEY_SIZE = 32};
+
+/* The most threads a run can use */
+enum {MAX_THREADS = 64};
+
+/* The number of times each thread reads every shared key while
+throughput is measured */
+enum {GET_ROUNDS = 4};
+
+/* A Worker holds what one thread needs: the shared table, its own
+number, the number of keys per thread, and a count of the checks that
+failed in it */
+struct Worker {
+  /* The table shared by every thread */
+  SymTable_T oSymTable;
+  /* The number of the thread, from 0 */
+  int iThread;
+  /* The number of keys of the thread, and of shared keys */
+  int iKeyCount;
+  /* The number of checks that failed */
+  int iFailures;
+};
+
+/* The table shared by the mapping thread and the number of shared keys
+it must see on every pass */
+struct Mapper {
+  /* The table shared by every thread */
+  SymTable_T oSymTable;
+  /* The number of shared keys */
+  int iKeyCount;
+  /* Set by the main thread once the workers are done */
+  int iStop;
+  /* Guards iStop */
+  pthread_mutex_t stopLock;
+  /* The number of passes that missed a shared key */
+  int iFailures;
+  /* The number of passes made */
+  int iPasses;
+};
+
+/* The value bound to every shared key */
+static char acShared[] = "shared";
+
+/* A helper function which returns the current time of the monotonic
+clock, in seconds */
+static double Stress_now(void) {
+  struct timespec sNow;
+  clock_gettime(CLOCK_MONOTONIC, &sNow);
+  return (double) sNow.tv_sec + (double) sNow.tv_nsec / 1e9;
+}
+
+/* The body of a worker thread. pvWorker is its struct Worker. It puts
+its own keys, checks every shared key, replaces its own values,
+removes half of its keys and uses SymTable_putOrGet on the others,
+counting every unexpected result in iFailures */
+static void *Stress_work(void *pvWorker) {
+  struct Worker *psWorker = (struct Worker *) pvWorker;
+  char acKey[KEY_SIZE];
+  void *pvValue;
+  int i;
+  assert(psWorker != NULL);
+
+  for (i = 0; i < psWorker->iKeyCount; i++) {
+    sprintf(acKey, "t%d-%d", psWorker->iThread, i);
+    if (! SymTable_put(psWorker->oSymTable, acKey, psWorker)) {
+      psWorker->iFailures++;
+    }
+    sprintf(acKey, "s%d", i);
+    if (SymTable_get(psWorker->oSymTable, acKey) != acShared) {
+      psWorker->iFailures++;
+    }
+  }
+  for (i = 0; i < psWorker->iKeyCount; i++) {
+    sprintf(acKey, "t%d-%d", psWorker->iThread, i);
+    if (SymTable_replace(psWorker->oSymTable, acKey, acKey) !=
+      psWorker) {
+      psWorker->iFailures++;
+    }
+  }
+  for (i = 0; i < psWorker->iKeyCount; i++) {
+    sprintf(acKey, "t%d-%d", psWorker->iThread, i);
+    if (i % 2 == 0) {
+      if (SymTable_remove(psWorker->oSymTable, acKey) == NULL) {
+        psWorker->iFailures++;
+      }
+    }
+    else if (SymTable_putOrGet(psWorker->oSymTable, acKey, psWorker,
+      &pvValue) != 0 || pvValue == (void *) psWorker) {
+      psWorker->iFailures++;
+    }
+  }
+  return NULL;
+}
+
+/* A helper function used as the pfApply of the mapping thread. It
+counts the shared keys in the int that pvExtra points to */
+static void Stress_countShared(const char *pcKey, void *pvValue,
+void *pvExtra) {
+  assert(pcKey != NULL);
+  assert(pvExtra != NULL);
+  if (pcKey[0] == 's' && pvValue == acShared) {
+    (*(int *) pvExtra)++;
+  }
+}
+
+/* The body of the mapping thread. pvMapper is its struct Mapper. It
+maps the table over and over until iStop is set. Since the shared keys
+are never changed, every pass must see each of them exactly once */
+static void *Stress_map(void *pvMapper) {
+  struct Mapper *psMapper = (struct Mapper *) pvMapper;
+  int iCount;
+  int iStop;
+  assert(psMapper != NULL);
+
+  do {
+    iCount = 0;
+    SymTable_map(psMapper->oSymTable, Stress_countShared, &iCount);
+    if (iCount != psMapper->iKeyCount) {
+      psMapper->iFailures++;
+    }
+    psMapper->iPasses++;
+    pthread_mutex_lock(&psMapper->stopLock);
+    iStop = psMapper->iStop;
+    pthread_mutex_unlock(&psMapper->stopLock);
+  } while (! iStop);
+  return NULL;
+}
+
+/* The body of a thread of the throughput phase. pvWorker is its
+struct Worker. It gets every shared key GET_ROUNDS times, starting at
+a different key in every thread */
+static void *Stress_get(void *pvWorker) {
+  struct Worker *psWorker = (struct Worker *) pvWorker;
+  char acKey[KEY_SIZE];
+  int iRound;
+  int i;
+  assert(psWorker != NULL);
+
+  for (iRound = 0; iRound < GET_ROUNDS; iRound++) {
+    for (i = 0; i < psWorker->iKeyCount; i++) {
+      sprintf(acKey, "s%d", (i + psWorker->iThread * 7919) %
+        psWorker->iKeyCount);
+      if (SymTable_get(psWorker->oSymTable, acKey) != acShared) {
+        psWorker->iFailures++;
+      }
+    }
+  }
+  return NULL;
+}
+
+/* A helper function which runs pfBody in iThreads threads, one for
+each of the first iThreads elements of asWorkers, and waits for them.
+It returns 1 if it could start them all, and 0 otherwise */
+static int Stress_run(void *(*pfBody)(void *), struct Worker *asWorkers,
+int iThreads) {
+  pthread_t aThreads[MAX_THREADS];
+  int iStarted;
+  int i;
+  assert(pfBody != NULL);
+  assert(asWorkers != NULL);
+
+  for (iStarted = 0; iStarted < iThreads; iStarted++) {
+    if (pthread_create(&aThreads[iStarted], NULL, pfBody,
+      &asWorkers[iStarted]) != 0) {
+      break;
+    }
+  }
+  for (i = 0; i < iStarted; i++) {
+    pthread_join(aThreads[i], NULL);
+  }
+  return (iStarted == iThreads);
+}
+
+/* Takes in a key count and optionally a number of threads, 4 by
+default. It writes "Test ... failed" for every check that failed, then
+the get throughput for 1, 2, 4... up to that many threads. It returns
+0, or EXIT_FAILURE if its arguments are bad or it can't start a thread
+or allocate memory */
+int main(int argc, char *argv[]) {
+  struct Worker asWorkers[MAX_THREADS];
+  struct Mapper sMapper;
+  pthread_t mapThread;
+  SymTable_T oSymTable;
+  char acKey[KEY_SIZE];
+  int iKeyCount;
+  int iThreads = 4;
+  int iFailures = 0;
+  int iRunning;
+  int i;
+  double dStart;
+  double dSeconds;
+
+  if (argc != 2 && argc != 3) {
+    fprintf(stderr, "Usage: %s keycount [threads]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (sscanf(argv[1], "%d", &iKeyCount) != 1 || iKeyCount < 0 ||
+    (argc == 3 && (sscanf(argv[2], "%d", &iThreads) != 1 ||
+    iThreads <= 0 || iThreads > MAX_THREADS))) {
+    fprintf(stderr, "keycount must be a number and threads must be "
+      "between 1 and %d\n", MAX_THREADS);
+    return EXIT_FAILURE;
+  }
+
+  oSymTable = SymTable_new();
+  if (oSymTable == NULL) {
+    fprintf(stderr, "%s: out of memory\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < iKeyCount; i++) {
+    sprintf(acKey, "s%d", i);
+    if (! SymTable_put(oSymTable, acKey, acShared)) {
+      fprintf(stderr, "%s: out of memory\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  for (i = 0; i < iThreads; i++) {
+    asWorkers[i].oSymTable = oSymTable;
+    asWorkers[i].iThread = i;
+    asWorkers[i].iKeyCount = iKeyCount;
+    asWorkers[i].iFailures = 0;
+  }
+
+  /* The mixed phase, with one more thread mapping all the while. The
+  workers' puts expand the table several times under the mapper */
+  printf("Stress testing %d threads with %d keys each.\n", iThreads,
+    iKeyCount);
+  sMapper.oSymTable = oSymTable;
+  sMapper.iKeyCount = iKeyCount;
+  sMapper.iStop = 0;
+  sMapper.iFailures = 0;
+  sMapper.iPasses = 0;
+  pthread_mutex_init(&sMapper.stopLock, NULL);
+  if (pthread_create(&mapThread, NULL, Stress_map, &sMapper) != 0) {
+    fprintf(stderr, "%s: can't start a thread\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  iRunning = Stress_run(Stress_work, asWorkers, iThreads);
+  pthread_mutex_lock(&sMapper.stopLock);
+  sMapper.iStop = 1;
+  pthread_mutex_unlock(&sMapper.stopLock);
+  pthread_join(mapThread, NULL);
+  pthread_mutex_destroy(&sMapper.stopLock);
+  if (! iRunning) {
+    fprintf(stderr, "%s: can't start a thread\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < iThreads; i++) {
+    iFailures += asWorkers[i].iFailures;
+  }
+  if (iFailures != 0) {
+    printf("Test of %d concurrent operations failed.\n", iFailures);
+  }
+  if (sMapper.iFailures != 0) {
+    printf("Test of %d of %d concurrent maps failed.\n",
+      sMapper.iFailures, sMapper.iPasses);
+  }
+  if (SymTable_getLength(oSymTable) != (size_t) iKeyCount +
+    (size_t) iThreads * (size_t) (iKeyCount / 2)) {
+    printf("Test of the final length failed.\n");
+  }
+
+  /* The throughput phase only reads, so it should scale. The thread
+  counts double, and end with iThreads even if it isn't a power of 2 */
+  for (iRunning = 1; ; iRunning = (iRunning * 2 < iThreads) ?
+    iRunning * 2 : iThreads) {
+    for (i = 0; i < iRunning; i++) {
+      asWorkers[i].iFailures = 0;
+    }
+    dStart = Stress_now();
+    if (! Stress_run(Stress_get, asWorkers, iRunning)) {
+      fprintf(stderr, "%s: can't start a thread\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+    dSeconds = Stress_now() - dStart;
+    for (i = 0; i < iRunning; i++) {
+      if (asWorkers[i].iFailures != 0) {
+        printf("Test of concurrent gets failed.\n");
+      }
+    }
+    printf("%d threads: %.0f gets per second\n", iRunning,
+      dSeconds > 0.0 ? (double) iRunning * GET_ROUNDS * iKeyCount /
+      dSeconds : 0.0);
+    if (iRunning == iThreads) {
+      break;
+    }
+  }
+
+  SymTable_free(oSymTable);
+  return 0;
+}
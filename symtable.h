@@ -14,12 +14,120 @@
 /* defines an alias for struct SymTable * */
 typedef struct SymTable * SymTable_T;
 
+/* A SymTable_Iter is a cursor over the bindings of a SymTable_T. Its
+caller owns it, usually as a local variable, so starting, stopping or
+abandoning an iteration allocates and frees nothing. Its fields belong
+to the implementation, apart from pcKey and pvValue, which hold the
+binding that SymTable_next last moved to and may be read directly, as
+SymTable_iterKey and SymTable_iterValue do. */
+typedef struct SymTable_Iter {
+  /* The table being iterated */
+  SymTable_T oSymTable;
+  /* Where the iteration is, as the implementation counts it */
+  size_t uPosition;
+  /* The current binding, for implementations that have them */
+  const void *pvCurrent;
+  /* The key of the current binding */
+  const char *pcKey;
+  /* The value of the current binding */
+  void *pvValue;
+} SymTable_Iter;
+
 /* The constructor. It takes in no parameters and
 returns an empty SymTable_T structure.
 A symbol table is a set of key-value pairs which supports a variety of
 operations such as put, get, replace... etc. */
 SymTable_T SymTable_new(void);
 
+/* The flags that can be given to SymTable_newWithFlags, combined with
+the | operator. An implementation ignores flags that don't apply to it.
+SYMTABLE_ARENA makes the table take its bindings from slabs and its key
+copies from chunks that belong to the table, instead of making two
+calls to malloc for every binding. SymTable_free then releases a
+handful of blocks instead of every binding one at a time. The memory of
+a removed binding is reused by later puts, but the bytes of its key are
+only reclaimed when the table is freed, so it suits tables that are
+short-lived or seldom removed from.
+SYMTABLE_INCREMENTAL makes a table that grows by rehashing spread the
+work over the operations that follow, instead of doing it all in the
+put that triggers it. The same goes for shrinking, and for the rehash
+under a new seed that keys which collide too often bring about. No
+single operation then does more than a fixed amount of rehashing,
+however large the table is.
+SYMTABLE_BORROWED makes the table store the pointers to the keys it is
+given instead of copies of the keys, which saves an allocation and a
+copy for every put and a free for every remove. The caller then owns
+every key: it must leave each one unchanged, at the same address, for
+as long as its binding is in the table, and free it (if it needs to)
+only after removing it or freeing the table. A key given to
+SymTable_putLen must then be a whole string, with a '\0' right after
+its uLength characters. The keys that SymTable_map passes to pfApply
+are the caller's own pointers.
+SYMTABLE_INTERNED makes the table compare keys by address instead of by
+their characters, and implies SYMTABLE_BORROWED. It is meant for keys
+that have been made canonical, such as those from an Intern_T (see
+intern.h), so that equal strings are always the same pointer: a lookup
+then never reads a key, its hash code is that of its address, and the
+length that SymTable_putLen and SymTable_getLen take is ignored. A
+string equal to a bound key but at another address is a different key.
+Every implementation honors it, and the hash function given to
+SymTable_newWithHash is then ignored.
+SYMTABLE_MOVE_TO_FRONT and SYMTABLE_TRANSPOSE make a table that scans
+its bindings in order reorganize itself on every lookup that finds its
+key, so that the keys looked up most often end up near the front and
+take the fewest comparisons to find. Move-to-front moves the binding
+found to the front; transpose moves it one step closer, which adapts
+more slowly but is not thrown off by a single lookup of a cold key. If
+both are given, move-to-front is used. Only the linked-list
+implementation applies them. */
+enum {SYMTABLE_ARENA = 1, SYMTABLE_INCREMENTAL = 2,
+  SYMTABLE_BORROWED = 4, SYMTABLE_INTERNED = 8,
+  SYMTABLE_MOVE_TO_FRONT = 16, SYMTABLE_TRANSPOSE = 32};
+
+/* A constructor that takes in uFlags, a combination of the SYMTABLE_
+flags above, and returns an empty SymTable_T structure that behaves as
+they specify, or NULL if it can't allocate memory.
+SymTable_new() is the same as SymTable_newWithFlags(0). */
+SymTable_T SymTable_newWithFlags(unsigned int uFlags);
+
+/* defines an alias for a pointer to a hash function: one that takes in
+a key pcKey of length uLength and returns its hash code as a size_t.
+hashfn.h declares some. Keys that are equal must have equal codes */
+typedef size_t (*SymTable_HashFn)(const char *pcKey, size_t uLength);
+
+/* A constructor that takes in pfHash, the hash function the table will
+use for its keys, and uFlags, as for SymTable_newWithFlags. If pfHash
+is NULL the table uses its default hash function, which may be seeded
+differently for every table, and changed if the table's keys collide
+too often; a given pfHash is used as it is. It returns an empty
+SymTable_T structure, or NULL if it can't allocate memory.
+Implementations that don't hash their keys ignore pfHash. */
+SymTable_T SymTable_newWithHash(SymTable_HashFn pfHash,
+unsigned int uFlags);
+
+/* A constructor that takes in uHint, the number of bindings the caller
+expects the table to hold, and returns an empty SymTable_T structure
+that is already large enough for them, or NULL if it can't allocate
+memory. Putting uHint bindings into it then skips every expansion
+that SymTable_new would have gone through on the way. It is only a
+hint: the table still grows past uHint as usual, and implementations
+that never expand ignore it. */
+SymTable_T SymTable_newWithCapacity(size_t uHint);
+
+/* A constructor that takes in an array ppcKeys of uCount strings and
+an array ppvValues of uCount values, and returns a SymTable_T structure
+that binds each key to the value at the same index, or NULL if it can't
+allocate memory. A key that comes up more than once in ppcKeys is bound
+to the value of its first occurrence, and the later ones are skipped,
+so SymTable_getLength of the result is uCount less the number of
+duplicates. The table is sized for all uCount bindings at once, and
+its bindings and key copies are allocated together, as for a table made
+with SYMTABLE_ARENA, whose other flags it has none of. Hash table
+implementations may hash a large array on several threads. It is
+faster than uCount calls of SymTable_put on an empty table. */
+SymTable_T SymTable_newFromArray(const char * const *ppcKeys,
+const void * const *ppvValues, size_t uCount);
+
 /* The deconstructor. Take in a SymTable_T called oSymTable and frees
 all memory associated with it. Doesn't return anything.
 Runs in linear time */
@@ -39,6 +147,38 @@ if the key is already in the table. */
 int SymTable_put(SymTable_T oSymTable, const char *pcKey,
 const void *pvValue);
 
+/* Works as SymTable_put, except that the key is the uLength characters
+that pcKey points to, which need not be followed by a '\0' but must not
+include one. The table's copy of the key is followed by a '\0'. Callers
+that already know the length of pcKey save a pass over it. */
+int SymTable_putLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, const void *pvValue);
+
+/* Takes a SymTable_T called oSymTable, an array ppcKeys of uCount
+strings and an array ppvValues of uCount values. It puts each
+key-value pair in turn, just as SymTable_put does, and returns the
+number of pairs it added. A key that is already in oSymTable (or that
+comes up twice in ppcKeys) isn't added, and neither is one for which it
+can't allocate memory. Hash table implementations start loading the
+memory of several keys before they look at any of them, so a batch is
+faster than the same calls of SymTable_put one by one. */
+size_t SymTable_putBatch(SymTable_T oSymTable,
+const char * const *ppcKeys, const void * const *ppvValues,
+size_t uCount);
+
+/* Takes a SymTable_T called oSymTable, a key-value pair: a string
+pcKey and a pointer to the value, pvValue, and ppvValue, which is of
+type void ** and may be NULL.
+If oSymTable doesn't contain pcKey, it adds the key-value pair just as
+SymTable_put does and returns 1. If it already does, it leaves
+oSymTable unchanged, stores the value already bound to pcKey in
+*ppvValue (when ppvValue isn't NULL), and returns 0. It returns -1 if
+it can't allocate memory. Either way the key is only looked up once,
+so it replaces a SymTable_contains followed by a SymTable_put or a
+SymTable_get. */
+int SymTable_putOrGet(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue, void **ppvValue);
+
 /* Takes a SymTable_T called oSymTable, and a key-value pair: a string
 pcKey, and a pointer to the value, pvValue, which is of type void *,
 both of which are presumed to be constant.
@@ -61,6 +201,20 @@ Null. If it does, it returns the value to which that key corresponds
 as a void * variable. */
 void *SymTable_get(SymTable_T oSymTable, const char *pcKey);
 
+/* Works as SymTable_get, except that the key is the uLength characters
+that pcKey points to, which need not be followed by a '\0' but must not
+include one. */
+void *SymTable_getLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength);
+
+/* Takes a SymTable_T called oSymTable, an array ppcKeys of uCount
+strings and an array ppvValues of uCount void *. It stores in each
+ppvValues[i] what SymTable_get would return for ppcKeys[i]. As with
+SymTable_putBatch, looking the keys up together lets the memory
+accesses of different keys overlap. */
+void SymTable_getBatch(SymTable_T oSymTable,
+const char * const *ppcKeys, size_t uCount, void **ppvValues);
+
 /* Takes a SymTable_T called oSymTable, and a key, which is a constant
 string pcKey.
 If the symbol table oSymTable doesn't contain the key pcKey, it returns
@@ -69,6 +223,28 @@ oSymTable, frees up the associated memory, and returns the value which
 corresponds to the key pcKey as a void * variable. */
 void *SymTable_remove(SymTable_T oSymTable, const char *pcKey);
 
+/* Takes a SymTable_T called oSymTable and shrinks the memory it uses
+to fit the bindings it holds now, so that memory and the cost of
+SymTable_map follow its length after many removals. It returns nothing
+and does not change the bindings. The hashed implementations already
+shrink with some hysteresis as bindings are removed; this does it at
+once and as far as it can. If it can't allocate smaller arrays it
+leaves oSymTable as it was. Runs in linear time */
+void SymTable_compact(SymTable_T oSymTable);
+
+/* Takes a SymTable_T called oSymTable, whose keys are not going to
+change any more, and rebuilds it for lookups alone. It returns 1 if it
+did, after which oSymTable is frozen: lookups, SymTable_replace,
+SymTable_map and iteration work as before, but no binding can be added
+or removed, so the SymTable_put family fails as if it were out of
+memory and SymTable_remove returns NULL. It returns 0, and leaves
+oSymTable as it was and still changeable, if it can't allocate memory,
+can't separate the keys, or the implementation has no frozen form.
+symtablehash.c freezes into a minimal perfect hash, in which a lookup
+makes one probe and one key comparison whatever the keys; the other
+implementations return 0. Runs in linear expected time */
+int SymTable_freeze(SymTable_T oSymTable);
+
 /* Takes a SymTable_T called oSymTable, a function of return type void
 called pfApply() of the signature seen below, and an extra parameter
 pvExtra of type void *.
@@ -80,4 +256,106 @@ void SymTable_map(SymTable_T oSymTable,
 void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
 const void *pvExtra);
 
+/* Works as SymTable_map, but only applies pfApply to the bindings
+whose keys come at or after pcLow and before pcHigh, in the order of
+strcmp. Either bound may be NULL, which leaves that side open. The
+ordered implementation (symtabletree.c) visits them in the order of
+their keys, in O(log n + k) time for k bindings; the others check every
+binding and visit the matching ones in the order of SymTable_map */
+void SymTable_mapRange(SymTable_T oSymTable, const char *pcLow,
+const char *pcHigh,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra);
+
+/* Works as SymTable_mapRange, but applies pfApply to the bindings
+whose keys start with pcPrefix, which must not be NULL; the empty
+prefix matches every key */
+void SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra);
+
+/* Works as SymTable_map, but spreads the calls of pfApply over up to
+uThreads threads, the calling one included, for tables whose pfApply
+does enough work per binding to be worth it. ppvExtras is NULL or an
+array of uThreads pointers, and each thread passes its own one, or
+NULL, as the pvExtra of pfApply, so that every thread can gather its
+results in its own extra without a lock; the caller merges them once
+SymTable_mapParallel returns. uThreads must be positive. pfApply is
+called on several bindings at once, in no particular order, so anything
+it shares between threads must be safe to; it must not change
+oSymTable, and no other thread may change it in the meantime. If fewer
+threads can be started, the ones that are do all the work. An
+implementation that can't split its bindings applies pfApply to all of
+them in the calling thread, with the first extra. */
+void SymTable_mapParallel(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+void * const *ppvExtras, size_t uThreads);
+
+/* Takes a SymTable_T called oSymTable and a SymTable_Iter that
+psIter points to, and starts an iteration of oSymTable in psIter,
+before its first binding. It returns nothing. Every binding is then
+visited once, in the same order as SymTable_map would visit it, by
+calling SymTable_next until it returns 0, or the caller can stop at any
+point. oSymTable must not be changed while it is iterated; for a table
+made with SYMTABLE_MOVE_TO_FRONT or SYMTABLE_TRANSPOSE that includes
+looking up its keys. Several iterations of one table can be under way
+at once */
+void SymTable_begin(SymTable_T oSymTable, SymTable_Iter *psIter);
+
+/* Takes a SymTable_Iter psIter that SymTable_begin started, and moves
+it to the next binding of its table. It returns 1 if there was one,
+and 0, leaving psIter at the end, if every binding has been visited */
+int SymTable_next(SymTable_Iter *psIter);
+
+/* Takes a SymTable_Iter psIter that SymTable_next last moved to a
+binding, and returns the key of that binding */
+const char *SymTable_iterKey(const SymTable_Iter *psIter);
+
+/* Takes a SymTable_Iter psIter that SymTable_next last moved to a
+binding, and returns the value of that binding */
+void *SymTable_iterValue(const SymTable_Iter *psIter);
+
+/* A SymTable_Stats is what SymTable_getStats reports about a table.
+The counters, from uHits to uMaxMigrate, cover the life of the table
+and are only kept by an implementation compiled with -DSYMTABLE_STATS;
+otherwise they cost nothing and are always 0. The rest describe the
+table as it is, and are worked out when SymTable_getStats is called.
+Only symtablelist.c and symtablehash.c keep statistics; the other
+implementations report 0 for every one of them. The return value of
+SymTable_getStats tells a table whose counters are 0 because nothing
+has been looked up from one that doesn't keep them. */
+typedef struct SymTable_Stats {
+  /* The number of lookups of a key that found it */
+  size_t uHits;
+  /* The number of lookups of a key that didn't */
+  size_t uMisses;
+  /* The number of bindings those lookups looked at, in all */
+  size_t uProbes;
+  /* The number of times the table grew */
+  size_t uExpansions;
+  /* The processor time that growing took, in seconds */
+  double dExpandSeconds;
+  /* The most buckets that one operation moved while the table was
+  resized, which SYMTABLE_INCREMENTAL keeps to a few */
+  size_t uMaxMigrate;
+  /* The number of bindings in the longest chain */
+  size_t uMaxChain;
+  /* The mean number of bindings in the chains that have any */
+  double dMeanChain;
+  /* The number of bytes allocated for bindings */
+  size_t uBindingBytes;
+  /* The number of bytes allocated for copies of keys */
+  size_t uKeyBytes;
+} SymTable_Stats;
+
+/* Takes a SymTable_T called oSymTable and fills in the SymTable_Stats
+that psStats points to with its statistics. It returns 1 (TRUE) if
+oSymTable keeps the counters, which only symtablelist.c and
+symtablehash.c compiled with -DSYMTABLE_STATS do, or 0 (FALSE) if they
+are 0 because it doesn't. It takes time in proportion to the size of
+oSymTable, but doesn't change it. Every lookup of a key, by any
+function that is given one, counts as a hit or a miss, and every
+binding whose key it compares or skips as a probe */
+int SymTable_getStats(SymTable_T oSymTable, SymTable_Stats *psStats);
+
 #endif
@@ -0,0 +1,956 @@
+/*--------------------------------------------------------------------*/
+/* symtablecompact.c                                                  */
+/* Author: Ahmed Farah                                                */
+/* Implements the Symbol Table abstract data type (ADT), compliant    */
+/* with the interface in symtable.h                                   */
+/* It uses a dense array of entries in insertion order, indexed by an */
+/* open-addressing (linear probing) hash table of entry numbers       */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <string.h>
+#include "symtable.h"
+#include "arena.h"
+#include "filter.h"
+#include "hashfn.h"
+#include "parallel.h"
+
+/* The number of index slots in a new symbol table. It must be a power
+of 2, since slot indices are computed by masking */
+enum {INITIAL_CAPACITY = 16};
+
+/* The maximum load factor of the index, as a percentage, as in
+symtableflat.c. It is also the share of the index slots that there are
+entries for. Linear probing needs at least one free slot, so it must be
+below 100 */
+#ifndef SYMTABLE_MAX_LOAD_PERCENT
+#define SYMTABLE_MAX_LOAD_PERCENT 75
+#endif
+#if SYMTABLE_MAX_LOAD_PERCENT <= 0 || SYMTABLE_MAX_LOAD_PERCENT >= 100
+#error "SYMTABLE_MAX_LOAD_PERCENT must be between 1 and 99"
+#endif
+
+/* The index slot value that marks a free slot. Every other value is
+one more than the number of the entry that the slot refers to */
+enum {FREE = 0};
+
+/* The number of keys that SymTable_getBatch and SymTable_putBatch hash
+and prefetch before they resolve any of them */
+enum {BATCH_GROUP = 16};
+
+/* Asks the processor to start loading the cache line at pv, without
+waiting for it, as in symtablehash.c */
+#ifdef __GNUC__
+#define SYMTABLE_PREFETCH(pv) __builtin_prefetch(pv)
+#else
+#define SYMTABLE_PREFETCH(pv) ((void) (pv))
+#endif
+
+/* An Entry is made up of 3 parts: Hash, the full hash code of Key,
+Key and Value. The Key of a removed entry is NULL */
+struct Entry {
+  /* The hash code of Key */
+  size_t Hash;
+  /* Symbol table key, or NULL once the entry is removed */
+  const char * Key;
+  /* Symbol table value */
+  const void * Value;
+};
+
+/* This is a compact implementation of a symbol table, laid out like
+the dictionaries of CPython. Entries holds the bindings in the order
+they were put, one after the other, and Indices is a linear probing
+hash table of capacity slots whose every used slot holds one more than
+the number of an entry. Lookups probe Indices and compare the hash of
+the entry each slot refers to, so the key of an entry is only compared
+when its hash matches. SymTable_map only reads the first entryCount
+entries, without touching Indices, which also makes it visit the
+bindings in the order they were put. A remove leaves a hole in Entries,
+whose Key is NULL, which the next rebuild of the table squeezes out.
+There are expandThreshold entries, as many as the maximum load factor
+allows for capacity slots, and both arrays live in one allocation,
+which starts at Entries. capacity is always a power of 2. arena,
+borrowed, interned and hash are as in symtableflat.c. */
+struct SymTable {
+  /* The bindings, in the order they were put */
+  struct Entry *Entries;
+  /* For each slot, one more than the number of its entry, or FREE */
+  size_t *Indices;
+  /* The number of index slots. Always a power of 2 */
+  size_t capacity;
+  /* The number of entries, and the size that makes the next put
+  rebuild the table */
+  size_t expandThreshold;
+  /* The number of entries in use, including removed ones */
+  size_t entryCount;
+  /* The current size of the symbol table */
+  size_t size;
+  /* Where key copies are allocated, if not from malloc */
+  Arena_T arena;
+  /* Whether the keys belong to the caller rather than to the table */
+  int borrowed;
+  /* Whether keys are compared by address rather than by characters */
+  int interned;
+  /* The hash function of the table */
+  SymTable_HashFn hash;
+};
+
+/* A helper function which takes in a SymTable_T oSymTable and a key
+pcKey, and returns the length of pcKey as a size_t. A table that
+compares keys by address never needs it, so it returns 0 without
+reading pcKey then. It is called by every function that is given a key
+without its length */
+static size_t SymTable_length(SymTable_T oSymTable, const char *pcKey) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  if (oSymTable->interned) {
+    return 0;
+  }
+  return strlen(pcKey);
+}
+
+/* A Helper function which takes in a hash code uHash and a size_t
+uMask, which is one less than the (power of 2) number of slots, and
+returns the slot where the probe sequence for uHash starts. The bits
+are mixed as in symtableflat.c */
+static size_t SymTable_home(size_t uHash, size_t uMask) {
+  uHash ^= uHash >> 15;
+  uHash *= 0x2c1b3c6dU;
+  uHash ^= uHash >> 12;
+  uHash *= 0x297a2d39U;
+  uHash ^= uHash >> 15;
+  return uHash & uMask;
+}
+
+/* A Helper function which takes in uCapacity, a power of 2 number of
+slots, and returns the number of bindings that many slots can hold
+before the load factor passes SYMTABLE_MAX_LOAD_PERCENT. It is called
+by SymTable_rebuild, SymTable_hintCapacity, SymTable_fitCapacity and
+SymTable_putOrGetHashed */
+static size_t SymTable_threshold(size_t uCapacity) {
+  /* We divide first, since capacity is a power of 2 above 100 long
+  before multiplying could overflow */
+  if (uCapacity >= 128) {
+    return uCapacity / 100 * SYMTABLE_MAX_LOAD_PERCENT;
+  }
+  return uCapacity * SYMTABLE_MAX_LOAD_PERCENT / 100;
+}
+
+/* A helper function which takes in a SymTable_T oSymTable and returns
+the fewest slots, a power of 2 and no fewer than INITIAL_CAPACITY,
+that hold uCount bindings without passing the maximum load factor, and
+no more than it has now. It is called by SymTable_shrink and
+SymTable_compact */
+static size_t SymTable_fitCapacity(SymTable_T oSymTable, size_t uCount)
+{
+  size_t uCapacity;
+  assert(oSymTable != NULL);
+
+  uCapacity = oSymTable->capacity;
+  while (uCapacity > INITIAL_CAPACITY &&
+    SymTable_threshold(uCapacity / 2) >= uCount) {
+    uCapacity /= 2;
+  }
+  return uCapacity;
+}
+
+/* A Helper function which gives SymTable_T oSymTable new arrays, with
+uCapacity index slots. It moves the bindings that haven't been removed
+to the front of the new Entries, in the same order, and indexes each of
+them by its stored hash, so no key is read or compared. Before the
+first call, oSymTable has no arrays and no bindings. It is called by
+every function that resizes the table, and by SymTable_newSized, and
+returns 1 if it succeeds. If it can't allocate the new arrays it
+returns 0 and leaves oSymTable in its original condition */
+static int SymTable_rebuild(SymTable_T oSymTable, size_t uCapacity) {
+  struct Entry *psNewEntries;
+  size_t *puNewIndices;
+  size_t uEntries;
+  size_t uMask;
+  size_t uNew;
+  size_t uOld;
+  size_t u;
+  assert(oSymTable != NULL);
+
+  uEntries = SymTable_threshold(uCapacity);
+  assert(uEntries >= oSymTable->size);
+
+  /* Entries comes first, since it's the more strictly aligned array */
+  if (uEntries > ((size_t) -1 - uCapacity * sizeof(size_t)) /
+    sizeof(struct Entry)) {
+    return 0;
+  }
+  psNewEntries = (struct Entry *) calloc(1,
+    uEntries * sizeof(struct Entry) + uCapacity * sizeof(size_t));
+  if (psNewEntries == NULL) {
+    return 0;
+  }
+  puNewIndices = (size_t *) (void *) (psNewEntries + uEntries);
+
+  uMask = uCapacity - 1;
+  uNew = 0;
+  for (uOld = 0; uOld < oSymTable->entryCount; uOld++) {
+    if (oSymTable->Entries[uOld].Key == NULL) {
+      continue;
+    }
+    psNewEntries[uNew] = oSymTable->Entries[uOld];
+    for (u = SymTable_home(psNewEntries[uNew].Hash, uMask);
+      puNewIndices[u] != FREE; u = (u + 1) & uMask) {
+    }
+    puNewIndices[u] = uNew + 1;
+    uNew++;
+  }
+
+  free(oSymTable->Entries);
+  oSymTable->Entries = psNewEntries;
+  oSymTable->Indices = puNewIndices;
+  oSymTable->capacity = uCapacity;
+  oSymTable->expandThreshold = uEntries;
+  oSymTable->entryCount = uNew;
+  return 1;
+}
+
+/* The SymTable constructor */
+SymTable_T SymTable_new(void) {
+  return SymTable_newWithFlags(0);
+}
+
+/* The SymTable constructor that takes flags */
+SymTable_T SymTable_newWithFlags(unsigned int uFlags) {
+  return SymTable_newWithHash(NULL, uFlags);
+}
+
+/* A helper function which works as SymTable_newWithHash, for a table
+that starts out with uCapacity slots, a power of 2. It is called by
+SymTable_newWithHash, SymTable_newWithCapacity and
+SymTable_newFromArray */
+static SymTable_T SymTable_newSized(SymTable_HashFn pfHash,
+unsigned int uFlags, size_t uCapacity) {
+  SymTable_T oSymTable;
+  oSymTable = (SymTable_T) malloc(sizeof(struct SymTable));
+  if (oSymTable == NULL) {
+    return NULL;
+  }
+  oSymTable->Entries = NULL;
+  oSymTable->entryCount = 0;
+  oSymTable->size = 0;
+  if (! SymTable_rebuild(oSymTable, uCapacity)) {
+    /* We must remember to free oSymTable, since we won't be actually
+    making a symbol table */
+    free(oSymTable);
+    return NULL;
+  }
+  oSymTable->arena = NULL;
+  if (uFlags & SYMTABLE_ARENA) {
+    /* The arena never hands out entries, only key copies */
+    oSymTable->arena = Arena_new(0);
+    if (oSymTable->arena == NULL) {
+      free(oSymTable->Entries);
+      free(oSymTable);
+      return NULL;
+    }
+  }
+  oSymTable->interned = ((uFlags & SYMTABLE_INTERNED) != 0);
+  oSymTable->borrowed = ((uFlags & SYMTABLE_BORROWED) != 0 ||
+    oSymTable->interned);
+  oSymTable->hash = pfHash;
+  if (pfHash == NULL) {
+    oSymTable->hash = HashFn_multiplicative;
+  }
+  if (oSymTable->interned) {
+    oSymTable->hash = HashFn_address;
+  }
+  return oSymTable;
+}
+
+/* The SymTable constructor that takes a hash function */
+SymTable_T SymTable_newWithHash(SymTable_HashFn pfHash,
+unsigned int uFlags) {
+  return SymTable_newSized(pfHash, uFlags, INITIAL_CAPACITY);
+}
+
+/* A helper function which doubles a number of slots from
+INITIAL_CAPACITY until uHint bindings fit without passing the maximum
+load factor, as that many puts would have, and returns it, or 0 if
+there would be too many slots to count. It is called by
+SymTable_newWithCapacity and SymTable_newFromArray */
+static size_t SymTable_hintCapacity(size_t uHint) {
+  size_t uCapacity = INITIAL_CAPACITY;
+  while (SymTable_threshold(uCapacity) < uHint) {
+    /* A table this large couldn't be allocated anyway */
+    if (uCapacity > (size_t) -1 / 2) {
+      return 0;
+    }
+    uCapacity *= 2;
+  }
+  return uCapacity;
+}
+
+/* The SymTable constructor that takes a capacity. Its slots are
+counted by SymTable_hintCapacity */
+SymTable_T SymTable_newWithCapacity(size_t uHint) {
+  size_t uCapacity;
+  uCapacity = SymTable_hintCapacity(uHint);
+  if (uCapacity == 0) {
+    return NULL;
+  }
+  return SymTable_newSized(NULL, 0, uCapacity);
+}
+
+/* A helper function which makes a defensive copy of the key pcKey, of
+length uLength, for SymTable_T oSymTable, from its arena if it has one
+and from malloc otherwise. If oSymTable borrows its keys, it makes no
+copy and returns pcKey itself. It returns the copy, or NULL if it can't
+allocate memory. It is called by SymTable_putOrGetHashed */
+static const char * SymTable_copyKey(SymTable_T oSymTable,
+const char *pcKey, size_t uLength) {
+  char *keyCopy;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  if (oSymTable->borrowed) {
+    assert(oSymTable->interned || pcKey[uLength] == '\0');
+    return pcKey;
+  }
+
+  if (oSymTable->arena != NULL) {
+    return Arena_copyKey(oSymTable->arena, pcKey, uLength);
+  }
+  keyCopy = (char *) calloc(uLength + 1, sizeof(char));
+  if (keyCopy == NULL) {
+    return NULL;
+  }
+  return memcpy(keyCopy, pcKey, uLength);
+}
+
+/* The SymTable deconstructor */
+void SymTable_free(SymTable_T oSymTable) {
+  size_t u;
+  assert(oSymTable != NULL);
+
+  /* Keys in an arena all go away with it, without a walk, and borrowed
+  keys aren't ours to free. Removed entries have no key left */
+  if (oSymTable->arena != NULL) {
+    Arena_free(oSymTable->arena);
+  }
+  else if (! oSymTable->borrowed) {
+    for (u = 0; u < oSymTable->entryCount; u++) {
+      free((void *) oSymTable->Entries[u].Key);
+    }
+  }
+  /* This also frees Indices, which shares the block */
+  free(oSymTable->Entries);
+  free(oSymTable);
+}
+
+/* Implements the SymTable_getLength() function */
+size_t SymTable_getLength(SymTable_T oSymTable) {
+  assert(oSymTable != NULL);
+  return oSymTable->size;
+}
+
+/* A helper function used by every function that looks up a key. It
+takes in a SymTable_T oSymTable, a char * pcKey, its length uLength and
+uHash, the hash code of pcKey. It returns the index of the slot
+referring to the entry of pcKey if oSymTable contains it, and otherwise
+the index of the free slot at which the probe sequence for pcKey ends,
+which is where pcKey would be indexed.
+It does not change the contents of oSymTable */
+static size_t SymTable_find(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, size_t uHash) {
+  struct Entry *psEntry;
+  size_t uMask;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  uMask = oSymTable->capacity - 1;
+  for (u = SymTable_home(uHash, uMask);
+    oSymTable->Indices[u] != FREE; u = (u + 1) & uMask) {
+    /* As in symtableflat.c, strncmp stops at the end of a shorter
+    stored key, and a longer one fails the second test */
+    psEntry = &oSymTable->Entries[oSymTable->Indices[u] - 1];
+    if (psEntry->Hash == uHash && (oSymTable->interned ?
+      psEntry->Key == pcKey :
+      (strncmp(psEntry->Key, pcKey, uLength) == 0 &&
+      psEntry->Key[uLength] == '\0'))) {
+      break;
+    }
+  }
+  return u;
+}
+
+/* A helper function which makes room for one more entry at the end of
+Entries of SymTable_T oSymTable, which is full. If at least half of the
+bindings it can hold are live, it doubles the index; otherwise there
+are enough removed entries that squeezing them out makes room at the
+same size. It returns 1 if it succeeds, and 0, leaving oSymTable
+unchanged, if it can't. It is called by SymTable_putOrGetHashed */
+static int SymTable_expand(SymTable_T oSymTable) {
+  size_t uCapacity;
+  assert(oSymTable != NULL);
+
+  uCapacity = oSymTable->capacity;
+  if (oSymTable->size >= oSymTable->expandThreshold / 2) {
+    /* A tiny maximum load factor can take more than one doubling */
+    do {
+      /* We give up rather than let the number of slots wrap around */
+      if (uCapacity * 2 < uCapacity) {
+        return 0;
+      }
+      uCapacity *= 2;
+    } while (SymTable_threshold(uCapacity) <= oSymTable->size);
+  }
+  return SymTable_rebuild(oSymTable, uCapacity);
+}
+
+/* A helper function which works as SymTable_putOrGet, for a key pcKey
+of length uLength whose hash code is uHash. It is called by
+SymTable_putOrGetLen, SymTable_putBatch and
+SymTable_newFromArray */
+static int SymTable_putOrGetHashed(SymTable_T oSymTable,
+const char *pcKey, size_t uLength, size_t uHash, const void *pvValue,
+void **ppvValue) {
+  struct Entry *psEntry;
+  const char *keyCopy;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  /* This is the only probe for pcKey, unless the table is rebuilt */
+  u = SymTable_find(oSymTable, pcKey, uLength, uHash);
+  if (oSymTable->Indices[u] != FREE) {
+    if (ppvValue != NULL) {
+      *ppvValue = (void *)
+        oSymTable->Entries[oSymTable->Indices[u] - 1].Value;
+    }
+    return 0;
+  }
+
+  keyCopy = SymTable_copyKey(oSymTable, pcKey, uLength);
+  if (keyCopy == NULL) {
+    return -1;
+  }
+
+  /* If there is no entry left, we rebuild the table first. The free
+  slot we found moves with it, so we probe again, but only for a free
+  slot since we know pcKey is absent */
+  if (oSymTable->entryCount == oSymTable->expandThreshold) {
+    if (! SymTable_expand(oSymTable)) {
+      /* A copy in the arena stays there until the table is freed */
+      if (oSymTable->arena == NULL && ! oSymTable->borrowed) {
+        free((void *) keyCopy);
+      }
+      return -1;
+    }
+    for (u = SymTable_home(uHash, oSymTable->capacity - 1);
+      oSymTable->Indices[u] != FREE;
+      u = (u + 1) & (oSymTable->capacity - 1)) {
+    }
+  }
+
+  psEntry = &oSymTable->Entries[oSymTable->entryCount];
+  psEntry->Hash = uHash;
+  psEntry->Key = keyCopy;
+  psEntry->Value = pvValue;
+  oSymTable->entryCount++;
+  oSymTable->Indices[u] = oSymTable->entryCount;
+  oSymTable->size++;
+
+  if (ppvValue != NULL) {
+    *ppvValue = (void *) pvValue;
+  }
+  return 1;
+}
+
+/* A helper function which works as SymTable_putOrGet, for a key pcKey
+of length uLength. It is called by SymTable_putOrGet, SymTable_put and
+SymTable_putLen */
+static int SymTable_putOrGetLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, const void *pvValue, void **ppvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return SymTable_putOrGetHashed(oSymTable, pcKey, uLength,
+    oSymTable->hash(pcKey, uLength), pvValue, ppvValue);
+}
+
+/* A helper function which hashes the keys ppcKeys[uStart] up to
+ppcKeys[uEnd - 1] of SymTable_T oSymTable into auHashes, and their
+lengths into auLengths, both indexed from uStart. It prefetches the
+home slot of each key in Indices, so that the misses of the group
+overlap. It is called by SymTable_putBatch, SymTable_getBatch and
+SymTable_newFromArray */
+static void SymTable_prefetchGroup(SymTable_T oSymTable,
+const char * const *ppcKeys, size_t uStart, size_t uEnd,
+size_t *auHashes, size_t *auLengths) {
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL);
+  assert(auHashes != NULL);
+  assert(auLengths != NULL);
+
+  for (u = uStart; u < uEnd; u++) {
+    assert(ppcKeys[u] != NULL);
+    auLengths[u - uStart] = SymTable_length(oSymTable, ppcKeys[u]);
+    auHashes[u - uStart] = oSymTable->hash(ppcKeys[u],
+      auLengths[u - uStart]);
+    SYMTABLE_PREFETCH(&oSymTable->Indices[SymTable_home(
+      auHashes[u - uStart], oSymTable->capacity - 1)]);
+  }
+}
+
+/* Implements the SymTable_putBatch() function. The keys are taken
+BATCH_GROUP at a time, and the home slots of a whole group are
+prefetched before any of its keys is put */
+size_t SymTable_putBatch(SymTable_T oSymTable,
+const char * const *ppcKeys, const void * const *ppvValues,
+size_t uCount) {
+  size_t auLengths[BATCH_GROUP];
+  size_t auHashes[BATCH_GROUP];
+  size_t uAdded = 0;
+  size_t uStart;
+  size_t uEnd;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL);
+  assert(ppvValues != NULL);
+
+  for (uStart = 0; uStart < uCount; uStart = uEnd) {
+    uEnd = (uCount - uStart > BATCH_GROUP) ? uStart + BATCH_GROUP :
+      uCount;
+    SymTable_prefetchGroup(oSymTable, ppcKeys, uStart, uEnd, auHashes,
+      auLengths);
+    /* A put may rebuild the table, which only makes the remaining
+    prefetches of the group useless, not wrong */
+    for (u = uStart; u < uEnd; u++) {
+      if (SymTable_putOrGetHashed(oSymTable, ppcKeys[u],
+        auLengths[u - uStart], auHashes[u - uStart], ppvValues[u],
+        NULL) == 1) {
+        uAdded++;
+      }
+    }
+  }
+  return uAdded;
+}
+
+/* The SymTable constructor that takes an array of bindings. The table
+starts out with the slots for all of them, and with one chunk of its
+arena large enough for all their key copies. Then the keys are put
+BATCH_GROUP at a time, as SymTable_putBatch puts them, so no put
+allocates anything or rebuilds the table */
+SymTable_T SymTable_newFromArray(const char * const *ppcKeys,
+const void * const *ppvValues, size_t uCount) {
+  size_t auLengths[BATCH_GROUP];
+  size_t auHashes[BATCH_GROUP];
+  SymTable_T oSymTable;
+  size_t uKeyBytes = 0;
+  size_t uCapacity;
+  size_t uStart;
+  size_t uEnd;
+  size_t u;
+  assert(ppcKeys != NULL);
+  assert(ppvValues != NULL);
+
+  uCapacity = SymTable_hintCapacity(uCount);
+  if (uCapacity == 0) {
+    return NULL;
+  }
+  oSymTable = SymTable_newSized(NULL, SYMTABLE_ARENA, uCapacity);
+  if (oSymTable == NULL) {
+    return NULL;
+  }
+  for (u = 0; u < uCount; u++) {
+    assert(ppcKeys[u] != NULL);
+    uKeyBytes += strlen(ppcKeys[u]) + 1;
+  }
+  if (! Arena_reserve(oSymTable->arena, 0, uKeyBytes)) {
+    SymTable_free(oSymTable);
+    return NULL;
+  }
+
+  for (uStart = 0; uStart < uCount; uStart = uEnd) {
+    uEnd = (uCount - uStart > BATCH_GROUP) ? uStart + BATCH_GROUP :
+      uCount;
+    SymTable_prefetchGroup(oSymTable, ppcKeys, uStart, uEnd, auHashes,
+      auLengths);
+    /* A duplicate key is found in its probe sequence, and left out */
+    for (u = uStart; u < uEnd; u++) {
+      if (SymTable_putOrGetHashed(oSymTable, ppcKeys[u],
+        auLengths[u - uStart], auHashes[u - uStart], ppvValues[u],
+        NULL) < 0) {
+        SymTable_free(oSymTable);
+        return NULL;
+      }
+    }
+  }
+  return oSymTable;
+}
+
+/* Implements the SymTable_putOrGet() function */
+int SymTable_putOrGet(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue, void **ppvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return SymTable_putOrGetLen(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey), pvValue, ppvValue);
+}
+
+/* Implements the SymTable_put() function */
+int SymTable_put(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return (SymTable_putOrGetLen(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey), pvValue, NULL) == 1);
+}
+
+/* Implements the SymTable_putLen() function */
+int SymTable_putLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, const void *pvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return (SymTable_putOrGetLen(oSymTable, pcKey, uLength, pvValue,
+    NULL) == 1);
+}
+
+/* A helper function which takes in a SymTable_T oSymTable and a key
+pcKey of length uLength, and returns the entry of pcKey, or NULL if
+oSymTable doesn't contain it. It is called by SymTable_replace,
+SymTable_contains and SymTable_getLen */
+static struct Entry * SymTable_findEntry(SymTable_T oSymTable,
+const char *pcKey, size_t uLength) {
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  u = SymTable_find(oSymTable, pcKey, uLength,
+    oSymTable->hash(pcKey, uLength));
+  if (oSymTable->Indices[u] == FREE) {
+    return NULL;
+  }
+  return &oSymTable->Entries[oSymTable->Indices[u] - 1];
+}
+
+/* implements the SymTable_replace() function. The binding keeps its
+place in the order of SymTable_map */
+void * SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue) {
+  struct Entry *psEntry;
+  const void * oldValue;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  psEntry = SymTable_findEntry(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey));
+  if (psEntry == NULL) {
+    return NULL;
+  }
+  oldValue = psEntry->Value;
+  psEntry->Value = pvValue;
+
+  /* Here we have to "cast away the constness" */
+  return (void *) oldValue;
+}
+
+/* implements the SymTable_contains() function */
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return (SymTable_findEntry(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey)) != NULL);
+}
+
+/* implements the SymTable_get() function */
+void * SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return SymTable_getLen(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey));
+}
+
+/* implements the SymTable_getLen() function */
+void * SymTable_getLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength) {
+  struct Entry *psEntry;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  psEntry = SymTable_findEntry(oSymTable, pcKey, uLength);
+  if (psEntry == NULL) {
+    return NULL;
+  }
+  return (void *) psEntry->Value;
+}
+
+/* implements the SymTable_getBatch() function, which prefetches home
+slots just as SymTable_putBatch does */
+void SymTable_getBatch(SymTable_T oSymTable,
+const char * const *ppcKeys, size_t uCount, void **ppvValues) {
+  size_t auLengths[BATCH_GROUP];
+  size_t auHashes[BATCH_GROUP];
+  size_t uStart;
+  size_t uEnd;
+  size_t u;
+  size_t uSlot;
+  size_t uEntry;
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL);
+  assert(ppvValues != NULL);
+
+  for (uStart = 0; uStart < uCount; uStart = uEnd) {
+    uEnd = (uCount - uStart > BATCH_GROUP) ? uStart + BATCH_GROUP :
+      uCount;
+    SymTable_prefetchGroup(oSymTable, ppcKeys, uStart, uEnd, auHashes,
+      auLengths);
+    for (u = uStart; u < uEnd; u++) {
+      uSlot = SymTable_find(oSymTable, ppcKeys[u],
+        auLengths[u - uStart], auHashes[u - uStart]);
+      uEntry = oSymTable->Indices[uSlot];
+      ppvValues[u] = (uEntry == FREE) ? NULL :
+        (void *) oSymTable->Entries[uEntry - 1].Value;
+    }
+  }
+}
+
+/* A helper function which rebuilds SymTable_T oSymTable with fewer
+slots once fewer than a quarter of the bindings it has entries for are
+left, as symtableflat.c does. The new index holds twice the current
+size. It is called by SymTable_remove. If it can't allocate the smaller
+arrays, oSymTable just stays as large as it was */
+static void SymTable_shrink(SymTable_T oSymTable) {
+  size_t uCapacity;
+  assert(oSymTable != NULL);
+
+  if (oSymTable->capacity == INITIAL_CAPACITY ||
+    oSymTable->size >= oSymTable->expandThreshold / 4) {
+    return;
+  }
+  uCapacity = SymTable_fitCapacity(oSymTable, oSymTable->size * 2);
+  if (uCapacity < oSymTable->capacity) {
+    (void) SymTable_rebuild(oSymTable, uCapacity);
+  }
+}
+
+/* implements the SymTable_remove() function */
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+  struct Entry *psEntry;
+  void * toReturn;
+  size_t uLength;
+  size_t uMask;
+  size_t uHole;
+  size_t uHome;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  uLength = SymTable_length(oSymTable, pcKey);
+  uHole = SymTable_find(oSymTable, pcKey, uLength,
+    oSymTable->hash(pcKey, uLength));
+
+  /* The case where we didn't find the binding corresponding to pcKey*/
+  if (oSymTable->Indices[uHole] == FREE) {
+    return NULL;
+  }
+
+  psEntry = &oSymTable->Entries[oSymTable->Indices[uHole] - 1];
+  toReturn = (void *) psEntry->Value;
+
+  /* Since we created a defensive copy of the key, we have to free that
+  too, unless it is in the arena, which keeps it until it is freed, or
+  it was borrowed */
+  if (oSymTable->arena == NULL && ! oSymTable->borrowed) {
+    free((void *) psEntry->Key);
+  }
+  psEntry->Key = NULL;
+
+  /* The last entry can just be given back, so a table used as a stack
+  never needs squeezing */
+  if (psEntry == &oSymTable->Entries[oSymTable->entryCount - 1]) {
+    oSymTable->entryCount--;
+  }
+
+  /* As in symtableflat.c, we shift back every later slot of the cluster
+  whose probe sequence passes through the hole, rather than leave a
+  tombstone in Indices */
+  uMask = oSymTable->capacity - 1;
+  for (u = (uHole + 1) & uMask; oSymTable->Indices[u] != FREE;
+    u = (u + 1) & uMask) {
+    uHome = SymTable_home(
+      oSymTable->Entries[oSymTable->Indices[u] - 1].Hash, uMask);
+    /* The slot u must stay put if its home lies cyclically after the
+    hole, i.e. in (uHole, u] */
+    if (uHole <= u ? (uHole < uHome && uHome <= u) :
+      (uHole < uHome || uHome <= u)) {
+      continue;
+    }
+    oSymTable->Indices[uHole] = oSymTable->Indices[u];
+    uHole = u;
+  }
+  oSymTable->Indices[uHole] = FREE;
+  oSymTable->size--;
+  SymTable_shrink(oSymTable);
+  return toReturn;
+}
+
+/* implements the SymTable_compact() function. Besides shrinking the
+index, it squeezes every removed entry out of Entries */
+void SymTable_compact(SymTable_T oSymTable) {
+  size_t uCapacity;
+  assert(oSymTable != NULL);
+
+  uCapacity = SymTable_fitCapacity(oSymTable, oSymTable->size);
+  if (uCapacity < oSymTable->capacity ||
+    oSymTable->entryCount > oSymTable->size) {
+    (void) SymTable_rebuild(oSymTable, uCapacity);
+  }
+}
+
+/* implements the SymTable_freeze() function. A compact table has no
+frozen form, so oSymTable is left as it is */
+int SymTable_freeze(SymTable_T oSymTable) {
+  assert(oSymTable != NULL);
+  (void) oSymTable;
+  return 0;
+}
+
+/* implements the SymTable_map() function. It reads Entries from front
+to back, so pfApply sees the bindings in the order they were first put,
+and the cost follows the number of entries, not of slots */
+void SymTable_map(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  struct Entry *psEntry;
+  struct Entry *psEnd;
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  psEnd = oSymTable->Entries + oSymTable->entryCount;
+  for (psEntry = oSymTable->Entries; psEntry < psEnd; psEntry++) {
+    if (psEntry->Key != NULL) {
+      (*pfApply)(psEntry->Key, (void *) psEntry->Value,
+        (void *) pvExtra);
+    }
+  }
+}
+
+/* implements the SymTable_mapRange() function. The bindings aren't in
+order, so every one of them is checked */
+void SymTable_mapRange(SymTable_T oSymTable, const char *pcLow,
+const char *pcHigh,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+  Filter_mapRange(oSymTable, pcLow, pcHigh, pfApply, pvExtra);
+}
+
+/* implements the SymTable_mapPrefix() function, which checks every
+binding as SymTable_mapRange does */
+void SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  assert(oSymTable != NULL);
+  assert(pcPrefix != NULL);
+  assert(pfApply != NULL);
+  Filter_mapPrefix(oSymTable, pcPrefix, pfApply, pvExtra);
+}
+
+/* A helper function which applies pfApply, with pvExtra, to every
+binding in the entries from uStart up to but not including uEnd of the
+SymTable_T that pvTable is. It is the Parallel_RangeFn of
+SymTable_mapParallel */
+static void SymTable_mapEntries(void *pvTable, size_t uStart,
+size_t uEnd, Parallel_ApplyFn pfApply, void *pvExtra) {
+  SymTable_T oSymTable = (SymTable_T) pvTable;
+  struct Entry *psEntry;
+  struct Entry *psEnd;
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  psEnd = oSymTable->Entries + uEnd;
+  for (psEntry = oSymTable->Entries + uStart; psEntry < psEnd;
+    psEntry++) {
+    if (psEntry->Key != NULL) {
+      pfApply(psEntry->Key, (void *) psEntry->Value, pvExtra);
+    }
+  }
+}
+
+/* implements the SymTable_mapParallel() function. The threads share
+out ranges of entries, so each of them still reads its entries in the
+order they were put, though the threads run side by side */
+void SymTable_mapParallel(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+void * const *ppvExtras, size_t uThreads) {
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+  assert(uThreads > 0);
+  Parallel_map(oSymTable, oSymTable->entryCount, SymTable_mapEntries,
+    pfApply, ppvExtras, uThreads);
+}
+
+/* implements the SymTable_begin() function */
+void SymTable_begin(SymTable_T oSymTable, SymTable_Iter *psIter) {
+  assert(oSymTable != NULL);
+  assert(psIter != NULL);
+  psIter->oSymTable = oSymTable;
+  psIter->uPosition = 0;
+  psIter->pvCurrent = NULL;
+  psIter->pcKey = NULL;
+  psIter->pvValue = NULL;
+}
+
+/* implements the SymTable_next() function. uPosition is the first
+entry that hasn't been looked at yet, so the bindings come in the order
+they were put, as in SymTable_map */
+int SymTable_next(SymTable_Iter *psIter) {
+  const struct Entry *psEntry;
+  SymTable_T oSymTable;
+  assert(psIter != NULL);
+  assert(psIter->oSymTable != NULL);
+
+  oSymTable = psIter->oSymTable;
+  while (psIter->uPosition < oSymTable->entryCount) {
+    psEntry = &oSymTable->Entries[psIter->uPosition++];
+    if (psEntry->Key != NULL) {
+      psIter->pcKey = psEntry->Key;
+      psIter->pvValue = (void *) psEntry->Value;
+      return 1;
+    }
+  }
+  psIter->pcKey = NULL;
+  psIter->pvValue = NULL;
+  return 0;
+}
+
+/* implements the SymTable_iterKey() function */
+const char *SymTable_iterKey(const SymTable_Iter *psIter) {
+  assert(psIter != NULL);
+  assert(psIter->pcKey != NULL);
+  return psIter->pcKey;
+}
+
+/* implements the SymTable_iterValue() function */
+void *SymTable_iterValue(const SymTable_Iter *psIter) {
+  assert(psIter != NULL);
+  assert(psIter->pcKey != NULL);
+  return psIter->pvValue;
+}
+
+/* implements the SymTable_getStats() function. A compact table keeps no
+statistics, so every one of them is 0, and it returns 0 (FALSE) */
+int SymTable_getStats(SymTable_T oSymTable, SymTable_Stats *psStats) {
+  assert(oSymTable != NULL);
+  assert(psStats != NULL);
+  (void) oSymTable;
+  psStats->uHits = 0;
+  psStats->uMisses = 0;
+  psStats->uProbes = 0;
+  psStats->uExpansions = 0;
+  psStats->dExpandSeconds = 0.0;
+  psStats->uMaxMigrate = 0;
+  psStats->uMaxChain = 0;
+  psStats->dMeanChain = 0.0;
+  psStats->uBindingBytes = 0;
+  psStats->uKeyBytes = 0;
+  return 0;
+}
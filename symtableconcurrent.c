@@ -0,0 +1,953 @@
+/*--------------------------------------------------------------------*/
+/* symtableconcurrent.c                                               */
+/* Author: Ahmed Farah                                                */
+/* Implements the Symbol Table abstract data type (ADT), compliant    */
+/* with the interface in symtable.h                                   */
+/* It uses a hash-table implementation that many threads can use at   */
+/* once: the buckets are split into stripes, each with its own        */
+/* reader/writer lock                                                 */
+/*--------------------------------------------------------------------*/
+
+/* pthread_rwlock_t is POSIX, not ANSI C */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <string.h>
+#include <pthread.h>
+#include "symtable.h"
+#include "filter.h"
+#include "hashfn.h"
+#include "parallel.h"
+
+/* The number of stripes, i.e. of locks. It can be overridden at compile
+time, e.g. with -DSYMTABLE_STRIPES=16. It must be a power of 2, since a
+key's stripe is the low-order bits of its mixed hash code */
+#ifndef SYMTABLE_STRIPES
+#define SYMTABLE_STRIPES 64
+#endif
+#if SYMTABLE_STRIPES <= 0 || (SYMTABLE_STRIPES & (SYMTABLE_STRIPES - 1))
+#error "SYMTABLE_STRIPES must be a power of 2"
+#endif
+
+/* The maximum load factor, as a percentage, as in symtablehash.c. Each
+stripe checks it against its own share of the buckets */
+#ifndef SYMTABLE_MAX_LOAD_PERCENT
+#define SYMTABLE_MAX_LOAD_PERCENT 100
+#endif
+#if SYMTABLE_MAX_LOAD_PERCENT <= 0
+#error "SYMTABLE_MAX_LOAD_PERCENT must be positive"
+#endif
+
+/* The number of buckets of each stripe in a new symbol table. It must
+be a power of 2 */
+enum {INITIAL_STRIPE_BUCKETS = 8};
+
+/* The number of bytes of padding after the fields of a stripe, so that
+two threads working on neighbouring stripes don't write to the same
+cache line */
+enum {STRIPE_PADDING = 64};
+
+/* A Binding is made up of 5 parts, just like in symtablehash.c: Key,
+Value, Hash, the full hash code of Key, Length, the length of Key, and
+psNextBinding, the next binding of its chain. */
+struct Binding {
+  /* Symbol table key */
+  const char * Key;
+  /* Symbol table value */
+  const void * Value;
+  /* The hash code of Key, before it is mixed and reduced to a bucket
+  index */
+  size_t Hash;
+  /* The number of characters of Key, not counting its '\0' */
+  size_t Length;
+  /* The next binding  */
+  struct Binding * psNextBinding;
+};
+
+/* A Stripe is the lock that guards a fixed subset of the buckets, the
+number of bindings in those buckets, and the limit that number may
+reach before a put into the stripe checks whether the whole table is
+due to expand. */
+struct Stripe {
+  /* Held for reading to look up a key of the stripe, and for writing
+  to change its buckets, its size or its limit */
+  pthread_rwlock_t lock;
+  /* The number of bindings in the buckets of the stripe */
+  size_t size;
+  /* The size past which a put checks the size of the table */
+  size_t limit;
+  /* Only here to keep the next stripe off this cache line */
+  char acPadding[STRIPE_PADDING];
+};
+
+/* This is a hash-table implementation of a symbol table that can be
+shared by many threads. Bindings is an array of bucketCount chains,
+where bucketCount is always a power of 2 and a multiple of
+SYMTABLE_STRIPES. The mixed hash code of a key picks its bucket with
+a mask of bucketCount - 1, and its stripe with a mask of
+SYMTABLE_STRIPES - 1, so bucket b belongs to stripe
+b % SYMTABLE_STRIPES, whatever bucketCount is. A key therefore never
+changes stripe, and holding the lock of its stripe is enough to look it
+up or change its binding. Bindings and bucketCount only change during an
+expansion, which holds every lock for writing, so holding any one lock
+is also enough to read them. There is no total size: each stripe
+counts its own bindings under its own lock, so that writers to
+different stripes share nothing, and SymTable_getLength adds the counts
+up. The table expands when that total passes the load limit, however
+the bindings are spread over the stripes: each stripe gets an even
+share of the room left, and only a put that takes its stripe past that
+share takes every lock to add the counts up. hash is the function that
+computes the hash
+code of every key. borrowed is set if the table was made with
+SYMTABLE_BORROWED, and its bindings hold their callers' keys instead of
+copies. interned is set if it was made with SYMTABLE_INTERNED, and
+compares its keys by address; borrowed is then set too. */
+struct SymTable {
+  /* The buckets of the symbol table */
+  struct Binding **Bindings;
+  /* The number of buckets. Always a power of 2 */
+  size_t bucketCount;
+  /* The hash function of the table */
+  SymTable_HashFn hash;
+  /* Whether the keys belong to the caller rather than to the table */
+  int borrowed;
+  /* Whether keys are compared by address rather than by characters */
+  int interned;
+  /* The stripes, each with the lock of its buckets */
+  struct Stripe stripes[SYMTABLE_STRIPES];
+};
+
+/* A Helper function which takes in the hash code uHash of a key and
+returns it mixed, so that all of its bits affect the low-order ones
+that pick the stripe and the bucket. It is called by SymTable_stripe
+and SymTable_bucket */
+static size_t SymTable_mix(size_t uHash) {
+  uHash ^= uHash >> 15;
+  uHash *= 0x2c1b3c6dU;
+  uHash ^= uHash >> 12;
+  uHash *= 0x297a2d39U;
+  uHash ^= uHash >> 15;
+  return uHash;
+}
+
+/* A Helper function which takes in a SymTable_T oSymTable and the hash
+code uHash of a key, and returns the stripe of that key */
+static struct Stripe * SymTable_stripe(SymTable_T oSymTable,
+size_t uHash) {
+  assert(oSymTable != NULL);
+  return &oSymTable->stripes[SymTable_mix(uHash) &
+    (SYMTABLE_STRIPES - 1)];
+}
+
+/* A Helper function which takes in a SymTable_T oSymTable and the hash
+code uHash of a key, and returns a pointer to the bucket of that key.
+The caller must hold the lock of the key's stripe */
+static struct Binding ** SymTable_bucket(SymTable_T oSymTable,
+size_t uHash) {
+  assert(oSymTable != NULL);
+  return &oSymTable->Bindings[SymTable_mix(uHash) &
+    (oSymTable->bucketCount - 1)];
+}
+
+/* A Helper function which returns the number of bindings that uBuckets
+buckets can hold before their load factor passes
+SYMTABLE_MAX_LOAD_PERCENT. It is called by SymTable_setLimits,
+SymTable_newWithCapacity and SymTable_compact */
+static size_t SymTable_threshold(size_t uBuckets) {
+  /* We divide first when multiplying first could overflow */
+  if (uBuckets > (size_t) -1 / SYMTABLE_MAX_LOAD_PERCENT) {
+    return uBuckets / 100 * SYMTABLE_MAX_LOAD_PERCENT;
+  }
+  return uBuckets * SYMTABLE_MAX_LOAD_PERCENT / 100;
+}
+
+/* A helper function which sets the limit of every stripe of SymTable_T
+oSymTable to its size plus an even share of the bindings the table can
+still take before it passes SYMTABLE_MAX_LOAD_PERCENT, or plus 1 if
+there is no room left. Until some stripe passes its limit the table
+then holds at most SYMTABLE_STRIPES bindings more than its load limit.
+The caller must hold every lock, or be the only thread that knows
+oSymTable. It is called by SymTable_newSized, SymTable_expand and
+SymTable_compact */
+static void SymTable_setLimits(SymTable_T oSymTable) {
+  size_t uThreshold;
+  size_t uTotal = 0;
+  size_t uShare = 1;
+  size_t u;
+  assert(oSymTable != NULL);
+
+  for (u = 0; u < SYMTABLE_STRIPES; u++) {
+    uTotal += oSymTable->stripes[u].size;
+  }
+  uThreshold = SymTable_threshold(oSymTable->bucketCount);
+  if (uThreshold > uTotal &&
+    (uThreshold - uTotal) / SYMTABLE_STRIPES > uShare) {
+    uShare = (uThreshold - uTotal) / SYMTABLE_STRIPES;
+  }
+  for (u = 0; u < SYMTABLE_STRIPES; u++) {
+    oSymTable->stripes[u].limit = oSymTable->stripes[u].size + uShare;
+  }
+}
+
+/* A helper function which locks every stripe of SymTable_T oSymTable
+for writing. The locks are always taken in the same order, so that two
+threads doing this can't deadlock */
+static void SymTable_lockAll(SymTable_T oSymTable) {
+  size_t u;
+  assert(oSymTable != NULL);
+  for (u = 0; u < SYMTABLE_STRIPES; u++) {
+    pthread_rwlock_wrlock(&oSymTable->stripes[u].lock);
+  }
+}
+
+/* A helper function which unlocks every stripe of SymTable_T
+oSymTable, which SymTable_lockAll locked */
+static void SymTable_unlockAll(SymTable_T oSymTable) {
+  size_t u;
+  assert(oSymTable != NULL);
+  for (u = SYMTABLE_STRIPES; u > 0; u--) {
+    pthread_rwlock_unlock(&oSymTable->stripes[u - 1].lock);
+  }
+}
+
+/* The SymTable constructor */
+SymTable_T SymTable_new(void) {
+  return SymTable_newWithFlags(0);
+}
+
+/* The SymTable constructor that takes flags. An arena isn't safe to
+share between threads, and an incremental expansion would have every
+lookup move buckets around, so both flags are ignored. SYMTABLE_BORROWED
+and SYMTABLE_INTERNED are honored */
+SymTable_T SymTable_newWithFlags(unsigned int uFlags) {
+  return SymTable_newWithHash(NULL, uFlags);
+}
+
+/* A helper function which works as SymTable_newWithHash, for a table
+that starts out with uStripeBuckets buckets per stripe, a power of 2.
+It is called by SymTable_newWithHash and SymTable_newWithCapacity */
+static SymTable_T SymTable_newSized(SymTable_HashFn pfHash,
+unsigned int uFlags, size_t uStripeBuckets) {
+  SymTable_T oSymTable;
+  size_t u;
+
+  oSymTable = (SymTable_T) malloc(sizeof(struct SymTable));
+  if (oSymTable == NULL) {
+    return NULL;
+  }
+  oSymTable->bucketCount = SYMTABLE_STRIPES * uStripeBuckets;
+  oSymTable->Bindings = (struct Binding **)
+    calloc(oSymTable->bucketCount, sizeof(struct Binding *));
+  if (oSymTable->Bindings == NULL) {
+    free(oSymTable);
+    return NULL;
+  }
+  for (u = 0; u < SYMTABLE_STRIPES; u++) {
+    if (pthread_rwlock_init(&oSymTable->stripes[u].lock, NULL) != 0) {
+      /* We undo the locks made so far */
+      while (u > 0) {
+        u--;
+        pthread_rwlock_destroy(&oSymTable->stripes[u].lock);
+      }
+      free(oSymTable->Bindings);
+      free(oSymTable);
+      return NULL;
+    }
+    oSymTable->stripes[u].size = 0;
+  }
+  SymTable_setLimits(oSymTable);
+  oSymTable->interned = ((uFlags & SYMTABLE_INTERNED) != 0);
+  oSymTable->borrowed = ((uFlags & SYMTABLE_BORROWED) != 0 ||
+    oSymTable->interned);
+  oSymTable->hash = pfHash;
+  if (pfHash == NULL) {
+    oSymTable->hash = HashFn_multiplicative;
+  }
+  if (oSymTable->interned) {
+    oSymTable->hash = HashFn_address;
+  }
+  return oSymTable;
+}
+
+/* The SymTable constructor that takes a hash function */
+SymTable_T SymTable_newWithHash(SymTable_HashFn pfHash,
+unsigned int uFlags) {
+  return SymTable_newSized(pfHash, uFlags, INITIAL_STRIPE_BUCKETS);
+}
+
+/* The SymTable constructor that takes a capacity. Every stripe gets
+enough buckets for its even share of uHint bindings, doubling from
+INITIAL_STRIPE_BUCKETS as SymTable_expand would. The table only
+expands once it holds more than uHint bindings in all, however they
+are spread over the stripes */
+SymTable_T SymTable_newWithCapacity(size_t uHint) {
+  size_t uStripeBuckets = INITIAL_STRIPE_BUCKETS;
+  size_t uShare;
+  uShare = uHint / SYMTABLE_STRIPES + 1;
+  while (SymTable_threshold(uStripeBuckets) < uShare) {
+    /* A table this large couldn't be allocated anyway */
+    if (uStripeBuckets > (size_t) -1 / 2 / SYMTABLE_STRIPES) {
+      return NULL;
+    }
+    uStripeBuckets *= 2;
+  }
+  return SymTable_newSized(NULL, 0, uStripeBuckets);
+}
+
+/* The SymTable deconstructor. No other thread may be using oSymTable */
+void SymTable_free(SymTable_T oSymTable) {
+  struct Binding *psCurrentBinding;
+  struct Binding *psNextBinding;
+  size_t u;
+  assert(oSymTable != NULL);
+
+  for (u = 0; u < oSymTable->bucketCount; u++) {
+    for (psCurrentBinding = oSymTable->Bindings[u];
+      psCurrentBinding != NULL; psCurrentBinding = psNextBinding) {
+      psNextBinding = psCurrentBinding->psNextBinding;
+      if (! oSymTable->borrowed) {
+        free((void *) psCurrentBinding->Key);
+      }
+      free(psCurrentBinding);
+    }
+  }
+  for (u = 0; u < SYMTABLE_STRIPES; u++) {
+    pthread_rwlock_destroy(&oSymTable->stripes[u].lock);
+  }
+  free(oSymTable->Bindings);
+  free(oSymTable);
+}
+
+/* Implements the SymTable_getLength() function. It adds up the sizes
+of the stripes, taking their locks one at a time, so a length read
+while other threads put or remove may count some of their changes and
+not others */
+size_t SymTable_getLength(SymTable_T oSymTable) {
+  size_t uLength = 0;
+  size_t u;
+  assert(oSymTable != NULL);
+
+  for (u = 0; u < SYMTABLE_STRIPES; u++) {
+    pthread_rwlock_rdlock(&oSymTable->stripes[u].lock);
+    uLength += oSymTable->stripes[u].size;
+    pthread_rwlock_unlock(&oSymTable->stripes[u].lock);
+  }
+  return uLength;
+}
+
+/* A helper function which takes in a SymTable_T oSymTable and a key
+pcKey, and returns the length of pcKey as a size_t. A table that
+compares keys by address never needs it, so it returns 0 without
+reading pcKey then. It is called by every function that is given a key
+without its length */
+static size_t SymTable_length(SymTable_T oSymTable, const char *pcKey) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  if (oSymTable->interned) {
+    return 0;
+  }
+  return strlen(pcKey);
+}
+
+/* A helper function which takes in the first binding of a chain,
+psFirstBinding, a char * pcKey, its length uLength, its hash code uHash
+and iInterned, which is 1 if keys are compared by address, and returns
+the binding of the chain whose key is pcKey, or NULL if there is none */
+static struct Binding * SymTable_findInChain(
+struct Binding *psFirstBinding, const char *pcKey, size_t uLength,
+size_t uHash, int iInterned) {
+  struct Binding *psCurrentBinding;
+  assert(pcKey != NULL);
+  for (psCurrentBinding = psFirstBinding;
+    psCurrentBinding != NULL;
+    psCurrentBinding = psCurrentBinding->psNextBinding) {
+    if (psCurrentBinding->Hash == uHash && (iInterned ?
+      psCurrentBinding->Key == pcKey :
+      (psCurrentBinding->Length == uLength &&
+      memcmp(psCurrentBinding->Key, pcKey, uLength) == 0))) {
+      return psCurrentBinding;
+    }
+  }
+  return NULL;
+}
+
+/* A Helper function which relinks every binding of SymTable_T
+oSymTable into a new array of uBucketCount buckets, a power of 2 and a
+multiple of SYMTABLE_STRIPES. The caller must hold every lock. It is
+called by SymTable_expand and SymTable_compact. If it can't allocate
+the new array it leaves oSymTable as it was, and it returns nothing
+either way */
+static void SymTable_rehash(SymTable_T oSymTable, size_t uBucketCount) {
+  struct Binding **ppsNewBindings;
+  struct Binding *psCurrentBinding;
+  struct Binding *psNextBinding;
+  struct Binding **ppsBucket;
+  size_t uOldCount;
+  size_t u;
+  assert(oSymTable != NULL);
+
+  ppsNewBindings = (struct Binding **)
+    calloc(uBucketCount, sizeof(struct Binding *));
+  if (ppsNewBindings == NULL) {
+    return;
+  }
+
+  /* As in symtablehash.c, the bindings are relinked, not copied */
+  uOldCount = oSymTable->bucketCount;
+  oSymTable->bucketCount = uBucketCount;
+  for (u = 0; u < uOldCount; u++) {
+    for (psCurrentBinding = oSymTable->Bindings[u];
+      psCurrentBinding != NULL; psCurrentBinding = psNextBinding) {
+      psNextBinding = psCurrentBinding->psNextBinding;
+      ppsBucket = &ppsNewBindings[SymTable_mix(psCurrentBinding->Hash)
+        & (oSymTable->bucketCount - 1)];
+      psCurrentBinding->psNextBinding = *ppsBucket;
+      *ppsBucket = psCurrentBinding;
+    }
+  }
+  free(oSymTable->Bindings);
+  oSymTable->Bindings = ppsNewBindings;
+}
+
+/* A Helper function which is called by SymTable_putOrGetLen, with no
+lock held, once a stripe of SymTable_T oSymTable passes its limit. With
+every lock held it adds up the sizes of the stripes, and doubles the
+number of buckets if the total has passed SYMTABLE_MAX_LOAD_PERCENT of
+them - another thread may have expanded oSymTable already. Either way
+it gives every stripe a new limit. If it can't allocate the new array
+it leaves oSymTable as it was, which only makes chains longer */
+static void SymTable_expand(SymTable_T oSymTable) {
+  size_t uTotal = 0;
+  size_t u;
+  assert(oSymTable != NULL);
+
+  /* Lookups of every stripe wait until the new array is in place */
+  SymTable_lockAll(oSymTable);
+  for (u = 0; u < SYMTABLE_STRIPES; u++) {
+    uTotal += oSymTable->stripes[u].size;
+  }
+  if (uTotal > SymTable_threshold(oSymTable->bucketCount) &&
+    oSymTable->bucketCount * 2 > oSymTable->bucketCount) {
+    SymTable_rehash(oSymTable, oSymTable->bucketCount * 2);
+  }
+  SymTable_setLimits(oSymTable);
+  SymTable_unlockAll(oSymTable);
+}
+
+/* A helper function which works as SymTable_putOrGet, for a key pcKey
+of length uLength. It is called by SymTable_putOrGet, SymTable_put,
+SymTable_putLen and SymTable_newFromArray */
+static int SymTable_putOrGetLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, const void *pvValue, void **ppvValue) {
+  struct Binding *psNewBinding;
+  struct Binding **ppsBucket;
+  struct Stripe *psStripe;
+  char *keyCopy;
+  size_t uHash;
+  int iExpand;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  uHash = oSymTable->hash(pcKey, uLength);
+  psStripe = SymTable_stripe(oSymTable, uHash);
+  pthread_rwlock_wrlock(&psStripe->lock);
+
+  ppsBucket = SymTable_bucket(oSymTable, uHash);
+  psNewBinding = SymTable_findInChain(*ppsBucket, pcKey, uLength,
+    uHash, oSymTable->interned);
+  if (psNewBinding != NULL) {
+    if (ppvValue != NULL) {
+      *ppvValue = (void *) psNewBinding->Value;
+    }
+    pthread_rwlock_unlock(&psStripe->lock);
+    return 0;
+  }
+
+  /* We make a memory allocation for the new binding and, unless the
+  key is borrowed, a defensive copy of the key */
+  psNewBinding = (struct Binding*) malloc(sizeof(struct Binding));
+  keyCopy = NULL;
+  if (psNewBinding != NULL && ! oSymTable->borrowed) {
+    keyCopy = (char *) calloc(uLength + 1, sizeof(char));
+    if (keyCopy == NULL) {
+      free(psNewBinding);
+      psNewBinding = NULL;
+    }
+  }
+  if (psNewBinding == NULL) {
+    pthread_rwlock_unlock(&psStripe->lock);
+    return -1;
+  }
+  if (keyCopy == NULL) {
+    assert(oSymTable->interned || pcKey[uLength] == '\0');
+    psNewBinding->Key = pcKey;
+  }
+  else {
+    psNewBinding->Key = memcpy(keyCopy, pcKey, uLength);
+  }
+  psNewBinding->Value = pvValue;
+  psNewBinding->Hash = uHash;
+  psNewBinding->Length = uLength;
+  psNewBinding->psNextBinding = *ppsBucket;
+  *ppsBucket = psNewBinding;
+  psStripe->size++;
+  iExpand = (psStripe->size > psStripe->limit);
+  pthread_rwlock_unlock(&psStripe->lock);
+
+  /* The expansion takes every lock, so we must give ours back first */
+  if (iExpand) {
+    SymTable_expand(oSymTable);
+  }
+
+  if (ppvValue != NULL) {
+    *ppvValue = (void *) pvValue;
+  }
+  return 1;
+}
+
+/* Implements the SymTable_putOrGet() function */
+int SymTable_putOrGet(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue, void **ppvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return SymTable_putOrGetLen(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey), pvValue, ppvValue);
+}
+
+/* Implements the SymTable_put() function */
+int SymTable_put(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return (SymTable_putOrGetLen(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey), pvValue, NULL) == 1);
+}
+
+/* Implements the SymTable_putLen() function */
+int SymTable_putLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, const void *pvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return (SymTable_putOrGetLen(oSymTable, pcKey, uLength, pvValue,
+    NULL) == 1);
+}
+
+/* Implements the SymTable_putBatch() function. Each key is put under
+the lock of its own stripe, so it is just a loop of SymTable_put, and
+other threads may see some of the batch before the rest */
+size_t SymTable_putBatch(SymTable_T oSymTable,
+const char * const *ppcKeys, const void * const *ppvValues,
+size_t uCount) {
+  size_t uAdded = 0;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL);
+  assert(ppvValues != NULL);
+
+  for (u = 0; u < uCount; u++) {
+    if (SymTable_put(oSymTable, ppcKeys[u], ppvValues[u])) {
+      uAdded++;
+    }
+  }
+  return uAdded;
+}
+
+/* The SymTable constructor that takes an array of bindings. The
+buckets are sized for all of them by SymTable_newWithCapacity. This
+implementation has no arena, so every binding and key copy is still
+allocated on its own. No other thread can see the table yet, but each
+put takes the lock of its stripe as usual */
+SymTable_T SymTable_newFromArray(const char * const *ppcKeys,
+const void * const *ppvValues, size_t uCount) {
+  SymTable_T oSymTable;
+  size_t u;
+  assert(ppcKeys != NULL);
+  assert(ppvValues != NULL);
+
+  oSymTable = SymTable_newWithCapacity(uCount);
+  if (oSymTable == NULL) {
+    return NULL;
+  }
+  /* A duplicate key is found in its bucket, and left out */
+  for (u = 0; u < uCount; u++) {
+    assert(ppcKeys[u] != NULL);
+    if (SymTable_putOrGetLen(oSymTable, ppcKeys[u],
+      strlen(ppcKeys[u]), ppvValues[u], NULL) < 0) {
+      SymTable_free(oSymTable);
+      return NULL;
+    }
+  }
+  return oSymTable;
+}
+
+/* implements the SymTable_replace() function */
+void * SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue) {
+  struct Binding * desiredBinding;
+  struct Stripe *psStripe;
+  const void * oldValue = NULL;
+  size_t uLength;
+  size_t uHash;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  uLength = SymTable_length(oSymTable, pcKey);
+  uHash = oSymTable->hash(pcKey, uLength);
+  psStripe = SymTable_stripe(oSymTable, uHash);
+  pthread_rwlock_wrlock(&psStripe->lock);
+  desiredBinding = SymTable_findInChain(
+    *SymTable_bucket(oSymTable, uHash), pcKey, uLength, uHash,
+    oSymTable->interned);
+  if (desiredBinding != NULL) {
+    oldValue = desiredBinding->Value;
+    desiredBinding->Value = pvValue;
+  }
+  pthread_rwlock_unlock(&psStripe->lock);
+
+  /* Here we have to "cast away the constness" */
+  return (void *) oldValue;
+}
+
+/* A helper function which looks up the key pcKey, of length uLength,
+in SymTable_T oSymTable under the read lock of its stripe. It returns
+1 and stores the bound value in *ppvValue if it finds pcKey, and
+returns 0 otherwise. It is called by SymTable_contains and
+SymTable_getLen */
+static int SymTable_lookup(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, void **ppvValue) {
+  struct Binding * desiredBinding;
+  struct Stripe *psStripe;
+  size_t uHash;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  assert(ppvValue != NULL);
+
+  uHash = oSymTable->hash(pcKey, uLength);
+  psStripe = SymTable_stripe(oSymTable, uHash);
+  pthread_rwlock_rdlock(&psStripe->lock);
+  desiredBinding = SymTable_findInChain(
+    *SymTable_bucket(oSymTable, uHash), pcKey, uLength, uHash,
+    oSymTable->interned);
+  if (desiredBinding != NULL) {
+    *ppvValue = (void *) desiredBinding->Value;
+  }
+  pthread_rwlock_unlock(&psStripe->lock);
+  return (desiredBinding != NULL);
+}
+
+/* implements the SymTable_contains() function */
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+  void *pvValue;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return SymTable_lookup(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey), &pvValue);
+}
+
+/* implements the SymTable_get() function */
+void * SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return SymTable_getLen(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey));
+}
+
+/* implements the SymTable_getLen() function */
+void * SymTable_getLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength) {
+  void *pvValue;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  if (! SymTable_lookup(oSymTable, pcKey, uLength, &pvValue)) {
+    return NULL;
+  }
+  return pvValue;
+}
+
+/* implements the SymTable_getBatch() function, as a loop of
+SymTable_get. Buckets can only be read under their stripe's lock, so
+they aren't prefetched */
+void SymTable_getBatch(SymTable_T oSymTable,
+const char * const *ppcKeys, size_t uCount, void **ppvValues) {
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL);
+  assert(ppvValues != NULL);
+
+  for (u = 0; u < uCount; u++) {
+    ppvValues[u] = SymTable_get(oSymTable, ppcKeys[u]);
+  }
+}
+
+/* implements the SymTable_remove() function */
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+  struct Binding *psCurrentBinding;
+  struct Binding **ppsLink;
+  struct Stripe *psStripe;
+  void * toReturn;
+  size_t uLength;
+  size_t uHash;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  uLength = SymTable_length(oSymTable, pcKey);
+  uHash = oSymTable->hash(pcKey, uLength);
+  psStripe = SymTable_stripe(oSymTable, uHash);
+  pthread_rwlock_wrlock(&psStripe->lock);
+
+  /* ppsLink points at whatever points at the binding we look at, so
+  unlinking it is the same at the head of the chain and further on */
+  for (ppsLink = SymTable_bucket(oSymTable, uHash); *ppsLink != NULL;
+    ppsLink = &(*ppsLink)->psNextBinding) {
+    if ((*ppsLink)->Hash == uHash && (oSymTable->interned ?
+      (*ppsLink)->Key == pcKey : ((*ppsLink)->Length == uLength &&
+      memcmp((*ppsLink)->Key, pcKey, uLength) == 0))) {
+      break;
+    }
+  }
+  psCurrentBinding = *ppsLink;
+  if (psCurrentBinding == NULL) {
+    pthread_rwlock_unlock(&psStripe->lock);
+    return NULL;
+  }
+  *ppsLink = psCurrentBinding->psNextBinding;
+  psStripe->size--;
+  pthread_rwlock_unlock(&psStripe->lock);
+
+  /* No other thread can reach the binding any more */
+  toReturn = (void *) psCurrentBinding->Value;
+  if (! oSymTable->borrowed) {
+    free((void *) psCurrentBinding->Key);
+  }
+  free(psCurrentBinding);
+  return toReturn;
+}
+
+/* implements the SymTable_compact() function. A remove only holds the
+lock of one stripe, so this table never shrinks by itself; here every
+lock is held, and the buckets are halved, down to
+INITIAL_STRIPE_BUCKETS per stripe, for as long as all the bindings
+would still fit under SymTable_threshold */
+void SymTable_compact(SymTable_T oSymTable) {
+  size_t uBucketCount;
+  size_t uTotal = 0;
+  size_t u;
+  assert(oSymTable != NULL);
+
+  SymTable_lockAll(oSymTable);
+  for (u = 0; u < SYMTABLE_STRIPES; u++) {
+    uTotal += oSymTable->stripes[u].size;
+  }
+  uBucketCount = oSymTable->bucketCount;
+  while (uBucketCount > INITIAL_STRIPE_BUCKETS * SYMTABLE_STRIPES &&
+    SymTable_threshold(uBucketCount / 2) >= uTotal) {
+    uBucketCount /= 2;
+  }
+  if (uBucketCount < oSymTable->bucketCount) {
+    SymTable_rehash(oSymTable, uBucketCount);
+  }
+  SymTable_setLimits(oSymTable);
+  SymTable_unlockAll(oSymTable);
+}
+
+/* implements the SymTable_freeze() function. A striped table has no
+frozen form, so oSymTable is left as it is */
+int SymTable_freeze(SymTable_T oSymTable) {
+  assert(oSymTable != NULL);
+  (void) oSymTable;
+  return 0;
+}
+
+/* implements the SymTable_map() function. The stripes are walked one
+at a time, each under its read lock, so other threads can keep using
+the others. A binding that is in oSymTable for the whole call is
+visited exactly once; one that is put or removed by another thread
+during the call may or may not be. pfApply must not call any function
+on oSymTable: a lock map holds could make it wait forever, for
+instance behind an expansion that is waiting for that lock */
+void SymTable_map(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  struct Binding *psCurrentBinding;
+  size_t uStripe;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  for (uStripe = 0; uStripe < SYMTABLE_STRIPES; uStripe++) {
+    pthread_rwlock_rdlock(&oSymTable->stripes[uStripe].lock);
+    /* The buckets of a stripe are every SYMTABLE_STRIPES-th one */
+    for (u = uStripe; u < oSymTable->bucketCount;
+      u += SYMTABLE_STRIPES) {
+      for (psCurrentBinding = oSymTable->Bindings[u];
+        psCurrentBinding != NULL;
+        psCurrentBinding = psCurrentBinding->psNextBinding) {
+        pfApply(psCurrentBinding->Key, (void *) psCurrentBinding->Value,
+        (void *) pvExtra);
+      }
+    }
+    pthread_rwlock_unlock(&oSymTable->stripes[uStripe].lock);
+  }
+}
+
+/* implements the SymTable_mapRange() function. The bindings aren't in
+order, so every one of them is checked */
+void SymTable_mapRange(SymTable_T oSymTable, const char *pcLow,
+const char *pcHigh,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+  Filter_mapRange(oSymTable, pcLow, pcHigh, pfApply, pvExtra);
+}
+
+/* implements the SymTable_mapPrefix() function, which checks every
+binding as SymTable_mapRange does */
+void SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  assert(oSymTable != NULL);
+  assert(pcPrefix != NULL);
+  assert(pfApply != NULL);
+  Filter_mapPrefix(oSymTable, pcPrefix, pfApply, pvExtra);
+}
+
+/* A helper function which applies pfApply, with pvExtra, to every
+binding in the buckets from uStart up to but not including uEnd of the
+SymTable_T that pvTable is, counting buckets stripe by stripe as
+SymTable_next does. It holds the read lock of each stripe while it
+walks the buckets of that stripe. It is the Parallel_RangeFn of
+SymTable_mapParallel */
+static void SymTable_mapBuckets(void *pvTable, size_t uStart,
+size_t uEnd, Parallel_ApplyFn pfApply, void *pvExtra) {
+  SymTable_T oSymTable = (SymTable_T) pvTable;
+  struct Binding *psCurrentBinding;
+  size_t uStripeBuckets;
+  size_t uStripe;
+  size_t uStop;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  /* No thread may change oSymTable during SymTable_mapParallel, so
+  the number of buckets stays put between ranges */
+  uStripeBuckets = oSymTable->bucketCount / SYMTABLE_STRIPES;
+  while (uStart < uEnd) {
+    uStripe = uStart / uStripeBuckets;
+    uStop = (uStripe + 1) * uStripeBuckets;
+    if (uStop > uEnd) {
+      uStop = uEnd;
+    }
+    pthread_rwlock_rdlock(&oSymTable->stripes[uStripe].lock);
+    for (u = uStart; u < uStop; u++) {
+      for (psCurrentBinding = oSymTable->Bindings[
+        u % uStripeBuckets * SYMTABLE_STRIPES + uStripe];
+        psCurrentBinding != NULL;
+        psCurrentBinding = psCurrentBinding->psNextBinding) {
+        pfApply(psCurrentBinding->Key, (void *) psCurrentBinding->Value,
+        pvExtra);
+      }
+    }
+    pthread_rwlock_unlock(&oSymTable->stripes[uStripe].lock);
+    uStart = uStop;
+  }
+}
+
+/* implements the SymTable_mapParallel() function. The threads share
+out ranges of buckets, each range within as few stripes as it can */
+void SymTable_mapParallel(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+void * const *ppvExtras, size_t uThreads) {
+  size_t uBucketCount;
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+  assert(uThreads > 0);
+
+  /* Any one lock is enough to read the number of buckets */
+  pthread_rwlock_rdlock(&oSymTable->stripes[0].lock);
+  uBucketCount = oSymTable->bucketCount;
+  pthread_rwlock_unlock(&oSymTable->stripes[0].lock);
+  Parallel_map(oSymTable, uBucketCount, SymTable_mapBuckets, pfApply,
+    ppvExtras, uThreads);
+}
+
+/* implements the SymTable_begin() function. Unlike
+SymTable_map, an iteration holds no lock, since its caller may stop at
+any point without telling us; no thread may change oSymTable until it
+is done, though any number of them may read it */
+void SymTable_begin(SymTable_T oSymTable, SymTable_Iter *psIter) {
+  assert(oSymTable != NULL);
+  assert(psIter != NULL);
+  psIter->oSymTable = oSymTable;
+  psIter->uPosition = 0;
+  psIter->pvCurrent = NULL;
+  psIter->pcKey = NULL;
+  psIter->pvValue = NULL;
+}
+
+/* implements the SymTable_next() function. pvCurrent is the binding
+last moved to, and uPosition the number of buckets started. They are
+started stripe by stripe, as SymTable_map walks them */
+int SymTable_next(SymTable_Iter *psIter) {
+  const struct Binding *psBinding = NULL;
+  SymTable_T oSymTable;
+  size_t uStripeBuckets;
+  assert(psIter != NULL);
+  assert(psIter->oSymTable != NULL);
+
+  oSymTable = psIter->oSymTable;
+  uStripeBuckets = oSymTable->bucketCount / SYMTABLE_STRIPES;
+  if (psIter->pvCurrent != NULL) {
+    psBinding = ((const struct Binding *) psIter->pvCurrent)
+      ->psNextBinding;
+  }
+  while (psBinding == NULL &&
+    psIter->uPosition < oSymTable->bucketCount) {
+    psBinding = oSymTable->Bindings[
+      psIter->uPosition % uStripeBuckets * SYMTABLE_STRIPES +
+      psIter->uPosition / uStripeBuckets];
+    psIter->uPosition++;
+  }
+  psIter->pvCurrent = psBinding;
+  if (psBinding == NULL) {
+    psIter->pcKey = NULL;
+    psIter->pvValue = NULL;
+    return 0;
+  }
+  psIter->pcKey = psBinding->Key;
+  psIter->pvValue = (void *) psBinding->Value;
+  return 1;
+}
+
+/* implements the SymTable_iterKey() function */
+const char *SymTable_iterKey(const SymTable_Iter *psIter) {
+  assert(psIter != NULL);
+  assert(psIter->pcKey != NULL);
+  return psIter->pcKey;
+}
+
+/* implements the SymTable_iterValue() function */
+void *SymTable_iterValue(const SymTable_Iter *psIter) {
+  assert(psIter != NULL);
+  assert(psIter->pcKey != NULL);
+  return psIter->pvValue;
+}
+
+/* implements the SymTable_getStats() function. A striped table keeps no
+statistics, so every one of them is 0, and it returns 0 (FALSE) */
+int SymTable_getStats(SymTable_T oSymTable, SymTable_Stats *psStats) {
+  assert(oSymTable != NULL);
+  assert(psStats != NULL);
+  (void) oSymTable;
+  psStats->uHits = 0;
+  psStats->uMisses = 0;
+  psStats->uProbes = 0;
+  psStats->uExpansions = 0;
+  psStats->dExpandSeconds = 0.0;
+  psStats->uMaxMigrate = 0;
+  psStats->uMaxChain = 0;
+  psStats->dMeanChain = 0.0;
+  psStats->uBindingBytes = 0;
+  psStats->uKeyBytes = 0;
+  return 0;
+}
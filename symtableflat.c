@@ -0,0 +1,1083 @@
+/*--------------------------------------------------------------------*/
+/* symtableflat.c                                                     */
+/* Author: Ahmed Farah                                                */
+/* Implements the Symbol Table abstract data type (ADT), compliant    */
+/* with the interface in symtable.h                                   */
+/* It uses an open-addressing (linear probing) hash table, stored in  */
+/* flat arrays rather than in chains of separately allocated bindings */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+#include "symtable.h"
+#include "arena.h"
+#include "filter.h"
+#include "hashfn.h"
+#include "parallel.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* The number of slots in a new symbol table. It must be a power of 2,
+since slot indices are computed by masking, and no smaller than
+GROUP_WIDTH, since a table never gets any smaller than it */
+enum {INITIAL_CAPACITY = 16};
+
+/* The number of slots whose control bytes SymTable_find tests at once,
+which is the width of an SSE2 register in bytes */
+enum {GROUP_WIDTH = 16};
+
+/* The control byte of a free slot. Every other slot has the tag of the
+hash code of its key as its control byte, which has its high bit set */
+enum {FREE_CONTROL = 0};
+
+/* The maximum load factor, as a percentage: the table doubles before
+more than SYMTABLE_MAX_LOAD_PERCENT of its slots are in use. It can be
+overridden at compile time, e.g. with -DSYMTABLE_MAX_LOAD_PERCENT=50.
+Linear probing needs at least one free slot, so it must be below 100 */
+#ifndef SYMTABLE_MAX_LOAD_PERCENT
+#define SYMTABLE_MAX_LOAD_PERCENT 75
+#endif
+#if SYMTABLE_MAX_LOAD_PERCENT <= 0 || SYMTABLE_MAX_LOAD_PERCENT >= 100
+#error "SYMTABLE_MAX_LOAD_PERCENT must be between 1 and 99"
+#endif
+
+/* The hash code that marks a free slot. SymTable_hash never returns it
+for a real key */
+enum {EMPTY = 0};
+
+/* The number of keys that SymTable_getBatch and SymTable_putBatch hash
+and prefetch before they resolve any of them */
+enum {BATCH_GROUP = 16};
+
+/* Asks the processor to start loading the cache line at pv, without
+waiting for it, as in symtablehash.c */
+#ifdef __GNUC__
+#define SYMTABLE_PREFETCH(pv) __builtin_prefetch(pv)
+#else
+#define SYMTABLE_PREFETCH(pv) ((void) (pv))
+#endif
+
+/* This is an open-addressing implementation of a symbol table. Instead
+of bindings, it has 3 parallel arrays of capacity slots each: Hashes,
+the hash code of the key in each slot (or EMPTY), Keys and Values.
+A fourth, Controls, has a control byte for each slot, followed by
+copies of the first GROUP_WIDTH - 1 of them, so that the bytes of the
+GROUP_WIDTH slots from any slot on, wrapping around, lie together.
+Probing reads Controls a group at a time, and the key of a slot is only
+compared when its tag matches. Whether a slot is free is told by its
+control byte too, so Hashes is only read to move bindings.
+All 4 arrays live in one allocation, which starts at Hashes.
+capacity is always a power of 2, and the table
+grows before its load factor passes SYMTABLE_MAX_LOAD_PERCENT, so every
+probe sequence ends at a free slot. If the table was made with
+SYMTABLE_ARENA, its key copies come from arena, and otherwise arena is
+NULL and they come from malloc. If it was made with SYMTABLE_BORROWED,
+borrowed is set and Keys holds its callers' keys instead of copies.
+If it was made with SYMTABLE_INTERNED, interned and borrowed are set,
+and keys are compared by address. There are no bindings to allocate.
+hash is the function that computes the hash code of every key. */
+struct SymTable {
+  /* The hash code of the key in each slot, or EMPTY */
+  size_t *Hashes;
+  /* The key in each slot */
+  const char **Keys;
+  /* The value in each slot */
+  const void **Values;
+  /* The control byte of each slot, then copies of the first few */
+  unsigned char *Controls;
+  /* The number of slots. Always a power of 2 */
+  size_t capacity;
+  /* The size past which the next put doubles the slot arrays */
+  size_t expandThreshold;
+  /* The current size of the symbol table */
+  size_t size;
+  /* Where key copies are allocated, if not from malloc */
+  Arena_T arena;
+  /* Whether the keys belong to the caller rather than to the table */
+  int borrowed;
+  /* Whether keys are compared by address rather than by characters */
+  int interned;
+  /* The hash function of the table */
+  SymTable_HashFn hash;
+};
+
+/* A Helper function which takes in a SymTable_T oSymTable and a string
+pcKey of length uLength, and returns the full hash code of pcKey, as
+computed by the hash function of oSymTable. The result is never EMPTY.
+It is called by every function that looks up a key */
+static size_t SymTable_hash(SymTable_T oSymTable, const char *pcKey,
+size_t uLength) {
+  size_t uHash;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  uHash = oSymTable->hash(pcKey, uLength);
+  if (uHash == EMPTY) {
+    uHash = 1;
+  }
+  return uHash;
+}
+
+/* A helper function which takes in a SymTable_T oSymTable and a key
+pcKey, and returns the length of pcKey as a size_t. A table that
+compares keys by address never needs it, so it returns 0 without
+reading pcKey then. It is called by every function that is given a key
+without its length */
+static size_t SymTable_length(SymTable_T oSymTable, const char *pcKey) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  if (oSymTable->interned) {
+    return 0;
+  }
+  return strlen(pcKey);
+}
+
+/* A Helper function which takes in a hash code uHash and returns it
+mixed. The default multiplicative hash has weak low-order bits, so they
+are mixed with the high-order ones: the low-order bits of the result
+pick the home slot of a key, and the high-order ones its tag. It is
+called by every function that looks up or moves a key */
+static size_t SymTable_mix(size_t uHash) {
+  uHash ^= uHash >> 15;
+  uHash *= 0x2c1b3c6dU;
+  uHash ^= uHash >> 12;
+  uHash *= 0x297a2d39U;
+  uHash ^= uHash >> 15;
+  return uHash;
+}
+
+/* A Helper function which takes in a hash code uHash and a size_t
+uMask, which is one less than the (power of 2) number of slots, and
+returns the slot where the probe sequence for uHash starts */
+static size_t SymTable_home(size_t uHash, size_t uMask) {
+  return SymTable_mix(uHash) & uMask;
+}
+
+/* A Helper function which takes in a hash code uHash, as mixed by
+SymTable_mix, and returns its tag, the control byte of the slot of its
+key: its top 7 bits, with the high bit of the byte set so that a tag is
+never FREE_CONTROL */
+static unsigned char SymTable_tag(size_t uMixed) {
+  return (unsigned char) (0x80 |
+    (uMixed >> (sizeof(size_t) * CHAR_BIT - 7)));
+}
+
+/* A Helper function which takes in a SymTable_T oSymTable, a slot u
+and a control byte ucControl, and makes ucControl the control byte of u,
+and of its copy if it has one. It is called by every function that
+fills or empties a slot */
+static void SymTable_setControl(SymTable_T oSymTable, size_t u,
+unsigned char ucControl) {
+  assert(oSymTable != NULL);
+  assert(u < oSymTable->capacity);
+  oSymTable->Controls[u] = ucControl;
+  if (u < GROUP_WIDTH - 1) {
+    oSymTable->Controls[oSymTable->capacity + u] = ucControl;
+  }
+}
+
+/* A Helper function which takes in pucGroup, the control bytes of
+GROUP_WIDTH slots, and a tag ucTag. It returns the set of those slots
+whose control byte is ucTag, as a bit mask with bit i for the ith slot,
+and stores the set of free ones in *puFree the same way. It uses SSE2
+when the compiler targets it, as it does on every x86-64 processor, and
+looks at one byte at a time otherwise */
+static unsigned int SymTable_matchGroup(const unsigned char *pucGroup,
+unsigned char ucTag, unsigned int *puFree) {
+#ifdef __SSE2__
+  __m128i group;
+  assert(pucGroup != NULL);
+  assert(puFree != NULL);
+
+  /* A free slot is one whose control byte has its high bit clear */
+  group = _mm_loadu_si128((const __m128i *) (const void *) pucGroup);
+  *puFree = ~(unsigned int) _mm_movemask_epi8(group) & 0xffffU;
+  return (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(group,
+    _mm_set1_epi8((char) ucTag)));
+#else
+  unsigned int uMatches = 0;
+  unsigned int i;
+  assert(pucGroup != NULL);
+  assert(puFree != NULL);
+
+  *puFree = 0;
+  for (i = 0; i < GROUP_WIDTH; i++) {
+    if (pucGroup[i] == ucTag) {
+      uMatches |= 1U << i;
+    }
+    else if (pucGroup[i] == FREE_CONTROL) {
+      *puFree |= 1U << i;
+    }
+  }
+  return uMatches;
+#endif
+}
+
+/* A Helper function which takes in a non-empty bit mask uBits and
+returns the index of its lowest set bit. It is called by
+SymTable_find */
+static unsigned int SymTable_lowestBit(unsigned int uBits) {
+#ifdef __GNUC__
+  assert(uBits != 0);
+  return (unsigned int) __builtin_ctz(uBits);
+#else
+  unsigned int i = 0;
+  assert(uBits != 0);
+  while ((uBits & 1U) == 0) {
+    uBits >>= 1;
+    i++;
+  }
+  return i;
+#endif
+}
+
+/* A Helper function which takes in uCapacity, a power of 2 number of
+slots, and returns the number of bindings that many slots can hold
+before the load factor passes SYMTABLE_MAX_LOAD_PERCENT. It is called
+by SymTable_allocSlots and SymTable_hintCapacity */
+static size_t SymTable_threshold(size_t uCapacity) {
+  /* We divide first, since capacity is a power of 2 above 100 long
+  before multiplying could overflow */
+  if (uCapacity >= 128) {
+    return uCapacity / 100 * SYMTABLE_MAX_LOAD_PERCENT;
+  }
+  return uCapacity * SYMTABLE_MAX_LOAD_PERCENT / 100;
+}
+
+/* A helper function which allocates the 4 slot arrays for uCapacity
+slots in one block. It takes in a SymTable_T oSymTable and a size_t
+uCapacity, and points the arrays of oSymTable at the new block. It
+returns 1 if it succeeds, and 0 (leaving oSymTable unchanged) if it
+can't allocate the memory. Every new slot is EMPTY, and its control
+byte FREE_CONTROL */
+static int SymTable_allocSlots(SymTable_T oSymTable, size_t uCapacity) {
+  size_t *puHashes;
+  assert(oSymTable != NULL);
+  assert(uCapacity >= GROUP_WIDTH);
+
+  /* GROUP_WIDTH more slots than we need leave room for Controls and
+  its copies at the end */
+  puHashes = (size_t *) calloc(uCapacity + GROUP_WIDTH,
+    sizeof(size_t) + sizeof(const char *) + sizeof(const void *) + 1);
+  if (puHashes == NULL) {
+    return 0;
+  }
+  oSymTable->Hashes = puHashes;
+  oSymTable->Keys = (const char **) (void *) (puHashes + uCapacity);
+  oSymTable->Values =
+    (const void **) (void *) (oSymTable->Keys + uCapacity);
+  oSymTable->Controls =
+    (unsigned char *) (void *) (oSymTable->Values + uCapacity);
+  oSymTable->capacity = uCapacity;
+  oSymTable->expandThreshold = SymTable_threshold(uCapacity);
+  return 1;
+}
+
+/* The SymTable constructor */
+SymTable_T SymTable_new(void) {
+  return SymTable_newWithFlags(0);
+}
+
+/* The SymTable constructor that takes flags */
+SymTable_T SymTable_newWithFlags(unsigned int uFlags) {
+  return SymTable_newWithHash(NULL, uFlags);
+}
+
+/* A helper function which works as SymTable_newWithHash, for a table
+that starts out with uCapacity slots, a power of 2. It is called by
+SymTable_newWithHash, SymTable_newWithCapacity and
+SymTable_newFromArray */
+static SymTable_T SymTable_newSized(SymTable_HashFn pfHash,
+unsigned int uFlags, size_t uCapacity) {
+  SymTable_T oSymTable;
+  oSymTable = (SymTable_T) malloc(sizeof(struct SymTable));
+  if (oSymTable == NULL) {
+    return NULL;
+  }
+  if (! SymTable_allocSlots(oSymTable, uCapacity)) {
+    /* We must remember to free oSymTable, since we won't be actually
+    making a symbol table */
+    free(oSymTable);
+    return NULL;
+  }
+  oSymTable->arena = NULL;
+  if (uFlags & SYMTABLE_ARENA) {
+    /* The arena never hands out nodes, only key copies */
+    oSymTable->arena = Arena_new(0);
+    if (oSymTable->arena == NULL) {
+      free(oSymTable->Hashes);
+      free(oSymTable);
+      return NULL;
+    }
+  }
+  oSymTable->interned = ((uFlags & SYMTABLE_INTERNED) != 0);
+  oSymTable->borrowed = ((uFlags & SYMTABLE_BORROWED) != 0 ||
+    oSymTable->interned);
+  oSymTable->hash = pfHash;
+  if (pfHash == NULL) {
+    oSymTable->hash = HashFn_multiplicative;
+  }
+  if (oSymTable->interned) {
+    oSymTable->hash = HashFn_address;
+  }
+  oSymTable->size = 0;
+  return oSymTable;
+}
+
+/* The SymTable constructor that takes a hash function */
+SymTable_T SymTable_newWithHash(SymTable_HashFn pfHash,
+unsigned int uFlags) {
+  return SymTable_newSized(pfHash, uFlags, INITIAL_CAPACITY);
+}
+
+/* A helper function which doubles a number of slots from
+INITIAL_CAPACITY until uHint bindings fit without passing the maximum
+load factor, as that many puts would have, and returns it, or 0 if
+there would be too many slots to count. It is called by
+SymTable_newWithCapacity and SymTable_newFromArray */
+static size_t SymTable_hintCapacity(size_t uHint) {
+  size_t uCapacity = INITIAL_CAPACITY;
+  while (SymTable_threshold(uCapacity) < uHint) {
+    /* A table this large couldn't be allocated anyway */
+    if (uCapacity > (size_t) -1 / 2) {
+      return 0;
+    }
+    uCapacity *= 2;
+  }
+  return uCapacity;
+}
+
+/* The SymTable constructor that takes a capacity. Its slots are
+counted by SymTable_hintCapacity */
+SymTable_T SymTable_newWithCapacity(size_t uHint) {
+  size_t uCapacity;
+  uCapacity = SymTable_hintCapacity(uHint);
+  if (uCapacity == 0) {
+    return NULL;
+  }
+  return SymTable_newSized(NULL, 0, uCapacity);
+}
+
+/* A helper function which makes a defensive copy of the key pcKey, of
+length uLength, for SymTable_T oSymTable, from its arena if it has one
+and from malloc otherwise. If oSymTable borrows its keys, it makes no
+copy and returns pcKey itself. It returns the copy, or NULL if it can't
+allocate memory. It is called by SymTable_putOrGetHashed */
+static const char * SymTable_copyKey(SymTable_T oSymTable,
+const char *pcKey, size_t uLength) {
+  char *keyCopy;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  if (oSymTable->borrowed) {
+    assert(oSymTable->interned || pcKey[uLength] == '\0');
+    return pcKey;
+  }
+
+  if (oSymTable->arena != NULL) {
+    return Arena_copyKey(oSymTable->arena, pcKey, uLength);
+  }
+  keyCopy = (char *) calloc(uLength + 1, sizeof(char));
+  if (keyCopy == NULL) {
+    return NULL;
+  }
+  return memcpy(keyCopy, pcKey, uLength);
+}
+
+/* The SymTable deconstructor */
+void SymTable_free(SymTable_T oSymTable) {
+  size_t u;
+  assert(oSymTable != NULL);
+
+  /* Since we create a defensive copy of each key, we have to free-up
+  the memory allocation of the keys as well. Keys in an arena all go
+  away with it, without a walk, and borrowed keys aren't ours to free */
+  if (oSymTable->arena != NULL) {
+    Arena_free(oSymTable->arena);
+  }
+  else if (! oSymTable->borrowed) {
+    for (u = 0; u < oSymTable->capacity; u++) {
+      if (oSymTable->Controls[u] != FREE_CONTROL) {
+        free((void *) oSymTable->Keys[u]);
+      }
+    }
+  }
+  /* This also frees Keys and Values, which share the block */
+  free(oSymTable->Hashes);
+  free(oSymTable);
+}
+
+/* Implements the SymTable_getLength() function */
+size_t SymTable_getLength(SymTable_T oSymTable) {
+  assert(oSymTable != NULL);
+  return oSymTable->size;
+}
+
+/* A helper function used by every function that looks up a key. It
+takes in a SymTable_T oSymTable, a char * pcKey, its length uLength and
+uHash, the hash code of pcKey. It returns the index of the slot holding
+pcKey if oSymTable contains it, and otherwise the index of the free slot
+at which the probe sequence for pcKey ends, which is where pcKey would
+be inserted.
+It does not change the contents of oSymTable */
+static size_t SymTable_find(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, size_t uHash) {
+  unsigned int uMatches;
+  unsigned int uFree;
+  unsigned char ucTag;
+  size_t uMixed;
+  size_t uMask;
+  size_t uGroup;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  /* The probe sequence is the same as a slot at a time, just taken a
+  group at a time, so it still ends at the first free slot */
+  uMask = oSymTable->capacity - 1;
+  uMixed = SymTable_mix(uHash);
+  ucTag = SymTable_tag(uMixed);
+  /* The key is most often in its home slot. Its Keys and Values
+  elements would only be loaded once the control bytes have been, so we
+  start on them now, and the misses overlap */
+  SYMTABLE_PREFETCH(&oSymTable->Keys[uMixed & uMask]);
+  SYMTABLE_PREFETCH(&oSymTable->Values[uMixed & uMask]);
+  for (uGroup = uMixed & uMask; ;
+    uGroup = (uGroup + GROUP_WIDTH) & uMask) {
+    uMatches = SymTable_matchGroup(&oSymTable->Controls[uGroup], ucTag,
+      &uFree);
+    if (uFree != 0) {
+      uMatches &= (uFree & (0U - uFree)) - 1;
+    }
+    for (; uMatches != 0; uMatches &= uMatches - 1) {
+      u = (uGroup + SymTable_lowestBit(uMatches)) & uMask;
+      /* Reading Hashes[u] as well would cost a cache miss of its own,
+      and only saves a key compare for 1 slot in 128. pcKey has no '\0'
+      among its uLength characters, so strncmp stops at the end of a
+      shorter stored key, and a longer one fails the second test */
+      if (oSymTable->interned ? oSymTable->Keys[u] == pcKey :
+        (strncmp(oSymTable->Keys[u], pcKey, uLength) == 0 &&
+        oSymTable->Keys[u][uLength] == '\0')) {
+        return u;
+      }
+    }
+    if (uFree != 0) {
+      return (uGroup + SymTable_lowestBit(uFree)) & uMask;
+    }
+  }
+}
+
+/* A Helper function which moves every binding of SymTable_T oSymTable
+into uCapacity slots, a power of 2 large enough to hold them all. It is
+called by SymTable_expand, SymTable_shrink and SymTable_compact, and
+returns 1 if it succeeds. If it can't allocate the new arrays it
+returns 0 and leaves oSymTable in its original condition. Every binding
+is reinserted using its stored hash, so no key is read or compared */
+static int SymTable_resize(SymTable_T oSymTable, size_t uCapacity) {
+  size_t *puOldHashes;
+  const char **ppcOldKeys;
+  const void **ppvOldValues;
+  size_t uOldCapacity;
+  size_t uMask;
+  size_t uOld;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(uCapacity > oSymTable->size);
+
+  puOldHashes = oSymTable->Hashes;
+  ppcOldKeys = oSymTable->Keys;
+  ppvOldValues = oSymTable->Values;
+  uOldCapacity = oSymTable->capacity;
+
+  if (! SymTable_allocSlots(oSymTable, uCapacity)) {
+    return 0;
+  }
+
+  /* The keys are all distinct, so each one just goes in the first free
+  slot of its new probe sequence */
+  uMask = oSymTable->capacity - 1;
+  for (uOld = 0; uOld < uOldCapacity; uOld++) {
+    if (puOldHashes[uOld] == EMPTY) {
+      continue;
+    }
+    for (u = SymTable_home(puOldHashes[uOld], uMask);
+      oSymTable->Controls[u] != FREE_CONTROL; u = (u + 1) & uMask) {
+    }
+    oSymTable->Hashes[u] = puOldHashes[uOld];
+    SymTable_setControl(oSymTable, u,
+      SymTable_tag(SymTable_mix(puOldHashes[uOld])));
+    oSymTable->Keys[u] = ppcOldKeys[uOld];
+    oSymTable->Values[u] = ppvOldValues[uOld];
+  }
+  free(puOldHashes);
+  return 1;
+}
+
+/* A Helper function which doubles the number of slots of SymTable_T
+oSymTable. It is called by SymTable_putOrGetLen, and returns 1 if it
+succeeds, and 0, leaving oSymTable unchanged, if it can't */
+static int SymTable_expand(SymTable_T oSymTable) {
+  assert(oSymTable != NULL);
+
+  /* We give up rather than let the number of slots wrap around */
+  if (oSymTable->capacity * 2 < oSymTable->capacity) {
+    return 0;
+  }
+  return SymTable_resize(oSymTable, oSymTable->capacity * 2);
+}
+
+/* A helper function which takes in a SymTable_T oSymTable and returns
+the fewest slots, a power of 2 and no fewer than INITIAL_CAPACITY,
+that hold uCount bindings without passing the maximum load factor. It
+is called by SymTable_shrink and SymTable_compact */
+static size_t SymTable_fitCapacity(SymTable_T oSymTable, size_t uCount)
+{
+  size_t uCapacity;
+  assert(oSymTable != NULL);
+
+  uCapacity = oSymTable->capacity;
+  while (uCapacity > INITIAL_CAPACITY &&
+    SymTable_threshold(uCapacity / 2) >= uCount) {
+    uCapacity /= 2;
+  }
+  return uCapacity;
+}
+
+/* A helper function which halves the slots of SymTable_T oSymTable,
+as many times as its size allows, once fewer than a quarter of the
+bindings that would make it expand are left. The new capacity holds
+twice the current size, so it takes many more puts or removes before
+the table resizes again. It is called by SymTable_remove. If it can't
+allocate the smaller arrays, oSymTable just stays as large as it was */
+static void SymTable_shrink(SymTable_T oSymTable) {
+  size_t uCapacity;
+  assert(oSymTable != NULL);
+
+  if (oSymTable->capacity == INITIAL_CAPACITY ||
+    oSymTable->size >= oSymTable->expandThreshold / 4) {
+    return;
+  }
+  uCapacity = SymTable_fitCapacity(oSymTable, oSymTable->size * 2);
+  if (uCapacity < oSymTable->capacity) {
+    (void) SymTable_resize(oSymTable, uCapacity);
+  }
+}
+
+/* A helper function which works as SymTable_putOrGet, for a key pcKey
+of length uLength whose hash code, as computed by SymTable_hash, is
+uHash. It is called by SymTable_putOrGetLen, SymTable_putBatch and
+SymTable_newFromArray */
+static int SymTable_putOrGetHashed(SymTable_T oSymTable,
+const char *pcKey, size_t uLength, size_t uHash, const void *pvValue,
+void **ppvValue) {
+  const char *keyCopy;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  u = SymTable_find(oSymTable, pcKey, uLength, uHash);
+  if (oSymTable->Controls[u] != FREE_CONTROL) {
+    if (ppvValue != NULL) {
+      *ppvValue = (void *) oSymTable->Values[u];
+    }
+    return 0;
+  }
+
+  /* We make a defensive copy of the key */
+  keyCopy = SymTable_copyKey(oSymTable, pcKey, uLength);
+  if (keyCopy == NULL) {
+    return -1;
+  }
+
+  /* If adding the binding would take us past the maximum load factor,
+  we expand the table first. The free slot we found moves with it, so we probe
+  again, but only for a free slot since we know pcKey is absent */
+  if (oSymTable->size >= oSymTable->expandThreshold) {
+    if (! SymTable_expand(oSymTable)) {
+      /* A copy in the arena stays there until the table is freed */
+      if (oSymTable->arena == NULL && ! oSymTable->borrowed) {
+        free((void *) keyCopy);
+      }
+      return -1;
+    }
+    for (u = SymTable_home(uHash, oSymTable->capacity - 1);
+      oSymTable->Controls[u] != FREE_CONTROL;
+      u = (u + 1) & (oSymTable->capacity - 1)) {
+    }
+  }
+
+  oSymTable->Hashes[u] = uHash;
+  SymTable_setControl(oSymTable, u, SymTable_tag(SymTable_mix(uHash)));
+  oSymTable->Keys[u] = keyCopy;
+  oSymTable->Values[u] = pvValue;
+  oSymTable->size++;
+
+  if (ppvValue != NULL) {
+    *ppvValue = (void *) pvValue;
+  }
+  return 1;
+}
+
+/* A helper function which works as SymTable_putOrGet, for a key pcKey
+of length uLength. It is called by SymTable_putOrGet, SymTable_put and
+SymTable_putLen */
+static int SymTable_putOrGetLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, const void *pvValue, void **ppvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return SymTable_putOrGetHashed(oSymTable, pcKey, uLength,
+    SymTable_hash(oSymTable, pcKey, uLength), pvValue, ppvValue);
+}
+
+/* A helper function which hashes the keys ppcKeys[uStart] up to
+ppcKeys[uEnd - 1] of SymTable_T oSymTable into auHashes, and their
+lengths into auLengths, both indexed from uStart. The lengths are
+taken from puLengths, indexed as ppcKeys, if it isn't NULL, and
+counted otherwise. It prefetches the
+home slot of each key in Controls and Keys, so that the misses of the
+group overlap. It is called by SymTable_putBatch, SymTable_getBatch
+and SymTable_newFromArray */
+static void SymTable_prefetchGroup(SymTable_T oSymTable,
+const char * const *ppcKeys, size_t uStart, size_t uEnd,
+size_t *auHashes, size_t *auLengths, const size_t *puLengths) {
+  size_t uHome;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL);
+  assert(auHashes != NULL);
+  assert(auLengths != NULL);
+
+  for (u = uStart; u < uEnd; u++) {
+    assert(ppcKeys[u] != NULL);
+    auLengths[u - uStart] = (puLengths != NULL) ? puLengths[u] :
+      SymTable_length(oSymTable, ppcKeys[u]);
+    auHashes[u - uStart] = SymTable_hash(oSymTable, ppcKeys[u],
+      auLengths[u - uStart]);
+    uHome = SymTable_home(auHashes[u - uStart],
+      oSymTable->capacity - 1);
+    SYMTABLE_PREFETCH(&oSymTable->Controls[uHome]);
+    SYMTABLE_PREFETCH(&oSymTable->Keys[uHome]);
+  }
+}
+
+/* Implements the SymTable_putBatch() function. The keys are taken
+BATCH_GROUP at a time, and the home slots of a whole group are
+prefetched before any of its keys is put */
+size_t SymTable_putBatch(SymTable_T oSymTable,
+const char * const *ppcKeys, const void * const *ppvValues,
+size_t uCount) {
+  size_t auLengths[BATCH_GROUP];
+  size_t auHashes[BATCH_GROUP];
+  size_t uAdded = 0;
+  size_t uStart;
+  size_t uEnd;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL);
+  assert(ppvValues != NULL);
+
+  for (uStart = 0; uStart < uCount; uStart = uEnd) {
+    uEnd = (uCount - uStart > BATCH_GROUP) ? uStart + BATCH_GROUP :
+      uCount;
+    SymTable_prefetchGroup(oSymTable, ppcKeys, uStart, uEnd, auHashes,
+      auLengths, NULL);
+    /* A put may double the slots, which only makes the remaining
+    prefetches of the group useless, not wrong */
+    for (u = uStart; u < uEnd; u++) {
+      if (SymTable_putOrGetHashed(oSymTable, ppcKeys[u],
+        auLengths[u - uStart], auHashes[u - uStart], ppvValues[u],
+        NULL) == 1) {
+        uAdded++;
+      }
+    }
+  }
+  return uAdded;
+}
+
+/* The SymTable constructor that takes an array of bindings. The table
+starts out with the slots for all of them, and with one chunk of its
+arena large enough for all their key copies. Then the keys are put
+BATCH_GROUP at a time, as SymTable_putBatch puts them, so no put
+allocates anything or doubles the table. The length of each key is
+counted once, for the arena, and kept for its put */
+SymTable_T SymTable_newFromArray(const char * const *ppcKeys,
+const void * const *ppvValues, size_t uCount) {
+  size_t auLengths[BATCH_GROUP];
+  size_t auHashes[BATCH_GROUP];
+  SymTable_T oSymTable;
+  size_t *puLengths;
+  size_t uKeyBytes = 0;
+  size_t uCapacity;
+  size_t uStart;
+  size_t uEnd;
+  size_t u;
+  assert(ppcKeys != NULL);
+  assert(ppvValues != NULL);
+
+  uCapacity = SymTable_hintCapacity(uCount);
+  if (uCapacity == 0) {
+    return NULL;
+  }
+  oSymTable = SymTable_newSized(NULL, SYMTABLE_ARENA, uCapacity);
+  if (oSymTable == NULL) {
+    return NULL;
+  }
+  /* One more element, so that the array is never of size 0 */
+  puLengths = (size_t *) malloc((uCount + 1) * sizeof(size_t));
+  if (puLengths == NULL) {
+    SymTable_free(oSymTable);
+    return NULL;
+  }
+  for (u = 0; u < uCount; u++) {
+    assert(ppcKeys[u] != NULL);
+    puLengths[u] = strlen(ppcKeys[u]);
+    uKeyBytes += puLengths[u] + 1;
+  }
+  if (! Arena_reserve(oSymTable->arena, 0, uKeyBytes)) {
+    free(puLengths);
+    SymTable_free(oSymTable);
+    return NULL;
+  }
+
+  for (uStart = 0; uStart < uCount; uStart = uEnd) {
+    uEnd = (uCount - uStart > BATCH_GROUP) ? uStart + BATCH_GROUP :
+      uCount;
+    SymTable_prefetchGroup(oSymTable, ppcKeys, uStart, uEnd, auHashes,
+      auLengths, puLengths);
+    /* A duplicate key is found in its probe sequence, and left out */
+    for (u = uStart; u < uEnd; u++) {
+      if (SymTable_putOrGetHashed(oSymTable, ppcKeys[u],
+        auLengths[u - uStart], auHashes[u - uStart], ppvValues[u],
+        NULL) < 0) {
+        free(puLengths);
+        SymTable_free(oSymTable);
+        return NULL;
+      }
+    }
+  }
+  free(puLengths);
+  return oSymTable;
+}
+
+/* Implements the SymTable_putOrGet() function */
+int SymTable_putOrGet(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue, void **ppvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return SymTable_putOrGetLen(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey), pvValue, ppvValue);
+}
+
+/* Implements the SymTable_put() function */
+int SymTable_put(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return (SymTable_putOrGetLen(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey), pvValue, NULL) == 1);
+}
+
+/* Implements the SymTable_putLen() function */
+int SymTable_putLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, const void *pvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return (SymTable_putOrGetLen(oSymTable, pcKey, uLength, pvValue,
+    NULL) == 1);
+}
+
+/* implements the SymTable_replace() function */
+void * SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue) {
+  const void * oldValue;
+  size_t uLength;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  uLength = SymTable_length(oSymTable, pcKey);
+  u = SymTable_find(oSymTable, pcKey, uLength,
+    SymTable_hash(oSymTable, pcKey, uLength));
+  if (oSymTable->Controls[u] == FREE_CONTROL) {
+    return NULL;
+  }
+  oldValue = oSymTable->Values[u];
+  oSymTable->Values[u] = pvValue;
+
+  /* Here we have to "cast away the constness" */
+  return (void *) oldValue;
+}
+
+/* implements the SymTable_contains() function */
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+  size_t uLength;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  uLength = SymTable_length(oSymTable, pcKey);
+  u = SymTable_find(oSymTable, pcKey, uLength,
+    SymTable_hash(oSymTable, pcKey, uLength));
+  return (oSymTable->Controls[u] != FREE_CONTROL);
+}
+
+/* implements the SymTable_get() function */
+void * SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return SymTable_getLen(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey));
+}
+
+/* implements the SymTable_getLen() function */
+void * SymTable_getLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength) {
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  u = SymTable_find(oSymTable, pcKey, uLength,
+    SymTable_hash(oSymTable, pcKey, uLength));
+  if (oSymTable->Controls[u] == FREE_CONTROL) {
+    return NULL;
+  }
+  return (void *) oSymTable->Values[u];
+}
+
+/* implements the SymTable_getBatch() function, which prefetches home
+slots just as SymTable_putBatch does */
+void SymTable_getBatch(SymTable_T oSymTable,
+const char * const *ppcKeys, size_t uCount, void **ppvValues) {
+  size_t auLengths[BATCH_GROUP];
+  size_t auHashes[BATCH_GROUP];
+  size_t uStart;
+  size_t uEnd;
+  size_t u;
+  size_t uSlot;
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL);
+  assert(ppvValues != NULL);
+
+  for (uStart = 0; uStart < uCount; uStart = uEnd) {
+    uEnd = (uCount - uStart > BATCH_GROUP) ? uStart + BATCH_GROUP :
+      uCount;
+    SymTable_prefetchGroup(oSymTable, ppcKeys, uStart, uEnd, auHashes,
+      auLengths, NULL);
+    for (u = uStart; u < uEnd; u++) {
+      uSlot = SymTable_find(oSymTable, ppcKeys[u],
+        auLengths[u - uStart], auHashes[u - uStart]);
+      ppvValues[u] = (oSymTable->Controls[uSlot] == FREE_CONTROL) ?
+        NULL : (void *) oSymTable->Values[uSlot];
+    }
+  }
+}
+
+/* implements the SymTable_remove() function */
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+  void * toReturn;
+  size_t uLength;
+  size_t uMask;
+  size_t uHole;
+  size_t uHome;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  uLength = SymTable_length(oSymTable, pcKey);
+  uHole = SymTable_find(oSymTable, pcKey, uLength,
+    SymTable_hash(oSymTable, pcKey, uLength));
+
+  /* The case where we didn't find the binding corresponding to pcKey*/
+  if (oSymTable->Controls[uHole] == FREE_CONTROL) {
+    return NULL;
+  }
+
+  toReturn = (void *) oSymTable->Values[uHole];
+
+  /* Since we created a defensive copy of the key, we have to free that
+  too, unless it is in the arena, which keeps it until it is freed, or
+  it was borrowed */
+  if (oSymTable->arena == NULL && ! oSymTable->borrowed) {
+    free((void *) oSymTable->Keys[uHole]);
+  }
+
+  /* Instead of leaving a tombstone, we shift back every later binding
+  of the cluster whose probe sequence passes through the hole, so that
+  lookups never have to skip over removed slots */
+  uMask = oSymTable->capacity - 1;
+  for (u = (uHole + 1) & uMask; oSymTable->Controls[u] != FREE_CONTROL;
+    u = (u + 1) & uMask) {
+    uHome = SymTable_home(oSymTable->Hashes[u], uMask);
+    /* The binding in slot u must stay put if its home lies cyclically
+    after the hole, i.e. in (uHole, u] */
+    if (uHole <= u ? (uHole < uHome && uHome <= u) :
+      (uHole < uHome || uHome <= u)) {
+      continue;
+    }
+    oSymTable->Hashes[uHole] = oSymTable->Hashes[u];
+    SymTable_setControl(oSymTable, uHole, oSymTable->Controls[u]);
+    oSymTable->Keys[uHole] = oSymTable->Keys[u];
+    oSymTable->Values[uHole] = oSymTable->Values[u];
+    uHole = u;
+  }
+  oSymTable->Hashes[uHole] = EMPTY;
+  SymTable_setControl(oSymTable, uHole, FREE_CONTROL);
+  oSymTable->size--;
+  SymTable_shrink(oSymTable);
+  return toReturn;
+}
+
+/* implements the SymTable_compact() function */
+void SymTable_compact(SymTable_T oSymTable) {
+  size_t uCapacity;
+  assert(oSymTable != NULL);
+
+  uCapacity = SymTable_fitCapacity(oSymTable, oSymTable->size);
+  if (uCapacity < oSymTable->capacity) {
+    (void) SymTable_resize(oSymTable, uCapacity);
+  }
+}
+
+/* implements the SymTable_freeze() function. An open-addressing
+table has no frozen form, so oSymTable is left as it is */
+int SymTable_freeze(SymTable_T oSymTable) {
+  assert(oSymTable != NULL);
+  (void) oSymTable;
+  return 0;
+}
+
+/* implements the SymTable_map() function */
+void SymTable_map(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  for (u = 0; u < oSymTable->capacity; u++) {
+    if (oSymTable->Controls[u] != FREE_CONTROL) {
+      pfApply(oSymTable->Keys[u], (void *) oSymTable->Values[u],
+      (void *) pvExtra);
+    }
+  }
+}
+
+/* implements the SymTable_mapRange() function. The bindings aren't in
+order, so every one of them is checked */
+void SymTable_mapRange(SymTable_T oSymTable, const char *pcLow,
+const char *pcHigh,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+  Filter_mapRange(oSymTable, pcLow, pcHigh, pfApply, pvExtra);
+}
+
+/* implements the SymTable_mapPrefix() function, which checks every
+binding as SymTable_mapRange does */
+void SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  assert(oSymTable != NULL);
+  assert(pcPrefix != NULL);
+  assert(pfApply != NULL);
+  Filter_mapPrefix(oSymTable, pcPrefix, pfApply, pvExtra);
+}
+
+/* A helper function which applies pfApply, with pvExtra, to every
+binding in the slots from uStart up to but not including uEnd of the
+SymTable_T that pvTable is. It is the Parallel_RangeFn of
+SymTable_mapParallel */
+static void SymTable_mapSlots(void *pvTable, size_t uStart,
+size_t uEnd, Parallel_ApplyFn pfApply, void *pvExtra) {
+  SymTable_T oSymTable = (SymTable_T) pvTable;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  for (u = uStart; u < uEnd; u++) {
+    if (oSymTable->Controls[u] != FREE_CONTROL) {
+      pfApply(oSymTable->Keys[u], (void *) oSymTable->Values[u],
+      pvExtra);
+    }
+  }
+}
+
+/* implements the SymTable_mapParallel() function. The threads share
+out ranges of slots */
+void SymTable_mapParallel(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+void * const *ppvExtras, size_t uThreads) {
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+  assert(uThreads > 0);
+  Parallel_map(oSymTable, oSymTable->capacity, SymTable_mapSlots,
+    pfApply, ppvExtras, uThreads);
+}
+
+/* implements the SymTable_begin() function */
+void SymTable_begin(SymTable_T oSymTable, SymTable_Iter *psIter) {
+  assert(oSymTable != NULL);
+  assert(psIter != NULL);
+  psIter->oSymTable = oSymTable;
+  psIter->uPosition = 0;
+  psIter->pvCurrent = NULL;
+  psIter->pcKey = NULL;
+  psIter->pvValue = NULL;
+}
+
+/* implements the SymTable_next() function. uPosition is the first slot
+that hasn't been looked at yet */
+int SymTable_next(SymTable_Iter *psIter) {
+  SymTable_T oSymTable;
+  size_t u;
+  assert(psIter != NULL);
+  assert(psIter->oSymTable != NULL);
+
+  oSymTable = psIter->oSymTable;
+  while (psIter->uPosition < oSymTable->capacity) {
+    u = psIter->uPosition++;
+    if (oSymTable->Controls[u] != FREE_CONTROL) {
+      psIter->pcKey = oSymTable->Keys[u];
+      psIter->pvValue = (void *) oSymTable->Values[u];
+      return 1;
+    }
+  }
+  psIter->pcKey = NULL;
+  psIter->pvValue = NULL;
+  return 0;
+}
+
+/* implements the SymTable_iterKey() function */
+const char *SymTable_iterKey(const SymTable_Iter *psIter) {
+  assert(psIter != NULL);
+  assert(psIter->pcKey != NULL);
+  return psIter->pcKey;
+}
+
+/* implements the SymTable_iterValue() function */
+void *SymTable_iterValue(const SymTable_Iter *psIter) {
+  assert(psIter != NULL);
+  assert(psIter->pcKey != NULL);
+  return psIter->pvValue;
+}
+
+/* implements the SymTable_getStats() function. An open-addressing table
+keeps no statistics, so every one of them is 0, and it returns 0
+(FALSE) */
+int SymTable_getStats(SymTable_T oSymTable, SymTable_Stats *psStats) {
+  assert(oSymTable != NULL);
+  assert(psStats != NULL);
+  (void) oSymTable;
+  psStats->uHits = 0;
+  psStats->uMisses = 0;
+  psStats->uProbes = 0;
+  psStats->uExpansions = 0;
+  psStats->dExpandSeconds = 0.0;
+  psStats->uMaxMigrate = 0;
+  psStats->uMaxChain = 0;
+  psStats->dMeanChain = 0.0;
+  psStats->uBindingBytes = 0;
+  psStats->uKeyBytes = 0;
+  return 0;
+}
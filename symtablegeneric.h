@@ -0,0 +1,397 @@
+/*--------------------------------------------------------------------*/
+/* symtablegeneric.h                                                  */
+/* Author: Ahmed Farah                                                */
+/* A header-only Symbol Table specialised by macro to any key and     */
+/* value types, with the hash and equality functions inlined. It uses */
+/* the same chained hash table as symtablehash.c                      */
+/*--------------------------------------------------------------------*/
+
+/* To prevent double inclusions */
+#ifndef SYMTABLEGENERIC_INCLUDED
+#define SYMTABLEGENERIC_INCLUDED
+
+/* allows us to use size_t, malloc and free */
+#include <stdlib.h>
+#include <assert.h>
+
+/* How the generated functions are declared. They are static, so that
+every file that uses a table has its own copy that the compiler can
+inline, and inline where the compiler knows the keyword, so that the
+functions a file doesn't call cost nothing and draw no warning */
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L
+#define SYMTABLE_INLINE static inline
+#elif defined(__GNUC__)
+#define SYMTABLE_INLINE static __inline__
+#else
+#define SYMTABLE_INLINE static
+#endif
+
+/* The maximum load factor, as a percentage, and the most bindings a
+small table holds in its single inline bucket. They mean what they
+mean in symtablehash.c, have the same defaults, and can be overridden
+at compile time the same way */
+#ifndef SYMTABLE_MAX_LOAD_PERCENT
+#define SYMTABLE_MAX_LOAD_PERCENT 100
+#endif
+#if SYMTABLE_MAX_LOAD_PERCENT <= 0
+#error "SYMTABLE_MAX_LOAD_PERCENT must be positive"
+#endif
+#ifndef SYMTABLE_SMALL_LIMIT
+#define SYMTABLE_SMALL_LIMIT 8
+#endif
+#if SYMTABLE_SMALL_LIMIT < 0
+#error "SYMTABLE_SMALL_LIMIT must not be negative"
+#endif
+
+/* Takes in a number of buckets, uBucketCount, and returns as a size_t
+the number of bindings a table with that many buckets can hold before
+it exceeds SYMTABLE_MAX_LOAD_PERCENT. It is shared by every table that
+SYMTABLE_DEFINE generates */
+SYMTABLE_INLINE size_t SymTableGeneric_threshold(size_t uBucketCount) {
+  /* We divide first when multiplying first could overflow */
+  if (uBucketCount > (size_t) -1 / SYMTABLE_MAX_LOAD_PERCENT) {
+    return uBucketCount / 100 * SYMTABLE_MAX_LOAD_PERCENT;
+  }
+  return uBucketCount * SYMTABLE_MAX_LOAD_PERCENT / 100;
+}
+
+/* Takes in the current number of buckets of a table, uBucketCount, and
+returns the number of buckets to expand to as a size_t, or 0 if that
+number doesn't fit in a size_t. As in symtablehash.c, a small table
+goes to 509 buckets, then the table follows the primes of SIZES, and
+after 65521 it goes to the smallest prime above twice uBucketCount.
+It is shared by every table that SYMTABLE_DEFINE generates */
+SYMTABLE_INLINE size_t SymTableGeneric_nextBucketCount(
+size_t uBucketCount) {
+  static const size_t SIZES[] = {509, 1021, 2039, 4093, 8191, 16381,
+    32749, 65521};
+  size_t u;
+  size_t uDivisor;
+
+  if (uBucketCount < SIZES[0]) {
+    return SIZES[0];
+  }
+  for (u = 0; u < sizeof(SIZES) / sizeof(SIZES[0]) - 1; u++) {
+    if (SIZES[u] == uBucketCount) {
+      return SIZES[u + 1];
+    }
+  }
+  if (uBucketCount > ((size_t) -1 - 1) / 2) {
+    return 0;
+  }
+  for (u = uBucketCount * 2 + 1; u > uBucketCount; u += 2) {
+    for (uDivisor = 3; uDivisor <= u / uDivisor; uDivisor += 2) {
+      if (u % uDivisor == 0) {
+        break;
+      }
+    }
+    if (uDivisor > u / uDivisor) {
+      return u;
+    }
+  }
+  return 0;
+}
+
+/* Generates a symbol table whose keys are of type KeyT and whose
+values are of type ValT, both stored by value in its bindings, so that
+a value needs neither a pointer nor an allocation of its own. hashfn
+is the name of a function, or of a function-like macro, that takes in a
+KeyT and returns its hash code as a size_t, and eqfn one that takes in
+two KeyT and returns nonzero if they are the same key. Keys that are
+the same must have the same hash code. Both are called directly, so
+the compiler can inline them, and the hash code of every binding is
+cached, so eqfn is only called on bindings whose hash code matches.
+Keys and values are copied by assignment: a table of string keys
+stores the pointers, which must stay valid while they are bound.
+SYMTABLE_DEFINE(name, ...) defines, at file scope, the type name_T,
+the binding type struct name_Binding, whose Key and Value fields may be
+read and Value changed, and the functions below, which work as the
+functions of symtable.h with the same names do:
+  name_T name_new(void)
+  void name_free(name_T oTable)
+  size_t name_getLength(name_T oTable)
+  int name_putOrGet(name_T oTable, KeyT Key, ValT Value,
+    ValT **ppValue)
+  int name_put(name_T oTable, KeyT Key, ValT Value)
+  int name_replace(name_T oTable, KeyT Key, ValT Value, ValT *pOld)
+  int name_contains(name_T oTable, KeyT Key)
+  ValT *name_get(name_T oTable, KeyT Key)
+  int name_remove(name_T oTable, KeyT Key, ValT *pValue)
+  void name_map(name_T oTable,
+    void (*pfApply)(KeyT Key, ValT *pValue, void *pvExtra),
+    void *pvExtra)
+  void name_begin(name_T oTable, name_Iter *psIter)
+  struct name_Binding *name_next(name_Iter *psIter)
+Since a ValT can't be NULL, name_get returns a pointer to the value in
+its binding instead, or NULL if Key isn't bound; the pointer is valid
+until the binding is removed or the table is freed, and the value may
+be changed through it. name_putOrGet stores such a pointer in *ppValue
+when ppValue isn't NULL. name_replace and name_remove return 1 if Key
+was bound and 0 if it wasn't, and store the old value in *pOld or
+*pValue when those aren't NULL. name_next returns the next binding of
+an iteration that name_begin started, or NULL once every one has been
+visited; the table must not change in the meantime.
+The table starts out with one inline bucket, like a symtablehash.c
+table, and expands by relinking its bindings, but it never shrinks,
+and has no flags, arena, incremental mode or frozen form. */
+#define SYMTABLE_DEFINE(name, KeyT, ValT, hashfn, eqfn) \
+ \
+/* A binding of the table: the key, the value, the cached hash code \
+of the key, and the next binding of its chain */ \
+struct name##_Binding { \
+  KeyT Key; \
+  ValT Value; \
+  size_t Hash; \
+  struct name##_Binding *psNextBinding; \
+}; \
+ \
+/* The table, laid out as the struct SymTable of symtablehash.c */ \
+struct name { \
+  struct name##_Binding **Bindings; \
+  size_t size; \
+  size_t bucketCount; \
+  size_t expandThreshold; \
+  struct name##_Binding *inlineBucket; \
+}; \
+ \
+typedef struct name *name##_T; \
+ \
+/* A cursor over the bindings of a table, owned by its caller */ \
+typedef struct name##_Iter { \
+  name##_T oTable; \
+  size_t uBucket; \
+  struct name##_Binding *psCurrent; \
+} name##_Iter; \
+ \
+SYMTABLE_INLINE name##_T name##_new(void) { \
+  name##_T oTable; \
+  oTable = (name##_T) malloc(sizeof(struct name)); \
+  if (oTable == NULL) { \
+    return NULL; \
+  } \
+  oTable->inlineBucket = NULL; \
+  oTable->Bindings = &oTable->inlineBucket; \
+  oTable->bucketCount = 1; \
+  oTable->expandThreshold = SYMTABLE_SMALL_LIMIT; \
+  oTable->size = 0; \
+  return oTable; \
+} \
+ \
+SYMTABLE_INLINE void name##_free(name##_T oTable) { \
+  struct name##_Binding *psCurrentBinding; \
+  struct name##_Binding *psNextBinding; \
+  size_t u; \
+  assert(oTable != NULL); \
+  for (u = 0; u < oTable->bucketCount; u++) { \
+    for (psCurrentBinding = oTable->Bindings[u]; \
+      psCurrentBinding != NULL; psCurrentBinding = psNextBinding) { \
+      psNextBinding = psCurrentBinding->psNextBinding; \
+      free(psCurrentBinding); \
+    } \
+  } \
+  if (oTable->Bindings != &oTable->inlineBucket) { \
+    free(oTable->Bindings); \
+  } \
+  free(oTable); \
+} \
+ \
+SYMTABLE_INLINE size_t name##_getLength(name##_T oTable) { \
+  assert(oTable != NULL); \
+  return oTable->size; \
+} \
+ \
+/* Returns the binding of Key, whose hash code is uHash, or NULL */ \
+SYMTABLE_INLINE struct name##_Binding *name##_find(name##_T oTable, \
+KeyT Key, size_t uHash) { \
+  struct name##_Binding *psCurrentBinding; \
+  assert(oTable != NULL); \
+  for (psCurrentBinding = \
+    oTable->Bindings[uHash % oTable->bucketCount]; \
+    psCurrentBinding != NULL; \
+    psCurrentBinding = psCurrentBinding->psNextBinding) { \
+    if (psCurrentBinding->Hash == uHash && \
+      eqfn(psCurrentBinding->Key, Key)) { \
+      return psCurrentBinding; \
+    } \
+  } \
+  return NULL; \
+} \
+ \
+/* Relinks every binding into a larger bucket array. If there is no \
+memory for one, the table keeps working with longer chains */ \
+SYMTABLE_INLINE void name##_expand(name##_T oTable) { \
+  struct name##_Binding **Bindings; \
+  struct name##_Binding *psCurrentBinding; \
+  struct name##_Binding *psNextBinding; \
+  size_t uBucketCount; \
+  size_t uBucket; \
+  size_t u; \
+  assert(oTable != NULL); \
+  uBucketCount = SymTableGeneric_nextBucketCount(oTable->bucketCount); \
+  if (uBucketCount == 0) { \
+    oTable->expandThreshold = (size_t) -1; \
+    return; \
+  } \
+  Bindings = (struct name##_Binding **) \
+    calloc(uBucketCount, sizeof(struct name##_Binding *)); \
+  if (Bindings == NULL) { \
+    return; \
+  } \
+  for (u = 0; u < oTable->bucketCount; u++) { \
+    for (psCurrentBinding = oTable->Bindings[u]; \
+      psCurrentBinding != NULL; psCurrentBinding = psNextBinding) { \
+      psNextBinding = psCurrentBinding->psNextBinding; \
+      uBucket = psCurrentBinding->Hash % uBucketCount; \
+      psCurrentBinding->psNextBinding = Bindings[uBucket]; \
+      Bindings[uBucket] = psCurrentBinding; \
+    } \
+  } \
+  if (oTable->Bindings != &oTable->inlineBucket) { \
+    free(oTable->Bindings); \
+  } \
+  oTable->Bindings = Bindings; \
+  oTable->bucketCount = uBucketCount; \
+  oTable->expandThreshold = SymTableGeneric_threshold(uBucketCount); \
+} \
+ \
+SYMTABLE_INLINE int name##_putOrGet(name##_T oTable, KeyT Key, \
+ValT Value, ValT **ppValue) { \
+  struct name##_Binding *psNewBinding; \
+  size_t uHash; \
+  assert(oTable != NULL); \
+  uHash = (size_t) (hashfn(Key)); \
+  psNewBinding = name##_find(oTable, Key, uHash); \
+  if (psNewBinding == NULL) { \
+    psNewBinding = (struct name##_Binding *) \
+      malloc(sizeof(struct name##_Binding)); \
+    if (psNewBinding == NULL) { \
+      return -1; \
+    } \
+    if (oTable->size >= oTable->expandThreshold) { \
+      name##_expand(oTable); \
+    } \
+    psNewBinding->Key = Key; \
+    psNewBinding->Value = Value; \
+    psNewBinding->Hash = uHash; \
+    psNewBinding->psNextBinding = \
+      oTable->Bindings[uHash % oTable->bucketCount]; \
+    oTable->Bindings[uHash % oTable->bucketCount] = psNewBinding; \
+    oTable->size++; \
+    if (ppValue != NULL) { \
+      *ppValue = &psNewBinding->Value; \
+    } \
+    return 1; \
+  } \
+  if (ppValue != NULL) { \
+    *ppValue = &psNewBinding->Value; \
+  } \
+  return 0; \
+} \
+ \
+SYMTABLE_INLINE int name##_put(name##_T oTable, KeyT Key, \
+ValT Value) { \
+  return (name##_putOrGet(oTable, Key, Value, NULL) == 1); \
+} \
+ \
+SYMTABLE_INLINE int name##_replace(name##_T oTable, KeyT Key, \
+ValT Value, ValT *pOld) { \
+  struct name##_Binding *psBinding; \
+  assert(oTable != NULL); \
+  psBinding = name##_find(oTable, Key, (size_t) (hashfn(Key))); \
+  if (psBinding == NULL) { \
+    return 0; \
+  } \
+  if (pOld != NULL) { \
+    *pOld = psBinding->Value; \
+  } \
+  psBinding->Value = Value; \
+  return 1; \
+} \
+ \
+SYMTABLE_INLINE int name##_contains(name##_T oTable, KeyT Key) { \
+  assert(oTable != NULL); \
+  return (name##_find(oTable, Key, (size_t) (hashfn(Key))) != NULL); \
+} \
+ \
+SYMTABLE_INLINE ValT *name##_get(name##_T oTable, KeyT Key) { \
+  struct name##_Binding *psBinding; \
+  assert(oTable != NULL); \
+  psBinding = name##_find(oTable, Key, (size_t) (hashfn(Key))); \
+  if (psBinding == NULL) { \
+    return NULL; \
+  } \
+  return &psBinding->Value; \
+} \
+ \
+SYMTABLE_INLINE int name##_remove(name##_T oTable, KeyT Key, \
+ValT *pValue) { \
+  struct name##_Binding **ppsLink; \
+  struct name##_Binding *psBinding; \
+  size_t uHash; \
+  assert(oTable != NULL); \
+  uHash = (size_t) (hashfn(Key)); \
+  for (ppsLink = &oTable->Bindings[uHash % oTable->bucketCount]; \
+    *ppsLink != NULL; ppsLink = &(*ppsLink)->psNextBinding) { \
+    psBinding = *ppsLink; \
+    if (psBinding->Hash == uHash && eqfn(psBinding->Key, Key)) { \
+      *ppsLink = psBinding->psNextBinding; \
+      if (pValue != NULL) { \
+        *pValue = psBinding->Value; \
+      } \
+      free(psBinding); \
+      oTable->size--; \
+      return 1; \
+    } \
+  } \
+  return 0; \
+} \
+ \
+SYMTABLE_INLINE void name##_map(name##_T oTable, \
+void (*pfApply)(KeyT Key, ValT *pValue, void *pvExtra), \
+void *pvExtra) { \
+  struct name##_Binding *psCurrentBinding; \
+  size_t u; \
+  assert(oTable != NULL); \
+  assert(pfApply != NULL); \
+  for (u = 0; u < oTable->bucketCount; u++) { \
+    for (psCurrentBinding = oTable->Bindings[u]; \
+      psCurrentBinding != NULL; \
+      psCurrentBinding = psCurrentBinding->psNextBinding) { \
+      (*pfApply)(psCurrentBinding->Key, &psCurrentBinding->Value, \
+        pvExtra); \
+    } \
+  } \
+} \
+ \
+SYMTABLE_INLINE void name##_begin(name##_T oTable, \
+name##_Iter *psIter) { \
+  assert(oTable != NULL); \
+  assert(psIter != NULL); \
+  psIter->oTable = oTable; \
+  psIter->uBucket = 0; \
+  psIter->psCurrent = NULL; \
+} \
+ \
+SYMTABLE_INLINE struct name##_Binding *name##_next( \
+name##_Iter *psIter) { \
+  assert(psIter != NULL); \
+  if (psIter->psCurrent != NULL) { \
+    psIter->psCurrent = psIter->psCurrent->psNextBinding; \
+    if (psIter->psCurrent == NULL) { \
+      psIter->uBucket++; \
+    } \
+  } \
+  while (psIter->psCurrent == NULL && \
+    psIter->uBucket < psIter->oTable->bucketCount) { \
+    psIter->psCurrent = psIter->oTable->Bindings[psIter->uBucket]; \
+    if (psIter->psCurrent == NULL) { \
+      psIter->uBucket++; \
+    } \
+  } \
+  return psIter->psCurrent; \
+} \
+ \
+/* Makes the macro usable with a semicolon after it */ \
+typedef int name##_Defined
+
+#endif
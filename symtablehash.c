@@ -6,80 +6,515 @@
 /* It uses a hash-table implementation to achieve this                */
 /*--------------------------------------------------------------------*/
 
+/* open, read and pthread_once are POSIX, not ANSI C */
+#define _POSIX_C_SOURCE 200112L
+
 #include <assert.h>
+#include <stddef.h>
 #include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "symtable.h"
+#include "arena.h"
+#include "filter.h"
+#include "hashfn.h"
+#include "parallel.h"
+#include "perfect.h"
 
 /* A global variable which specifies the sequence of numbers dictating
 the number of buckets our hash table will have when it expands. It
-starts out with 509 buckets, and then expands to the next size as
-needed. It does not expand any further once it hits 65521 buckets. */
+starts out small, with a single bucket inside the table, goes to 509
+buckets once it holds more than SYMTABLE_SMALL_LIMIT bindings, and then
+expands to the next size as needed. Past 65521 buckets,
+SymTable_nextBucketCount computes further primes, so the table keeps
+growing for as long as memory allows. */
 static const size_t SIZES[] = {509, 1021, 2039, 4093, 8191, 16381,
 32749, 65521};
 
-/* A Binding is an abstract data structure made up of 3 parts: Key,
+/* The maximum load factor, as a percentage: the table expands once it
+holds SYMTABLE_MAX_LOAD_PERCENT bindings for every 100 buckets. It can
+be overridden at compile time, e.g. with -DSYMTABLE_MAX_LOAD_PERCENT=75.
+The default of 100 expands when there are as many bindings as buckets */
+#ifndef SYMTABLE_MAX_LOAD_PERCENT
+#define SYMTABLE_MAX_LOAD_PERCENT 100
+#endif
+#if SYMTABLE_MAX_LOAD_PERCENT <= 0
+#error "SYMTABLE_MAX_LOAD_PERCENT must be positive"
+#endif
+
+/* The most bindings a small table holds in its single inline bucket.
+Such a table is just one chain, like a linked list, with no bucket
+array to allocate and zero. The put that would take it past the limit
+allocates SIZES[0] buckets first, and a table of SIZES[0] buckets that
+shrinks below half the limit goes back to its inline bucket. It can be
+overridden at compile time, e.g. with -DSYMTABLE_SMALL_LIMIT=16; 0
+makes every table allocate its buckets on its first put */
+#ifndef SYMTABLE_SMALL_LIMIT
+#define SYMTABLE_SMALL_LIMIT 8
+#endif
+#if SYMTABLE_SMALL_LIMIT < 0
+#error "SYMTABLE_SMALL_LIMIT must not be negative"
+#endif
+
+/* The size below which a table of SIZES[0] buckets goes back to being
+small. A variable rather than a macro, so that a limit of 0 or 1 doesn't
+make the comparison with it trivially true */
+static const size_t DEMOTE_SIZE = SYMTABLE_SMALL_LIMIT / 2;
+
+/* The number of old buckets that each operation on a table made with
+SYMTABLE_INCREMENTAL moves to the new bucket array while it expands.
+Expansions happen when the size reaches SYMTABLE_MAX_LOAD_PERCENT of
+the bucket count, and they roughly double it, so moving more than
+100 / SYMTABLE_MAX_LOAD_PERCENT buckets per put is enough to finish
+one expansion before the next one is due. A shrink leaves the table
+less room before its next expansion, so SymTable_resize moves more
+buckets per operation then */
+enum {MIGRATE_BUCKETS = 2 + 100 / SYMTABLE_MAX_LOAD_PERCENT};
+
+/* The number of keys that SymTable_getBatch and SymTable_putBatch hash
+and prefetch before they resolve any of them. It bounds how many cache
+misses are in flight at once, and the size of their local arrays */
+enum {BATCH_GROUP = 16};
+
+/* Asks the processor to start loading the cache line at pv, without
+waiting for it. It is only a hint, so compilers that don't have it
+just evaluate pv */
+#ifdef __GNUC__
+#define SYMTABLE_PREFETCH(pv) __builtin_prefetch(pv)
+#else
+#define SYMTABLE_PREFETCH(pv) ((void) (pv))
+#endif
+
+/* Adds 1 to the counter c, a field of the stats of a table, when the
+statistics of SymTable_getStats are compiled in with -DSYMTABLE_STATS.
+Otherwise the counters don't exist, and c isn't even evaluated */
+#ifdef SYMTABLE_STATS
+#define SYMTABLE_COUNT(c) ((void) ((c)++))
+#else
+#define SYMTABLE_COUNT(c) ((void) 0)
+#endif
+
+/* The longest chain a put may make before the table suspects that its
+keys were chosen to collide, and reseeds its hash function with
+SymTable_reseed. With the load factor capped, chains of random keys
+stay short, so 32 is far past what chance gives. It can be overridden
+at compile time, e.g. with -DSYMTABLE_MAX_CHAIN=64 */
+#ifndef SYMTABLE_MAX_CHAIN
+#define SYMTABLE_MAX_CHAIN 32
+#endif
+#if SYMTABLE_MAX_CHAIN <= 0
+#error "SYMTABLE_MAX_CHAIN must be positive"
+#endif
+
+/* The number of keys from which SymTable_newFromArray hashes its keys
+on SYMTABLE_LOAD_THREADS threads instead of on the calling one alone.
+Below it, starting the threads costs more than it saves. Both can be
+overridden at compile time, e.g. with -DSYMTABLE_PARALLEL_LOAD=1000 */
+#ifndef SYMTABLE_PARALLEL_LOAD
+#define SYMTABLE_PARALLEL_LOAD 65536
+#endif
+#ifndef SYMTABLE_LOAD_THREADS
+#define SYMTABLE_LOAD_THREADS 4
+#endif
+#if SYMTABLE_LOAD_THREADS <= 0
+#error "SYMTABLE_LOAD_THREADS must be positive"
+#endif
+
+/* The size of the array in every binding that holds a copy of its key,
+if the key is shorter than that, so that most keys need no allocation
+of their own and are read from the binding's own cache lines. With
+the 5 other parts of a binding it makes up 56 bytes where pointers
+have 8 */
+enum {INLINE_KEY_SIZE = 16};
+
+/* A Binding is an abstract data structure made up of 6 parts: Key,
 a pointer to a string (to store the key), Value, which is of type
-void * and is a pointer to the value, and psNextBinding, which points
-to another binding - It allows the bindings to be strung together to
-form a singly-linked list. */
+void * and is a pointer to the value, Hash, the full hash code of Key
+as computed by the table's hash function, Length, the length of Key,
+psNextBinding, which points to another binding - It allows the
+bindings to be strung together to form a singly-linked list - and
+InlineKey, which holds the copy of a key of fewer than INLINE_KEY_SIZE
+characters. Key then points at InlineKey, so a binding must not be
+copied without pointing the copy's Key at the copy's InlineKey. A table
+that borrows its keys never uses InlineKey, so its bindings are
+allocated without it; see SymTable_bindingSize. */
 struct Binding {
   /* Symbol table key */
   const char * Key;
   /* Symbol table value */
   const void * Value;
+  /* The hash code of Key, before it is reduced to a bucket index. It
+  lets us rebucket without rereading the key, and lets chain walks skip
+  the memcmp for bindings whose hash doesn't match */
+  size_t Hash;
+  /* The number of characters of Key, not counting its '\0' */
+  size_t Length;
   /* The next binding  */
   struct Binding * psNextBinding;
+  /* The copy of a short key, which Key then points at */
+  char InlineKey[INLINE_KEY_SIZE];
 };
 
-/* This is a hash-table implementation of a symbol table. SymTable is
-an abstract data structure which has 3 fields. First, Bindings is an
-array of pointers to bindings. It is realized as a variable of type
-struct Binding **. The second is the size, which is of type size_t,
-and stores the current number of elements in the symbol table. The
-third is the bucketCountOrder, and it is the index of the element in
-SIZES[] which corresponds to the current number of buckets in the
-symbol table. It starts off at 0 and is incremented by 1 for every
-expansion of Bindindgs. */
+/* This is a hash-table implementation of a symbol table. SymTable is an
+abstract data structure which has 22 fields, or 23 with SYMTABLE_STATS.
+First, Bindings is an array of pointers to bindings. It is realized as a
+variable of type struct Binding **. The second is the size, which is of
+type size_t, and stores the current number of elements in the symbol
+table. The third is the bucketCount, the number of elements of Bindings.
+It starts off at 1, goes up with every expansion of Bindings and down
+again when most bindings have been removed. The fourth is
+expandThreshold, the size at which the load factor reaches
+SYMTABLE_MAX_LOAD_PERCENT; it is recomputed with bucketCount. The fifth
+is arena, the Arena_T that the bindings and key copies come from, or
+NULL if they come from malloc. The sixth is hash, the function that
+computes the hash code of every key. The seventh is borrowed, which is
+set if the table was made with SYMTABLE_BORROWED and stores its callers'
+keys instead of copies. The eighth is interned, which is set if it was
+made with SYMTABLE_INTERNED and compares its keys by address; borrowed
+is then set too. The next 5 are only used while a resize of a table made
+with SYMTABLE_INCREMENTAL is in progress. Then oldBindings is the array
+being resized from, with oldBucketCount buckets, and its buckets before
+migrateNext have been moved to Bindings already. Every operation moves
+migrateRate more of them, which is enough to move them all before the
+table can reach its next expandThreshold. Every binding is in
+exactly one of the two arrays, and new bindings always go in Bindings.
+The rest of the time oldBindings is NULL. Then inlineBucket is the only
+bucket of a small table, whose Bindings points at it instead of at an
+allocated array. The next 3 are NULL and 0 until SymTable_freeze
+succeeds. Frozen then holds every binding, in the slot that the minimal
+perfect hash gives its key, and Bindings is the empty inline bucket.
+Displacements has an element for each of the frozenMask + 1 buckets of
+the first level of the hash: an odd one is the slot of the only key of
+its bucket, shifted left by 1, and an even one the seed, shifted the
+same way, that spreads the keys of its bucket over free slots. The next
+3 are only used by a table whose caller didn't give it a hash function,
+and which doesn't compare keys by address. Then seededHash is the
+function that hashes its keys instead of hash, under seed, which is
+different for every table, and reseedSize is the size below which a long
+chain doesn't make the table reseed again. For other tables seededHash
+is NULL. While a reseed moves the bindings of oldBindings to Bindings,
+oldSeededHash and oldSeed are the function and the seed that the old
+buckets were hashed with, and a binding's Hash is recomputed as it is
+moved. The rest of the time oldSeededHash is NULL, and oldBindings, if
+any, is hashed like Bindings. When SYMTABLE_STATS is defined, stats
+holds the counters that SymTable_getStats reports. */
 struct SymTable {
   /* The buckets of the hash table. An array of pointers to bindings */
   struct Binding ** Bindings;
   /* The current size of the symbol table */
   size_t size;
-  /* index of the element in SIZES[] which corresponds to the current
-  number of buckets in the symbol table */
-  size_t bucketCountOrder;
+  /* The current number of buckets in the symbol table */
+  size_t bucketCount;
+  /* The size at which the next put expands Bindings */
+  size_t expandThreshold;
+  /* Where bindings and key copies are allocated, if not from malloc */
+  Arena_T arena;
+  /* The hash function of the table */
+  SymTable_HashFn hash;
+  /* Whether the keys belong to the caller rather than to the table */
+  int borrowed;
+  /* Whether keys are compared by address rather than by characters */
+  int interned;
+  /* Whether resizes move a few buckets per operation */
+  int incremental;
+  /* The buckets still being moved to Bindings, or NULL */
+  struct Binding ** oldBindings;
+  /* The number of buckets of oldBindings */
+  size_t oldBucketCount;
+  /* The first bucket of oldBindings that hasn't been moved yet */
+  size_t migrateNext;
+  /* The number of buckets of oldBindings each operation moves */
+  size_t migrateRate;
+  /* The one bucket of a small table */
+  struct Binding * inlineBucket;
+  /* The bindings of a frozen table, by slot, or NULL */
+  struct Binding * Frozen;
+  /* The slot or the seed of each bucket of a frozen table, or NULL */
+  unsigned int * Displacements;
+  /* The number of buckets in the first level of the hash, less 1 */
+  size_t frozenMask;
+  /* The seeded hash function of the table, or NULL to use hash */
+  size_t (*seededHash)(const char *pcKey, size_t uLength,
+    size_t uSeed);
+  /* The seed given to seededHash */
+  size_t seed;
+  /* The size the table must reach before it may reseed again */
+  size_t reseedSize;
+  /* The seeded hash function of oldBindings during a reseed, or NULL */
+  size_t (*oldSeededHash)(const char *pcKey, size_t uLength,
+    size_t uSeed);
+  /* The seed given to oldSeededHash */
+  size_t oldSeed;
+#ifdef SYMTABLE_STATS
+  /* The counters of the table. Its other statistics aren't used */
+  SymTable_Stats stats;
+#endif
 };
 
+/* Random bytes from the system, which every seed is made from, or 0
+if they couldn't be read. They are read once per process, the first
+time a table needs a seed */
+static size_t uRandomSeed = 0;
+
+/* Makes sure that uRandomSeed is only read once, even if several
+threads make their first tables at the same time */
+static pthread_once_t sRandomSeedOnce = PTHREAD_ONCE_INIT;
+
+/* A helper function which reads uRandomSeed from /dev/urandom, and
+leaves it 0 if it can't. It is called through pthread_once by
+SymTable_newSeed */
+static void SymTable_readRandomSeed(void) {
+  size_t uSeed;
+  int iFd;
+
+  iFd = open("/dev/urandom", O_RDONLY);
+  if (iFd < 0) {
+    return;
+  }
+  if (read(iFd, &uSeed, sizeof(uSeed)) == (ssize_t) sizeof(uSeed)) {
+    uRandomSeed = uSeed;
+  }
+  close(iFd);
+}
+
+/* A helper function which takes in a SymTable_T oSymTable and returns
+a new seed for its hash function as a size_t. It mixes the random
+bytes of uRandomSeed, which make the seed secret, with the address of
+the table, its current seed, the time and the processor time used so
+far, which make the seeds of two tables, or the two seeds of one
+table, differ. Where /dev/urandom can't be read only the latter are
+left, which an attacker who knows the time could guess. It is called
+by SymTable_newWithHash and SymTable_reseed */
+static size_t SymTable_newSeed(SymTable_T oSymTable) {
+  assert(oSymTable != NULL);
+  pthread_once(&sRandomSeedOnce, SymTable_readRandomSeed);
+  return HashFn_mix(uRandomSeed ^ (size_t) (void *) oSymTable ^
+    (size_t) time(NULL), (size_t) clock() ^ oSymTable->seed);
+}
+
+/* A Helper function which takes in a number of buckets, uBucketCount,
+and returns as a size_t the number of bindings a table with that many
+buckets can hold before it exceeds SYMTABLE_MAX_LOAD_PERCENT. It is
+called by SymTable_newWithHash and SymTable_expand */
+static size_t SymTable_threshold(size_t uBucketCount) {
+  /* We divide first when multiplying first could overflow */
+  if (uBucketCount > (size_t) -1 / SYMTABLE_MAX_LOAD_PERCENT) {
+    return uBucketCount / 100 * SYMTABLE_MAX_LOAD_PERCENT;
+  }
+  return uBucketCount * SYMTABLE_MAX_LOAD_PERCENT / 100;
+}
+
+/* A helper function which takes a SymTable_T oSymTable and returns as a
+size_t the number of bytes allocated for each of its bindings: all of
+struct Binding, or only the part before InlineKey if oSymTable borrows
+its keys and so never copies one into a binding. It is called by
+SymTable_newWithHash, SymTable_newBinding, SymTable_perfect and
+SymTable_getStats */
+static size_t SymTable_bindingSize(SymTable_T oSymTable) {
+  assert(oSymTable != NULL);
+  if (oSymTable->borrowed) {
+    return offsetof(struct Binding, InlineKey);
+  }
+  return sizeof(struct Binding);
+}
+
 /* The SymTable constructor */
 SymTable_T SymTable_new(void) {
+  return SymTable_newWithFlags(0);
+}
+
+/* The SymTable constructor that takes flags */
+SymTable_T SymTable_newWithFlags(unsigned int uFlags) {
+  return SymTable_newWithHash(NULL, uFlags);
+}
+
+/* The SymTable constructor that takes a hash function */
+SymTable_T SymTable_newWithHash(SymTable_HashFn pfHash,
+unsigned int uFlags) {
   SymTable_T oSymTable;
   oSymTable = (SymTable_T) malloc(sizeof(struct SymTable));
   if (oSymTable == NULL) {
     return NULL;
   }
-  oSymTable->Bindings = calloc(SIZES[0], sizeof(struct Binding *));
-  if (oSymTable->Bindings == NULL) {
-    /* We must remember to free oSymTable, since we won't be actually
-    making a symbol table */
-    free(oSymTable);
-    return NULL;
+  oSymTable->incremental = ((uFlags & SYMTABLE_INCREMENTAL) != 0);
+  oSymTable->interned = ((uFlags & SYMTABLE_INTERNED) != 0);
+  oSymTable->borrowed = ((uFlags & SYMTABLE_BORROWED) != 0 ||
+    oSymTable->interned);
+  oSymTable->arena = NULL;
+  if (uFlags & SYMTABLE_ARENA) {
+    oSymTable->arena = Arena_new(SymTable_bindingSize(oSymTable));
+    if (oSymTable->arena == NULL) {
+      /* We must remember to free oSymTable, since we won't be actually
+      making a symbol table */
+      free(oSymTable);
+      return NULL;
+    }
+  }
+  oSymTable->hash = pfHash;
+  if (pfHash == NULL) {
+    oSymTable->hash = HashFn_multiplicative;
+  }
+  if (oSymTable->interned) {
+    oSymTable->hash = HashFn_address;
+  }
+  oSymTable->oldBindings = NULL;
+  oSymTable->oldBucketCount = 0;
+  oSymTable->migrateNext = 0;
+  oSymTable->migrateRate = MIGRATE_BUCKETS;
+  oSymTable->Frozen = NULL;
+  oSymTable->Displacements = NULL;
+  oSymTable->frozenMask = 0;
+
+  /* Unless the caller chose how keys are hashed, they are hashed under
+  a seed of this table's own */
+  oSymTable->seededHash = NULL;
+  oSymTable->seed = 0;
+  oSymTable->reseedSize = 0;
+  oSymTable->oldSeededHash = NULL;
+  oSymTable->oldSeed = 0;
+  if (pfHash == NULL && ! oSymTable->interned) {
+    oSymTable->seededHash = HashFn_seeded;
+    oSymTable->seed = SymTable_newSeed(oSymTable);
   }
-  oSymTable->bucketCountOrder = 0;
+#ifdef SYMTABLE_STATS
+  oSymTable->stats.uHits = 0;
+  oSymTable->stats.uMisses = 0;
+  oSymTable->stats.uProbes = 0;
+  oSymTable->stats.uExpansions = 0;
+  oSymTable->stats.dExpandSeconds = 0.0;
+  oSymTable->stats.uMaxMigrate = 0;
+#endif
+
+  /* Every table starts out small, so no bucket array is allocated */
+  oSymTable->inlineBucket = NULL;
+  oSymTable->Bindings = &oSymTable->inlineBucket;
+  oSymTable->bucketCount = 1;
+  oSymTable->expandThreshold = SYMTABLE_SMALL_LIMIT;
   oSymTable->size = 0;
   return oSymTable;
 }
 
-/* Helper function which frees up an array of pointers to bindings. It
-takes in an array of pointers to bindings (of type struct Binding **)
-called Bindings, and a size_t variable called size, which is the size
-of this array. It then frees up all the memory associated with Bindings,
-and returns nothing. It is called by SymTable_free as well as
-SymTable_expand */
-static void SymTable_free_Bindings(struct Binding ** Bindings,
-size_t size) {
+/* A helper function which allocates a binding along with a defensive
+copy of the key pcKey, of length uLength, for SymTable_T oSymTable, from
+its arena if it has one and from malloc otherwise. A short key is
+copied into the binding itself instead. If oSymTable borrows its keys,
+the binding points at pcKey itself. It returns the new
+binding, with only its Key and Length filled in, or NULL if it can't
+allocate memory. It is called by SymTable_putOrGetLen */
+static struct Binding * SymTable_newBinding(SymTable_T oSymTable,
+const char *pcKey, size_t uLength) {
+  struct Binding *psNewBinding;
+  char *keyCopy;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  /* We make a memory allocation for the new binding */
+  if (oSymTable->arena != NULL) {
+    psNewBinding = (struct Binding *) Arena_allocNode(oSymTable->arena);
+  }
+  else {
+    psNewBinding = (struct Binding*)
+      malloc(SymTable_bindingSize(oSymTable));
+  }
+  if (psNewBinding == NULL) {
+    return NULL;
+  }
+  psNewBinding->Length = uLength;
+
+  /* A borrowed key is stored as it is */
+  if (oSymTable->borrowed) {
+    assert(oSymTable->interned || pcKey[uLength] == '\0');
+    psNewBinding->Key = pcKey;
+    return psNewBinding;
+  }
+
+  /* We make a defensive copy of the key, in the binding if it fits */
+  if (uLength < INLINE_KEY_SIZE) {
+    memcpy(psNewBinding->InlineKey, pcKey, uLength);
+    psNewBinding->InlineKey[uLength] = '\0';
+    psNewBinding->Key = psNewBinding->InlineKey;
+    return psNewBinding;
+  }
+  if (oSymTable->arena != NULL) {
+    keyCopy = Arena_copyKey(oSymTable->arena, pcKey, uLength);
+    if (keyCopy == NULL) {
+      Arena_freeNode(oSymTable->arena, psNewBinding);
+      return NULL;
+    }
+    psNewBinding->Key = keyCopy;
+    return psNewBinding;
+  }
+  keyCopy = (char *) calloc(uLength + 1, sizeof(char));
+  if (keyCopy == NULL) {
+    /* Since we won't be adding psNewBinding to the symbol table,
+    we must free it */
+    free(psNewBinding);
+    return NULL;
+  }
+  psNewBinding->Key = memcpy(keyCopy, pcKey, uLength);
+  return psNewBinding;
+}
+
+/* A helper function which takes in a SymTable_T oSymTable and
+psBinding, one of its bindings, and returns 1 (TRUE) if the key of
+psBinding is a copy of its own, allocated from malloc, or 0 (FALSE) if
+it is borrowed, held in the binding, or in an arena. It is called by
+SymTable_freeBinding and SymTable_free */
+static int SymTable_hasKeyCopy(SymTable_T oSymTable,
+const struct Binding *psBinding) {
+  assert(oSymTable != NULL);
+  assert(psBinding != NULL);
+  return (oSymTable->arena == NULL && ! oSymTable->borrowed &&
+    psBinding->Key != psBinding->InlineKey);
+}
+
+/* A helper function which frees psBinding, a binding of SymTable_T
+oSymTable, along with its key copy. An arena only takes the binding
+back; it keeps the key bytes until the arena itself is freed. It is
+called by SymTable_remove */
+static void SymTable_freeBinding(SymTable_T oSymTable,
+struct Binding *psBinding) {
+  assert(oSymTable != NULL);
+  assert(psBinding != NULL);
+
+  if (oSymTable->arena != NULL) {
+    Arena_freeNode(oSymTable->arena, psBinding);
+    return;
+  }
+  /* Since we created a defensive copy of the key, we have to free that
+  too, unless the key was borrowed or is in the binding */
+  if (SymTable_hasKeyCopy(oSymTable, psBinding)) {
+    free((void *) psBinding->Key);
+  }
+  free(psBinding);
+}
+
+/* A helper function which frees Bindings, an array of buckets of
+SymTable_T oSymTable, unless it is the inline bucket of oSymTable,
+which is part of the table itself. It has no return value. It is
+called whenever a bucket array is done with */
+static void SymTable_freeBuckets(SymTable_T oSymTable,
+struct Binding **Bindings) {
+  assert(oSymTable != NULL);
+  if (Bindings != &oSymTable->inlineBucket) {
+    free(Bindings);
+  }
+}
+
+/* Helper function which frees up the bindings of an array of pointers
+to bindings. It takes in a SymTable_T oSymTable, which doesn't have an
+arena, an array of its pointers to bindings (of type struct Binding
+**) called Bindings, and a size_t variable called size, which is the
+size of this array. It then frees up every binding of Bindings, but not
+the array itself, and returns nothing. It is called by SymTable_free */
+static void SymTable_free_Bindings(SymTable_T oSymTable,
+struct Binding ** Bindings, size_t size) {
   struct Binding * psCurrentBinding;
   struct Binding * psNextBinding;
   size_t hash;
+  assert(oSymTable != NULL);
   assert(Bindings != NULL);
   assert(size > 0);
 
@@ -89,271 +524,1236 @@ size_t size) {
       psNextBinding = psCurrentBinding->psNextBinding;
       /* Since we create a defensive copy of the key, we have to free-up
       the memory allocation of the key as well */
-      free((void *) psCurrentBinding->Key);
+      if (SymTable_hasKeyCopy(oSymTable, psCurrentBinding)) {
+        free((void *) psCurrentBinding->Key);
+      }
       free(psCurrentBinding);
     }
   }
-  free(Bindings);
 }
 
-/* A Helper function which takes in a string, pcKey, and a size_t called
-uBucketCount, which represents the number of buckets available. It
-then returns a hash code for pcKey that is between 0 and uBucketCount-1,
-inclusive, as a size_t variable. It is called directly by
-SymTable_expand, SymTable_find, and SymTable_remove */
-static size_t SymTable_hash(const char *pcKey, size_t uBucketCount) {
-  const size_t HASH_MULTIPLIER = 65599;
+/* A Helper function which takes in the current number of buckets,
+uBucketCount, and returns the number of buckets to expand to as a
+size_t. It follows SIZES while it can, and after that returns the
+smallest prime above twice uBucketCount. It returns 0 if that number
+doesn't fit in a size_t. It is called by SymTable_expand and
+SymTable_fitBucketCount */
+static size_t SymTable_nextBucketCount(size_t uBucketCount) {
   size_t u;
-  size_t uHash = 0;
-  assert(pcKey != NULL);
+  size_t uDivisor;
   assert(uBucketCount > 0);
 
-  for (u = 0; pcKey[u] != '\0'; u++) {
-    uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+  /* A small table gets its first real bucket array */
+  if (uBucketCount < SIZES[0]) {
+    return SIZES[0];
   }
-  return uHash % uBucketCount;
-}
-
-/* A Helper function which Expands Bindings, the array of binding
-pointers that SymTable_T oSymTable uses.
-It is called by SymTable_put. It takes in a SymTable_T oSymTable and
-has no return value. It expands the relevant array if it can, but
-returns and leaves oSymTable in its original condition if it can't
-expand it. It exaapnds according to the sequence of sizes recorded in
-SIZES by increasing the number of buckets by one level in that sequence
-of numbers (unless it's already reached the highest of them) */
-static void SymTable_expand(SymTable_T oSymTable) {
-  struct Binding ** newBindings;
-  struct Binding * psCurrentBinding;
-  struct Binding * psNewBinding;
-  size_t hash;
-  size_t newHash;
-  char * keyCopy;
-  assert(oSymTable != NULL);
-
-  /* If we've already hit the max number of buckets,
-  we don't expand any further */
-  if (oSymTable->bucketCountOrder==sizeof(SIZES)/sizeof(SIZES[0] - 1)){
-    return;
+  for (u = 0; u < sizeof(SIZES) / sizeof(SIZES[0]) - 1; u++) {
+    if (SIZES[u] == uBucketCount) {
+      return SIZES[u + 1];
+    }
   }
 
-  /* We allocate the memory for the new bindings array */
-  newBindings = calloc(
-    SIZES[oSymTable->bucketCountOrder + 1], sizeof(struct Binding *));
-  if(newBindings == NULL) {
-    return;
+  /* The candidates are odd, so we only try odd divisors. Trial
+  division is slow, but this runs once per expansion, which rehashes
+  millions of bindings anyway */
+  if (uBucketCount > ((size_t) -1 - 1) / 2) {
+    return 0;
   }
-
-  /* We recompute the hashes for every single key (since they're gonna
-  change as we've increased the number of buckets) make a new copy of
-  each binding, and place it in the new bindings table */
-  for (hash = 0; hash < SIZES[oSymTable->bucketCountOrder]; hash++){
-    for (psCurrentBinding = (oSymTable->Bindings)[hash];
-    psCurrentBinding != NULL;
-    psCurrentBinding = psCurrentBinding->psNextBinding) {
-      psNewBinding = (struct Binding*) malloc(sizeof(struct Binding));
-      if (psNewBinding == NULL) {
-        /* If ever we can't allocate more memory, we have to free up
-        the entire table we just created */
-        SymTable_free_Bindings(newBindings,
-        SIZES[oSymTable->bucketCountOrder + 1]);
-        return;
-      }
-      keyCopy = (char *) calloc(strlen(psCurrentBinding->Key) + 1,
-      sizeof(char));
-      if (keyCopy == NULL) {
-        /* If ever we can't allocate more memory, we have to free up
-        the entire table we just created */
-        free(psNewBinding);
-        SymTable_free_Bindings(newBindings,
-        SIZES[oSymTable->bucketCountOrder + 1]);
-        return;
+  for (u = uBucketCount * 2 + 1; u > uBucketCount; u += 2) {
+    for (uDivisor = 3; uDivisor <= u / uDivisor; uDivisor += 2) {
+      if (u % uDivisor == 0) {
+        break;
       }
-      newHash = SymTable_hash(psCurrentBinding->Key,
-      SIZES[oSymTable->bucketCountOrder + 1]);
-      keyCopy = strcpy(keyCopy, psCurrentBinding->Key);
-      psNewBinding->Key = keyCopy;
-      psNewBinding->Value = psCurrentBinding->Value;
-      psNewBinding->psNextBinding = newBindings[newHash];
-      newBindings[newHash] = psNewBinding;
+    }
+    if (uDivisor > u / uDivisor) {
+      return u;
     }
   }
-  /* We free the old table */
-  SymTable_free_Bindings(oSymTable->Bindings,
-  SIZES[oSymTable->bucketCountOrder]);
-
-  /* We link the new table and increment bucketCountOrder */
-  oSymTable->Bindings = newBindings;
-  oSymTable->bucketCountOrder++;
+  return 0;
 }
 
-/* A helper function used by SymTable_replace, SymTable_contains,
-and SymTable_get. It takes in a SymTable_T oSymTable and a char * pcKey.
-If oSymTable contains a binding with the key pcKey, it returns a pointer
-to that binding. Otherwise, it returns Null. It does not change the
-contents of oSymTable */
-static struct Binding * SymTable_find(SymTable_T oSymTable,
-const char *pcKey) {
-  struct Binding *psCurrentBinding;
-  size_t hash;
-  assert(oSymTable != NULL);
-  assert(pcKey != NULL);
-  hash = SymTable_hash(pcKey, SIZES[oSymTable->bucketCountOrder]);
-  for (psCurrentBinding = (oSymTable->Bindings)[hash];
-    psCurrentBinding != NULL;
-    psCurrentBinding = psCurrentBinding->psNextBinding) {
-    if (strcmp(psCurrentBinding->Key,pcKey) == 0) {
-      return psCurrentBinding;
+/* A helper function which returns the smallest number of buckets that
+SymTable_nextBucketCount reaches from SIZES[0] whose threshold is at
+least uCount, or the largest it reaches if none is. It is called by
+SymTable_presize, SymTable_shrink and SymTable_compact */
+static size_t SymTable_fitBucketCount(size_t uCount) {
+  size_t uBucketCount;
+  size_t uNextCount;
+
+  uBucketCount = SIZES[0];
+  while (SymTable_threshold(uBucketCount) < uCount) {
+    uNextCount = SymTable_nextBucketCount(uBucketCount);
+    if (uNextCount == 0) {
+      break;
     }
+    uBucketCount = uNextCount;
   }
-  return NULL;
+  return uBucketCount;
 }
 
-/* The SymTable deconstructor */
-void SymTable_free(SymTable_T oSymTable) {
+/* A helper function which takes in an empty SymTable_T oSymTable, that
+is still small, and uHint, and gives it at once as many buckets as the
+first expansion whose threshold reaches uHint would have reached, so
+no put up to uHint expands. It returns 1 if it succeeds and 0, leaving
+oSymTable as it was, if it can't allocate memory. It is called by
+SymTable_newWithCapacity and SymTable_newFromArray */
+static int SymTable_presize(SymTable_T oSymTable, size_t uHint) {
+  struct Binding **Bindings;
+  size_t uBucketCount;
   assert(oSymTable != NULL);
-  SymTable_free_Bindings(oSymTable->Bindings,
-  SIZES[oSymTable->bucketCountOrder]);
-  /* here we free up the rest of the table */
-  free(oSymTable);
+  assert(oSymTable->size == 0);
+
+  if (uHint <= oSymTable->expandThreshold) {
+    return 1;
+  }
+  uBucketCount = SymTable_fitBucketCount(uHint);
+  Bindings = calloc(uBucketCount, sizeof(struct Binding *));
+  if (Bindings == NULL) {
+    return 0;
+  }
+  oSymTable->Bindings = Bindings;
+  oSymTable->bucketCount = uBucketCount;
+  oSymTable->expandThreshold = SymTable_threshold(uBucketCount);
+  return 1;
 }
 
-/* Implements the SymTable_getLength() function */
-size_t SymTable_getLength(SymTable_T oSymTable) {
-  assert(oSymTable != NULL);
-  return oSymTable->size;
+/* The SymTable constructor that takes a capacity. The buckets are
+allocated at once by SymTable_presize */
+SymTable_T SymTable_newWithCapacity(size_t uHint) {
+  SymTable_T oSymTable;
+
+  /* Every binding takes more than a byte, so memory can't hold more
+  than this many */
+  if (uHint > (size_t) -1 / sizeof(struct Binding)) {
+    return NULL;
+  }
+  oSymTable = SymTable_newWithFlags(0);
+  if (oSymTable == NULL) {
+    return NULL;
+  }
+  if (! SymTable_presize(oSymTable, uHint)) {
+    SymTable_free(oSymTable);
+    return NULL;
+  }
+  return oSymTable;
 }
 
-/* Implements the SymTable_put() function */
-int SymTable_put(SymTable_T oSymTable, const char *pcKey,
-const void *pvValue) {
-  struct Binding *psNewBinding;
-  char *keyCopy;
-  size_t hash;
+/* A Helper function which moves the bindings of up to uBuckets
+buckets of oldBindings, the array that SymTable_T oSymTable is
+resizing from, to Bindings. Each binding is relinked at the front of
+the bucket that its cached hash selects, so nothing is allocated and
+nothing can fail. During a reseed that hash is recomputed first, with
+the new seed. Once every old bucket has been moved it frees
+oldBindings and sets it to NULL, ending the resize. It has no return
+value. It is called by SymTable_resize and SymTable_compact, which
+move every bucket at once, and by every operation on a table made with
+SYMTABLE_INCREMENTAL, which moves migrateRate of them */
+static void SymTable_migrate(SymTable_T oSymTable, size_t uBuckets) {
+  struct Binding * psCurrentBinding;
+  struct Binding * psNextBinding;
+  size_t newHash;
   assert(oSymTable != NULL);
-  assert(pcKey != NULL);
+  assert(oSymTable->oldBindings != NULL);
 
-  if (SymTable_contains(oSymTable, pcKey)) {
-    return 0;
+#ifdef SYMTABLE_STATS
+  if (uBuckets > oSymTable->oldBucketCount - oSymTable->migrateNext) {
+    uBuckets = oSymTable->oldBucketCount - oSymTable->migrateNext;
+  }
+  if (uBuckets > oSymTable->stats.uMaxMigrate) {
+    oSymTable->stats.uMaxMigrate = uBuckets;
   }
+#endif
 
-  /* We make a memory allocation for the new binding and create it */
-  psNewBinding = (struct Binding*) malloc(sizeof(struct Binding));
-  if (psNewBinding == NULL) {
-    return 0;
+  for (; uBuckets > 0 &&
+    oSymTable->migrateNext < oSymTable->oldBucketCount; uBuckets--) {
+    for (psCurrentBinding =
+      (oSymTable->oldBindings)[oSymTable->migrateNext];
+      psCurrentBinding != NULL;
+      psCurrentBinding = psNextBinding) {
+      psNextBinding = psCurrentBinding->psNextBinding;
+      if (oSymTable->oldSeededHash != NULL) {
+        psCurrentBinding->Hash = (*oSymTable->seededHash)(
+          psCurrentBinding->Key, psCurrentBinding->Length,
+          oSymTable->seed);
+      }
+      newHash = psCurrentBinding->Hash % oSymTable->bucketCount;
+      psCurrentBinding->psNextBinding = (oSymTable->Bindings)[newHash];
+      (oSymTable->Bindings)[newHash] = psCurrentBinding;
+    }
+    (oSymTable->oldBindings)[oSymTable->migrateNext] = NULL;
+    oSymTable->migrateNext++;
   }
 
-  /* We make a defensive copy of the key */
-  keyCopy = (char *) calloc(strlen(pcKey) + 1, sizeof(char));
-  if (keyCopy == NULL) {
-    /* Since we won't be adding psNewBinding to the symbol table,
-    we must free it */
-    free(psNewBinding);
-    return 0;
+  /* The old bindings now all live in Bindings, so we only free the old
+  array of pointers */
+  if (oSymTable->migrateNext == oSymTable->oldBucketCount) {
+    SymTable_freeBuckets(oSymTable, oSymTable->oldBindings);
+    oSymTable->oldBindings = NULL;
+    oSymTable->oldSeededHash = NULL;
   }
-  keyCopy = strcpy(keyCopy, pcKey);
+}
 
-  /* If we need to expand the bindings array, expand it */
-  if (oSymTable->size >= SIZES[oSymTable->bucketCountOrder]) {
-    SymTable_expand(oSymTable);
+/* A Helper function which moves the bindings of SymTable_T oSymTable
+to a new array of newBucketCount buckets, which may have more or fewer
+buckets than the current one. It is called by SymTable_expand,
+SymTable_shrink and SymTable_compact. It has no return value: if it
+can't allocate the new array it leaves oSymTable in its original
+condition, which is still a working table.
+The existing bindings are relinked into the new array rather than
+copied, so the only allocation is the new array itself. For a table
+made with SYMTABLE_INCREMENTAL only the new array is set up here, and
+the bindings are moved a few buckets at a time by later operations. */
+static void SymTable_resize(SymTable_T oSymTable,
+size_t newBucketCount) {
+  struct Binding ** newBindings;
+  size_t uRoom;
+  assert(oSymTable != NULL);
+  assert(newBucketCount > 0);
+
+  /* A resize that's still under way is finished first, which keeps us
+  from having to track three arrays. The migrateRate set below finishes
+  every resize before the table can expand again, and SymTable_shrink
+  waits for one to finish, so this only happens for SymTable_compact */
+  if (oSymTable->oldBindings != NULL) {
+    SymTable_migrate(oSymTable, oSymTable->oldBucketCount);
   }
 
-  /* We hash the key to get the index of where to place the binding */
-  hash = SymTable_hash(pcKey, SIZES[oSymTable->bucketCountOrder]);
-  /* We fill the binding and add it to the front of the linked list
-  of the corresponding bucket */
-  psNewBinding->Key = keyCopy;
-  psNewBinding->Value = pvValue;
-  psNewBinding->psNextBinding = (oSymTable->Bindings)[hash];
-  (oSymTable->Bindings)[hash] = psNewBinding;
-  oSymTable->size++;
+  /* We allocate the memory for the new bindings array */
+  newBindings = calloc(newBucketCount, sizeof(struct Binding *));
+  if(newBindings == NULL) {
+    return;
+  }
 
-  return 1;
+  /* The current array becomes the one we migrate from, and we link the
+  new table and record its size */
+  oSymTable->oldBindings = oSymTable->Bindings;
+  oSymTable->oldBucketCount = oSymTable->bucketCount;
+  oSymTable->migrateNext = 0;
+  oSymTable->Bindings = newBindings;
+  oSymTable->bucketCount = newBucketCount;
+  oSymTable->expandThreshold = SymTable_threshold(newBucketCount);
+
+  /* Each put that doesn't take the table to expandThreshold moves
+  migrateRate buckets first, so after a shrink, which leaves less room
+  than an expansion does, it must move more of them */
+  uRoom = 1;
+  if (oSymTable->expandThreshold > oSymTable->size) {
+    uRoom = oSymTable->expandThreshold - oSymTable->size;
+  }
+  oSymTable->migrateRate = oSymTable->oldBucketCount / uRoom + 1;
+  if (oSymTable->migrateRate < MIGRATE_BUCKETS) {
+    oSymTable->migrateRate = MIGRATE_BUCKETS;
+  }
+
+  /* We recompute the bucket of every binding from its cached hash
+  (since it's gonna change with the number of buckets) and move each
+  binding to the new array, either now or bit by bit */
+  if (! oSymTable->incremental) {
+    SymTable_migrate(oSymTable, oSymTable->oldBucketCount);
+  }
 }
 
-/* implements the SymTable_replace() function */
-void * SymTable_replace(SymTable_T oSymTable, const char *pcKey,
-const void *pvValue) {
-  struct Binding * desiredBinding;
-  const void * oldValue;
+/* A Helper function which Expands Bindings, the array of binding
+pointers that SymTable_T oSymTable uses.
+It is called by SymTable_putOrGet. It takes in a SymTable_T oSymTable
+and has no return value. It expands to the number of buckets given by
+SymTable_nextBucketCount, as SymTable_resize does it */
+static void SymTable_expand(SymTable_T oSymTable) {
+  size_t newBucketCount;
+#ifdef SYMTABLE_STATS
+  clock_t start;
+#endif
   assert(oSymTable != NULL);
-  assert(pcKey != NULL);
 
-  desiredBinding = SymTable_find(oSymTable, pcKey);
-  if (desiredBinding == NULL) {
-    return NULL;
+  /* If the number of buckets can't grow any further, we don't expand.
+  The table keeps working, only with longer chains */
+  newBucketCount = SymTable_nextBucketCount(oSymTable->bucketCount);
+  if (newBucketCount == 0) {
+    oSymTable->expandThreshold = (size_t) -1;
+    return;
   }
-  oldValue = desiredBinding->Value;
-  desiredBinding->Value = pvValue;
+#ifdef SYMTABLE_STATS
+  /* An incremental resize only starts here, so the buckets it moves
+  later aren't timed */
+  start = clock();
+  SymTable_resize(oSymTable, newBucketCount);
+  oSymTable->stats.uExpansions++;
+  oSymTable->stats.dExpandSeconds +=
+    (double) (clock() - start) / CLOCKS_PER_SEC;
+#else
+  SymTable_resize(oSymTable, newBucketCount);
+#endif
+}
 
-  /* Here we have to "cast away the constness" */
-  return (void *) oldValue;
+/* A helper function which takes a step of the resize of SymTable_T
+oSymTable, if one is under way. It is called at the start of every
+operation that looks up a key, which bounds the extra work any one of
+them does to migrateRate buckets */
+static void SymTable_step(SymTable_T oSymTable) {
+  assert(oSymTable != NULL);
+  if (oSymTable->oldBindings != NULL) {
+    SymTable_migrate(oSymTable, oSymTable->migrateRate);
+  }
 }
 
-/* implements the SymTable_contains() function */
-int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+/* A helper function which takes in a SymTable_T oSymTable and a key
+pcKey, and returns the length of pcKey as a size_t. A table that
+compares keys by address never needs it, so it returns 0 without
+reading pcKey then. It is called by every function that is given a key
+without its length */
+static size_t SymTable_length(SymTable_T oSymTable, const char *pcKey) {
   assert(oSymTable != NULL);
   assert(pcKey != NULL);
-  return (SymTable_find(oSymTable, pcKey) != NULL);
+  if (oSymTable->interned) {
+    return 0;
+  }
+  return strlen(pcKey);
 }
 
-/* implements the SymTable_get() function */
-void * SymTable_get(SymTable_T oSymTable, const char *pcKey) {
-  struct Binding * desiredBinding;
+/* A helper function which takes in a SymTable_T oSymTable, a key pcKey
+and its length uLength, and returns the hash code of pcKey as a size_t:
+the one its seeded hash function gives under its seed, if it has one,
+and the one its hash function gives otherwise. It is called by every
+function that is given a key without its hash code */
+static size_t SymTable_hashKey(SymTable_T oSymTable, const char *pcKey,
+size_t uLength) {
   assert(oSymTable != NULL);
   assert(pcKey != NULL);
-  desiredBinding = SymTable_find(oSymTable, pcKey);
-  if (desiredBinding == NULL) {
-    return NULL;
+  if (oSymTable->seededHash != NULL) {
+    return (*oSymTable->seededHash)(pcKey, uLength, oSymTable->seed);
   }
-  return (void *) desiredBinding->Value;
+  return oSymTable->hash(pcKey, uLength);
 }
 
-/* implements the SymTable_remove() replace function */
-void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+/* A helper function which takes in a SymTable_T oSymTable that is
+resizing, a key pcKey, its length uLength and its hash code uHash, and
+returns as a size_t the code that the buckets of oldBindings were
+hashed with: uHash itself, unless a reseed is under way. It is called
+by SymTable_findHashed and SymTable_remove */
+static size_t SymTable_oldHash(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, size_t uHash) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  if (oSymTable->oldSeededHash != NULL) {
+    return (*oSymTable->oldSeededHash)(pcKey, uLength,
+      oSymTable->oldSeed);
+  }
+  return uHash;
+}
+
+/* A helper function which takes in a SymTable_T oSymTable, the first
+binding of one of its chains, psFirstBinding, a char * pcKey, its
+length uLength and its hash code uHash, and returns the binding of the
+chain whose key is pcKey, or NULL if there is none. It is called by
+SymTable_findHashed */
+static struct Binding * SymTable_findInChain(SymTable_T oSymTable,
+struct Binding *psFirstBinding, const char *pcKey, size_t uLength,
+size_t uHash) {
   struct Binding *psCurrentBinding;
-  struct Binding *psPreviousBinding;
-  void * toReturn;
-  size_t hash;
   assert(oSymTable != NULL);
   assert(pcKey != NULL);
-  hash = SymTable_hash(pcKey, SIZES[oSymTable->bucketCountOrder]);
-  psCurrentBinding = oSymTable->Bindings[hash];
-  psPreviousBinding = NULL;
-  while (psCurrentBinding != NULL) {
-    if (strcmp(psCurrentBinding->Key, pcKey) == 0) {
-      break;
+  for (psCurrentBinding = psFirstBinding;
+    psCurrentBinding != NULL;
+    psCurrentBinding = psCurrentBinding->psNextBinding) {
+    SYMTABLE_COUNT(oSymTable->stats.uProbes);
+    /* Bindings with a different hash or length can't have the same
+    key */
+    if (psCurrentBinding->Hash == uHash && (oSymTable->interned ?
+      psCurrentBinding->Key == pcKey :
+      (psCurrentBinding->Length == uLength &&
+      memcmp(psCurrentBinding->Key, pcKey, uLength) == 0))) {
+      return psCurrentBinding;
     }
-    psPreviousBinding = psCurrentBinding;
-    psCurrentBinding = psCurrentBinding->psNextBinding;
   }
+  return NULL;
+}
 
-  /* The case where we didn't find the binding corresponding to pcKey*/
-  if (psCurrentBinding == NULL) {
-    return NULL;
+/* A helper function which takes in a SymTable_T oSymTable and the hash
+code uHash of a key, and returns the code that its frozen form works
+with. The seeded hash functions already mix every bit of a key into
+every bit of their codes, so those are used as they are; a caller's
+hash function may not, so its codes are mixed first. It is called by
+SymTable_frozenSlot and SymTable_perfect */
+static size_t SymTable_frozenHash(SymTable_T oSymTable, size_t uHash) {
+  assert(oSymTable != NULL);
+  if (oSymTable->seededHash != NULL) {
+    return uHash;
   }
+  return HashFn_mix(uHash, 0);
+}
 
-  /* The case where we did but it was the first one in the linked list
-  and hence we never updated  psPreviousBinding*/
-  if (psPreviousBinding == NULL) {
-    oSymTable->Bindings[hash] = psCurrentBinding->psNextBinding;
+/* A helper function which takes in a frozen SymTable_T oSymTable that
+isn't empty and the hash code uHash of a key, and returns the slot of
+Frozen that the key would be in. It is called by SymTable_findHashed */
+static size_t SymTable_frozenSlot(SymTable_T oSymTable, size_t uHash) {
+  assert(oSymTable != NULL);
+  assert(oSymTable->Frozen != NULL);
+  return Perfect_slot(SymTable_frozenHash(oSymTable, uHash),
+    oSymTable->Displacements, oSymTable->frozenMask + 1,
+    oSymTable->size);
+}
+
+/* A helper function used by SymTable_find, SymTable_putOrGetHashed and
+SymTable_getBatch. It takes in a SymTable_T oSymTable, a char * pcKey,
+its length uLength and uHash, its hash code.
+If oSymTable contains a binding with the key pcKey, it returns a pointer
+to that binding. Otherwise, it returns Null. It does not change the
+contents of oSymTable */
+static struct Binding * SymTable_findHashed(SymTable_T oSymTable,
+const char *pcKey, size_t uLength, size_t uHash) {
+  struct Binding *psFoundBinding;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  /* A frozen table has one slot the key can be in. Its binding has no
+  next one, so it is a chain of its own */
+  if (oSymTable->Frozen != NULL) {
+    if (oSymTable->size == 0) {
+      return NULL;
+    }
+    psFoundBinding = SymTable_findInChain(oSymTable,
+      &(oSymTable->Frozen)[SymTable_frozenSlot(oSymTable, uHash)],
+      pcKey, uLength, uHash);
+  }
+  else {
+    psFoundBinding = SymTable_findInChain(oSymTable,
+      (oSymTable->Bindings)[uHash % oSymTable->bucketCount],
+      pcKey, uLength, uHash);
+
+    /* During a resize, the binding may not have been moved yet */
+    if (psFoundBinding == NULL && oSymTable->oldBindings != NULL) {
+      uHash = SymTable_oldHash(oSymTable, pcKey, uLength, uHash);
+      psFoundBinding = SymTable_findInChain(oSymTable,
+        (oSymTable->oldBindings)[uHash % oSymTable->oldBucketCount],
+        pcKey, uLength, uHash);
+    }
+  }
+
+  if (psFoundBinding != NULL) {
+    SYMTABLE_COUNT(oSymTable->stats.uHits);
+  }
+  else {
+    SYMTABLE_COUNT(oSymTable->stats.uMisses);
+  }
+  return psFoundBinding;
+}
+
+/* A helper function used by SymTable_replace, SymTable_contains, and
+SymTable_getLen. It takes in a SymTable_T oSymTable, a char * pcKey and
+its length uLength, and works as SymTable_findHashed with the hash code
+of pcKey */
+static struct Binding * SymTable_find(SymTable_T oSymTable,
+const char *pcKey, size_t uLength) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return SymTable_findHashed(oSymTable, pcKey, uLength,
+    SymTable_hashKey(oSymTable, pcKey, uLength));
+}
+
+/* The SymTable deconstructor */
+void SymTable_free(SymTable_T oSymTable) {
+  size_t u;
+  assert(oSymTable != NULL);
+
+  /* The bindings of a frozen table are all in one array */
+  if (oSymTable->Frozen != NULL) {
+    if (oSymTable->arena != NULL) {
+      Arena_free(oSymTable->arena);
+    }
+    else if (! oSymTable->borrowed) {
+      for (u = 0; u < oSymTable->size; u++) {
+        if (SymTable_hasKeyCopy(oSymTable, &(oSymTable->Frozen)[u])) {
+          free((void *) (oSymTable->Frozen)[u].Key);
+        }
+      }
+    }
+    free(oSymTable->Frozen);
+    free(oSymTable->Displacements);
+    free(oSymTable);
+    return;
+  }
+
+  /* Bindings in an arena all go away with it, without a walk */
+  if (oSymTable->arena != NULL) {
+    Arena_free(oSymTable->arena);
+    SymTable_freeBuckets(oSymTable, oSymTable->oldBindings);
+    SymTable_freeBuckets(oSymTable, oSymTable->Bindings);
+    free(oSymTable);
+    return;
+  }
+
+  /* The bindings that an unfinished expansion hasn't moved yet */
+  if (oSymTable->oldBindings != NULL) {
+    SymTable_free_Bindings(oSymTable, oSymTable->oldBindings,
+    oSymTable->oldBucketCount);
+    SymTable_freeBuckets(oSymTable, oSymTable->oldBindings);
+  }
+  SymTable_free_Bindings(oSymTable, oSymTable->Bindings,
+  oSymTable->bucketCount);
+  SymTable_freeBuckets(oSymTable, oSymTable->Bindings);
+  /* here we free up the rest of the table */
+  free(oSymTable);
+}
+
+/* Implements the SymTable_getLength() function */
+size_t SymTable_getLength(SymTable_T oSymTable) {
+  assert(oSymTable != NULL);
+  return oSymTable->size;
+}
+
+/* A helper function which takes in psFirstBinding, the first binding of
+a chain, and returns 1 (TRUE) if the chain has more than
+SYMTABLE_MAX_CHAIN bindings, or 0 (FALSE) if not. It stops counting
+there, so it never walks more than that many. It is called by
+SymTable_putOrGetHashed */
+static int SymTable_isLongChain(const struct Binding *psFirstBinding) {
+  const struct Binding *psCurrentBinding;
+  size_t uChainLength = 0;
+  for (psCurrentBinding = psFirstBinding; psCurrentBinding != NULL;
+    psCurrentBinding = psCurrentBinding->psNextBinding) {
+    uChainLength++;
+    if (uChainLength > SYMTABLE_MAX_CHAIN) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* A Helper function which gives SymTable_T oSymTable, one of whose
+chains has grown longer than chance would make it, a new seed, and
+switches it to HashFn_sip, which no choice of keys makes collide
+without knowing the seed. The bindings are moved to a new bucket array
+by SymTable_resize, as for an expansion, and SymTable_migrate
+recomputes the hash code of each one from its key as it moves it, so a
+table made with SYMTABLE_INCREMENTAL reseeds a few buckets per
+operation too. The new array has more buckets if the table is more
+than half way to its next expansion, which leaves room for the move to
+finish before that. A reseed waits for a resize that's under way, and
+doesn't happen at all if the new array can't be allocated; either way
+the next long chain tries again. It has no return value. It is called
+by SymTable_putOrGetHashed */
+static void SymTable_reseed(SymTable_T oSymTable) {
+  struct Binding **oldBindings;
+  size_t newBucketCount;
+  assert(oSymTable != NULL);
+  assert(oSymTable->seededHash != NULL);
+
+  /* Three arrays hashed three ways would be too many to track */
+  if (oSymTable->oldBindings != NULL) {
+    return;
+  }
+
+  newBucketCount = oSymTable->bucketCount;
+  if (oSymTable->size >= oSymTable->expandThreshold / 2 &&
+    SymTable_nextBucketCount(newBucketCount) != 0) {
+    newBucketCount = SymTable_nextBucketCount(newBucketCount);
+  }
+
+  /* The current buckets keep the old seed until they are moved */
+  oldBindings = oSymTable->Bindings;
+  oSymTable->oldSeededHash = oSymTable->seededHash;
+  oSymTable->oldSeed = oSymTable->seed;
+  oSymTable->seededHash = HashFn_sip;
+  oSymTable->seed = SymTable_newSeed(oSymTable);
+  SymTable_resize(oSymTable, newBucketCount);
+  if (oSymTable->Bindings == oldBindings) {
+    oSymTable->seededHash = oSymTable->oldSeededHash;
+    oSymTable->seed = oSymTable->oldSeed;
+    oSymTable->oldSeededHash = NULL;
+    return;
+  }
+
+  /* A table that can't expand any more has long chains whatever its
+  seed, so it only reseeds again once it has doubled in size. That
+  keeps the cost of reseeding to a constant per put */
+  oSymTable->reseedSize = 2 * oSymTable->size;
+}
+
+/* A helper function which works as SymTable_putOrGet, for a key pcKey
+of length uLength whose hash code is uHash. It is called by
+SymTable_putOrGetLen, SymTable_putBatch and SymTable_newFromArray */
+static int SymTable_putOrGetHashed(SymTable_T oSymTable,
+const char *pcKey, size_t uLength, size_t uHash, const void *pvValue,
+void **ppvValue) {
+  struct Binding *psNewBinding;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  SymTable_step(oSymTable);
+
+  /* This is the only time the key's bucket is walked */
+  psNewBinding = SymTable_findHashed(oSymTable, pcKey, uLength, uHash);
+  if (psNewBinding != NULL) {
+    if (ppvValue != NULL) {
+      *ppvValue = (void *) psNewBinding->Value;
+    }
+    return 0;
+  }
+
+  /* A frozen table has nowhere to put a new key */
+  if (oSymTable->Frozen != NULL) {
+    return -1;
+  }
+
+  psNewBinding = SymTable_newBinding(oSymTable, pcKey, uLength);
+  if (psNewBinding == NULL) {
+    return -1;
+  }
+
+  /* If adding the binding would take us past the maximum load factor,
+  expand the bindings array */
+  if (oSymTable->size >= oSymTable->expandThreshold) {
+    SymTable_expand(oSymTable);
+  }
+
+  /* We fill the binding and add it to the front of the linked list
+  of the bucket its hash selects. The hash is still valid after an
+  expansion; only the bucket it reduces to changes */
+  psNewBinding->Value = pvValue;
+  psNewBinding->Hash = uHash;
+  uHash %= oSymTable->bucketCount;
+  psNewBinding->psNextBinding = (oSymTable->Bindings)[uHash];
+  (oSymTable->Bindings)[uHash] = psNewBinding;
+  oSymTable->size++;
+
+  /* A chain this long means the keys were most likely chosen to
+  collide, so we change the hash function out from under them. A small
+  table is a single chain by design, so it never reseeds */
+  if (oSymTable->seededHash != NULL && oSymTable->bucketCount > 1 &&
+    oSymTable->size >= oSymTable->reseedSize &&
+    SymTable_isLongChain(psNewBinding)) {
+    SymTable_reseed(oSymTable);
+  }
+
+  if (ppvValue != NULL) {
+    *ppvValue = (void *) pvValue;
+  }
+  return 1;
+}
+
+/* A helper function which works as SymTable_putOrGet, for a key pcKey
+of length uLength. It is called by SymTable_putOrGet, SymTable_put and
+SymTable_putLen */
+static int SymTable_putOrGetLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, const void *pvValue, void **ppvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return SymTable_putOrGetHashed(oSymTable, pcKey, uLength,
+    SymTable_hashKey(oSymTable, pcKey, uLength), pvValue, ppvValue);
+}
+
+/* Implements the SymTable_putOrGet() function */
+int SymTable_putOrGet(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue, void **ppvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return SymTable_putOrGetLen(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey), pvValue, ppvValue);
+}
+
+/* Implements the SymTable_put() function */
+int SymTable_put(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return (SymTable_putOrGetLen(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey), pvValue, NULL) == 1);
+}
+
+/* Implements the SymTable_putLen() function */
+int SymTable_putLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, const void *pvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return (SymTable_putOrGetLen(oSymTable, pcKey, uLength, pvValue,
+    NULL) == 1);
+}
+
+/* Implements the SymTable_putBatch() function. The keys are taken
+BATCH_GROUP at a time: every key of a group is hashed and the bucket
+that holds the head of its chain is prefetched, then the first binding
+of each chain is prefetched, and only then is each key put. The misses
+of a whole group overlap instead of being paid one after another */
+size_t SymTable_putBatch(SymTable_T oSymTable,
+const char * const *ppcKeys, const void * const *ppvValues,
+size_t uCount) {
+  size_t auLengths[BATCH_GROUP];
+  size_t auHashes[BATCH_GROUP];
+  struct Binding *psFirstBinding;
+  size_t uAdded = 0;
+  size_t uSeed;
+  size_t uStart;
+  size_t uEnd;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL);
+  assert(ppvValues != NULL);
+
+  for (uStart = 0; uStart < uCount; uStart = uEnd) {
+    uEnd = (uCount - uStart > BATCH_GROUP) ? uStart + BATCH_GROUP :
+      uCount;
+    uSeed = oSymTable->seed;
+    for (u = uStart; u < uEnd; u++) {
+      assert(ppcKeys[u] != NULL);
+      auLengths[u - uStart] = SymTable_length(oSymTable, ppcKeys[u]);
+      auHashes[u - uStart] = SymTable_hashKey(oSymTable,
+        ppcKeys[u], auLengths[u - uStart]);
+      SYMTABLE_PREFETCH(&(oSymTable->Bindings)
+        [auHashes[u - uStart] % oSymTable->bucketCount]);
+    }
+    for (u = uStart; u < uEnd; u++) {
+      psFirstBinding = (oSymTable->Bindings)
+        [auHashes[u - uStart] % oSymTable->bucketCount];
+      if (psFirstBinding != NULL) {
+        SYMTABLE_PREFETCH(psFirstBinding);
+      }
+    }
+    /* A put may expand the table, which only makes the remaining
+    prefetches of the group useless, not wrong. A put that reseeds it
+    makes the remaining hash codes wrong, so they are computed again */
+    for (u = uStart; u < uEnd; u++) {
+      if (oSymTable->seed != uSeed) {
+        auHashes[u - uStart] = SymTable_hashKey(oSymTable, ppcKeys[u],
+          auLengths[u - uStart]);
+      }
+      if (SymTable_putOrGetHashed(oSymTable, ppcKeys[u],
+        auLengths[u - uStart], auHashes[u - uStart], ppvValues[u],
+        NULL) == 1) {
+        uAdded++;
+      }
+    }
+  }
+  return uAdded;
+}
+
+/* A Load is what the threads of SymTable_newFromArray share while they
+hash its keys: the table, the keys, and the arrays that the length and
+the hash code of each key go in, at the index of the key. Each thread
+writes only to the elements of its own keys */
+struct Load {
+  /* The table being loaded */
+  SymTable_T oSymTable;
+  /* The keys to load */
+  const char * const *ppcKeys;
+  /* The length of each key */
+  size_t *puLengths;
+  /* The hash code of each key */
+  size_t *puHashes;
+};
+
+/* A helper function which takes in pvLoad, a struct Load, and computes
+the length and the hash code of its keys from uStart up to but not
+including uEnd. It has the signature of a Parallel_RangeFn, but applies
+nothing, so it ignores pfApply and pvExtra. It is called by
+SymTable_newFromArray, directly or through Parallel_map */
+static void SymTable_hashRange(void *pvLoad, size_t uStart,
+size_t uEnd, Parallel_ApplyFn pfApply, void *pvExtra) {
+  struct Load *psLoad = (struct Load *) pvLoad;
+  size_t u;
+  assert(psLoad != NULL);
+  (void) pfApply;
+  (void) pvExtra;
+
+  for (u = uStart; u < uEnd; u++) {
+    assert(psLoad->ppcKeys[u] != NULL);
+    psLoad->puLengths[u] = SymTable_length(psLoad->oSymTable,
+      psLoad->ppcKeys[u]);
+    psLoad->puHashes[u] = SymTable_hashKey(psLoad->oSymTable,
+      psLoad->ppcKeys[u], psLoad->puLengths[u]);
+  }
+}
+
+/* The SymTable constructor that takes an array of bindings. Every key
+is hashed first, on several threads if there are enough of them. Then
+the buckets are allocated for all of them, along with one slab for the
+bindings and one chunk for the keys too long to go in them, and the
+bindings are put in order, each with the hash code already computed.
+Nothing is allocated after that, and no put expands the table */
+SymTable_T SymTable_newFromArray(const char * const *ppcKeys,
+const void * const *ppvValues, size_t uCount) {
+  SymTable_T oSymTable;
+  struct Load sLoad;
+  size_t uKeyBytes = 0;
+  size_t uSeed;
+  size_t u;
+  assert(ppcKeys != NULL);
+  assert(ppvValues != NULL);
+
+  /* Every binding takes more than a byte, so memory can't hold more
+  than this many */
+  if (uCount > (size_t) -1 / sizeof(struct Binding)) {
+    return NULL;
+  }
+  oSymTable = SymTable_newWithFlags(SYMTABLE_ARENA);
+  if (oSymTable == NULL || uCount == 0) {
+    return oSymTable;
+  }
+  sLoad.oSymTable = oSymTable;
+  sLoad.ppcKeys = ppcKeys;
+  sLoad.puLengths = (size_t *) malloc(2 * uCount * sizeof(size_t));
+  if (sLoad.puLengths == NULL) {
+    SymTable_free(oSymTable);
+    return NULL;
+  }
+  sLoad.puHashes = sLoad.puLengths + uCount;
+
+  if (uCount >= SYMTABLE_PARALLEL_LOAD) {
+    Parallel_map(&sLoad, uCount, SymTable_hashRange, NULL, NULL,
+      SYMTABLE_LOAD_THREADS);
+  }
+  else {
+    SymTable_hashRange(&sLoad, 0, uCount, NULL, NULL);
+  }
+
+  /* Keys short enough to go in their bindings need no room in the
+  chunk */
+  for (u = 0; u < uCount; u++) {
+    if (sLoad.puLengths[u] >= INLINE_KEY_SIZE) {
+      uKeyBytes += sLoad.puLengths[u] + 1;
+    }
+  }
+  if (! SymTable_presize(oSymTable, uCount) ||
+    ! Arena_reserve(oSymTable->arena, uCount, uKeyBytes)) {
+    free(sLoad.puLengths);
+    SymTable_free(oSymTable);
+    return NULL;
+  }
+
+  uSeed = oSymTable->seed;
+  for (u = 0; u < uCount; u++) {
+    if (u + BATCH_GROUP < uCount) {
+      SYMTABLE_PREFETCH(&(oSymTable->Bindings)
+        [sLoad.puHashes[u + BATCH_GROUP] % oSymTable->bucketCount]);
+    }
+    /* A put that reseeds the table makes the remaining hash codes
+    wrong, so they are computed again */
+    if (oSymTable->seed != uSeed) {
+      sLoad.puHashes[u] = SymTable_hashKey(oSymTable, ppcKeys[u],
+        sLoad.puLengths[u]);
+    }
+    /* A duplicate key is found in its bucket, and left out */
+    if (SymTable_putOrGetHashed(oSymTable, ppcKeys[u],
+      sLoad.puLengths[u], sLoad.puHashes[u], ppvValues[u], NULL) < 0) {
+      free(sLoad.puLengths);
+      SymTable_free(oSymTable);
+      return NULL;
+    }
+  }
+  free(sLoad.puLengths);
+  return oSymTable;
+}
+
+/* implements the SymTable_replace() function */
+void * SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue) {
+  struct Binding * desiredBinding;
+  const void * oldValue;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  SymTable_step(oSymTable);
+
+  desiredBinding = SymTable_find(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey));
+  if (desiredBinding == NULL) {
+    return NULL;
+  }
+  oldValue = desiredBinding->Value;
+  desiredBinding->Value = pvValue;
+
+  /* Here we have to "cast away the constness" */
+  return (void *) oldValue;
+}
+
+/* implements the SymTable_contains() function */
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  SymTable_step(oSymTable);
+  return (SymTable_find(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey)) != NULL);
+}
+
+/* implements the SymTable_get() function */
+void * SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return SymTable_getLen(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey));
+}
+
+/* implements the SymTable_getLen() function */
+void * SymTable_getLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength) {
+  struct Binding * desiredBinding;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  SymTable_step(oSymTable);
+  desiredBinding = SymTable_find(oSymTable, pcKey, uLength);
+  if (desiredBinding == NULL) {
+    return NULL;
+  }
+  return (void *) desiredBinding->Value;
+}
+
+/* implements the SymTable_getBatch() function. Like SymTable_putBatch,
+it hashes a group of keys and prefetches their buckets and first
+bindings before it resolves any of them */
+void SymTable_getBatch(SymTable_T oSymTable,
+const char * const *ppcKeys, size_t uCount, void **ppvValues) {
+  size_t auLengths[BATCH_GROUP];
+  size_t auHashes[BATCH_GROUP];
+  struct Binding *psBinding;
+  size_t uStart;
+  size_t uEnd;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL);
+  assert(ppvValues != NULL);
+
+  for (uStart = 0; uStart < uCount; uStart = uEnd) {
+    uEnd = (uCount - uStart > BATCH_GROUP) ? uStart + BATCH_GROUP :
+      uCount;
+    for (u = uStart; u < uEnd; u++) {
+      assert(ppcKeys[u] != NULL);
+      auLengths[u - uStart] = SymTable_length(oSymTable, ppcKeys[u]);
+      auHashes[u - uStart] = SymTable_hashKey(oSymTable,
+        ppcKeys[u], auLengths[u - uStart]);
+      SYMTABLE_PREFETCH(&(oSymTable->Bindings)
+        [auHashes[u - uStart] % oSymTable->bucketCount]);
+    }
+    for (u = uStart; u < uEnd; u++) {
+      psBinding = (oSymTable->Bindings)
+        [auHashes[u - uStart] % oSymTable->bucketCount];
+      if (psBinding != NULL) {
+        SYMTABLE_PREFETCH(psBinding);
+      }
+    }
+    /* Each key still counts as one operation towards an incremental
+    expansion, which moves bindings but never the array Bindings */
+    for (u = uStart; u < uEnd; u++) {
+      SymTable_step(oSymTable);
+      psBinding = SymTable_findHashed(oSymTable, ppcKeys[u],
+        auLengths[u - uStart], auHashes[u - uStart]);
+      ppvValues[u] = (psBinding == NULL) ? NULL :
+        (void *) psBinding->Value;
+    }
+  }
+}
+
+/* A helper function which takes in a SymTable_T oSymTable, ppsBucket,
+a pointer to one of its buckets, a char * pcKey, its length uLength and
+its hash code uHash. If the bucket's chain has a binding whose key is
+pcKey, it unlinks it from the chain and returns it. Otherwise it
+returns NULL. It is called by SymTable_remove */
+static struct Binding * SymTable_unlink(SymTable_T oSymTable,
+struct Binding **ppsBucket, const char *pcKey, size_t uLength,
+size_t uHash) {
+  struct Binding *psCurrentBinding;
+  struct Binding *psPreviousBinding;
+  assert(oSymTable != NULL);
+  assert(ppsBucket != NULL);
+  assert(pcKey != NULL);
+  psCurrentBinding = *ppsBucket;
+  psPreviousBinding = NULL;
+  while (psCurrentBinding != NULL) {
+    SYMTABLE_COUNT(oSymTable->stats.uProbes);
+    if (psCurrentBinding->Hash == uHash && (oSymTable->interned ?
+      psCurrentBinding->Key == pcKey :
+      (psCurrentBinding->Length == uLength &&
+      memcmp(psCurrentBinding->Key, pcKey, uLength) == 0))) {
+      break;
+    }
+    psPreviousBinding = psCurrentBinding;
+    psCurrentBinding = psCurrentBinding->psNextBinding;
+  }
+
+  /* The case where we didn't find the binding corresponding to pcKey*/
+  if (psCurrentBinding == NULL) {
+    return NULL;
+  }
+
+  /* The case where we did but it was the first one in the linked list
+  and hence we never updated  psPreviousBinding*/
+  if (psPreviousBinding == NULL) {
+    *ppsBucket = psCurrentBinding->psNextBinding;
   }
 
   /* All other cases*/
   else {
     psPreviousBinding->psNextBinding = psCurrentBinding->psNextBinding;
   }
+  return psCurrentBinding;
+}
 
-  toReturn = (void *) psCurrentBinding->Value;
+/* A helper function which takes SymTable_T oSymTable back to a small
+table, with every binding relinked into its inline bucket. No
+expansion may be under way. It has no return value, and it can't fail.
+It is called by SymTable_demote and SymTable_compact */
+static void SymTable_toInline(SymTable_T oSymTable) {
+  struct Binding *psCurrentBinding;
+  struct Binding *psNextBinding;
+  size_t hash;
+  assert(oSymTable != NULL);
+  assert(oSymTable->oldBindings == NULL);
 
-  /* Since we created a defensive copy of the key, we have to free that
-  too */
-  free((void *) psCurrentBinding->Key);
-  free(psCurrentBinding);
+  if (oSymTable->Bindings == &oSymTable->inlineBucket) {
+    return;
+  }
+  oSymTable->inlineBucket = NULL;
+  for (hash = 0; hash < oSymTable->bucketCount; hash++) {
+    for (psCurrentBinding = (oSymTable->Bindings)[hash];
+      psCurrentBinding != NULL; psCurrentBinding = psNextBinding) {
+      psNextBinding = psCurrentBinding->psNextBinding;
+      psCurrentBinding->psNextBinding = oSymTable->inlineBucket;
+      oSymTable->inlineBucket = psCurrentBinding;
+    }
+  }
+  free(oSymTable->Bindings);
+  oSymTable->Bindings = &oSymTable->inlineBucket;
+  oSymTable->bucketCount = 1;
+  oSymTable->expandThreshold = SYMTABLE_SMALL_LIMIT;
+}
+
+/* A helper function which moves the bindings of SymTable_T oSymTable
+to fewer buckets once fewer than a quarter of the bindings that would
+make it expand are left. The new array is the smallest whose threshold
+is twice the current size, so it takes many more puts or removes
+before the table resizes again. Like an expansion, the move is spread
+out over later operations if the table was made with
+SYMTABLE_INCREMENTAL, so it doesn't start while one is under way. The
+new threshold is never below a quarter of the old one either, even if
+the table lost many more bindings while a resize was under way: the
+room it leaves before the next expansion then bounds the buckets each
+operation must move. It is called by SymTable_remove */
+static void SymTable_shrink(SymTable_T oSymTable) {
+  size_t newBucketCount;
+  size_t uCount;
+  assert(oSymTable != NULL);
+
+  if (oSymTable->bucketCount <= SIZES[0] ||
+    oSymTable->oldBindings != NULL ||
+    oSymTable->size >= oSymTable->expandThreshold / 4) {
+    return;
+  }
+  uCount = oSymTable->size * 2;
+  if (uCount < oSymTable->expandThreshold / 4) {
+    uCount = oSymTable->expandThreshold / 4;
+  }
+  newBucketCount = SymTable_fitBucketCount(uCount);
+  if (newBucketCount < oSymTable->bucketCount) {
+    SymTable_resize(oSymTable, newBucketCount);
+  }
+}
+
+/* A helper function which takes SymTable_T oSymTable back to a small
+table if it has fallen below half of SYMTABLE_SMALL_LIMIT bindings.
+Only a table of SIZES[0] buckets goes back, which bounds the walk over
+the buckets, and only when no expansion is under way. It has no return
+value, and it can't fail. It is called by SymTable_remove */
+static void SymTable_demote(SymTable_T oSymTable) {
+  assert(oSymTable != NULL);
+
+  if (oSymTable->size >= DEMOTE_SIZE ||
+    oSymTable->bucketCount != SIZES[0] ||
+    oSymTable->oldBindings != NULL) {
+    return;
+  }
+  SymTable_toInline(oSymTable);
+}
+
+/* implements the SymTable_remove() replace function */
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+  struct Binding *psCurrentBinding;
+  void * toReturn;
+  size_t uLength;
+  size_t uHash;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  if (oSymTable->Frozen != NULL) {
+    return NULL;
+  }
+  SymTable_step(oSymTable);
+  uLength = SymTable_length(oSymTable, pcKey);
+  uHash = SymTable_hashKey(oSymTable, pcKey, uLength);
+  psCurrentBinding = SymTable_unlink(oSymTable,
+    &(oSymTable->Bindings)[uHash % oSymTable->bucketCount],
+    pcKey, uLength, uHash);
+
+  /* During a resize, the binding may not have been moved yet */
+  if (psCurrentBinding == NULL && oSymTable->oldBindings != NULL) {
+    uHash = SymTable_oldHash(oSymTable, pcKey, uLength, uHash);
+    psCurrentBinding = SymTable_unlink(oSymTable,
+      &(oSymTable->oldBindings)[uHash % oSymTable->oldBucketCount],
+      pcKey, uLength, uHash);
+  }
+  if (psCurrentBinding == NULL) {
+    SYMTABLE_COUNT(oSymTable->stats.uMisses);
+    return NULL;
+  }
+  SYMTABLE_COUNT(oSymTable->stats.uHits);
+
+  toReturn = (void *) psCurrentBinding->Value;
+  SymTable_freeBinding(oSymTable, psCurrentBinding);
   oSymTable->size--;
+  SymTable_shrink(oSymTable);
+  SymTable_demote(oSymTable);
   return toReturn;
 }
 
+/* implements the SymTable_compact() function. Unlike SymTable_shrink,
+it finishes any move at once, since its caller has asked for the work
+now */
+void SymTable_compact(SymTable_T oSymTable) {
+  size_t newBucketCount;
+  assert(oSymTable != NULL);
+
+  /* A frozen table has exactly one slot per binding already */
+  if (oSymTable->Frozen != NULL) {
+    return;
+  }
+
+  if (oSymTable->oldBindings != NULL) {
+    SymTable_migrate(oSymTable, oSymTable->oldBucketCount);
+  }
+  if (oSymTable->size <= SYMTABLE_SMALL_LIMIT) {
+    SymTable_toInline(oSymTable);
+    return;
+  }
+  newBucketCount = SymTable_fitBucketCount(oSymTable->size);
+  if (newBucketCount < oSymTable->bucketCount) {
+    SymTable_resize(oSymTable, newBucketCount);
+    if (oSymTable->oldBindings != NULL) {
+      SymTable_migrate(oSymTable, oSymTable->oldBucketCount);
+    }
+  }
+}
+
+/* A helper function which builds a minimal perfect hash with
+Perfect_build for the uCount bindings of SymTable_T oSymTable that
+ppsBindings points to, whose hash codes must all differ, and copies
+each binding into the slot of Frozen that the hash gives its key. It
+fills Displacements, which has uBucketCount elements that must all be
+0 to start with. It returns 1 if it succeeds, and 0 if Perfect_build
+fails. It is called by SymTable_freeze */
+static int SymTable_perfect(SymTable_T oSymTable,
+struct Binding * const *ppsBindings, size_t uCount,
+size_t uBucketCount, struct Binding *Frozen,
+unsigned int *Displacements) {
+  size_t *puHashes;
+  size_t *puSlots;
+  struct Binding *psBinding;
+  size_t u;
+  int iSuccessful;
+  assert(oSymTable != NULL);
+  assert(ppsBindings != NULL);
+  assert(Frozen != NULL);
+  assert(Displacements != NULL);
+
+  puHashes = (size_t *) malloc((uCount + 1) * sizeof(size_t));
+  puSlots = (size_t *) malloc((uCount + 1) * sizeof(size_t));
+  if (puHashes == NULL || puSlots == NULL) {
+    free(puHashes);
+    free(puSlots);
+    return 0;
+  }
+  for (u = 0; u < uCount; u++) {
+    puHashes[u] = SymTable_frozenHash(oSymTable, ppsBindings[u]->Hash);
+  }
+
+  iSuccessful = Perfect_build(puHashes, uCount, uBucketCount,
+    Displacements, puSlots);
+  for (u = 0; iSuccessful && u < uCount; u++) {
+    psBinding = ppsBindings[u];
+    /* A binding may have been allocated without its InlineKey */
+    memcpy(&Frozen[puSlots[u]], psBinding,
+      SymTable_bindingSize(oSymTable));
+    Frozen[puSlots[u]].psNextBinding = NULL;
+    if (psBinding->Key == psBinding->InlineKey) {
+      Frozen[puSlots[u]].Key = Frozen[puSlots[u]].InlineKey;
+    }
+  }
+
+  free(puHashes);
+  free(puSlots);
+  return iSuccessful;
+}
+
+/* implements the SymTable_freeze() function. The bindings are copied
+into Frozen, and once the perfect hash is built their nodes and the
+buckets go, but not the keys that weren't in their nodes, which Frozen
+now points to */
+int SymTable_freeze(SymTable_T oSymTable) {
+  struct Binding **ppsBindings;
+  struct Binding *psCurrentBinding;
+  struct Binding *Frozen;
+  unsigned int *Displacements;
+  size_t uCount;
+  size_t uBucketCount;
+  size_t hash;
+  size_t u = 0;
+  assert(oSymTable != NULL);
+
+  if (oSymTable->Frozen != NULL) {
+    return 1;
+  }
+  uCount = oSymTable->size;
+  uBucketCount = Perfect_bucketCount(uCount);
+  if (uBucketCount == 0) {
+    return 0;
+  }
+  if (oSymTable->oldBindings != NULL) {
+    SymTable_migrate(oSymTable, oSymTable->oldBucketCount);
+  }
+
+  ppsBindings = (struct Binding **) malloc((uCount + 1) *
+    sizeof(struct Binding *));
+  Frozen = (struct Binding *) malloc((uCount + 1) *
+    sizeof(struct Binding));
+  Displacements = (unsigned int *) calloc(uBucketCount,
+    sizeof(unsigned int));
+  if (ppsBindings == NULL || Frozen == NULL || Displacements == NULL) {
+    free(ppsBindings);
+    free(Frozen);
+    free(Displacements);
+    return 0;
+  }
+  for (hash = 0; hash < oSymTable->bucketCount; hash++) {
+    for (psCurrentBinding = (oSymTable->Bindings)[hash];
+      psCurrentBinding != NULL;
+      psCurrentBinding = psCurrentBinding->psNextBinding) {
+      ppsBindings[u++] = psCurrentBinding;
+    }
+  }
+  assert(u == uCount);
+
+  if (! SymTable_perfect(oSymTable, ppsBindings, uCount, uBucketCount,
+    Frozen, Displacements)) {
+    free(ppsBindings);
+    free(Frozen);
+    free(Displacements);
+    return 0;
+  }
+
+  for (u = 0; u < uCount; u++) {
+    if (oSymTable->arena != NULL) {
+      Arena_freeNode(oSymTable->arena, ppsBindings[u]);
+    }
+    else {
+      free(ppsBindings[u]);
+    }
+  }
+  free(ppsBindings);
+  SymTable_freeBuckets(oSymTable, oSymTable->Bindings);
+  oSymTable->inlineBucket = NULL;
+  oSymTable->Bindings = &oSymTable->inlineBucket;
+  oSymTable->bucketCount = 1;
+  oSymTable->expandThreshold = SYMTABLE_SMALL_LIMIT;
+  oSymTable->Frozen = Frozen;
+  oSymTable->Displacements = Displacements;
+  oSymTable->frozenMask = uBucketCount - 1;
+  return 1;
+}
+
 /* implements the SymTable_map() replace function */
 void SymTable_map(SymTable_T oSymTable,
 void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
@@ -363,7 +1763,16 @@ const void *pvExtra) {
   assert(oSymTable != NULL);
   assert(pfApply != NULL);
 
-  for (hash = 0; hash < SIZES[oSymTable->bucketCountOrder]; hash++) {
+  if (oSymTable->Frozen != NULL) {
+    for (hash = 0; hash < oSymTable->size; hash++) {
+      psCurrentBinding = &(oSymTable->Frozen)[hash];
+      pfApply(psCurrentBinding->Key, (void *) psCurrentBinding->Value,
+        (void *) pvExtra);
+    }
+    return;
+  }
+
+  for (hash = 0; hash < oSymTable->bucketCount; hash++) {
     for (psCurrentBinding = (oSymTable->Bindings)[hash];
       psCurrentBinding != NULL;
       psCurrentBinding = psCurrentBinding->psNextBinding) {
@@ -371,4 +1780,256 @@ const void *pvExtra) {
       (void *) pvExtra);
     }
   }
+
+  /* During an expansion, the buckets that haven't been moved yet */
+  if (oSymTable->oldBindings != NULL) {
+    for (hash = oSymTable->migrateNext; hash < oSymTable->oldBucketCount;
+      hash++) {
+      for (psCurrentBinding = (oSymTable->oldBindings)[hash];
+        psCurrentBinding != NULL;
+        psCurrentBinding = psCurrentBinding->psNextBinding) {
+        pfApply(psCurrentBinding->Key, (void *) psCurrentBinding->Value,
+        (void *) pvExtra);
+      }
+    }
+  }
+}
+
+/* implements the SymTable_mapRange() function. The bindings aren't in
+order, so every one of them is checked */
+void SymTable_mapRange(SymTable_T oSymTable, const char *pcLow,
+const char *pcHigh,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+  Filter_mapRange(oSymTable, pcLow, pcHigh, pfApply, pvExtra);
+}
+
+/* implements the SymTable_mapPrefix() function, which checks every
+binding as SymTable_mapRange does */
+void SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  assert(oSymTable != NULL);
+  assert(pcPrefix != NULL);
+  assert(pfApply != NULL);
+  Filter_mapPrefix(oSymTable, pcPrefix, pfApply, pvExtra);
+}
+
+/* A helper function which applies pfApply, with pvExtra, to every
+binding in the buckets from uStart up to but not including uEnd of the
+SymTable_T that pvTable is. It is the Parallel_RangeFn of
+SymTable_mapParallel */
+static void SymTable_mapBuckets(void *pvTable, size_t uStart,
+size_t uEnd, Parallel_ApplyFn pfApply, void *pvExtra) {
+  SymTable_T oSymTable = (SymTable_T) pvTable;
+  struct Binding *psCurrentBinding;
+  size_t hash;
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  for (hash = uStart; hash < uEnd; hash++) {
+    for (psCurrentBinding = (oSymTable->Bindings)[hash];
+      psCurrentBinding != NULL;
+      psCurrentBinding = psCurrentBinding->psNextBinding) {
+      pfApply(psCurrentBinding->Key, (void *) psCurrentBinding->Value,
+      pvExtra);
+    }
+  }
+}
+
+/* A helper function which applies pfApply, with pvExtra, to the
+bindings in the slots from uStart up to but not including uEnd of the
+frozen SymTable_T that pvTable is. It is the Parallel_RangeFn of
+SymTable_mapParallel once the table is frozen */
+static void SymTable_mapFrozen(void *pvTable, size_t uStart,
+size_t uEnd, Parallel_ApplyFn pfApply, void *pvExtra) {
+  SymTable_T oSymTable = (SymTable_T) pvTable;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(oSymTable->Frozen != NULL);
+  assert(pfApply != NULL);
+
+  for (u = uStart; u < uEnd; u++) {
+    pfApply((oSymTable->Frozen)[u].Key,
+      (void *) (oSymTable->Frozen)[u].Value, pvExtra);
+  }
+}
+
+/* implements the SymTable_mapParallel() function. The threads share
+out ranges of buckets, or of slots once the table is frozen. An
+expansion that is still under way is finished first, so that every
+binding is in Bindings, and so that lookups that pfApply makes don't
+move bindings under the other threads */
+void SymTable_mapParallel(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+void * const *ppvExtras, size_t uThreads) {
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+  assert(uThreads > 0);
+
+  if (oSymTable->Frozen != NULL) {
+    Parallel_map(oSymTable, oSymTable->size, SymTable_mapFrozen,
+      pfApply, ppvExtras, uThreads);
+    return;
+  }
+  if (oSymTable->oldBindings != NULL) {
+    SymTable_migrate(oSymTable, oSymTable->oldBucketCount);
+  }
+  Parallel_map(oSymTable, oSymTable->bucketCount, SymTable_mapBuckets,
+    pfApply, ppvExtras, uThreads);
+}
+
+/* implements the SymTable_begin() function. An expansion that is
+still under way is finished first, so that lookups made during the
+iteration, which would otherwise move bindings, leave the table as it
+is */
+void SymTable_begin(SymTable_T oSymTable, SymTable_Iter *psIter) {
+  assert(oSymTable != NULL);
+  assert(psIter != NULL);
+
+  if (oSymTable->oldBindings != NULL) {
+    SymTable_migrate(oSymTable, oSymTable->oldBucketCount);
+  }
+  psIter->oSymTable = oSymTable;
+  psIter->uPosition = 0;
+  psIter->pvCurrent = NULL;
+  psIter->pcKey = NULL;
+  psIter->pvValue = NULL;
+}
+
+/* implements the SymTable_next() function. pvCurrent is the binding
+last moved to, and uPosition the bucket to go on from once its chain
+ends, or the next slot of a frozen table */
+int SymTable_next(SymTable_Iter *psIter) {
+  const struct Binding *psBinding = NULL;
+  SymTable_T oSymTable;
+  assert(psIter != NULL);
+  assert(psIter->oSymTable != NULL);
+
+  oSymTable = psIter->oSymTable;
+  if (oSymTable->Frozen != NULL) {
+    if (psIter->uPosition < oSymTable->size) {
+      psBinding = &(oSymTable->Frozen)[psIter->uPosition];
+      psIter->uPosition++;
+    }
+  }
+  else {
+    if (psIter->pvCurrent != NULL) {
+      psBinding = ((const struct Binding *) psIter->pvCurrent)
+        ->psNextBinding;
+    }
+    while (psBinding == NULL &&
+      psIter->uPosition < oSymTable->bucketCount) {
+      psBinding = (oSymTable->Bindings)[psIter->uPosition];
+      psIter->uPosition++;
+    }
+  }
+  psIter->pvCurrent = psBinding;
+  if (psBinding == NULL) {
+    psIter->pcKey = NULL;
+    psIter->pvValue = NULL;
+    return 0;
+  }
+  psIter->pcKey = psBinding->Key;
+  psIter->pvValue = (void *) psBinding->Value;
+  return 1;
+}
+
+/* implements the SymTable_iterKey() function */
+const char *SymTable_iterKey(const SymTable_Iter *psIter) {
+  assert(psIter != NULL);
+  assert(psIter->pcKey != NULL);
+  return psIter->pcKey;
+}
+
+/* implements the SymTable_iterValue() function */
+void *SymTable_iterValue(const SymTable_Iter *psIter) {
+  assert(psIter != NULL);
+  assert(psIter->pcKey != NULL);
+  return psIter->pvValue;
+}
+
+/* A helper function which adds the chain that starts at psFirstBinding
+to the SymTable_Stats that psStats points to: the bytes of its keys to
+uKeyBytes, and its length to uMaxChain if it is the longest yet. It
+returns 1 if the chain has any bindings, and 0 if it is empty. It is
+called by SymTable_getStats */
+static int SymTable_measureChain(const struct Binding *psFirstBinding,
+SymTable_Stats *psStats) {
+  const struct Binding *psCurrentBinding;
+  size_t uChainLength = 0;
+  assert(psStats != NULL);
+
+  for (psCurrentBinding = psFirstBinding; psCurrentBinding != NULL;
+    psCurrentBinding = psCurrentBinding->psNextBinding) {
+    if (psCurrentBinding->Key != psCurrentBinding->InlineKey) {
+      psStats->uKeyBytes += psCurrentBinding->Length + 1;
+    }
+    uChainLength++;
+  }
+  if (uChainLength > psStats->uMaxChain) {
+    psStats->uMaxChain = uChainLength;
+  }
+  return (uChainLength > 0);
+}
+
+/* implements the SymTable_getStats() function. The chains are the
+buckets of Bindings and, during an expansion, the buckets of
+oldBindings that haven't been moved yet; every slot of a frozen table
+is a chain of one binding. The counters are only kept, and it only
+returns 1 (TRUE), when it is compiled with -DSYMTABLE_STATS */
+int SymTable_getStats(SymTable_T oSymTable, SymTable_Stats *psStats) {
+  size_t uChains = 0;
+  size_t hash;
+  int iCounting;
+  assert(oSymTable != NULL);
+  assert(psStats != NULL);
+
+#ifdef SYMTABLE_STATS
+  *psStats = oSymTable->stats;
+  iCounting = 1;
+#else
+  psStats->uHits = 0;
+  psStats->uMisses = 0;
+  psStats->uProbes = 0;
+  psStats->uExpansions = 0;
+  psStats->dExpandSeconds = 0.0;
+  psStats->uMaxMigrate = 0;
+  iCounting = 0;
+#endif
+  psStats->uMaxChain = 0;
+  psStats->dMeanChain = 0.0;
+  /* The slots of a frozen table are whole bindings */
+  psStats->uBindingBytes = oSymTable->size * (oSymTable->Frozen != NULL ?
+    sizeof(struct Binding) : SymTable_bindingSize(oSymTable));
+  psStats->uKeyBytes = 0;
+
+  if (oSymTable->Frozen != NULL) {
+    for (hash = 0; hash < oSymTable->size; hash++) {
+      uChains += SymTable_measureChain(&(oSymTable->Frozen)[hash],
+        psStats);
+    }
+  }
+  for (hash = 0; hash < oSymTable->bucketCount; hash++) {
+    uChains += SymTable_measureChain((oSymTable->Bindings)[hash],
+      psStats);
+  }
+  if (oSymTable->oldBindings != NULL) {
+    for (hash = oSymTable->migrateNext;
+      hash < oSymTable->oldBucketCount; hash++) {
+      uChains += SymTable_measureChain((oSymTable->oldBindings)[hash],
+        psStats);
+    }
+  }
+
+  /* Borrowed keys are the caller's, so none of them were copied */
+  if (oSymTable->borrowed) {
+    psStats->uKeyBytes = 0;
+  }
+  if (uChains > 0) {
+    psStats->dMeanChain = (double) oSymTable->size / (double) uChains;
+  }
+  return iCounting;
 }
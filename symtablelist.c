@@ -7,61 +7,271 @@
 /*--------------------------------------------------------------------*/
 
 #include <assert.h>
+#include <stddef.h>
 #include <string.h>
 #include "symtable.h"
+#include "arena.h"
+#include "filter.h"
 
-/* A Binding is an abstract data structure made up of 3 parts: Key,
+/* Adds 1 to the counter c, a field of the stats of a table, when the
+statistics of SymTable_getStats are compiled in with -DSYMTABLE_STATS,
+as in symtablehash.c, and does nothing otherwise */
+#ifdef SYMTABLE_STATS
+#define SYMTABLE_COUNT(c) ((void) ((c)++))
+#else
+#define SYMTABLE_COUNT(c) ((void) 0)
+#endif
+
+/* The size of the array in every binding that holds a copy of its key,
+if the key is shorter than that, so that most keys need no allocation
+of their own and are compared without leaving the binding */
+enum {INLINE_KEY_SIZE = 16};
+
+/* A Binding is an abstract data structure made up of 5 parts: Key,
 a pointer to a string (to store the key), Value, which is of type
-void * and is a pointer to the value, and psNextBinding, which points
-to another binding - It allows the bindings to be strung together to
-form a singly-linked list. */
+void * and is a pointer to the value, Length, the length of Key,
+psNextBinding, which points to another binding - It allows the
+bindings to be strung together to form a singly-linked list - and
+InlineKey, which holds the copy of a key of fewer than INLINE_KEY_SIZE
+characters. Key then points at InlineKey, so a binding's key must only
+be moved to another binding with SymTable_copyBinding. A table that
+borrows its keys never uses InlineKey, so its bindings are allocated
+without it; see SymTable_bindingSize. */
 struct Binding {
   /* Symbol table key */
   const char * Key;
   /* Symbol table value */
   const void * Value;
+  /* The number of characters of Key, not counting its '\0' */
+  size_t Length;
   /* The next binding  */
   struct Binding * psNextBinding;
+  /* The copy of a short key, which Key then points at */
+  char InlineKey[INLINE_KEY_SIZE];
 };
 
 /* This is a linked-list implementation of a symbol table. SymTable is
-an abstract data structure which has 2 fields. First, psFirstBinding,
-is a pointer to the first binding in the symbol table, and the second
-is the size, which is of type size_t, stores the size of the symbol
-table */
+an abstract data structure which has 6 fields, or 7 with SYMTABLE_STATS.
+First, psFirstBinding, is a pointer to the first binding in the symbol
+table, the second is the size, which is of type size_t, stores the size
+of the symbol table, the third is arena, the Arena_T that the bindings
+and key copies come from, or NULL if they come from malloc, the fourth
+is borrowed, which is set if the table was made with SYMTABLE_BORROWED
+and stores its callers' keys instead of copies, the fifth is interned,
+which is set if it was made with SYMTABLE_INTERNED and compares its keys
+by address; borrowed is then set too, and the sixth is reorder, the
+self-organizing policy applied to every binding that is found:
+SYMTABLE_MOVE_TO_FRONT, SYMTABLE_TRANSPOSE, or 0 for none. The seventh,
+stats, holds the counters that SymTable_getStats reports */
 struct SymTable {
   /* A pointer to the first binding in the symbol table */
   struct Binding *psFirstBinding;
   /* The current size of the symbol table */
   size_t size;
+  /* Where bindings and key copies are allocated, if not from malloc */
+  Arena_T arena;
+  /* Whether the keys belong to the caller rather than to the table */
+  int borrowed;
+  /* Whether keys are compared by address rather than by characters */
+  int interned;
+  /* How found bindings move towards psFirstBinding, if at all */
+  unsigned int reorder;
+#ifdef SYMTABLE_STATS
+  /* The counters of the table. Its other statistics aren't used */
+  SymTable_Stats stats;
+#endif
 };
 
+/* A helper function which takes a SymTable_T oSymTable and returns as a
+size_t the number of bytes allocated for each of its bindings: all of
+struct Binding, or only the part before InlineKey if oSymTable borrows
+its keys and so never copies one into a binding. It is called by
+SymTable_newWithHash, SymTable_newBinding and SymTable_getStats */
+static size_t SymTable_bindingSize(SymTable_T oSymTable) {
+  assert(oSymTable != NULL);
+  if (oSymTable->borrowed) {
+    return offsetof(struct Binding, InlineKey);
+  }
+  return sizeof(struct Binding);
+}
+
 /* The SymTable constructor */
 SymTable_T SymTable_new(void) {
+  return SymTable_newWithFlags(0);
+}
+
+/* The SymTable constructor that takes flags */
+SymTable_T SymTable_newWithFlags(unsigned int uFlags) {
+  return SymTable_newWithHash(NULL, uFlags);
+}
+
+/* The SymTable constructor that takes a capacity. A linked list has
+nothing to size in advance, so uHint is ignored */
+SymTable_T SymTable_newWithCapacity(size_t uHint) {
+  (void) uHint;
+  return SymTable_newWithFlags(0);
+}
+
+/* The SymTable constructor that takes a hash function. A linked list
+never hashes its keys, so pfHash is ignored */
+SymTable_T SymTable_newWithHash(SymTable_HashFn pfHash,
+unsigned int uFlags) {
   SymTable_T oSymTable;
+  (void) pfHash;
   oSymTable = (SymTable_T) malloc(sizeof(struct SymTable));
   if (oSymTable == NULL) {
     return NULL;
   }
+  oSymTable->interned = ((uFlags & SYMTABLE_INTERNED) != 0);
+  oSymTable->reorder = 0;
+  if (uFlags & SYMTABLE_MOVE_TO_FRONT) {
+    oSymTable->reorder = SYMTABLE_MOVE_TO_FRONT;
+  }
+  else if (uFlags & SYMTABLE_TRANSPOSE) {
+    oSymTable->reorder = SYMTABLE_TRANSPOSE;
+  }
+  oSymTable->borrowed = ((uFlags & SYMTABLE_BORROWED) != 0 ||
+    oSymTable->interned);
+  oSymTable->arena = NULL;
+  if (uFlags & SYMTABLE_ARENA) {
+    oSymTable->arena = Arena_new(SymTable_bindingSize(oSymTable));
+    if (oSymTable->arena == NULL) {
+      free(oSymTable);
+      return NULL;
+    }
+  }
   oSymTable->psFirstBinding = NULL;
   oSymTable->size = 0;
+#ifdef SYMTABLE_STATS
+  oSymTable->stats.uHits = 0;
+  oSymTable->stats.uMisses = 0;
+  oSymTable->stats.uProbes = 0;
+  oSymTable->stats.uExpansions = 0;
+  oSymTable->stats.dExpandSeconds = 0.0;
+  oSymTable->stats.uMaxMigrate = 0;
+#endif
   return oSymTable;
 }
 
+/* A helper function which allocates a binding along with a defensive
+copy of the key pcKey, of length uLength, for SymTable_T oSymTable, from
+its arena if it has one and from malloc otherwise. A short key is
+copied into the binding itself instead. If oSymTable borrows its keys,
+the binding points at pcKey itself. It returns the new binding, with
+only its Key and Length filled in, or NULL if it can't allocate memory.
+It is called by SymTable_putOrGetLen */
+static struct Binding * SymTable_newBinding(SymTable_T oSymTable,
+const char *pcKey, size_t uLength) {
+  struct Binding *psNewBinding;
+  char *keyCopy;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  /* We make a memory allocation for the new binding */
+  if (oSymTable->arena != NULL) {
+    psNewBinding = (struct Binding *) Arena_allocNode(oSymTable->arena);
+  }
+  else {
+    psNewBinding = (struct Binding*)
+      malloc(SymTable_bindingSize(oSymTable));
+  }
+  if (psNewBinding == NULL) {
+    return NULL;
+  }
+  psNewBinding->Length = uLength;
+
+  /* A borrowed key is stored as it is */
+  if (oSymTable->borrowed) {
+    assert(oSymTable->interned || pcKey[uLength] == '\0');
+    psNewBinding->Key = pcKey;
+    return psNewBinding;
+  }
+
+  /* We make a defensive copy of the key, in the binding if it fits */
+  if (uLength < INLINE_KEY_SIZE) {
+    memcpy(psNewBinding->InlineKey, pcKey, uLength);
+    psNewBinding->InlineKey[uLength] = '\0';
+    psNewBinding->Key = psNewBinding->InlineKey;
+    return psNewBinding;
+  }
+  if (oSymTable->arena != NULL) {
+    keyCopy = Arena_copyKey(oSymTable->arena, pcKey, uLength);
+    if (keyCopy == NULL) {
+      Arena_freeNode(oSymTable->arena, psNewBinding);
+      return NULL;
+    }
+    psNewBinding->Key = keyCopy;
+    return psNewBinding;
+  }
+  keyCopy = (char *) calloc(uLength + 1, sizeof(char));
+  if (keyCopy == NULL) {
+    /* Since we won't be adding psNewBinding to the symbol table,
+    we must free it */
+    free(psNewBinding);
+    return NULL;
+  }
+  psNewBinding->Key = memcpy(keyCopy, pcKey, uLength);
+  return psNewBinding;
+}
+
+/* A helper function which takes in a SymTable_T oSymTable and
+psBinding, one of its bindings, and returns 1 (TRUE) if the key of
+psBinding is a copy of its own, allocated from malloc, or 0 (FALSE) if
+it is borrowed, held in the binding, or in an arena. It is called by
+SymTable_freeBinding and SymTable_free */
+static int SymTable_hasKeyCopy(SymTable_T oSymTable,
+const struct Binding *psBinding) {
+  assert(oSymTable != NULL);
+  assert(psBinding != NULL);
+  return (oSymTable->arena == NULL && ! oSymTable->borrowed &&
+    psBinding->Key != psBinding->InlineKey);
+}
+
+/* A helper function which frees psBinding, a binding of SymTable_T
+oSymTable, along with its key copy. An arena only takes the binding
+back; it keeps the key bytes until the arena itself is freed. It is
+called by SymTable_remove */
+static void SymTable_freeBinding(SymTable_T oSymTable,
+struct Binding *psBinding) {
+  assert(oSymTable != NULL);
+  assert(psBinding != NULL);
+
+  if (oSymTable->arena != NULL) {
+    Arena_freeNode(oSymTable->arena, psBinding);
+    return;
+  }
+  /* Since we created a defensive copy of the key, we have to free that
+  too, unless the key was borrowed or is in the binding */
+  if (SymTable_hasKeyCopy(oSymTable, psBinding)) {
+    free((void *) psBinding->Key);
+  }
+  free(psBinding);
+}
+
 /* The SymTable deconstructor */
 void SymTable_free(SymTable_T oSymTable) {
   struct Binding *psCurrentBinding;
   struct Binding *psNextBinding;
   assert(oSymTable != NULL);
 
+  /* Bindings in an arena all go away with it, without a walk */
+  if (oSymTable->arena != NULL) {
+    Arena_free(oSymTable->arena);
+    free(oSymTable);
+    return;
+  }
+
   /* We iterate through the linked list from first to last */
   for (psCurrentBinding = oSymTable->psFirstBinding;
     psCurrentBinding != NULL; psCurrentBinding = psNextBinding) {
     psNextBinding = psCurrentBinding->psNextBinding;
 
     /* Since we create a defensive copy of the key, we have to free-up
-    the memory allocation of the key as well */
-    free((void *) psCurrentBinding->Key);
+    the memory allocation of the key as well, unless it was borrowed or
+    is in the binding */
+    if (SymTable_hasKeyCopy(oSymTable, psCurrentBinding)) {
+      free((void *) psCurrentBinding->Key);
+    }
     free(psCurrentBinding);
   }
   free(oSymTable);
@@ -73,62 +283,293 @@ size_t SymTable_getLength(SymTable_T oSymTable) {
   return oSymTable->size;
 }
 
-/* Implements the SymTable_put() function */
-int SymTable_put(SymTable_T oSymTable, const char *pcKey,
-const void *pvValue) {
-  struct Binding *psNewBinding;
-  char *keyCopy;
+/* A helper function which takes in a SymTable_T oSymTable and a key
+pcKey, and returns the length of pcKey as a size_t. A table that
+compares keys by address never needs it, so it returns 0 without
+reading pcKey then. It is called by every function that is given a key
+without its length */
+static size_t SymTable_length(SymTable_T oSymTable, const char *pcKey) {
   assert(oSymTable != NULL);
   assert(pcKey != NULL);
-
-  if (SymTable_contains(oSymTable, pcKey)) {
+  if (oSymTable->interned) {
     return 0;
   }
+  return strlen(pcKey);
+}
 
-  /* We make a memory allocation for the new binding and create it */
-  psNewBinding = (struct Binding*) malloc(sizeof(struct Binding));
-  if (psNewBinding == NULL) {
-    return 0;
+/* A helper function which copies the key, its length and the value of
+the binding psFrom to the binding psTo, but not the next binding. A key
+held in psFrom is copied into psTo, so psFrom may be reused at once.
+It is called by SymTable_reorder */
+static void SymTable_copyBinding(struct Binding *psTo,
+const struct Binding *psFrom) {
+  assert(psTo != NULL);
+  assert(psFrom != NULL);
+  psTo->Key = psFrom->Key;
+  psTo->Value = psFrom->Value;
+  psTo->Length = psFrom->Length;
+  if (psFrom->Key == psFrom->InlineKey) {
+    memcpy(psTo->InlineKey, psFrom->InlineKey, INLINE_KEY_SIZE);
+    psTo->Key = psTo->InlineKey;
   }
+}
 
-  /* We make a defensive copy of the key */
-  keyCopy = (char *) calloc(strlen(pcKey) + 1, sizeof(char));
-  if (keyCopy == NULL) {
-    /* Since we won't be adding psNewBinding to the symbol table,
-    we must free it */
-    free(psNewBinding);
+/* A helper function which applies the self-organizing policy of
+SymTable_T oSymTable to psFoundBinding, a binding that was just found,
+whose predecessor in the list is psPreviousBinding (or NULL if it is
+the first). Move-to-front relinks it at the head of the list.
+Transpose swaps its key and value with those of its predecessor, which
+moves it one step forward without relinking anything. It returns the
+binding that holds the key of psFoundBinding afterwards. It is called
+by SymTable_find */
+static struct Binding * SymTable_reorder(SymTable_T oSymTable,
+struct Binding *psPreviousBinding, struct Binding *psFoundBinding) {
+  struct Binding sSwap;
+  assert(oSymTable != NULL);
+  assert(psFoundBinding != NULL);
+
+  if (psPreviousBinding == NULL) {
+    return psFoundBinding;
+  }
+  if (oSymTable->reorder == SYMTABLE_MOVE_TO_FRONT) {
+    psPreviousBinding->psNextBinding = psFoundBinding->psNextBinding;
+    psFoundBinding->psNextBinding = oSymTable->psFirstBinding;
+    oSymTable->psFirstBinding = psFoundBinding;
+    return psFoundBinding;
+  }
+  if (oSymTable->reorder == SYMTABLE_TRANSPOSE) {
+    SymTable_copyBinding(&sSwap, psPreviousBinding);
+    SymTable_copyBinding(psPreviousBinding, psFoundBinding);
+    SymTable_copyBinding(psFoundBinding, &sSwap);
+    return psPreviousBinding;
+  }
+  return psFoundBinding;
+}
+
+/* A helper function used by SymTable_putOrGetLen, SymTable_replace,
+SymTable_contains, and SymTable_getLen. It takes in a SymTable_T
+oSymTable, a char * pcKey and its length uLength.
+If oSymTable contains a binding with the key pcKey, it returns a pointer
+to that binding. Otherwise, it returns Null. It only changes the order
+of the bindings of oSymTable, if it has a self-organizing policy */
+static struct Binding * SymTable_find(SymTable_T oSymTable,
+const char *pcKey, size_t uLength) {
+  struct Binding *psCurrentBinding;
+  struct Binding *psPreviousBinding = NULL;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  for (psCurrentBinding = oSymTable->psFirstBinding;
+    psCurrentBinding != NULL;
+    psCurrentBinding = psCurrentBinding->psNextBinding) {
+    SYMTABLE_COUNT(oSymTable->stats.uProbes);
+    /* Bindings with a different length can't have the same key */
+    if (oSymTable->interned ? psCurrentBinding->Key == pcKey :
+      (psCurrentBinding->Length == uLength &&
+      memcmp(psCurrentBinding->Key, pcKey, uLength) == 0)) {
+      SYMTABLE_COUNT(oSymTable->stats.uHits);
+      return SymTable_reorder(oSymTable, psPreviousBinding,
+        psCurrentBinding);
+    }
+    psPreviousBinding = psCurrentBinding;
+  }
+  SYMTABLE_COUNT(oSymTable->stats.uMisses);
+  return NULL;
+}
+
+/* A helper function which binds the key pcKey, of length uLength, to
+pvValue in a new binding at the front of the list of SymTable_T
+oSymTable, without looking for pcKey first. It returns 1 (TRUE), or 0
+(FALSE) if it can't allocate memory. It is called by
+SymTable_putOrGetLen and SymTable_newFromArray */
+static int SymTable_addBinding(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, const void *pvValue) {
+  struct Binding *psNewBinding;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  psNewBinding = SymTable_newBinding(oSymTable, pcKey, uLength);
+  if (psNewBinding == NULL) {
     return 0;
   }
-  keyCopy = strcpy(keyCopy, pcKey);
 
   /* We fill the binding and add it to the front of the linked list */
-  psNewBinding->Key = keyCopy;
   psNewBinding->Value = pvValue;
   psNewBinding->psNextBinding = oSymTable->psFirstBinding;
   oSymTable->psFirstBinding = psNewBinding;
   oSymTable->size++;
+  return 1;
+}
 
+/* A helper function which works as SymTable_putOrGet, for a key pcKey
+of length uLength. It is called by SymTable_putOrGet, SymTable_put
+and SymTable_putLen */
+static int SymTable_putOrGetLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, const void *pvValue, void **ppvValue) {
+  struct Binding *psNewBinding;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  /* This is the only walk of the list */
+  psNewBinding = SymTable_find(oSymTable, pcKey, uLength);
+  if (psNewBinding != NULL) {
+    if (ppvValue != NULL) {
+      *ppvValue = (void *) psNewBinding->Value;
+    }
+    return 0;
+  }
+
+  if (! SymTable_addBinding(oSymTable, pcKey, uLength, pvValue)) {
+    return -1;
+  }
+
+  if (ppvValue != NULL) {
+    *ppvValue = (void *) pvValue;
+  }
   return 1;
 }
 
-/* A helper function used by SymTable_replace, SymTable_contains,
-and SymTable_get. It takes in a SymTable_T oSymTable and a char * pcKey.
-If oSymTable contains a binding with the key pcKey, it returns a pointer
-to that binding. Otherwise, it returns Null. It does not change the
-contents of oSymTable */
-static struct Binding * SymTable_find(SymTable_T oSymTable,
-const char *pcKey) {
-  struct Binding *psCurrentBinding;
+/* Implements the SymTable_putOrGet() function */
+int SymTable_putOrGet(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue, void **ppvValue) {
   assert(oSymTable != NULL);
   assert(pcKey != NULL);
-  for (psCurrentBinding = oSymTable->psFirstBinding;
-    psCurrentBinding != NULL;
-    psCurrentBinding = psCurrentBinding->psNextBinding) {
-    if (strcmp(psCurrentBinding->Key,pcKey) == 0) {
-      return psCurrentBinding;
+  return SymTable_putOrGetLen(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey), pvValue, ppvValue);
+}
+
+/* Implements the SymTable_put() function */
+int SymTable_put(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return (SymTable_putOrGetLen(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey), pvValue, NULL) == 1);
+}
+
+/* Implements the SymTable_putLen() function */
+int SymTable_putLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, const void *pvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return (SymTable_putOrGetLen(oSymTable, pcKey, uLength, pvValue,
+    NULL) == 1);
+}
+
+/* Implements the SymTable_putBatch() function. A linked list has no
+buckets to prefetch, so it is just a loop of SymTable_put */
+size_t SymTable_putBatch(SymTable_T oSymTable,
+const char * const *ppcKeys, const void * const *ppvValues,
+size_t uCount) {
+  size_t uAdded = 0;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL);
+  assert(ppvValues != NULL);
+
+  for (u = 0; u < uCount; u++) {
+    if (SymTable_put(oSymTable, ppcKeys[u], ppvValues[u])) {
+      uAdded++;
     }
   }
-  return NULL;
+  return uAdded;
+}
+
+/* A key of the array given to SymTable_newFromArray, with its index in
+that array, so the keys can be sorted without losing their order */
+struct KeyRef {
+  const char *pcKey;
+  size_t uIndex;
+};
+
+/* A helper function which compares the KeyRefs that pvFirst and
+pvSecond point to, by key and then by index, for qsort. The first
+occurrence of a key in the array is then the first of its run. It is
+called by SymTable_newFromArray */
+static int SymTable_compareKeyRefs(const void *pvFirst,
+const void *pvSecond) {
+  const struct KeyRef *psFirst = (const struct KeyRef *) pvFirst;
+  const struct KeyRef *psSecond = (const struct KeyRef *) pvSecond;
+  int iCompare;
+  iCompare = strcmp(psFirst->pcKey, psSecond->pcKey);
+  if (iCompare != 0) {
+    return iCompare;
+  }
+  return (psFirst->uIndex > psSecond->uIndex) -
+    (psFirst->uIndex < psSecond->uIndex);
+}
+
+/* The SymTable constructor that takes an array of bindings. The
+bindings and the keys too long to go in them are allocated up front,
+in one slab and one chunk of the arena. The duplicates are found by
+sorting the keys, in O(n log n) time, instead of by walking the list
+for each key, so no binding is looked for at all. The bindings are then
+added in the order of the array, as uCount calls of SymTable_put would
+add them */
+SymTable_T SymTable_newFromArray(const char * const *ppcKeys,
+const void * const *ppvValues, size_t uCount) {
+  SymTable_T oSymTable;
+  struct KeyRef *psRefs;
+  size_t *puLengths;
+  unsigned char *pucDuplicate;
+  size_t uKeyBytes = 0;
+  size_t u;
+  int iSuccessful = 1;
+  assert(ppcKeys != NULL);
+  assert(ppvValues != NULL);
+
+  oSymTable = SymTable_newWithFlags(SYMTABLE_ARENA);
+  if (oSymTable == NULL) {
+    return NULL;
+  }
+  /* One more element in each array, so that none is of size 0 */
+  psRefs = (struct KeyRef *)
+    malloc((uCount + 1) * sizeof(struct KeyRef));
+  puLengths = (size_t *) malloc((uCount + 1) * sizeof(size_t));
+  pucDuplicate = (unsigned char *) calloc(uCount + 1, 1);
+  if (psRefs == NULL || puLengths == NULL || pucDuplicate == NULL) {
+    free(psRefs);
+    free(puLengths);
+    free(pucDuplicate);
+    SymTable_free(oSymTable);
+    return NULL;
+  }
+
+  for (u = 0; u < uCount; u++) {
+    assert(ppcKeys[u] != NULL);
+    puLengths[u] = strlen(ppcKeys[u]);
+    if (puLengths[u] >= INLINE_KEY_SIZE) {
+      uKeyBytes += puLengths[u] + 1;
+    }
+    psRefs[u].pcKey = ppcKeys[u];
+    psRefs[u].uIndex = u;
+  }
+
+  /* Every key of a run but the first is a later occurrence */
+  qsort(psRefs, uCount, sizeof(struct KeyRef), SymTable_compareKeyRefs);
+  for (u = 1; u < uCount; u++) {
+    if (strcmp(psRefs[u - 1].pcKey, psRefs[u].pcKey) == 0) {
+      pucDuplicate[psRefs[u].uIndex] = 1;
+    }
+  }
+
+  if (! Arena_reserve(oSymTable->arena, uCount, uKeyBytes)) {
+    iSuccessful = 0;
+  }
+  for (u = 0; iSuccessful && u < uCount; u++) {
+    if (! pucDuplicate[u] && ! SymTable_addBinding(oSymTable,
+      ppcKeys[u], puLengths[u], ppvValues[u])) {
+      iSuccessful = 0;
+    }
+  }
+
+  free(psRefs);
+  free(puLengths);
+  free(pucDuplicate);
+  if (! iSuccessful) {
+    SymTable_free(oSymTable);
+    return NULL;
+  }
+  return oSymTable;
 }
 
 /* implements the SymTable_replace() function */
@@ -139,7 +580,8 @@ const void *pvValue) {
   assert(oSymTable != NULL);
   assert(pcKey != NULL);
 
-  desiredBinding = SymTable_find(oSymTable, pcKey);
+  desiredBinding = SymTable_find(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey));
   if (desiredBinding == NULL) {
     return NULL;
   }
@@ -154,32 +596,61 @@ const void *pvValue) {
 int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
   assert(oSymTable != NULL);
   assert(pcKey != NULL);
-  return (SymTable_find(oSymTable, pcKey) != NULL);
+  return (SymTable_find(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey)) != NULL);
 }
 
 /* implements the SymTable_get() replace function */
 void * SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return SymTable_getLen(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey));
+}
+
+/* implements the SymTable_getLen() function */
+void * SymTable_getLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength) {
   struct Binding * desiredBinding;
   assert(oSymTable != NULL);
   assert(pcKey != NULL);
-  desiredBinding = SymTable_find(oSymTable, pcKey);
+  desiredBinding = SymTable_find(oSymTable, pcKey, uLength);
   if (desiredBinding == NULL) {
     return NULL;
   }
   return (void *) desiredBinding->Value;
 }
 
+/* implements the SymTable_getBatch() function, as a loop of
+SymTable_get */
+void SymTable_getBatch(SymTable_T oSymTable,
+const char * const *ppcKeys, size_t uCount, void **ppvValues) {
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL);
+  assert(ppvValues != NULL);
+
+  for (u = 0; u < uCount; u++) {
+    ppvValues[u] = SymTable_get(oSymTable, ppcKeys[u]);
+  }
+}
+
 /* implements the SymTable_remove() function */
 void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
   struct Binding *psCurrentBinding;
   struct Binding *psPreviousBinding;
   void * toReturn;
+  size_t uLength;
   assert(oSymTable != NULL);
   assert(pcKey != NULL);
+  uLength = SymTable_length(oSymTable, pcKey);
   psCurrentBinding = oSymTable->psFirstBinding;
   psPreviousBinding = NULL;
   while (psCurrentBinding != NULL) {
-    if (strcmp(psCurrentBinding->Key, pcKey) == 0) {
+    SYMTABLE_COUNT(oSymTable->stats.uProbes);
+    if (oSymTable->interned ? psCurrentBinding->Key == pcKey :
+      (psCurrentBinding->Length == uLength &&
+      memcmp(psCurrentBinding->Key, pcKey, uLength) == 0)) {
       break;
     }
     psPreviousBinding = psCurrentBinding;
@@ -188,8 +659,10 @@ void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
 
   /* The case where we didn't find the binding corresponding to pcKey*/
   if (psCurrentBinding == NULL) {
+    SYMTABLE_COUNT(oSymTable->stats.uMisses);
     return NULL;
   }
+  SYMTABLE_COUNT(oSymTable->stats.uHits);
 
   /* The case where we did but it was the first one in the linked list
   and hence we never updated  psPreviousBinding*/
@@ -203,15 +676,26 @@ void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
   }
 
   toReturn = (void *) psCurrentBinding->Value;
-
-  /* Since we created a defensive copy of the key, we have to free that
-  too */
-  free((void *) psCurrentBinding->Key);
-  free(psCurrentBinding);
+  SymTable_freeBinding(oSymTable, psCurrentBinding);
   oSymTable->size--;
   return toReturn;
 }
 
+/* implements the SymTable_compact() function. A list only holds its
+bindings, which removes already free, so there is nothing to shrink */
+void SymTable_compact(SymTable_T oSymTable) {
+  assert(oSymTable != NULL);
+  (void) oSymTable;
+}
+
+/* implements the SymTable_freeze() function. A list has no
+frozen form, so oSymTable is left as it is */
+int SymTable_freeze(SymTable_T oSymTable) {
+  assert(oSymTable != NULL);
+  (void) oSymTable;
+  return 0;
+}
+
 /* implements the SymTable_map() function */
 void SymTable_map(SymTable_T oSymTable,
 void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
@@ -227,3 +711,136 @@ const void *pvExtra) {
     (void *) pvExtra);
   }
 }
+
+/* implements the SymTable_mapRange() function. The bindings aren't in
+order, so every one of them is checked */
+void SymTable_mapRange(SymTable_T oSymTable, const char *pcLow,
+const char *pcHigh,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+  Filter_mapRange(oSymTable, pcLow, pcHigh, pfApply, pvExtra);
+}
+
+/* implements the SymTable_mapPrefix() function, which checks every
+binding as SymTable_mapRange does */
+void SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  assert(oSymTable != NULL);
+  assert(pcPrefix != NULL);
+  assert(pfApply != NULL);
+  Filter_mapPrefix(oSymTable, pcPrefix, pfApply, pvExtra);
+}
+
+/* implements the SymTable_mapParallel() function. A list can only be
+walked from its front, so it is never split: the calling thread does it
+all, with the first extra */
+void SymTable_mapParallel(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+void * const *ppvExtras, size_t uThreads) {
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+  assert(uThreads > 0);
+  (void) uThreads;
+  SymTable_map(oSymTable, pfApply,
+    ppvExtras == NULL ? NULL : ppvExtras[0]);
+}
+
+/* implements the SymTable_begin() function */
+void SymTable_begin(SymTable_T oSymTable, SymTable_Iter *psIter) {
+  assert(oSymTable != NULL);
+  assert(psIter != NULL);
+  psIter->oSymTable = oSymTable;
+  psIter->uPosition = 0;
+  psIter->pvCurrent = NULL;
+  psIter->pcKey = NULL;
+  psIter->pvValue = NULL;
+}
+
+/* implements the SymTable_next() function. uPosition is 1 once the
+first binding has been reached, and pvCurrent is the binding last moved
+to */
+int SymTable_next(SymTable_Iter *psIter) {
+  const struct Binding *psBinding;
+  assert(psIter != NULL);
+  assert(psIter->oSymTable != NULL);
+
+  if (psIter->pvCurrent != NULL) {
+    psBinding = ((const struct Binding *) psIter->pvCurrent)
+      ->psNextBinding;
+  }
+  else if (psIter->uPosition == 0) {
+    psBinding = psIter->oSymTable->psFirstBinding;
+  }
+  else {
+    psBinding = NULL;
+  }
+  psIter->uPosition = 1;
+  psIter->pvCurrent = psBinding;
+  if (psBinding == NULL) {
+    psIter->pcKey = NULL;
+    psIter->pvValue = NULL;
+    return 0;
+  }
+  psIter->pcKey = psBinding->Key;
+  psIter->pvValue = (void *) psBinding->Value;
+  return 1;
+}
+
+/* implements the SymTable_iterKey() function */
+const char *SymTable_iterKey(const SymTable_Iter *psIter) {
+  assert(psIter != NULL);
+  assert(psIter->pcKey != NULL);
+  return psIter->pcKey;
+}
+
+/* implements the SymTable_iterValue() function */
+void *SymTable_iterValue(const SymTable_Iter *psIter) {
+  assert(psIter != NULL);
+  assert(psIter->pcKey != NULL);
+  return psIter->pvValue;
+}
+
+/* implements the SymTable_getStats() function. The whole list is a
+single chain, and it never grows all at once. The counters are only
+kept, and it only returns 1 (TRUE), when it is compiled with
+-DSYMTABLE_STATS */
+int SymTable_getStats(SymTable_T oSymTable, SymTable_Stats *psStats) {
+  struct Binding *psCurrentBinding;
+  int iCounting;
+  assert(oSymTable != NULL);
+  assert(psStats != NULL);
+
+#ifdef SYMTABLE_STATS
+  *psStats = oSymTable->stats;
+  iCounting = 1;
+#else
+  psStats->uHits = 0;
+  psStats->uMisses = 0;
+  psStats->uProbes = 0;
+  psStats->uExpansions = 0;
+  psStats->dExpandSeconds = 0.0;
+  psStats->uMaxMigrate = 0;
+  iCounting = 0;
+#endif
+  psStats->uMaxChain = oSymTable->size;
+  psStats->dMeanChain = (double) oSymTable->size;
+  psStats->uBindingBytes = oSymTable->size *
+    SymTable_bindingSize(oSymTable);
+  psStats->uKeyBytes = 0;
+
+  /* Borrowed keys are the caller's, so none of them were copied */
+  if (oSymTable->borrowed) {
+    return iCounting;
+  }
+  for (psCurrentBinding = oSymTable->psFirstBinding;
+    psCurrentBinding != NULL;
+    psCurrentBinding = psCurrentBinding->psNextBinding) {
+    if (psCurrentBinding->Key != psCurrentBinding->InlineKey) {
+      psStats->uKeyBytes += psCurrentBinding->Length + 1;
+    }
+  }
+  return iCounting;
+}
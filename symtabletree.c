@@ -0,0 +1,1155 @@
+/*--------------------------------------------------------------------*/
+/* symtabletree.c                                                     */
+/* Author: Ahmed Farah                                                */
+/* Implements the Symbol Table abstract data type (ADT), compliant    */
+/* with the interface in symtable.h                                   */
+/* It uses a B-tree, which keeps the keys in order, so that ranges    */
+/* and prefixes of them can be visited without a sort                 */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <string.h>
+#include "symtable.h"
+#include "arena.h"
+
+/* The minimum degree of the B-tree: every node but the root holds
+between SYMTABLE_BTREE_DEGREE - 1 and 2 * SYMTABLE_BTREE_DEGREE - 1
+keys. It can be overridden at compile time, e.g. with
+-DSYMTABLE_BTREE_DEGREE=4. With the default, the keys of a node fill
+two cache lines, and lookups touch about log16 of the size nodes */
+#ifndef SYMTABLE_BTREE_DEGREE
+#define SYMTABLE_BTREE_DEGREE 8
+#endif
+#if SYMTABLE_BTREE_DEGREE < 2
+#error "SYMTABLE_BTREE_DEGREE must be at least 2"
+#endif
+
+/* The fewest and the most keys of a node other than the root */
+enum {MIN_KEYS = SYMTABLE_BTREE_DEGREE - 1,
+  MAX_KEYS = 2 * SYMTABLE_BTREE_DEGREE - 1};
+
+/* A Node of the B-tree holds uCount bindings, whose keys are in
+increasing order, split between Keys and Values. An internal node also
+has uCount + 1 children: every key in Children[i] comes before Keys[i],
+and every key in Children[i + 1] comes after it. psParent lets a walk
+climb back up without a stack. */
+struct Node {
+  /* The number of bindings of the node */
+  size_t uCount;
+  /* The node that has this one among its children, or NULL */
+  struct Node * psParent;
+  /* Whether the node has no children */
+  int iLeaf;
+  /* The keys of the node, in increasing order */
+  const char * Keys[MAX_KEYS];
+  /* The value of each key */
+  const void * Values[MAX_KEYS];
+  /* The children of an internal node */
+  struct Node * Children[MAX_KEYS + 1];
+};
+
+/* This is a B-tree implementation of a symbol table. psRoot is its
+root, which is an empty leaf in an empty table, and size the number of
+bindings. Keys are ordered as strcmp orders them. If the table was made
+with SYMTABLE_ARENA, its nodes and key copies come from arena, and
+otherwise arena is NULL and they come from malloc. borrowed and
+interned are as in symtablehash.c; keys that compare by address are
+still kept in the order of their characters, and two equal strings at
+different addresses in the order of their addresses. */
+struct SymTable {
+  /* The root of the tree */
+  struct Node * psRoot;
+  /* The current size of the symbol table */
+  size_t size;
+  /* Where nodes and key copies are allocated, if not from malloc */
+  Arena_T arena;
+  /* Whether the keys belong to the caller rather than to the table */
+  int borrowed;
+  /* Whether keys are compared by address rather than by characters */
+  int interned;
+};
+
+/* A Position is a binding of a B-tree: the Keys[uIndex] of psNode, or
+the end of the tree if psNode is NULL */
+struct Position {
+  /* The node of the binding, or NULL */
+  struct Node * psNode;
+  /* The index of the binding in psNode */
+  size_t uIndex;
+};
+
+/* A helper function which takes in a SymTable_T oSymTable and a key
+pcKey, and returns the length of pcKey as a size_t. A table that
+compares keys by address never needs it, so it returns 0 without
+reading pcKey then. It is called by every function that is given a key
+without its length */
+static size_t SymTable_length(SymTable_T oSymTable, const char *pcKey) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  if (oSymTable->interned) {
+    return 0;
+  }
+  return strlen(pcKey);
+}
+
+/* A helper function which takes in a SymTable_T oSymTable, a key pcKey
+of length uLength, and pcStored, a key of oSymTable. It returns a
+negative number, 0 or a positive one as pcKey comes before, is, or
+comes after pcStored. It is called by every function that looks up a
+key */
+static int SymTable_compare(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, const char *pcStored) {
+  int iCompare;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  assert(pcStored != NULL);
+
+  if (oSymTable->interned) {
+    if (pcKey == pcStored) {
+      return 0;
+    }
+    iCompare = strcmp(pcKey, pcStored);
+    if (iCompare != 0) {
+      return iCompare;
+    }
+    return ((size_t) pcKey < (size_t) pcStored) ? -1 : 1;
+  }
+
+  /* As in symtableflat.c, pcKey has no '\0' among its uLength
+  characters, so strncmp stops at the end of a shorter stored key, and
+  a longer one is told apart by its next character */
+  iCompare = strncmp(pcKey, pcStored, uLength);
+  if (iCompare != 0) {
+    return iCompare;
+  }
+  return (pcStored[uLength] == '\0') ? 0 : -1;
+}
+
+/* A helper function which takes in a SymTable_T oSymTable, a node
+psNode, and a key pcKey of length uLength. It returns the index of the
+first key of psNode that doesn't come before pcKey, or uCount if there
+is none, and sets *piFound to 1 if that key is pcKey and to 0
+otherwise. It is called by every function that looks up a key */
+static size_t SymTable_search(SymTable_T oSymTable,
+const struct Node *psNode, const char *pcKey, size_t uLength,
+int *piFound) {
+  size_t uLow = 0;
+  size_t uHigh;
+  size_t uMiddle;
+  int iCompare;
+  assert(oSymTable != NULL);
+  assert(psNode != NULL);
+  assert(piFound != NULL);
+
+  /* Binary search, keeping Keys[uHigh] (if any) not before pcKey and
+  every key before uLow before it */
+  uHigh = psNode->uCount;
+  *piFound = 0;
+  while (uLow < uHigh) {
+    uMiddle = uLow + (uHigh - uLow) / 2;
+    iCompare = SymTable_compare(oSymTable, pcKey, uLength,
+      psNode->Keys[uMiddle]);
+    if (iCompare == 0) {
+      *piFound = 1;
+      return uMiddle;
+    }
+    if (iCompare > 0) {
+      uLow = uMiddle + 1;
+    }
+    else {
+      uHigh = uMiddle;
+    }
+  }
+  return uLow;
+}
+
+/* A helper function which returns a new empty node for SymTable_T
+oSymTable, a leaf if iLeaf is 1, from its arena if it has one and from
+malloc otherwise, or NULL if it can't allocate memory */
+static struct Node * SymTable_newNode(SymTable_T oSymTable, int iLeaf) {
+  struct Node *psNode;
+  assert(oSymTable != NULL);
+
+  if (oSymTable->arena != NULL) {
+    psNode = (struct Node *) Arena_allocNode(oSymTable->arena);
+  }
+  else {
+    psNode = (struct Node *) malloc(sizeof(struct Node));
+  }
+  if (psNode == NULL) {
+    return NULL;
+  }
+  psNode->uCount = 0;
+  psNode->psParent = NULL;
+  psNode->iLeaf = iLeaf;
+  return psNode;
+}
+
+/* A helper function which gives psNode, a node of SymTable_T
+oSymTable that no longer holds anything, back to where SymTable_newNode
+got it. It has no return value */
+static void SymTable_freeNode(SymTable_T oSymTable,
+struct Node *psNode) {
+  assert(oSymTable != NULL);
+  assert(psNode != NULL);
+  if (oSymTable->arena != NULL) {
+    Arena_freeNode(oSymTable->arena, psNode);
+  }
+  else {
+    free(psNode);
+  }
+}
+
+/* The SymTable constructor */
+SymTable_T SymTable_new(void) {
+  return SymTable_newWithFlags(0);
+}
+
+/* The SymTable constructor that takes flags. Only SYMTABLE_ARENA,
+SYMTABLE_BORROWED and SYMTABLE_INTERNED apply to a tree */
+SymTable_T SymTable_newWithFlags(unsigned int uFlags) {
+  SymTable_T oSymTable;
+  oSymTable = (SymTable_T) malloc(sizeof(struct SymTable));
+  if (oSymTable == NULL) {
+    return NULL;
+  }
+  oSymTable->arena = NULL;
+  if (uFlags & SYMTABLE_ARENA) {
+    oSymTable->arena = Arena_new(sizeof(struct Node));
+    if (oSymTable->arena == NULL) {
+      free(oSymTable);
+      return NULL;
+    }
+  }
+  oSymTable->psRoot = SymTable_newNode(oSymTable, 1);
+  if (oSymTable->psRoot == NULL) {
+    if (oSymTable->arena != NULL) {
+      Arena_free(oSymTable->arena);
+    }
+    free(oSymTable);
+    return NULL;
+  }
+  oSymTable->interned = ((uFlags & SYMTABLE_INTERNED) != 0);
+  oSymTable->borrowed = ((uFlags & SYMTABLE_BORROWED) != 0 ||
+    oSymTable->interned);
+  oSymTable->size = 0;
+  return oSymTable;
+}
+
+/* The SymTable constructor that takes a hash function. A tree never
+hashes its keys, so pfHash is ignored */
+SymTable_T SymTable_newWithHash(SymTable_HashFn pfHash,
+unsigned int uFlags) {
+  (void) pfHash;
+  return SymTable_newWithFlags(uFlags);
+}
+
+/* The SymTable constructor that takes a capacity. A tree grows a node
+at a time and never rehashes, so uHint is ignored */
+SymTable_T SymTable_newWithCapacity(size_t uHint) {
+  (void) uHint;
+  return SymTable_newWithFlags(0);
+}
+
+/* A helper function which frees psNode, a node of SymTable_T
+oSymTable, and every node below it, along with their key copies unless
+they are borrowed. It has no return value. It is called by
+SymTable_free */
+static void SymTable_freeTree(SymTable_T oSymTable,
+struct Node *psNode) {
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(psNode != NULL);
+
+  if (! psNode->iLeaf) {
+    for (u = 0; u <= psNode->uCount; u++) {
+      SymTable_freeTree(oSymTable, psNode->Children[u]);
+    }
+  }
+  if (! oSymTable->borrowed) {
+    for (u = 0; u < psNode->uCount; u++) {
+      free((void *) psNode->Keys[u]);
+    }
+  }
+  free(psNode);
+}
+
+/* The SymTable deconstructor */
+void SymTable_free(SymTable_T oSymTable) {
+  assert(oSymTable != NULL);
+
+  /* Nodes and keys in an arena all go away with it, without a walk */
+  if (oSymTable->arena != NULL) {
+    Arena_free(oSymTable->arena);
+  }
+  else {
+    SymTable_freeTree(oSymTable, oSymTable->psRoot);
+  }
+  free(oSymTable);
+}
+
+/* Implements the SymTable_getLength() function */
+size_t SymTable_getLength(SymTable_T oSymTable) {
+  assert(oSymTable != NULL);
+  return oSymTable->size;
+}
+
+/* A helper function which takes in a SymTable_T oSymTable and a key
+pcKey of length uLength, and returns the position of pcKey, whose
+psNode is NULL if oSymTable doesn't contain it. It is called by every
+function that looks a key up without changing the tree */
+static struct Position SymTable_find(SymTable_T oSymTable,
+const char *pcKey, size_t uLength) {
+  struct Position sPosition;
+  int iFound;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  sPosition.psNode = oSymTable->psRoot;
+  for (;;) {
+    sPosition.uIndex = SymTable_search(oSymTable, sPosition.psNode,
+      pcKey, uLength, &iFound);
+    if (iFound) {
+      return sPosition;
+    }
+    if (sPosition.psNode->iLeaf) {
+      sPosition.psNode = NULL;
+      return sPosition;
+    }
+    sPosition.psNode = sPosition.psNode->Children[sPosition.uIndex];
+  }
+}
+
+/* A helper function which makes psChild the child uIndex of psNode,
+both nodes of one tree. It is called by every function that moves
+children between nodes */
+static void SymTable_setChild(struct Node *psNode, size_t uIndex,
+struct Node *psChild) {
+  assert(psNode != NULL);
+  assert(psChild != NULL);
+  psNode->Children[uIndex] = psChild;
+  psChild->psParent = psNode;
+}
+
+/* A helper function which splits the full child uIndex of psNode, an
+internal node of SymTable_T oSymTable that isn't full, into two nodes
+of MIN_KEYS keys each, and moves the middle key up into psNode. It
+returns 1 if it succeeds, and 0, leaving oSymTable unchanged, if it
+can't allocate the new node. It is called by SymTable_putOrGetLen */
+static int SymTable_split(SymTable_T oSymTable, struct Node *psNode,
+size_t uIndex) {
+  struct Node *psLeft;
+  struct Node *psRight;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(psNode != NULL);
+  assert(psNode->uCount < MAX_KEYS);
+
+  psLeft = psNode->Children[uIndex];
+  assert(psLeft->uCount == MAX_KEYS);
+  psRight = SymTable_newNode(oSymTable, psLeft->iLeaf);
+  if (psRight == NULL) {
+    return 0;
+  }
+
+  /* The upper half of psLeft moves to psRight */
+  for (u = 0; u < MIN_KEYS; u++) {
+    psRight->Keys[u] = psLeft->Keys[u + MIN_KEYS + 1];
+    psRight->Values[u] = psLeft->Values[u + MIN_KEYS + 1];
+  }
+  if (! psLeft->iLeaf) {
+    for (u = 0; u <= MIN_KEYS; u++) {
+      SymTable_setChild(psRight, u, psLeft->Children[u + MIN_KEYS + 1]);
+    }
+  }
+  psRight->uCount = MIN_KEYS;
+  psLeft->uCount = MIN_KEYS;
+
+  /* And the middle key goes up, with psRight just after it */
+  for (u = psNode->uCount; u > uIndex; u--) {
+    psNode->Keys[u] = psNode->Keys[u - 1];
+    psNode->Values[u] = psNode->Values[u - 1];
+    psNode->Children[u + 1] = psNode->Children[u];
+  }
+  psNode->Keys[uIndex] = psLeft->Keys[MIN_KEYS];
+  psNode->Values[uIndex] = psLeft->Values[MIN_KEYS];
+  SymTable_setChild(psNode, uIndex + 1, psRight);
+  psNode->uCount++;
+  return 1;
+}
+
+/* A helper function which makes a defensive copy of the key pcKey, of
+length uLength, for SymTable_T oSymTable, from its arena if it has one
+and from malloc otherwise. If oSymTable borrows its keys, it makes no
+copy and returns pcKey itself. It returns the copy, or NULL if it can't
+allocate memory. It is called by SymTable_putOrGetLen */
+static const char * SymTable_copyKey(SymTable_T oSymTable,
+const char *pcKey, size_t uLength) {
+  char *keyCopy;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  if (oSymTable->borrowed) {
+    assert(oSymTable->interned || pcKey[uLength] == '\0');
+    return pcKey;
+  }
+  if (oSymTable->arena != NULL) {
+    return Arena_copyKey(oSymTable->arena, pcKey, uLength);
+  }
+  keyCopy = (char *) calloc(uLength + 1, sizeof(char));
+  if (keyCopy == NULL) {
+    return NULL;
+  }
+  return memcpy(keyCopy, pcKey, uLength);
+}
+
+/* A helper function which works as SymTable_putOrGet, for a key pcKey
+of length uLength. It is called by SymTable_putOrGet, SymTable_put,
+SymTable_putLen, SymTable_putBatch and SymTable_newFromArray. Full
+nodes are split on the way down, so the leaf that pcKey goes in always
+has room for it. If a split can't allocate its node, the nodes split so
+far stay split, which leaves a valid tree */
+static int SymTable_putOrGetLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, const void *pvValue, void **ppvValue) {
+  struct Position sPosition;
+  struct Node *psNode;
+  struct Node *psRoot;
+  const char *keyCopy;
+  size_t uIndex;
+  size_t u;
+  int iFound;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  sPosition = SymTable_find(oSymTable, pcKey, uLength);
+  if (sPosition.psNode != NULL) {
+    if (ppvValue != NULL) {
+      *ppvValue =
+        (void *) sPosition.psNode->Values[sPosition.uIndex];
+    }
+    return 0;
+  }
+
+  keyCopy = SymTable_copyKey(oSymTable, pcKey, uLength);
+  if (keyCopy == NULL) {
+    return -1;
+  }
+
+  /* A full root gets a new root above it, which is how the tree gets
+  taller */
+  if (oSymTable->psRoot->uCount == MAX_KEYS) {
+    psRoot = SymTable_newNode(oSymTable, 0);
+    if (psRoot != NULL) {
+      SymTable_setChild(psRoot, 0, oSymTable->psRoot);
+      if (SymTable_split(oSymTable, psRoot, 0)) {
+        oSymTable->psRoot = psRoot;
+      }
+      else {
+        oSymTable->psRoot->psParent = NULL;
+        SymTable_freeNode(oSymTable, psRoot);
+        psRoot = NULL;
+      }
+    }
+    if (psRoot == NULL) {
+      goto outOfMemory;
+    }
+  }
+
+  psNode = oSymTable->psRoot;
+  while (! psNode->iLeaf) {
+    uIndex = SymTable_search(oSymTable, psNode, keyCopy, uLength,
+      &iFound);
+    if (psNode->Children[uIndex]->uCount == MAX_KEYS) {
+      if (! SymTable_split(oSymTable, psNode, uIndex)) {
+        goto outOfMemory;
+      }
+      /* pcKey goes on whichever side of the key that came up */
+      if (SymTable_compare(oSymTable, keyCopy, uLength,
+        psNode->Keys[uIndex]) > 0) {
+        uIndex++;
+      }
+    }
+    psNode = psNode->Children[uIndex];
+  }
+
+  uIndex = SymTable_search(oSymTable, psNode, keyCopy, uLength,
+    &iFound);
+  for (u = psNode->uCount; u > uIndex; u--) {
+    psNode->Keys[u] = psNode->Keys[u - 1];
+    psNode->Values[u] = psNode->Values[u - 1];
+  }
+  psNode->Keys[uIndex] = keyCopy;
+  psNode->Values[uIndex] = pvValue;
+  psNode->uCount++;
+  oSymTable->size++;
+
+  if (ppvValue != NULL) {
+    *ppvValue = (void *) pvValue;
+  }
+  return 1;
+
+outOfMemory:
+  /* A copy in the arena stays there until the table is freed */
+  if (oSymTable->arena == NULL && ! oSymTable->borrowed) {
+    free((void *) keyCopy);
+  }
+  return -1;
+}
+
+/* Implements the SymTable_putOrGet() function */
+int SymTable_putOrGet(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue, void **ppvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return SymTable_putOrGetLen(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey), pvValue, ppvValue);
+}
+
+/* Implements the SymTable_put() function */
+int SymTable_put(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return (SymTable_putOrGetLen(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey), pvValue, NULL) == 1);
+}
+
+/* Implements the SymTable_putLen() function */
+int SymTable_putLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength, const void *pvValue) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return (SymTable_putOrGetLen(oSymTable, pcKey, uLength, pvValue,
+    NULL) == 1);
+}
+
+/* Implements the SymTable_putBatch() function. A tree has no hash to
+compute ahead of time, so the keys are just put one after the other */
+size_t SymTable_putBatch(SymTable_T oSymTable,
+const char * const *ppcKeys, const void * const *ppvValues,
+size_t uCount) {
+  size_t uAdded = 0;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL);
+  assert(ppvValues != NULL);
+
+  for (u = 0; u < uCount; u++) {
+    assert(ppcKeys[u] != NULL);
+    if (SymTable_putOrGetLen(oSymTable, ppcKeys[u],
+      SymTable_length(oSymTable, ppcKeys[u]), ppvValues[u],
+      NULL) == 1) {
+      uAdded++;
+    }
+  }
+  return uAdded;
+}
+
+/* The SymTable constructor that takes an array of bindings. One chunk
+of the arena is allocated for every key copy at once, and then the keys
+are put one after the other, as SymTable_putBatch puts them */
+SymTable_T SymTable_newFromArray(const char * const *ppcKeys,
+const void * const *ppvValues, size_t uCount) {
+  SymTable_T oSymTable;
+  size_t uKeyBytes = 0;
+  size_t u;
+  assert(ppcKeys != NULL);
+  assert(ppvValues != NULL);
+
+  oSymTable = SymTable_newWithFlags(SYMTABLE_ARENA);
+  if (oSymTable == NULL) {
+    return NULL;
+  }
+  for (u = 0; u < uCount; u++) {
+    assert(ppcKeys[u] != NULL);
+    uKeyBytes += strlen(ppcKeys[u]) + 1;
+  }
+  if (! Arena_reserve(oSymTable->arena, 0, uKeyBytes)) {
+    SymTable_free(oSymTable);
+    return NULL;
+  }
+  /* A duplicate key is found on the way down, and left out */
+  for (u = 0; u < uCount; u++) {
+    if (SymTable_putOrGetLen(oSymTable, ppcKeys[u],
+      strlen(ppcKeys[u]), ppvValues[u], NULL) < 0) {
+      SymTable_free(oSymTable);
+      return NULL;
+    }
+  }
+  return oSymTable;
+}
+
+/* implements the SymTable_replace() function */
+void * SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue) {
+  struct Position sPosition;
+  const void * oldValue;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  sPosition = SymTable_find(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey));
+  if (sPosition.psNode == NULL) {
+    return NULL;
+  }
+  oldValue = sPosition.psNode->Values[sPosition.uIndex];
+  sPosition.psNode->Values[sPosition.uIndex] = pvValue;
+
+  /* Here we have to "cast away the constness" */
+  return (void *) oldValue;
+}
+
+/* implements the SymTable_contains() function */
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return (SymTable_find(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey)).psNode != NULL);
+}
+
+/* implements the SymTable_get() function */
+void * SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+  return SymTable_getLen(oSymTable, pcKey,
+    SymTable_length(oSymTable, pcKey));
+}
+
+/* implements the SymTable_getLen() function */
+void * SymTable_getLen(SymTable_T oSymTable, const char *pcKey,
+size_t uLength) {
+  struct Position sPosition;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  sPosition = SymTable_find(oSymTable, pcKey, uLength);
+  if (sPosition.psNode == NULL) {
+    return NULL;
+  }
+  return (void *) sPosition.psNode->Values[sPosition.uIndex];
+}
+
+/* implements the SymTable_getBatch() function, which just gets the
+keys one after the other, as SymTable_putBatch puts them */
+void SymTable_getBatch(SymTable_T oSymTable,
+const char * const *ppcKeys, size_t uCount, void **ppvValues) {
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(ppcKeys != NULL);
+  assert(ppvValues != NULL);
+
+  for (u = 0; u < uCount; u++) {
+    assert(ppcKeys[u] != NULL);
+    ppvValues[u] = SymTable_get(oSymTable, ppcKeys[u]);
+  }
+}
+
+/* A helper function which merges the child uIndex + 1 of psNode, an
+internal node of SymTable_T oSymTable, into the child uIndex, with the
+key of psNode between them brought down in the middle. Both children
+must have MIN_KEYS keys. It has no return value, and it can't fail. It
+is called by SymTable_delete */
+static void SymTable_merge(SymTable_T oSymTable, struct Node *psNode,
+size_t uIndex) {
+  struct Node *psLeft;
+  struct Node *psRight;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(psNode != NULL);
+  assert(uIndex < psNode->uCount);
+
+  psLeft = psNode->Children[uIndex];
+  psRight = psNode->Children[uIndex + 1];
+  assert(psLeft->uCount + psRight->uCount < MAX_KEYS);
+
+  psLeft->Keys[psLeft->uCount] = psNode->Keys[uIndex];
+  psLeft->Values[psLeft->uCount] = psNode->Values[uIndex];
+  for (u = 0; u < psRight->uCount; u++) {
+    psLeft->Keys[psLeft->uCount + 1 + u] = psRight->Keys[u];
+    psLeft->Values[psLeft->uCount + 1 + u] = psRight->Values[u];
+  }
+  if (! psLeft->iLeaf) {
+    for (u = 0; u <= psRight->uCount; u++) {
+      SymTable_setChild(psLeft, psLeft->uCount + 1 + u,
+        psRight->Children[u]);
+    }
+  }
+  psLeft->uCount += psRight->uCount + 1;
+
+  for (u = uIndex; u + 1 < psNode->uCount; u++) {
+    psNode->Keys[u] = psNode->Keys[u + 1];
+    psNode->Values[u] = psNode->Values[u + 1];
+    psNode->Children[u + 1] = psNode->Children[u + 2];
+  }
+  psNode->uCount--;
+  SymTable_freeNode(oSymTable, psRight);
+}
+
+/* A helper function which makes sure that the child uIndex of psNode,
+an internal node of SymTable_T oSymTable, has more than MIN_KEYS keys,
+so that one can be deleted from it. It borrows a key through psNode
+from a sibling that can spare one, and otherwise merges the child with
+a sibling. It returns the child to go down to, which is a different
+node if the child was merged into its left sibling. It is called by
+SymTable_delete */
+static struct Node * SymTable_fill(SymTable_T oSymTable,
+struct Node *psNode, size_t uIndex) {
+  struct Node *psChild;
+  struct Node *psSibling;
+  size_t u;
+  assert(oSymTable != NULL);
+  assert(psNode != NULL);
+
+  psChild = psNode->Children[uIndex];
+  if (psChild->uCount > MIN_KEYS) {
+    return psChild;
+  }
+
+  /* The last key of the left sibling goes up, and the key of psNode
+  comes down to the front of psChild */
+  if (uIndex > 0 && psNode->Children[uIndex - 1]->uCount > MIN_KEYS) {
+    psSibling = psNode->Children[uIndex - 1];
+    for (u = psChild->uCount; u > 0; u--) {
+      psChild->Keys[u] = psChild->Keys[u - 1];
+      psChild->Values[u] = psChild->Values[u - 1];
+    }
+    if (! psChild->iLeaf) {
+      for (u = psChild->uCount + 1; u > 0; u--) {
+        psChild->Children[u] = psChild->Children[u - 1];
+      }
+      SymTable_setChild(psChild, 0,
+        psSibling->Children[psSibling->uCount]);
+    }
+    psChild->Keys[0] = psNode->Keys[uIndex - 1];
+    psChild->Values[0] = psNode->Values[uIndex - 1];
+    psChild->uCount++;
+    psNode->Keys[uIndex - 1] = psSibling->Keys[psSibling->uCount - 1];
+    psNode->Values[uIndex - 1] =
+      psSibling->Values[psSibling->uCount - 1];
+    psSibling->uCount--;
+    return psChild;
+  }
+
+  /* The first key of the right sibling goes up, and the key of psNode
+  comes down to the end of psChild */
+  if (uIndex < psNode->uCount &&
+    psNode->Children[uIndex + 1]->uCount > MIN_KEYS) {
+    psSibling = psNode->Children[uIndex + 1];
+    psChild->Keys[psChild->uCount] = psNode->Keys[uIndex];
+    psChild->Values[psChild->uCount] = psNode->Values[uIndex];
+    if (! psChild->iLeaf) {
+      SymTable_setChild(psChild, psChild->uCount + 1,
+        psSibling->Children[0]);
+    }
+    psChild->uCount++;
+    psNode->Keys[uIndex] = psSibling->Keys[0];
+    psNode->Values[uIndex] = psSibling->Values[0];
+    for (u = 0; u + 1 < psSibling->uCount; u++) {
+      psSibling->Keys[u] = psSibling->Keys[u + 1];
+      psSibling->Values[u] = psSibling->Values[u + 1];
+    }
+    if (! psSibling->iLeaf) {
+      for (u = 0; u < psSibling->uCount; u++) {
+        psSibling->Children[u] = psSibling->Children[u + 1];
+      }
+    }
+    psSibling->uCount--;
+    return psChild;
+  }
+
+  /* Neither sibling can spare a key, so psChild is merged with one */
+  if (uIndex < psNode->uCount) {
+    SymTable_merge(oSymTable, psNode, uIndex);
+    return psChild;
+  }
+  SymTable_merge(oSymTable, psNode, uIndex - 1);
+  return psNode->Children[uIndex - 1];
+}
+
+/* A helper function which deletes the binding of the key pcKey, of
+length uLength, from the subtree of SymTable_T oSymTable that psNode is
+the root of, and stores the key and the value of the binding in
+*ppcKey and *ppvValue. psNode must be the root or have more than
+MIN_KEYS keys, and every node it goes down to is made so first, so
+that a key can always be taken out of the leaf it ends at. It returns 1
+if it found pcKey, and 0 otherwise. It is called by SymTable_remove */
+static int SymTable_delete(SymTable_T oSymTable, struct Node *psNode,
+const char *pcKey, size_t uLength, const char **ppcKey,
+const void **ppvValue) {
+  struct Node *psLeft;
+  struct Node *psRight;
+  const char *pcMoved;
+  const void *pvMoved;
+  size_t uIndex;
+  size_t u;
+  int iFound;
+  assert(oSymTable != NULL);
+  assert(psNode != NULL);
+  assert(ppcKey != NULL);
+  assert(ppvValue != NULL);
+
+  for (;;) {
+    uIndex = SymTable_search(oSymTable, psNode, pcKey, uLength,
+      &iFound);
+
+    /* A leaf just closes up the gap */
+    if (psNode->iLeaf) {
+      if (! iFound) {
+        return 0;
+      }
+      *ppcKey = psNode->Keys[uIndex];
+      *ppvValue = psNode->Values[uIndex];
+      for (u = uIndex; u + 1 < psNode->uCount; u++) {
+        psNode->Keys[u] = psNode->Keys[u + 1];
+        psNode->Values[u] = psNode->Values[u + 1];
+      }
+      psNode->uCount--;
+      return 1;
+    }
+
+    if (! iFound) {
+      psNode = SymTable_fill(oSymTable, psNode, uIndex);
+      continue;
+    }
+
+    /* An internal key is replaced by the binding just before or just
+    after it, whichever child can spare one, and that one is deleted
+    from the child instead */
+    psLeft = psNode->Children[uIndex];
+    psRight = psNode->Children[uIndex + 1];
+    if (psLeft->uCount <= MIN_KEYS && psRight->uCount <= MIN_KEYS) {
+      SymTable_merge(oSymTable, psNode, uIndex);
+      psNode = psLeft;
+      continue;
+    }
+    *ppcKey = psNode->Keys[uIndex];
+    *ppvValue = psNode->Values[uIndex];
+    if (psLeft->uCount > MIN_KEYS) {
+      for (psNode = psLeft; ! psNode->iLeaf;
+        psNode = psNode->Children[psNode->uCount]) {
+      }
+      pcMoved = psNode->Keys[psNode->uCount - 1];
+      pvMoved = psNode->Values[psNode->uCount - 1];
+      psNode = psLeft;
+    }
+    else {
+      for (psNode = psRight; ! psNode->iLeaf;
+        psNode = psNode->Children[0]) {
+      }
+      pcMoved = psNode->Keys[0];
+      pvMoved = psNode->Values[0];
+      psNode = psRight;
+    }
+    psLeft = psNode->psParent;
+    psLeft->Keys[uIndex] = pcMoved;
+    psLeft->Values[uIndex] = pvMoved;
+    /* The moved binding is still in the child, where it comes first or
+    last, and has to be taken out of it without being freed */
+    {
+      const char *pcIgnored;
+      const void *pvIgnored;
+      iFound = SymTable_delete(oSymTable, psNode, pcMoved,
+        SymTable_length(oSymTable, pcMoved), &pcIgnored, &pvIgnored);
+      assert(iFound);
+    }
+    return 1;
+  }
+}
+
+/* implements the SymTable_remove() function */
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+  struct Node *psRoot;
+  const char *pcRemoved;
+  const void *pvRemoved;
+  assert(oSymTable != NULL);
+  assert(pcKey != NULL);
+
+  if (! SymTable_delete(oSymTable, oSymTable->psRoot, pcKey,
+    SymTable_length(oSymTable, pcKey), &pcRemoved, &pvRemoved)) {
+    pvRemoved = NULL;
+  }
+  else {
+    /* Since we created a defensive copy of the key, we have to free
+    that too, unless it is in the arena or was borrowed */
+    if (oSymTable->arena == NULL && ! oSymTable->borrowed) {
+      free((void *) pcRemoved);
+    }
+    oSymTable->size--;
+  }
+
+  /* A merge may have emptied the root, which is how the tree gets
+  shorter. That can happen on the way to a key that isn't there */
+  psRoot = oSymTable->psRoot;
+  if (psRoot->uCount == 0 && ! psRoot->iLeaf) {
+    oSymTable->psRoot = psRoot->Children[0];
+    oSymTable->psRoot->psParent = NULL;
+    SymTable_freeNode(oSymTable, psRoot);
+  }
+
+  /* Here we have to "cast away the constness" */
+  return (void *) pvRemoved;
+}
+
+/* implements the SymTable_compact() function. Every node but the root
+is at least half full whatever has been removed, so there is nothing to
+shrink */
+void SymTable_compact(SymTable_T oSymTable) {
+  assert(oSymTable != NULL);
+  (void) oSymTable;
+}
+
+/* implements the SymTable_freeze() function. A tree has no
+frozen form, so oSymTable is left as it is */
+int SymTable_freeze(SymTable_T oSymTable) {
+  assert(oSymTable != NULL);
+  (void) oSymTable;
+  return 0;
+}
+
+/* A helper function which returns the position of the first binding
+of the subtree that psNode is the root of, or the end if it is empty */
+static struct Position SymTable_first(struct Node *psNode) {
+  struct Position sPosition;
+  assert(psNode != NULL);
+
+  while (! psNode->iLeaf) {
+    psNode = psNode->Children[0];
+  }
+  sPosition.psNode = (psNode->uCount == 0) ? NULL : psNode;
+  sPosition.uIndex = 0;
+  return sPosition;
+}
+
+/* A helper function which returns the position of the binding right
+after sPosition, in the order of the keys, or the end. It climbs
+through psParent rather than keeping a stack, so walking a whole tree
+this way still visits every node a bounded number of times */
+static struct Position SymTable_successor(struct Position sPosition) {
+  struct Node *psNode;
+  struct Node *psParent;
+  size_t u;
+  assert(sPosition.psNode != NULL);
+
+  psNode = sPosition.psNode;
+  if (! psNode->iLeaf) {
+    return SymTable_first(psNode->Children[sPosition.uIndex + 1]);
+  }
+  if (sPosition.uIndex + 1 < psNode->uCount) {
+    sPosition.uIndex++;
+    return sPosition;
+  }
+
+  /* The next key is in the first ancestor that we climb to from a
+  child other than its last */
+  for (psParent = psNode->psParent; psParent != NULL;
+    psNode = psParent, psParent = psNode->psParent) {
+    for (u = 0; psParent->Children[u] != psNode; u++) {
+    }
+    if (u < psParent->uCount) {
+      sPosition.psNode = psParent;
+      sPosition.uIndex = u;
+      return sPosition;
+    }
+  }
+  sPosition.psNode = NULL;
+  return sPosition;
+}
+
+/* A helper function which returns the position of the first binding
+of SymTable_T oSymTable whose key doesn't come before pcLow, in the
+order of strcmp, or the end if there is none. It goes down from the
+root once, keeping the last key found that would do */
+static struct Position SymTable_seek(SymTable_T oSymTable,
+const char *pcLow) {
+  struct Position sPosition;
+  struct Position sBest;
+  size_t uLow;
+  size_t uHigh;
+  size_t uMiddle;
+  assert(oSymTable != NULL);
+  assert(pcLow != NULL);
+
+  sBest.psNode = NULL;
+  sBest.uIndex = 0;
+  sPosition.psNode = oSymTable->psRoot;
+  for (;;) {
+    uLow = 0;
+    uHigh = sPosition.psNode->uCount;
+    while (uLow < uHigh) {
+      uMiddle = uLow + (uHigh - uLow) / 2;
+      if (strcmp(sPosition.psNode->Keys[uMiddle], pcLow) < 0) {
+        uLow = uMiddle + 1;
+      }
+      else {
+        uHigh = uMiddle;
+      }
+    }
+    if (uLow < sPosition.psNode->uCount) {
+      sBest.psNode = sPosition.psNode;
+      sBest.uIndex = uLow;
+    }
+    if (sPosition.psNode->iLeaf) {
+      return sBest;
+    }
+    sPosition.psNode = sPosition.psNode->Children[uLow];
+  }
+}
+
+/* implements the SymTable_map() function. The bindings are visited in
+the order of their keys */
+void SymTable_map(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  struct Position sPosition;
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  for (sPosition = SymTable_first(oSymTable->psRoot);
+    sPosition.psNode != NULL;
+    sPosition = SymTable_successor(sPosition)) {
+    pfApply(sPosition.psNode->Keys[sPosition.uIndex],
+      (void *) sPosition.psNode->Values[sPosition.uIndex],
+      (void *) pvExtra);
+  }
+}
+
+/* implements the SymTable_mapRange() function. It seeks to pcLow in
+O(log n) time and walks from there, so it takes O(log n + k) time to
+visit k bindings */
+void SymTable_mapRange(SymTable_T oSymTable, const char *pcLow,
+const char *pcHigh,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  struct Position sPosition;
+  const char *pcKey;
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+
+  sPosition = (pcLow == NULL) ? SymTable_first(oSymTable->psRoot) :
+    SymTable_seek(oSymTable, pcLow);
+  for (; sPosition.psNode != NULL;
+    sPosition = SymTable_successor(sPosition)) {
+    pcKey = sPosition.psNode->Keys[sPosition.uIndex];
+    if (pcHigh != NULL && strcmp(pcKey, pcHigh) >= 0) {
+      return;
+    }
+    pfApply(pcKey, (void *) sPosition.psNode->Values[sPosition.uIndex],
+      (void *) pvExtra);
+  }
+}
+
+/* implements the SymTable_mapPrefix() function. The keys that start
+with pcPrefix are all together, from the first one that doesn't come
+before pcPrefix itself */
+void SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+  struct Position sPosition;
+  const char *pcKey;
+  size_t uPrefixLength;
+  assert(oSymTable != NULL);
+  assert(pcPrefix != NULL);
+  assert(pfApply != NULL);
+
+  uPrefixLength = strlen(pcPrefix);
+  for (sPosition = SymTable_seek(oSymTable, pcPrefix);
+    sPosition.psNode != NULL;
+    sPosition = SymTable_successor(sPosition)) {
+    pcKey = sPosition.psNode->Keys[sPosition.uIndex];
+    if (strncmp(pcKey, pcPrefix, uPrefixLength) != 0) {
+      return;
+    }
+    pfApply(pcKey, (void *) sPosition.psNode->Values[sPosition.uIndex],
+      (void *) pvExtra);
+  }
+}
+
+/* implements the SymTable_mapParallel() function. The bindings are
+walked in order, which one thread does, with the first extra */
+void SymTable_mapParallel(SymTable_T oSymTable,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+void * const *ppvExtras, size_t uThreads) {
+  assert(oSymTable != NULL);
+  assert(pfApply != NULL);
+  assert(uThreads > 0);
+  (void) uThreads;
+  SymTable_map(oSymTable, pfApply,
+    ppvExtras == NULL ? NULL : ppvExtras[0]);
+}
+
+/* implements the SymTable_begin() function */
+void SymTable_begin(SymTable_T oSymTable, SymTable_Iter *psIter) {
+  assert(oSymTable != NULL);
+  assert(psIter != NULL);
+  psIter->oSymTable = oSymTable;
+  psIter->uPosition = 0;
+  psIter->pvCurrent = NULL;
+  psIter->pcKey = NULL;
+  psIter->pvValue = NULL;
+}
+
+/* implements the SymTable_next() function. pvCurrent and uPosition
+are the node and the index of the binding last moved to; once the end
+is reached, pvCurrent is NULL and uPosition is 1 */
+int SymTable_next(SymTable_Iter *psIter) {
+  struct Position sPosition;
+  assert(psIter != NULL);
+  assert(psIter->oSymTable != NULL);
+
+  if (psIter->pvCurrent != NULL) {
+    sPosition.psNode = (struct Node *) psIter->pvCurrent;
+    sPosition.uIndex = psIter->uPosition;
+    sPosition = SymTable_successor(sPosition);
+  }
+  else if (psIter->uPosition == 0) {
+    sPosition = SymTable_first(psIter->oSymTable->psRoot);
+  }
+  else {
+    sPosition.psNode = NULL;
+  }
+
+  psIter->pvCurrent = sPosition.psNode;
+  if (sPosition.psNode == NULL) {
+    psIter->uPosition = 1;
+    psIter->pcKey = NULL;
+    psIter->pvValue = NULL;
+    return 0;
+  }
+  psIter->uPosition = sPosition.uIndex;
+  psIter->pcKey = sPosition.psNode->Keys[sPosition.uIndex];
+  psIter->pvValue = (void *) sPosition.psNode->Values[sPosition.uIndex];
+  return 1;
+}
+
+/* implements the SymTable_iterKey() function */
+const char *SymTable_iterKey(const SymTable_Iter *psIter) {
+  assert(psIter != NULL);
+  assert(psIter->pcKey != NULL);
+  return psIter->pcKey;
+}
+
+/* implements the SymTable_iterValue() function */
+void *SymTable_iterValue(const SymTable_Iter *psIter) {
+  assert(psIter != NULL);
+  assert(psIter->pcKey != NULL);
+  return psIter->pvValue;
+}
+
+/* implements the SymTable_getStats() function. A tree keeps no
+statistics, so every one of them is 0, and it returns 0 (FALSE) */
+int SymTable_getStats(SymTable_T oSymTable, SymTable_Stats *psStats) {
+  assert(oSymTable != NULL);
+  assert(psStats != NULL);
+  (void) oSymTable;
+  psStats->uHits = 0;
+  psStats->uMisses = 0;
+  psStats->uProbes = 0;
+  psStats->uExpansions = 0;
+  psStats->dExpandSeconds = 0.0;
+  psStats->uMaxMigrate = 0;
+  psStats->uMaxChain = 0;
+  psStats->dMeanChain = 0.0;
+  psStats->uBindingBytes = 0;
+  psStats->uKeyBytes = 0;
+  return 0;
+}
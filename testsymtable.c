@@ -4,6 +4,11 @@
 /*--------------------------------------------------------------------*/
 
 #include "symtable.h"
+#include "hashfn.h"
+#include "intern.h"
+#include "scope.h"
+#include "snapshot.h"
+#include "symtablegeneric.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -383,6 +388,68 @@ static void testRemove(void)
 
 /*--------------------------------------------------------------------*/
 
+/* Test the SymTable_putOrGet() function. */
+
+static void testPutOrGet(void)
+{
+   SymTable_T oSymTable;
+   char acJeter[] = "Jeter";
+   char acMantle[] = "Mantle";
+   char acShortstop[] = "Shortstop";
+   char acCenterField[] = "Center Field";
+   char *pcValue;
+   int iStatus;
+   size_t uLength;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the SymTable_putOrGet() function.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* A new key is added, and its own value is reported. */
+   pcValue = NULL;
+   iStatus = SymTable_putOrGet(oSymTable, acJeter, acShortstop,
+      (void**)&pcValue);
+   ASSURE(iStatus == 1);
+   ASSURE(pcValue == acShortstop);
+
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == 1);
+
+   /* An existing key is left alone, and its old value is reported. */
+   pcValue = NULL;
+   iStatus = SymTable_putOrGet(oSymTable, acJeter, acCenterField,
+      (void**)&pcValue);
+   ASSURE(iStatus == 0);
+   ASSURE(pcValue == acShortstop);
+
+   pcValue = (char*)SymTable_get(oSymTable, acJeter);
+   ASSURE(pcValue == acShortstop);
+
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == 1);
+
+   /* The value pointer is optional, and NULL values are reported. */
+   iStatus = SymTable_putOrGet(oSymTable, acMantle, NULL, NULL);
+   ASSURE(iStatus == 1);
+
+   pcValue = acCenterField;
+   iStatus = SymTable_putOrGet(oSymTable, acMantle, acCenterField,
+      (void**)&pcValue);
+   ASSURE(iStatus == 0);
+   ASSURE(pcValue == NULL);
+
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == 2);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
 /* Test the SymTable_map() function. */
 
 static void testMap(void)
@@ -776,6 +843,2186 @@ static void testCollisions(void)
 
 /*--------------------------------------------------------------------*/
 
+/* Increment the count of bindings that pvExtra points to.  pcKey and
+   pvValue are unused. */
+
+static void countBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+   (void)pvValue;
+
+   (*(size_t*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTable object created with uFlags, whose name is pcFlags,
+   with keys of every length from 0 to MAX_LENGTH, so that both the
+   keys short enough to be kept inside their binding and those that
+   are copied elsewhere are put, found, moved, and removed. */
+
+static void testKeyLengths(unsigned int uFlags, const char *pcFlags)
+{
+   enum {MAX_LENGTH = 40, ROUNDS = 3};
+
+   SymTable_T oSymTable;
+   static char aacKeys[MAX_LENGTH + 1][MAX_LENGTH + 1];
+   char acKey[MAX_LENGTH + 2];
+   size_t uCount = 0;
+   int iSuccessful;
+   int iRound;
+   int i;
+
+   assert(pcFlags != NULL);
+
+   printf("------------------------------------------------------\n");
+   printf("Testing keys of every length with %s.\n", pcFlags);
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newWithFlags(uFlags);
+   ASSURE(oSymTable != NULL);
+
+   for (i = 0; i <= MAX_LENGTH; i++)
+   {
+      memset(aacKeys[i], 'a' + i % 26, (size_t)i);
+      aacKeys[i][i] = '\0';
+      iSuccessful = SymTable_put(oSymTable, aacKeys[i], &aacKeys[i]);
+      ASSURE(iSuccessful);
+   }
+
+   /* Looking the keys up out of order makes a self-organizing table
+      move them, and a copy of each key must give the same answer. */
+   for (iRound = 0; iRound < ROUNDS; iRound++)
+      for (i = MAX_LENGTH; i >= 0; i--)
+      {
+         strcpy(acKey, aacKeys[i]);
+         ASSURE(SymTable_get(oSymTable, acKey) == &aacKeys[i]);
+         acKey[i] = 'z';
+         acKey[i + 1] = '\0';
+         ASSURE(! SymTable_contains(oSymTable, acKey));
+      }
+
+   SymTable_map(oSymTable, countBinding, &uCount);
+   ASSURE(uCount == (size_t)(MAX_LENGTH + 1));
+
+   for (i = 0; i <= MAX_LENGTH; i += 2)
+      ASSURE(SymTable_remove(oSymTable, aacKeys[i]) == &aacKeys[i]);
+   for (i = 0; i <= MAX_LENGTH; i++)
+      ASSURE(SymTable_contains(oSymTable, aacKeys[i]) == (i % 2 == 1));
+
+   SymTable_free(oSymTable);
+}
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTable object created with flags uFlags, whose name is
+   pcFlags, through enough bindings to expand a hash table, checking
+   every binding while any expansion may still be under way.  Also
+   test the reuse of removed bindings, and keys that are longer than a
+   chunk of an arena. */
+
+static void testFlags(unsigned int uFlags, const char *pcFlags)
+{
+   enum {BINDING_COUNT = 1000, LONG_KEY_SIZE = 5000};
+
+   SymTable_T oSymTable;
+   char acKey[LONG_KEY_SIZE];
+   char acShortstop[] = "Shortstop";
+   char *pcValue;
+   int i;
+   int iSuccessful;
+   size_t uLength;
+   size_t uCount;
+   int j;
+
+   assert(pcFlags != NULL);
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object created with %s.\n", pcFlags);
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newWithFlags(uFlags);
+   ASSURE(oSymTable != NULL);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acShortstop);
+      ASSURE(iSuccessful);
+      /* Make sure no binding is lost or duplicated mid-expansion. */
+      if (i % 64 == 0)
+      {
+         uCount = 0;
+         SymTable_map(oSymTable, countBinding, &uCount);
+         ASSURE(uCount == (size_t)(i + 1));
+         for (j = 0; j <= i; j++)
+         {
+            sprintf(acKey, "%d", j);
+            ASSURE(SymTable_get(oSymTable, acKey) == acShortstop);
+         }
+      }
+   }
+
+   /* Remove the even keys, and put them back under new names. */
+   for (i = 0; i < BINDING_COUNT; i += 2)
+   {
+      sprintf(acKey, "%d", i);
+      pcValue = (char*)SymTable_remove(oSymTable, acKey);
+      ASSURE(pcValue == acShortstop);
+   }
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == BINDING_COUNT / 2);
+
+   for (i = 0; i < BINDING_COUNT; i += 2)
+   {
+      sprintf(acKey, "x%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acKey);
+      ASSURE(iSuccessful);
+   }
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, (i % 2 == 0) ? "x%d" : "%d", i);
+      pcValue = (char*)SymTable_get(oSymTable, acKey);
+      ASSURE(pcValue == ((i % 2 == 0) ? acKey : acShortstop));
+      sprintf(acKey, (i % 2 == 0) ? "%d" : "x%d", i);
+      ASSURE(! SymTable_contains(oSymTable, acKey));
+   }
+
+   /* A key longer than any chunk. */
+   memset(acKey, 'k', LONG_KEY_SIZE - 1);
+   acKey[LONG_KEY_SIZE - 1] = '\0';
+   iSuccessful = SymTable_put(oSymTable, acKey, acShortstop);
+   ASSURE(iSuccessful);
+   pcValue = (char*)SymTable_get(oSymTable, acKey);
+   ASSURE(pcValue == acShortstop);
+
+   uCount = 0;
+   SymTable_map(oSymTable, countBinding, &uCount);
+   ASSURE(uCount == BINDING_COUNT + 1);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the same hash code for every key, so that all keys collide.
+   pcKey and uLength are unused. */
+
+static size_t constantHash(const char *pcKey, size_t uLength)
+{
+   assert(pcKey != NULL);
+   (void)uLength;
+
+   return 42;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTable object created with the hash function pfHash, whose
+   name is pcHash, and the SymTable_putLen and SymTable_getLen
+   functions, whose keys need not end with '\0'. */
+
+static void testHash(SymTable_HashFn pfHash, const char *pcHash)
+{
+   enum {BINDING_COUNT = 1000};
+
+   SymTable_T oSymTable;
+   char acKey[] = "JeterMantle";
+   char acBuffer[32];
+   char acShortstop[] = "Shortstop";
+   char acCenterField[] = "Center Field";
+   char *pcValue;
+   int i;
+   int iSuccessful;
+   size_t uLength;
+   size_t uCount;
+
+   assert(pcHash != NULL);
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object created with %s.\n", pcHash);
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newWithHash(pfHash, 0);
+   ASSURE(oSymTable != NULL);
+
+   /* "Jeter" is a prefix of acKey, not a string of its own. */
+   iSuccessful = SymTable_putLen(oSymTable, acKey, 5, acShortstop);
+   ASSURE(iSuccessful);
+
+   ASSURE(SymTable_contains(oSymTable, "Jeter"));
+   ASSURE(! SymTable_contains(oSymTable, "JeterMantle"));
+   ASSURE(! SymTable_contains(oSymTable, "Jete"));
+   ASSURE(SymTable_getLen(oSymTable, acKey, 4) == NULL);
+   ASSURE(SymTable_getLen(oSymTable, acKey, 6) == NULL);
+
+   pcValue = (char*)SymTable_getLen(oSymTable, acKey, 5);
+   ASSURE(pcValue == acShortstop);
+
+   iSuccessful = SymTable_putLen(oSymTable, acKey, 5, acCenterField);
+   ASSURE(! iSuccessful);
+
+   iSuccessful = SymTable_putLen(oSymTable, acKey, 11, acCenterField);
+   ASSURE(iSuccessful);
+
+   iSuccessful = SymTable_putLen(oSymTable, acKey, 0, acCenterField);
+   ASSURE(iSuccessful);
+
+   pcValue = (char*)SymTable_get(oSymTable, "JeterMantle");
+   ASSURE(pcValue == acCenterField);
+
+   pcValue = (char*)SymTable_get(oSymTable, "");
+   ASSURE(pcValue == acCenterField);
+
+   /* The table must have copied "Jeter" with its own '\0'. */
+   pcValue = (char*)SymTable_remove(oSymTable, "Jeter");
+   ASSURE(pcValue == acShortstop);
+   ASSURE(SymTable_get(oSymTable, "JeterMantle") == acCenterField);
+
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == 2);
+
+   /* Enough bindings to expand a hash table, with keys that are read
+      out of a longer buffer. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acBuffer, "%dxyz", i);
+      iSuccessful = SymTable_putLen(oSymTable, acBuffer,
+         strlen(acBuffer) - 3, acShortstop);
+      ASSURE(iSuccessful);
+   }
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acBuffer, "%d", i);
+      pcValue = (char*)SymTable_get(oSymTable, acBuffer);
+      ASSURE(pcValue == acShortstop);
+      strcat(acBuffer, "x");
+      ASSURE(SymTable_getLen(oSymTable, acBuffer, strlen(acBuffer) - 1)
+         == acShortstop);
+      ASSURE(! SymTable_contains(oSymTable, acBuffer));
+   }
+
+   for (i = 0; i < BINDING_COUNT; i += 2)
+   {
+      sprintf(acBuffer, "%d", i);
+      pcValue = (char*)SymTable_remove(oSymTable, acBuffer);
+      ASSURE(pcValue == acShortstop);
+   }
+
+   uCount = 0;
+   SymTable_map(oSymTable, countBinding, &uCount);
+   ASSURE(uCount == BINDING_COUNT / 2 + 2);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable objects created with SymTable_newWithCapacity, with
+   fewer, as many and more bindings than their capacity hints. */
+
+static void testCapacity(void)
+{
+   enum {HINT_COUNT = 5, KEY_SIZE = 16};
+   static const size_t auHints[HINT_COUNT] = {0, 1, 8, 100, 3000};
+
+   SymTable_T oSymTable;
+   char acKey[KEY_SIZE];
+   char acShortstop[] = "Shortstop";
+   int iSuccessful;
+   size_t uLength;
+   size_t uCount;
+   size_t uHint;
+   size_t u;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the SymTable_newWithCapacity() function.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   for (u = 0; u < HINT_COUNT; u++)
+   {
+      uHint = auHints[u];
+      oSymTable = SymTable_newWithCapacity(uHint);
+      ASSURE(oSymTable != NULL);
+      uLength = SymTable_getLength(oSymTable);
+      ASSURE(uLength == 0);
+      ASSURE(SymTable_get(oSymTable, "Jeter") == NULL);
+
+      /* Go past the hint, which must not stop the object growing. */
+      for (i = 0; (size_t)i < uHint * 2 + 10; i++)
+      {
+         sprintf(acKey, "%d", i);
+         iSuccessful = SymTable_put(oSymTable, acKey, acShortstop);
+         ASSURE(iSuccessful);
+      }
+      for (i = 0; (size_t)i < uHint * 2 + 10; i++)
+      {
+         sprintf(acKey, "%d", i);
+         ASSURE(SymTable_get(oSymTable, acKey) == acShortstop);
+      }
+      uLength = SymTable_getLength(oSymTable);
+      ASSURE(uLength == uHint * 2 + 10);
+      uCount = 0;
+      SymTable_map(oSymTable, countBinding, &uCount);
+      ASSURE(uCount == uLength);
+
+      SymTable_free(oSymTable);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable_putBatch and SymTable_getBatch functions, with
+   batches large enough to expand a hash table partway through. */
+
+static void testBatch(void)
+{
+   enum {BATCH_SIZE = 1000, KEY_SIZE = 16};
+
+   SymTable_T oSymTable;
+   static char aacKeys[BATCH_SIZE][KEY_SIZE];
+   const char *apcKeys[BATCH_SIZE];
+   const void *apvValues[BATCH_SIZE];
+   void *apvFound[BATCH_SIZE];
+   char acShortstop[] = "Shortstop";
+   char acCatcher[] = "Catcher";
+   size_t uAdded;
+   size_t uLength;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the SymTable_putBatch and SymTable_getBatch\n");
+   printf("functions.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* Put the even keys first, so that the second batch is half new. */
+   for (i = 0; i < BATCH_SIZE; i++)
+   {
+      sprintf(aacKeys[i], "%d", i * 2);
+      apcKeys[i] = aacKeys[i];
+      apvValues[i] = acShortstop;
+   }
+   uAdded = SymTable_putBatch(oSymTable, apcKeys, apvValues,
+      BATCH_SIZE);
+   ASSURE(uAdded == BATCH_SIZE);
+
+   for (i = 0; i < BATCH_SIZE; i++)
+   {
+      sprintf(aacKeys[i], "%d", i);
+      apvValues[i] = acCatcher;
+   }
+   uAdded = SymTable_putBatch(oSymTable, apcKeys, apvValues,
+      BATCH_SIZE);
+   ASSURE(uAdded == BATCH_SIZE / 2);
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == BATCH_SIZE + BATCH_SIZE / 2);
+
+   /* Every key of the batch is a hit. */
+   SymTable_getBatch(oSymTable, apcKeys, BATCH_SIZE, apvFound);
+   for (i = 0; i < BATCH_SIZE; i++)
+   {
+      ASSURE(apvFound[i] == ((i % 2 == 0) ? acShortstop : acCatcher));
+      ASSURE(apvFound[i] == SymTable_get(oSymTable, apcKeys[i]));
+   }
+
+   /* Half of the keys of this batch are misses. */
+   for (i = 0; i < BATCH_SIZE; i++)
+   {
+      sprintf(aacKeys[i], "%d", (i % 2 == 0) ? i : i + 2 * BATCH_SIZE);
+   }
+   SymTable_getBatch(oSymTable, apcKeys, BATCH_SIZE, apvFound);
+   for (i = 0; i < BATCH_SIZE; i++)
+   {
+      ASSURE(apvFound[i] == ((i % 2 == 0) ? acShortstop : NULL));
+   }
+
+   /* A key that comes up twice in a batch is added once. */
+   apcKeys[0] = "Ruth";
+   apcKeys[1] = "Gehrig";
+   apcKeys[2] = "Ruth";
+   uAdded = SymTable_putBatch(oSymTable, apcKeys, apvValues, 3);
+   ASSURE(uAdded == 2);
+
+   /* An empty batch does nothing. */
+   uAdded = SymTable_putBatch(oSymTable, apcKeys, apvValues, 0);
+   ASSURE(uAdded == 0);
+   SymTable_getBatch(oSymTable, apcKeys, 0, apvFound);
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == BATCH_SIZE + BATCH_SIZE / 2 + 2);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable objects created with SymTable_newFromArray, from
+   arrays with short and long keys, some of which come up twice, and
+   from an empty array. */
+
+static void testNewFromArray(void)
+{
+   enum {LOAD_SIZE = 3000, KEY_SIZE = 32, DUPLICATE_EVERY = 10};
+
+   SymTable_T oSymTable;
+   static char aacKeys[LOAD_SIZE][KEY_SIZE];
+   static const char *apcKeys[LOAD_SIZE];
+   static const void *apvValues[LOAD_SIZE];
+   size_t uDuplicates = 0;
+   size_t uLength;
+   size_t uCount;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the SymTable_newFromArray() function.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* Every third key is too long to be kept inside a binding, and
+      every DUPLICATE_EVERY-th one repeats a key that came before it,
+      with a value of its own. */
+   for (i = 0; i < LOAD_SIZE; i++)
+   {
+      if (i % DUPLICATE_EVERY == DUPLICATE_EVERY - 1)
+      {
+         apcKeys[i] = apcKeys[i - 5];
+         uDuplicates++;
+      }
+      else
+      {
+         sprintf(aacKeys[i], (i % 3 == 0) ? "%024d" : "%d", i);
+         apcKeys[i] = aacKeys[i];
+      }
+      apvValues[i] = &aacKeys[i];
+   }
+
+   oSymTable = SymTable_newFromArray(apcKeys, apvValues, LOAD_SIZE);
+   ASSURE(oSymTable != NULL);
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == LOAD_SIZE - uDuplicates);
+
+   /* A key that came up twice is bound to its first value. */
+   for (i = 0; i < LOAD_SIZE; i++)
+   {
+      if (i % DUPLICATE_EVERY == DUPLICATE_EVERY - 1)
+         ASSURE(SymTable_get(oSymTable, apcKeys[i]) == &aacKeys[i - 5]);
+      else
+         ASSURE(SymTable_get(oSymTable, apcKeys[i]) == &aacKeys[i]);
+   }
+   uCount = 0;
+   SymTable_map(oSymTable, countBinding, &uCount);
+   ASSURE(uCount == uLength);
+
+   /* The object can still be changed like any other. */
+   for (i = 0; i < LOAD_SIZE; i += 2)
+      ASSURE(SymTable_remove(oSymTable, apcKeys[i]) == &aacKeys[i]);
+   iSuccessful = SymTable_put(oSymTable, "Ruth", "Right Field");
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_get(oSymTable, "Ruth") != NULL);
+   ASSURE(SymTable_contains(oSymTable, apcKeys[1]));
+   ASSURE(! SymTable_contains(oSymTable, apcKeys[0]));
+   SymTable_free(oSymTable);
+
+   /* An empty array makes an empty object. */
+   oSymTable = SymTable_newFromArray(apcKeys, apvValues, 0);
+   ASSURE(oSymTable != NULL);
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == 0);
+   iSuccessful = SymTable_put(oSymTable, "Gehrig", "First Base");
+   ASSURE(iSuccessful);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* A player of a table generated by SYMTABLE_DEFINE, which stores it
+   by value rather than through a pointer. */
+
+struct Player
+{
+   char acPosition[16];
+   int iNumber;
+};
+
+/* Return a hash code for the uniform number i. */
+
+static size_t hashNumber(int i)
+{
+   return (size_t)(unsigned int)i * 2654435761U;
+}
+
+/* Return 1 (TRUE) if uniform numbers i and j are the same, or 0
+   (FALSE) otherwise. */
+
+static int equalNumbers(int i, int j)
+{
+   return i == j;
+}
+
+SYMTABLE_DEFINE(PlayerTable, int, struct Player, hashNumber,
+   equalNumbers);
+
+/* Add the number of the player that pPlayer points to, to the int that
+   pvExtra points to.  The key iNumber is the same number. */
+
+static void sumNumbers(int iNumber, struct Player *pPlayer,
+   void *pvExtra)
+{
+   assert(pPlayer != NULL);
+   assert(pvExtra != NULL);
+   ASSURE(iNumber == pPlayer->iNumber);
+   *(int*)pvExtra += pPlayer->iNumber;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a PlayerTable, the table generated by SYMTABLE_DEFINE above,
+   with enough bindings to expand it, and negative keys. */
+
+static void testGeneric(void)
+{
+   enum {PLAYER_COUNT = 2000};
+
+   PlayerTable_T oTable;
+   PlayerTable_Iter sIter;
+   struct PlayerTable_Binding *psBinding;
+   struct Player sPlayer;
+   struct Player sOld;
+   struct Player *pPlayer;
+   size_t uLength;
+   int iSuccessful;
+   int iSum;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a table generated by SYMTABLE_DEFINE.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oTable = PlayerTable_new();
+   ASSURE(oTable != NULL);
+   ASSURE(PlayerTable_get(oTable, 0) == NULL);
+
+   strcpy(sPlayer.acPosition, "Shortstop");
+   for (i = -PLAYER_COUNT / 2; i < PLAYER_COUNT / 2; i++)
+   {
+      sPlayer.iNumber = i;
+      iSuccessful = PlayerTable_put(oTable, i, sPlayer);
+      ASSURE(iSuccessful);
+   }
+   iSuccessful = PlayerTable_put(oTable, 7, sPlayer);
+   ASSURE(! iSuccessful);
+   uLength = PlayerTable_getLength(oTable);
+   ASSURE(uLength == PLAYER_COUNT);
+
+   /* The table holds copies, which can be changed in place. */
+   sPlayer.iNumber = -1;
+   for (i = -PLAYER_COUNT / 2; i < PLAYER_COUNT / 2; i++)
+   {
+      pPlayer = PlayerTable_get(oTable, i);
+      ASSURE(pPlayer != NULL);
+      ASSURE(pPlayer->iNumber == i);
+      ASSURE(strcmp(pPlayer->acPosition, "Shortstop") == 0);
+   }
+   pPlayer = PlayerTable_get(oTable, 3);
+   strcpy(pPlayer->acPosition, "Catcher");
+   ASSURE(strcmp(PlayerTable_get(oTable, 3)->acPosition, "Catcher")
+      == 0);
+
+   ASSURE(PlayerTable_putOrGet(oTable, 3, sPlayer, &pPlayer) == 0);
+   ASSURE(pPlayer->iNumber == 3);
+   strcpy(sPlayer.acPosition, "Center Field");
+   sPlayer.iNumber = 3;
+   ASSURE(PlayerTable_replace(oTable, 3, sPlayer, &sOld));
+   ASSURE(strcmp(sOld.acPosition, "Catcher") == 0);
+   ASSURE(! PlayerTable_replace(oTable, PLAYER_COUNT, sPlayer, NULL));
+
+   /* Every binding is visited once, by map and by iteration. */
+   iSum = 0;
+   PlayerTable_map(oTable, sumNumbers, &iSum);
+   ASSURE(iSum == -PLAYER_COUNT / 2);
+   iSum = 0;
+   PlayerTable_begin(oTable, &sIter);
+   while ((psBinding = PlayerTable_next(&sIter)) != NULL)
+   {
+      ASSURE(psBinding->Key == psBinding->Value.iNumber);
+      iSum++;
+   }
+   ASSURE(iSum == PLAYER_COUNT);
+   ASSURE(PlayerTable_next(&sIter) == NULL);
+
+   for (i = -PLAYER_COUNT / 2; i < PLAYER_COUNT / 2; i += 2)
+   {
+      ASSURE(PlayerTable_remove(oTable, i, &sOld));
+      ASSURE(sOld.iNumber == i);
+   }
+   ASSURE(! PlayerTable_remove(oTable, 0, NULL));
+   for (i = -PLAYER_COUNT / 2; i < PLAYER_COUNT / 2; i++)
+      ASSURE(PlayerTable_contains(oTable, i) == (i % 2 != 0));
+   uLength = PlayerTable_getLength(oTable);
+   ASSURE(uLength == PLAYER_COUNT / 2);
+
+   PlayerTable_free(oTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTable object created with flags uFlags, whose name is
+   pcFlags, that is repeatedly filled past the size of a small table
+   and emptied again, checking every binding after every change. */
+
+static void testGrowAndShrink(unsigned int uFlags, const char *pcFlags)
+{
+   enum {BINDING_COUNT = 40, ROUND_COUNT = 3, KEY_SIZE = 16};
+
+   SymTable_T oSymTable;
+   char acKey[KEY_SIZE];
+   char acShortstop[] = "Shortstop";
+   int iSuccessful;
+   size_t uLength;
+   size_t uCount;
+   void *pvValue;
+   int iRound;
+   int i;
+   int j;
+
+   assert(pcFlags != NULL);
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object created with %s that\n", pcFlags);
+   printf("grows and shrinks.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newWithFlags(uFlags);
+   ASSURE(oSymTable != NULL);
+
+   for (iRound = 0; iRound < ROUND_COUNT; iRound++)
+   {
+      for (i = 0; i < BINDING_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         iSuccessful = SymTable_put(oSymTable, acKey, acShortstop);
+         ASSURE(iSuccessful);
+         for (j = 0; j < BINDING_COUNT; j++)
+         {
+            sprintf(acKey, "%d", j);
+            iSuccessful = SymTable_contains(oSymTable, acKey);
+            ASSURE(iSuccessful == (j <= i));
+         }
+      }
+
+      /* Remove the bindings in another order than they were put. */
+      for (i = 0; i < BINDING_COUNT; i++)
+      {
+         sprintf(acKey, "%d", (i * 7) % BINDING_COUNT);
+         pvValue = SymTable_remove(oSymTable, acKey);
+         ASSURE(pvValue == acShortstop);
+         uLength = SymTable_getLength(oSymTable);
+         ASSURE(uLength == (size_t)(BINDING_COUNT - i - 1));
+         uCount = 0;
+         SymTable_map(oSymTable, countBinding, &uCount);
+         ASSURE(uCount == uLength);
+         for (j = i + 1; j < BINDING_COUNT; j++)
+         {
+            sprintf(acKey, "%d", (j * 7) % BINDING_COUNT);
+            ASSURE(SymTable_get(oSymTable, acKey) == acShortstop);
+         }
+      }
+   }
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTable object created with SYMTABLE_INCREMENTAL that grows,
+   shrinks when it loses most of its bindings, and grows back. The
+   shrink must be moved over before the table grows again, so that no
+   single put has to finish it. */
+
+static void testIncrementalResize(void)
+{
+   enum {BINDING_COUNT = 70000, REMOVE_COUNT = 38000, KEY_SIZE = 16};
+
+   SymTable_T oSymTable;
+   SymTable_Stats sStats;
+   char acKey[KEY_SIZE];
+   int iSuccessful;
+   size_t uLength;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object created with SYMTABLE_INCREMENTAL\n");
+   printf("that grows, shrinks and grows again.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newWithFlags(SYMTABLE_INCREMENTAL);
+   ASSURE(oSymTable != NULL);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "Berra%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, NULL);
+      ASSURE(iSuccessful);
+   }
+   for (i = 0; i < REMOVE_COUNT; i++)
+   {
+      sprintf(acKey, "Berra%d", i);
+      ASSURE(SymTable_remove(oSymTable, acKey) == NULL);
+   }
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == (size_t)(BINDING_COUNT - REMOVE_COUNT));
+
+   /* Putting the keys back takes the table past the size at which it
+      grows again. */
+   for (i = 0; i < REMOVE_COUNT; i++)
+   {
+      sprintf(acKey, "Berra%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, NULL);
+      ASSURE(iSuccessful);
+   }
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == (size_t)BINDING_COUNT);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "Berra%d", i);
+      ASSURE(SymTable_contains(oSymTable, acKey));
+   }
+
+   /* Implementations that don't resize a few buckets at a time, or
+      don't count, report 0. */
+   SymTable_getStats(oSymTable, &sStats);
+   ASSURE(sStats.uMaxMigrate < 16);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTable object created with flags uFlags, whose name is
+   pcFlags, that loses most of its bindings and is then compacted,
+   checking the bindings that are left after every step. */
+
+static void testCompact(unsigned int uFlags, const char *pcFlags)
+{
+   enum {BINDING_COUNT = 20000, KEPT_EVERY = 100, KEY_SIZE = 16};
+
+   SymTable_T oSymTable;
+   char acKey[KEY_SIZE];
+   char acShortstop[] = "Shortstop";
+   int iSuccessful;
+   size_t uCount;
+   void *pvValue;
+   int iStep;
+   int i;
+
+   assert(pcFlags != NULL);
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object created with %s that\n", pcFlags);
+   printf("is compacted.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newWithFlags(uFlags);
+   ASSURE(oSymTable != NULL);
+
+   /* Compacting an empty table leaves a working table. */
+   SymTable_compact(oSymTable);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acShortstop);
+      ASSURE(iSuccessful);
+   }
+
+   /* Removing most bindings shrinks the table on the way down. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      if (i % KEPT_EVERY != 0)
+      {
+         sprintf(acKey, "%d", i);
+         pvValue = SymTable_remove(oSymTable, acKey);
+         ASSURE(pvValue == acShortstop);
+      }
+   }
+
+   /* Check, compact, check again, and compact a compact table. */
+   for (iStep = 0; iStep < 3; iStep++)
+   {
+      ASSURE(SymTable_getLength(oSymTable) ==
+         (size_t)(BINDING_COUNT / KEPT_EVERY));
+      uCount = 0;
+      SymTable_map(oSymTable, countBinding, &uCount);
+      ASSURE(uCount == (size_t)(BINDING_COUNT / KEPT_EVERY));
+      for (i = 0; i < BINDING_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         iSuccessful = SymTable_contains(oSymTable, acKey);
+         ASSURE(iSuccessful == (i % KEPT_EVERY == 0));
+      }
+      SymTable_compact(oSymTable);
+   }
+
+   /* A compacted table grows again as usual. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acShortstop);
+      ASSURE(iSuccessful == (i % KEPT_EVERY != 0));
+   }
+   ASSURE(SymTable_getLength(oSymTable) == (size_t)BINDING_COUNT);
+
+   /* And it can be emptied and compacted all the way down. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pvValue = SymTable_remove(oSymTable, acKey);
+      ASSURE(pvValue == acShortstop);
+   }
+   SymTable_compact(oSymTable);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   iSuccessful = SymTable_put(oSymTable, "Ruth", acShortstop);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_get(oSymTable, "Ruth") == acShortstop);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The keys that recordKey has seen, in the order it saw them. */
+
+struct KeyRecord
+{
+   const char **ppcKeys;
+   size_t uCount;
+};
+
+/* Append pcKey to the struct KeyRecord that pvExtra points to.
+   pvValue is unused. */
+
+static void recordKey(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   struct KeyRecord *psRecord = (struct KeyRecord *)pvExtra;
+
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+   (void)pvValue;
+
+   psRecord->ppcKeys[psRecord->uCount] = pcKey;
+   psRecord->uCount++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable_Iter cursor over a SymTable object created with
+   flags uFlags, whose name is pcFlags. */
+
+static void testIterator(unsigned int uFlags, const char *pcFlags)
+{
+   enum {BINDING_COUNT = 1000, STOP_AFTER = 3, KEY_SIZE = 16};
+
+   SymTable_T oSymTable;
+   SymTable_Iter sIter;
+   SymTable_Iter sOtherIter;
+   struct KeyRecord sRecord;
+   const char *apcKeys[BINDING_COUNT];
+   char acKey[KEY_SIZE];
+   char acShortstop[] = "Shortstop";
+   int iSuccessful;
+   size_t uCount;
+   int i;
+
+   assert(pcFlags != NULL);
+
+   printf("------------------------------------------------------\n");
+   printf("Testing iterators over a SymTable object created with\n");
+   printf("%s.\n", pcFlags);
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newWithFlags(uFlags);
+   ASSURE(oSymTable != NULL);
+
+   /* An empty table has nothing to visit, however often it's asked. */
+   SymTable_begin(oSymTable, &sIter);
+   ASSURE(! SymTable_next(&sIter));
+   ASSURE(! SymTable_next(&sIter));
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acShortstop + i % 9);
+      ASSURE(iSuccessful);
+   }
+
+   /* The cursor visits the bindings in the order SymTable_map does,
+      with the same key pointers, and lookups may be made as it goes. */
+   SymTable_begin(oSymTable, &sIter);
+   sRecord.ppcKeys = apcKeys;
+   sRecord.uCount = 0;
+   SymTable_map(oSymTable, recordKey, &sRecord);
+   ASSURE(sRecord.uCount == (size_t)BINDING_COUNT);
+   for (uCount = 0; SymTable_next(&sIter); uCount++)
+   {
+      ASSURE(uCount < (size_t)BINDING_COUNT);
+      if (uCount >= (size_t)BINDING_COUNT)
+         break;
+      ASSURE(SymTable_iterKey(&sIter) == apcKeys[uCount]);
+      ASSURE(sIter.pcKey == SymTable_iterKey(&sIter));
+      ASSURE(sIter.pvValue == SymTable_iterValue(&sIter));
+      ASSURE(SymTable_get(oSymTable, SymTable_iterKey(&sIter)) ==
+         SymTable_iterValue(&sIter));
+   }
+   ASSURE(uCount == (size_t)BINDING_COUNT);
+   ASSURE(! SymTable_next(&sIter));
+
+   /* An iteration can stop early, and two can be under way at once. */
+   SymTable_begin(oSymTable, &sIter);
+   for (i = 0; i < STOP_AFTER; i++)
+      ASSURE(SymTable_next(&sIter));
+   SymTable_begin(oSymTable, &sOtherIter);
+   for (uCount = 0; SymTable_next(&sOtherIter); uCount++)
+   {
+      if (uCount == (size_t)STOP_AFTER)
+      {
+         ASSURE(SymTable_next(&sIter));
+         ASSURE(SymTable_iterKey(&sIter) ==
+            SymTable_iterKey(&sOtherIter));
+      }
+   }
+   ASSURE(uCount == (size_t)BINDING_COUNT);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Compare the strings that pvFirst and pvSecond point to, for qsort. */
+
+static int compareKeys(const void *pvFirst, const void *pvSecond)
+{
+   assert(pvFirst != NULL);
+   assert(pvSecond != NULL);
+
+   return strcmp(*(const char * const *)pvFirst,
+      *(const char * const *)pvSecond);
+}
+
+/* Check that the keys of psRecord are distinct, that each of them is
+   at or after pcLow and before pcHigh (either of which may be NULL)
+   and starts with pcPrefix, and that there are as many as there are
+   such keys among the uCount keys that ppcKeys points to, which are
+   those of the table.  An ordered implementation must also have
+   recorded them in order. */
+
+static void checkRange(struct KeyRecord *psRecord, const char *pcLow,
+   const char *pcHigh, const char *pcPrefix, const char **ppcKeys,
+   size_t uCount)
+{
+   size_t uExpected = 0;
+   size_t u;
+
+   assert(psRecord != NULL);
+   assert(pcPrefix != NULL);
+   assert(ppcKeys != NULL);
+
+   for (u = 0; u < uCount; u++)
+      if ((pcLow == NULL || strcmp(ppcKeys[u], pcLow) >= 0) &&
+         (pcHigh == NULL || strcmp(ppcKeys[u], pcHigh) < 0) &&
+         strncmp(ppcKeys[u], pcPrefix, strlen(pcPrefix)) == 0)
+         uExpected++;
+   ASSURE(psRecord->uCount == uExpected);
+
+   for (u = 0; u < psRecord->uCount; u++)
+   {
+      ASSURE(pcLow == NULL || strcmp(psRecord->ppcKeys[u], pcLow) >= 0);
+      ASSURE(pcHigh == NULL ||
+         strcmp(psRecord->ppcKeys[u], pcHigh) < 0);
+      ASSURE(strncmp(psRecord->ppcKeys[u], pcPrefix,
+         strlen(pcPrefix)) == 0);
+#ifdef SYMTABLE_ORDERED
+      ASSURE(u == 0 ||
+         strcmp(psRecord->ppcKeys[u - 1], psRecord->ppcKeys[u]) < 0);
+#endif
+   }
+
+   qsort(psRecord->ppcKeys, psRecord->uCount, sizeof(const char *),
+      compareKeys);
+   for (u = 1; u < psRecord->uCount; u++)
+      ASSURE(strcmp(psRecord->ppcKeys[u - 1],
+         psRecord->ppcKeys[u]) < 0);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_mapRange and SymTable_mapPrefix over a SymTable object
+   created with flags uFlags, whose name is pcFlags. */
+
+static void testMapRange(unsigned int uFlags, const char *pcFlags)
+{
+   enum {BINDING_COUNT = 3000, QUERY_COUNT = 9, KEY_SIZE = 16};
+
+   /* Each query is a low bound, a high bound and a prefix. */
+   static const char *apcQueries[QUERY_COUNT][3] =
+   {
+      {NULL, NULL, ""},
+      {NULL, NULL, "ns::"},
+      {NULL, NULL, "ns"},
+      {NULL, NULL, "zzz"},
+      {"ns::", "ns::5", ""},
+      {NULL, "5", ""},
+      {"5", NULL, ""},
+      {"ns::12", "ns::13", ""},
+      {"b", "a", ""}
+   };
+   SymTable_T oSymTable;
+   struct KeyRecord sRecord;
+   static char aacKeys[BINDING_COUNT][KEY_SIZE];
+   const char *apcKeys[BINDING_COUNT];
+   const char *apcRecorded[BINDING_COUNT];
+   char acShortstop[] = "Shortstop";
+   int iSuccessful;
+   size_t uCount;
+   size_t uRun;
+   size_t u;
+   int q;
+   int i;
+
+   assert(pcFlags != NULL);
+
+   printf("------------------------------------------------------\n");
+   printf("Testing ranges and prefixes of a SymTable object created\n");
+   printf("with %s.\n", pcFlags);
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newWithFlags(uFlags);
+   ASSURE(oSymTable != NULL);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      if (i % 3 == 0)
+         sprintf(aacKeys[i], "ns::%d", i);
+      else if (i % 3 == 1)
+         sprintf(aacKeys[i], "nsx%d", i);
+      else
+         sprintf(aacKeys[i], "%d", i);
+      iSuccessful = SymTable_put(oSymTable, aacKeys[i], acShortstop);
+      ASSURE(iSuccessful);
+   }
+
+   /* Every query is run over the full table, and again after half of
+      its bindings have been removed, in a scattered order. */
+   sRecord.ppcKeys = apcRecorded;
+   for (uRun = 0; uRun < 2; uRun++)
+   {
+      uCount = 0;
+      for (i = 0; i < BINDING_COUNT; i++)
+         if (SymTable_contains(oSymTable, aacKeys[i]))
+            apcKeys[uCount++] = aacKeys[i];
+      ASSURE(uCount == SymTable_getLength(oSymTable));
+
+      for (q = 0; q < QUERY_COUNT; q++)
+      {
+         sRecord.uCount = 0;
+         if (apcQueries[q][0] == NULL && apcQueries[q][1] == NULL)
+            SymTable_mapPrefix(oSymTable, apcQueries[q][2], recordKey,
+               &sRecord);
+         else
+            SymTable_mapRange(oSymTable, apcQueries[q][0],
+               apcQueries[q][1], recordKey, &sRecord);
+         checkRange(&sRecord, apcQueries[q][0], apcQueries[q][1],
+            apcQueries[q][2], apcKeys, uCount);
+      }
+
+      /* The open range is the whole table. */
+      sRecord.uCount = 0;
+      SymTable_mapRange(oSymTable, NULL, NULL, recordKey, &sRecord);
+      checkRange(&sRecord, NULL, NULL, "", apcKeys, uCount);
+
+      for (u = 0; u < (size_t)BINDING_COUNT; u += 2)
+         (void)SymTable_remove(oSymTable,
+            aacKeys[u * 7919 % BINDING_COUNT]);
+   }
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* What one thread of SymTable_mapParallel gathers: the number of
+   bindings it saw, and the array in which it marks every binding as
+   seen, which all threads share. */
+
+struct ThreadCount
+{
+   size_t uCount;
+   unsigned char *pucSeen;
+};
+
+/* Increment the count of the struct ThreadCount that pvExtra points
+   to, and mark the binding, whose key is its number, as seen.
+   pvValue is unused. */
+
+static void countInThread(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   struct ThreadCount *psCount = (struct ThreadCount *)pvExtra;
+
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+   (void)pvValue;
+
+   psCount->uCount++;
+   psCount->pucSeen[atoi(pcKey)]++;
+}
+
+/* Do nothing with a binding. pcKey, pvValue and pvExtra are unused. */
+
+static void ignoreBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   assert(pcKey != NULL);
+   (void)pvValue;
+   (void)pvExtra;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_mapParallel over a SymTable object with many
+   bindings, with several numbers of threads. */
+
+static void testMapParallel(void)
+{
+   enum {BINDING_COUNT = 20000, MAX_THREADS = 8, KEY_SIZE = 16};
+
+   static const size_t auThreads[] = {1, 3, MAX_THREADS};
+   SymTable_T oSymTable;
+   struct ThreadCount asCounts[MAX_THREADS];
+   void *apvExtras[MAX_THREADS];
+   unsigned char *pucSeen;
+   char acKey[KEY_SIZE];
+   char acShortstop[] = "Shortstop";
+   int iSuccessful;
+   size_t uTotal;
+   size_t uRun;
+   size_t u;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_mapParallel.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   pucSeen = (unsigned char *)calloc(BINDING_COUNT, 1);
+   ASSURE(pucSeen != NULL);
+   if (pucSeen == NULL)
+      return;
+   for (u = 0; u < MAX_THREADS; u++)
+   {
+      asCounts[u].pucSeen = pucSeen;
+      apvExtras[u] = &asCounts[u];
+   }
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* An empty table, and more threads than there is work for. */
+   SymTable_mapParallel(oSymTable, ignoreBinding, NULL, MAX_THREADS);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acShortstop);
+      ASSURE(iSuccessful);
+   }
+
+   /* Every binding is seen exactly once, by some thread, and the
+      threads' counts add up without having shared a counter. */
+   for (uRun = 0; uRun < sizeof(auThreads) / sizeof(auThreads[0]);
+      uRun++)
+   {
+      memset(pucSeen, 0, BINDING_COUNT);
+      for (u = 0; u < MAX_THREADS; u++)
+         asCounts[u].uCount = 0;
+      SymTable_mapParallel(oSymTable, countInThread, apvExtras,
+         auThreads[uRun]);
+      uTotal = 0;
+      for (u = 0; u < MAX_THREADS; u++)
+      {
+         ASSURE(u < auThreads[uRun] || asCounts[u].uCount == 0);
+         uTotal += asCounts[u].uCount;
+      }
+      ASSURE(uTotal == (size_t)BINDING_COUNT);
+      for (i = 0; i < BINDING_COUNT; i++)
+         ASSURE(pucSeen[i] == 1);
+   }
+
+   SymTable_mapParallel(oSymTable, ignoreBinding, NULL, MAX_THREADS);
+
+   SymTable_free(oSymTable);
+   free(pucSeen);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_freeze on a SymTable object created with the hash
+   function pfHash and the flags uFlags, whose names are pcName.  An
+   implementation may decline to freeze, in which case the object must
+   be as it was; if it freezes, every lookup must still work, and no
+   binding may be added or removed. */
+
+static void testFreeze(SymTable_HashFn pfHash, unsigned int uFlags,
+   const char *pcName)
+{
+   enum {BINDING_COUNT = 5000, KEY_SIZE = 16, THREADS = 3};
+
+   SymTable_T oSymTable;
+   SymTable_Iter sIter;
+   const char *apcKeys[BINDING_COUNT];
+   static char aacKeys[BINDING_COUNT][KEY_SIZE];
+   void *apvValues[BINDING_COUNT];
+   char acShortstop[] = "Shortstop";
+   char acCenterField[] = "Center Field";
+   char *pcValue;
+   int iFrozen;
+   int iSuccessful;
+   size_t uCount;
+   int i;
+
+   assert(pcName != NULL);
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_freeze with %s.\n", pcName);
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* An empty table. */
+   oSymTable = SymTable_newWithHash(pfHash, uFlags);
+   ASSURE(oSymTable != NULL);
+   iFrozen = SymTable_freeze(oSymTable);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   ASSURE(! SymTable_contains(oSymTable, "Jeter"));
+   uCount = 0;
+   SymTable_map(oSymTable, countBinding, &uCount);
+   ASSURE(uCount == 0);
+   iSuccessful = SymTable_put(oSymTable, "Jeter", acShortstop);
+   ASSURE(iSuccessful == ! iFrozen);
+   SymTable_free(oSymTable);
+
+   oSymTable = SymTable_newWithHash(pfHash, uFlags);
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(aacKeys[i], "%d", i);
+      apcKeys[i] = aacKeys[i];
+      iSuccessful = SymTable_put(oSymTable, aacKeys[i], &aacKeys[i]);
+      ASSURE(iSuccessful);
+   }
+   iSuccessful = SymTable_put(oSymTable, "", acShortstop);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_remove(oSymTable, "4999") == &aacKeys[4999];
+   ASSURE(iSuccessful);
+
+   iFrozen = SymTable_freeze(oSymTable);
+
+   /* Every lookup, whether or not the table was frozen. */
+   ASSURE(SymTable_getLength(oSymTable) == (size_t)BINDING_COUNT);
+   for (i = 0; i < BINDING_COUNT - 1; i++)
+   {
+      pcValue = (char*)SymTable_get(oSymTable, apcKeys[i]);
+      ASSURE(pcValue == aacKeys[i]);
+   }
+   ASSURE(SymTable_get(oSymTable, "") == acShortstop);
+   ASSURE(! SymTable_contains(oSymTable, "4999"));
+   ASSURE(! SymTable_contains(oSymTable, "Jeter"));
+   ASSURE(SymTable_getLen(oSymTable, "1234xyz", 4) == aacKeys[1234]);
+   SymTable_getBatch(oSymTable, apcKeys, BINDING_COUNT, apvValues);
+   for (i = 0; i < BINDING_COUNT - 1; i++)
+      ASSURE(apvValues[i] == aacKeys[i]);
+   ASSURE(apvValues[BINDING_COUNT - 1] == NULL);
+
+   ASSURE(SymTable_replace(oSymTable, "", acCenterField) ==
+      acShortstop);
+   ASSURE(SymTable_get(oSymTable, "") == acCenterField);
+
+   uCount = 0;
+   SymTable_map(oSymTable, countBinding, &uCount);
+   ASSURE(uCount == (size_t)BINDING_COUNT);
+   uCount = 0;
+   for (SymTable_begin(oSymTable, &sIter); SymTable_next(&sIter); )
+   {
+      ASSURE(SymTable_get(oSymTable, SymTable_iterKey(&sIter)) ==
+         SymTable_iterValue(&sIter));
+      uCount++;
+   }
+   ASSURE(uCount == (size_t)BINDING_COUNT);
+   uCount = 0;
+   SymTable_mapPrefix(oSymTable, "12", countBinding, &uCount);
+   ASSURE(uCount == 111);
+   SymTable_mapParallel(oSymTable, ignoreBinding, NULL, THREADS);
+   SymTable_compact(oSymTable);
+   ASSURE(SymTable_get(oSymTable, "0") == aacKeys[0]);
+
+   /* A frozen table neither gains nor loses bindings; one that isn't
+      goes on as usual. */
+   iSuccessful = SymTable_put(oSymTable, "Jeter", acShortstop);
+   ASSURE(iSuccessful == ! iFrozen);
+   ASSURE(SymTable_putOrGet(oSymTable, "0", acShortstop,
+      (void**)&pcValue) == 0);
+   ASSURE(pcValue == aacKeys[0]);
+   pcValue = (char*)SymTable_remove(oSymTable, "0");
+   ASSURE(pcValue == (iFrozen ? NULL : aacKeys[0]));
+   ASSURE(SymTable_getLength(oSymTable) == (size_t)BINDING_COUNT);
+   if (iFrozen)
+      ASSURE(SymTable_freeze(oSymTable));
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_getStats on a table made with uFlags, which pcName
+   describes. Implementations that keep no statistics report 0 for all
+   of them, so the shape of the table is only checked once it's known to
+   be kept. The counters are kept exactly when this file and the
+   implementation were compiled with -DSYMTABLE_STATS, and are 0
+   otherwise. */
+
+static void testGetStats(unsigned int uFlags, const char *pcName)
+{
+   enum {BINDING_COUNT = 2000, MISS_COUNT = 100, KEY_SIZE = 32};
+
+   SymTable_T oSymTable;
+   SymTable_Stats sStats;
+   static char aacKeys[BINDING_COUNT][KEY_SIZE];
+   char acKey[KEY_SIZE];
+   size_t uKeyBytes = 0;
+   int iCounting;
+   int iSuccessful;
+   int i;
+
+   assert(pcName != NULL);
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_getStats with %s.\n", pcName);
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newWithFlags(uFlags);
+   ASSURE(oSymTable != NULL);
+
+   /* An empty table has nothing to report yet. */
+   iCounting = SymTable_getStats(oSymTable, &sStats);
+#ifdef SYMTABLE_STATS
+   ASSURE(iCounting);
+#else
+   ASSURE(! iCounting);
+#endif
+   ASSURE(sStats.uHits == 0);
+   ASSURE(sStats.uMisses == 0);
+   ASSURE(sStats.uProbes == 0);
+   ASSURE(sStats.uMaxChain == 0);
+   ASSURE(sStats.dMeanChain == 0.0);
+   ASSURE(sStats.uBindingBytes == 0);
+   ASSURE(sStats.uKeyBytes == 0);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(aacKeys[i], "Gehrig%016d", i);
+      uKeyBytes += strlen(aacKeys[i]) + 1;
+      iSuccessful = SymTable_put(oSymTable, aacKeys[i], &aacKeys[i]);
+      ASSURE(iSuccessful);
+   }
+   for (i = 0; i < BINDING_COUNT; i++)
+      ASSURE(SymTable_get(oSymTable, aacKeys[i]) == &aacKeys[i]);
+   for (i = 0; i < MISS_COUNT; i++)
+   {
+      sprintf(acKey, "Jeter%d", i);
+      ASSURE(! SymTable_contains(oSymTable, acKey));
+   }
+
+   iCounting = SymTable_getStats(oSymTable, &sStats);
+   if (sStats.uBindingBytes != 0)
+   {
+      ASSURE(sStats.uMaxChain >= 1);
+      ASSURE(sStats.dMeanChain >= 1.0);
+      ASSURE(sStats.dMeanChain <= (double)sStats.uMaxChain);
+      ASSURE(sStats.uKeyBytes ==
+         ((uFlags & SYMTABLE_BORROWED) ? 0 : uKeyBytes));
+   }
+
+   /* Each put looked for its key first, and didn't find it. */
+#ifdef SYMTABLE_STATS
+   ASSURE(iCounting);
+   ASSURE(sStats.uHits == (size_t)BINDING_COUNT);
+   ASSURE(sStats.uMisses == (size_t)(BINDING_COUNT + MISS_COUNT));
+   ASSURE(sStats.uProbes >= sStats.uHits);
+   ASSURE(sStats.dExpandSeconds >= 0.0);
+#else
+   ASSURE(! iCounting);
+   ASSURE(sStats.uHits == 0);
+   ASSURE(sStats.uMisses == 0);
+   ASSURE(sStats.uProbes == 0);
+   ASSURE(sStats.uExpansions == 0);
+   ASSURE(sStats.dExpandSeconds == 0.0);
+#endif
+
+   /* A short key may be kept in its binding, with no copy of its
+      own. */
+   iSuccessful = SymTable_put(oSymTable, "Ruth", NULL);
+   ASSURE(iSuccessful);
+   uKeyBytes = sStats.uKeyBytes;
+   SymTable_getStats(oSymTable, &sStats);
+   ASSURE(sStats.uKeyBytes <= uKeyBytes + sizeof("Ruth"));
+   uKeyBytes = sStats.uKeyBytes;
+
+   /* A frozen table has a slot of its own for every binding. */
+   if (SymTable_freeze(oSymTable))
+   {
+      SymTable_getStats(oSymTable, &sStats);
+      ASSURE(sStats.uMaxChain == 1);
+      ASSURE(sStats.dMeanChain == 1.0);
+      ASSURE(sStats.uKeyBytes == uKeyBytes);
+   }
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the counters of SymTable_getStats on a table whose keys all
+   hash alike, and which is too small to expand, so that its bindings
+   form one chain. Every lookup must then probe exactly the bindings
+   that the chain holds in front of its key, and the key itself. */
+
+static void testCounters(void)
+{
+   enum {BINDING_COUNT = 4};
+
+   SymTable_T oSymTable;
+   SymTable_Stats sStats;
+   char acKey[] = "Mantle0";
+   int iCounting;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the counters of SymTable_getStats.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newWithHash(constantHash, 0);
+   ASSURE(oSymTable != NULL);
+
+   /* The put of the i'th key walks the i bindings before it, and
+      misses. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      acKey[6] = (char)('0' + i);
+      iSuccessful = SymTable_put(oSymTable, acKey, NULL);
+      ASSURE(iSuccessful);
+   }
+
+   /* Whichever end of the chain new bindings go to, finding every key
+      once probes 1 + 2 + ... + BINDING_COUNT bindings, and a missing
+      key probes them all. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      acKey[6] = (char)('0' + i);
+      ASSURE(SymTable_contains(oSymTable, acKey));
+   }
+   ASSURE(! SymTable_contains(oSymTable, "Maris"));
+
+   iCounting = SymTable_getStats(oSymTable, &sStats);
+#ifdef SYMTABLE_STATS
+   ASSURE(iCounting);
+   ASSURE(sStats.uHits == (size_t)BINDING_COUNT);
+   ASSURE(sStats.uMisses == (size_t)(BINDING_COUNT + 1));
+   ASSURE(sStats.uProbes == (size_t)
+      (BINDING_COUNT * (BINDING_COUNT - 1) / 2 +
+      BINDING_COUNT * (BINDING_COUNT + 1) / 2 + BINDING_COUNT));
+#else
+   ASSURE(! iCounting);
+   ASSURE(sStats.uHits == 0);
+   ASSURE(sStats.uMisses == 0);
+   ASSURE(sStats.uProbes == 0);
+#endif
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the default hash function of a table with keys chosen to
+   collide under HashFn_multiplicative: each is made of BLOCK_COUNT
+   blocks, each block a Thue-Morse string or its complement, which
+   have the same code under any polynomial hash modulo a power of 2. A
+   table that hashes its keys must spread them over more buckets than
+   one made with HashFn_multiplicative does. */
+
+static void testFlooding(void)
+{
+   enum {BLOCK_ORDER = 11, BLOCK_LENGTH = 1 << BLOCK_ORDER,
+      BLOCK_COUNT = 7, KEY_COUNT = 1 << BLOCK_COUNT,
+      KEY_LENGTH = BLOCK_LENGTH * BLOCK_COUNT};
+
+   SymTable_T oFixed;
+   SymTable_T oDefault;
+   SymTable_Stats sFixed;
+   SymTable_Stats sDefault;
+   static char aacBlocks[2][BLOCK_LENGTH];
+   static char aacKeys[KEY_COUNT][KEY_LENGTH + 1];
+   size_t uLength;
+   size_t u;
+   int iSuccessful;
+   int i;
+   int j;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing keys that collide under a fixed hash.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* Each step appends the complement of the string so far. */
+   aacBlocks[0][0] = 'a';
+   aacBlocks[1][0] = 'b';
+   for (uLength = 1; uLength < (size_t)BLOCK_LENGTH; uLength *= 2)
+      for (u = 0; u < uLength; u++)
+      {
+         aacBlocks[0][uLength + u] = aacBlocks[1][u];
+         aacBlocks[1][uLength + u] = aacBlocks[0][u];
+      }
+   ASSURE(HashFn_multiplicative(aacBlocks[0], BLOCK_LENGTH) ==
+      HashFn_multiplicative(aacBlocks[1], BLOCK_LENGTH));
+
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      for (j = 0; j < BLOCK_COUNT; j++)
+         memcpy(aacKeys[i] + j * BLOCK_LENGTH,
+            aacBlocks[(i >> j) & 1], BLOCK_LENGTH);
+      aacKeys[i][KEY_LENGTH] = '\0';
+   }
+
+   oFixed = SymTable_newWithHash(HashFn_multiplicative, 0);
+   ASSURE(oFixed != NULL);
+   oDefault = SymTable_new();
+   ASSURE(oDefault != NULL);
+
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      iSuccessful = SymTable_put(oFixed, aacKeys[i], &aacKeys[i]);
+      ASSURE(iSuccessful);
+      iSuccessful = SymTable_put(oDefault, aacKeys[i], &aacKeys[i]);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_getLength(oFixed) == (size_t)KEY_COUNT);
+   ASSURE(SymTable_getLength(oDefault) == (size_t)KEY_COUNT);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      ASSURE(SymTable_get(oFixed, aacKeys[i]) == &aacKeys[i]);
+      ASSURE(SymTable_get(oDefault, aacKeys[i]) == &aacKeys[i]);
+      ASSURE(! SymTable_put(oDefault, aacKeys[i], NULL));
+   }
+
+   /* Implementations that don't hash report the same chains for both,
+      and those that keep no statistics report none. */
+   SymTable_getStats(oFixed, &sFixed);
+   SymTable_getStats(oDefault, &sDefault);
+   ASSURE(sDefault.uMaxChain < sFixed.uMaxChain ||
+      sDefault.uMaxChain == 0 ||
+      sDefault.uMaxChain == (size_t)KEY_COUNT);
+
+   for (i = 0; i < KEY_COUNT; i += 2)
+      ASSURE(SymTable_remove(oDefault, aacKeys[i]) == &aacKeys[i]);
+   for (i = 0; i < KEY_COUNT; i++)
+      ASSURE(SymTable_contains(oDefault, aacKeys[i]) == (i % 2 == 1));
+
+   SymTable_free(oFixed);
+   SymTable_free(oDefault);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Check that pcKey is the very string that pvValue points to, and
+   increment the count of such bindings that pvExtra points to. */
+
+static void checkBorrowedKey(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   ASSURE(pcKey == (const char*)pvValue);
+   (*(size_t*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTable object created with SYMTABLE_BORROWED and the other
+   flags uFlags, whose name is pcFlags.  The object must keep the
+   caller's keys themselves rather than copies of them. */
+
+static void testBorrowed(unsigned int uFlags, const char *pcFlags)
+{
+   enum {BINDING_COUNT = 1000, KEY_SIZE = 16};
+
+   SymTable_T oSymTable;
+   SymTable_T oCopied;
+   SymTable_Stats sBorrowed;
+   SymTable_Stats sCopied;
+   static char aacKeys[BINDING_COUNT][KEY_SIZE];
+   char acKey[KEY_SIZE];
+   int iSuccessful;
+   size_t uLength;
+   size_t uCount;
+   void *pvValue;
+   int i;
+
+   assert(pcFlags != NULL);
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object created with SYMTABLE_BORROWED\n");
+   printf("and %s.\n", pcFlags);
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newWithFlags(SYMTABLE_BORROWED | uFlags);
+   ASSURE(oSymTable != NULL);
+
+   /* Bind each key to itself, through SymTable_put and
+      SymTable_putLen in turn. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(aacKeys[i], "Jeter%d", i);
+      if (i % 2 == 0)
+      {
+         iSuccessful = SymTable_put(oSymTable, aacKeys[i], aacKeys[i]);
+      }
+      else
+      {
+         iSuccessful = SymTable_putLen(oSymTable, aacKeys[i],
+            strlen(aacKeys[i]), aacKeys[i]);
+      }
+      ASSURE(iSuccessful);
+   }
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == BINDING_COUNT);
+
+   /* The object must find the keys through copies of them, and must
+      hand back the caller's strings. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "Jeter%d", i);
+      ASSURE(SymTable_get(oSymTable, acKey) == aacKeys[i]);
+      iSuccessful = SymTable_put(oSymTable, acKey, acKey);
+      ASSURE(! iSuccessful);
+   }
+   uCount = 0;
+   SymTable_map(oSymTable, checkBorrowedKey, &uCount);
+   ASSURE(uCount == BINDING_COUNT);
+
+   /* Removing a binding must leave the caller's key alone. */
+   for (i = 0; i < BINDING_COUNT; i += 2)
+   {
+      pvValue = SymTable_remove(oSymTable, aacKeys[i]);
+      ASSURE(pvValue == aacKeys[i]);
+      sprintf(acKey, "Jeter%d", i);
+      ASSURE(strcmp(aacKeys[i], acKey) == 0);
+   }
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == BINDING_COUNT / 2);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      iSuccessful = SymTable_contains(oSymTable, aacKeys[i]);
+      ASSURE(iSuccessful == (i % 2 != 0));
+   }
+
+   /* A binding with a borrowed key has no room for a copy of it, so it
+      must take less memory than one in a table that copies its keys. */
+   oCopied = SymTable_newWithFlags(uFlags);
+   ASSURE(oCopied != NULL);
+   for (i = 1; i < BINDING_COUNT; i += 2)
+   {
+      iSuccessful = SymTable_put(oCopied, aacKeys[i], aacKeys[i]);
+      ASSURE(iSuccessful);
+   }
+   SymTable_getStats(oSymTable, &sBorrowed);
+   SymTable_getStats(oCopied, &sCopied);
+   if (sCopied.uBindingBytes != 0)
+      ASSURE(sBorrowed.uBindingBytes < sCopied.uBindingBytes);
+   SymTable_free(oCopied);
+
+   SymTable_free(oSymTable);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "Jeter%d", i);
+      ASSURE(strcmp(aacKeys[i], acKey) == 0);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test an Intern_T object, and SymTable objects created with
+   SYMTABLE_INTERNED and the other flags uFlags, whose name is pcFlags,
+   that share its strings.  Such objects must compare keys by
+   address. */
+
+static void testInterned(unsigned int uFlags, const char *pcFlags)
+{
+   enum {BINDING_COUNT = 1000, KEY_SIZE = 16};
+
+   Intern_T oIntern;
+   SymTable_T oSymTable;
+   SymTable_T oSymTable2;
+   const char *apcKeys[BINDING_COUNT];
+   char acKey[KEY_SIZE];
+   char acShortstop[] = "Shortstop";
+   char acCatcher[] = "Catcher";
+   int iSuccessful;
+   size_t uLength;
+   size_t uCount;
+   void *pvValue;
+   int i;
+
+   assert(pcFlags != NULL);
+
+   printf("------------------------------------------------------\n");
+   printf("Testing an Intern_T object, and SymTable objects created\n");
+   printf("with SYMTABLE_INTERNED and %s.\n", pcFlags);
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oIntern = Intern_new();
+   ASSURE(oIntern != NULL);
+   oSymTable = SymTable_newWithFlags(SYMTABLE_INTERNED | uFlags);
+   ASSURE(oSymTable != NULL);
+   oSymTable2 = SymTable_newWithFlags(SYMTABLE_INTERNED | uFlags);
+   ASSURE(oSymTable2 != NULL);
+
+   /* Equal strings must get the same canonical copy. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "Jeter%d", i);
+      apcKeys[i] = Intern_string(oIntern, acKey);
+      ASSURE(apcKeys[i] != NULL);
+      ASSURE(apcKeys[i] != acKey);
+      ASSURE(strcmp(apcKeys[i], acKey) == 0);
+   }
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "Jeter%d", i);
+      ASSURE(Intern_string(oIntern, acKey) == apcKeys[i]);
+   }
+   ASSURE(Intern_stringLen(oIntern, "Jeter1Mantle", 6) == apcKeys[1]);
+   uLength = Intern_getLength(oIntern);
+   ASSURE(uLength == BINDING_COUNT);
+
+   /* Both objects share the canonical keys. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      iSuccessful = SymTable_put(oSymTable, apcKeys[i], acShortstop);
+      ASSURE(iSuccessful);
+      iSuccessful = SymTable_putLen(oSymTable2, apcKeys[i],
+         strlen(apcKeys[i]), apcKeys[i]);
+      ASSURE(iSuccessful);
+   }
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      iSuccessful = SymTable_put(oSymTable, apcKeys[i], acCatcher);
+      ASSURE(! iSuccessful);
+   }
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == BINDING_COUNT);
+
+   /* A string equal to a key but at another address is another key. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      ASSURE(SymTable_get(oSymTable, apcKeys[i]) == acShortstop);
+      ASSURE(SymTable_getLen(oSymTable2, apcKeys[i], 0) == apcKeys[i]);
+      sprintf(acKey, "Jeter%d", i);
+      ASSURE(SymTable_get(oSymTable, acKey) == NULL);
+      iSuccessful = SymTable_contains(oSymTable2, acKey);
+      ASSURE(! iSuccessful);
+   }
+   uCount = 0;
+   SymTable_map(oSymTable2, checkBorrowedKey, &uCount);
+   ASSURE(uCount == BINDING_COUNT);
+
+   pvValue = SymTable_replace(oSymTable, apcKeys[0], acCatcher);
+   ASSURE(pvValue == acShortstop);
+   ASSURE(SymTable_get(oSymTable, apcKeys[0]) == acCatcher);
+   pvValue = SymTable_replace(oSymTable, acKey, acCatcher);
+   ASSURE(pvValue == NULL);
+
+   /* Removing from one object must leave the other alone. */
+   for (i = 0; i < BINDING_COUNT; i += 2)
+   {
+      pvValue = SymTable_remove(oSymTable, apcKeys[i]);
+      ASSURE(pvValue != NULL);
+   }
+   pvValue = SymTable_remove(oSymTable, acKey);
+   ASSURE(pvValue == NULL);
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == BINDING_COUNT / 2);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      iSuccessful = SymTable_contains(oSymTable, apcKeys[i]);
+      ASSURE(iSuccessful == (i % 2 != 0));
+      iSuccessful = SymTable_contains(oSymTable2, apcKeys[i]);
+      ASSURE(iSuccessful);
+   }
+
+   SymTable_free(oSymTable);
+   SymTable_free(oSymTable2);
+   Intern_free(oIntern);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a Scope_T object, whose nested scopes shadow and then restore
+   the bindings of outer ones. */
+
+static void testScope(void)
+{
+   enum {BINDING_COUNT = 1000, DEPTH = 20, KEY_SIZE = 16};
+
+   Scope_T oScope;
+   char acKey[KEY_SIZE];
+   char acJeter[] = "Jeter";
+   char acShortstop[] = "Shortstop";
+   char acCenterField[] = "Center Field";
+   char acFirstBase[] = "First Base";
+   char acLevels[DEPTH];
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a Scope_T object.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oScope = Scope_new();
+   ASSURE(oScope != NULL);
+   ASSURE(Scope_getDepth(oScope) == 0);
+
+   iSuccessful = Scope_put(oScope, acJeter, acShortstop);
+   ASSURE(iSuccessful);
+   iSuccessful = Scope_put(oScope, "Jeter", acFirstBase);
+   ASSURE(! iSuccessful);
+   ASSURE(Scope_get(oScope, "Jeter") == acShortstop);
+
+   /* The key is copied, as SymTable_put copies it. */
+   strcpy(acJeter, "Ruth ");
+   ASSURE(! Scope_contains(oScope, "Ruth "));
+   ASSURE(Scope_contains(oScope, "Jeter"));
+
+   /* An inner binding shadows the outer one until its scope ends, and
+      a key first bound inside a scope goes away with it. */
+   Scope_enter(oScope);
+   ASSURE(Scope_getDepth(oScope) == 1);
+   ASSURE(Scope_get(oScope, "Jeter") == acShortstop);
+   iSuccessful = Scope_put(oScope, "Jeter", acCenterField);
+   ASSURE(iSuccessful);
+   iSuccessful = Scope_put(oScope, "Jeter", acFirstBase);
+   ASSURE(! iSuccessful);
+   iSuccessful = Scope_put(oScope, "Mantle", acCenterField);
+   ASSURE(iSuccessful);
+   ASSURE(Scope_get(oScope, "Jeter") == acCenterField);
+
+   Scope_enter(oScope);
+   iSuccessful = Scope_put(oScope, "Jeter", NULL);
+   ASSURE(iSuccessful);
+   ASSURE(Scope_contains(oScope, "Jeter"));
+   ASSURE(Scope_get(oScope, "Jeter") == NULL);
+   Scope_exit(oScope);
+
+   ASSURE(Scope_get(oScope, "Jeter") == acCenterField);
+   Scope_exit(oScope);
+   ASSURE(Scope_getDepth(oScope) == 0);
+   ASSURE(Scope_get(oScope, "Jeter") == acShortstop);
+   ASSURE(! Scope_contains(oScope, "Mantle"));
+
+   /* An empty scope, and then many bindings in one scope. */
+   Scope_enter(oScope);
+   Scope_exit(oScope);
+   Scope_enter(oScope);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = Scope_put(oScope, acKey, acShortstop);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(Scope_contains(oScope, "999"));
+   Scope_exit(oScope);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(! Scope_contains(oScope, acKey));
+   }
+   ASSURE(Scope_get(oScope, "Jeter") == acShortstop);
+
+   /* Deeply nested shadowing, each level restoring the one around
+      it. */
+   for (i = 0; i < DEPTH; i++)
+   {
+      Scope_enter(oScope);
+      iSuccessful = Scope_put(oScope, "Jeter", &acLevels[i]);
+      ASSURE(iSuccessful);
+   }
+   for (i = DEPTH - 1; i >= 0; i--)
+   {
+      ASSURE(Scope_getDepth(oScope) == (size_t)(i + 1));
+      ASSURE(Scope_get(oScope, "Jeter") == &acLevels[i]);
+      Scope_exit(oScope);
+   }
+   ASSURE(Scope_get(oScope, "Jeter") == acShortstop);
+
+   /* A table can be freed with scopes still open. */
+   Scope_enter(oScope);
+   iSuccessful = Scope_put(oScope, "Jeter", acFirstBase);
+   ASSURE(iSuccessful);
+   iSuccessful = Scope_put(oScope, "Gehrig", acFirstBase);
+   ASSURE(iSuccessful);
+   Scope_free(oScope);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the index in the array of ints that pvExtra points to of the
+   int that pvValue points to.  pcKey is unused. */
+
+static size_t encodeIndex(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvValue != NULL);
+   assert(pvExtra != NULL);
+
+   return (size_t)((int*)pvValue - (int*)pvExtra);
+}
+
+/* Check that the binding of pcKey and uValue, one of a Snapshot_T
+   saved with encodeIndex, is the one put into the table, and increment
+   the count that pvExtra points to. */
+
+static void checkSnapshotBinding(const char *pcKey, size_t uValue,
+   void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   ASSURE(uValue == (size_t)atoi(pcKey));
+   (*(size_t*)pvExtra)++;
+}
+
+/* Check that pcKey, a key of a damaged Snapshot_T saved from a table
+   that bound "x" and "y", is one of those, and increment the count
+   that pvExtra points to.  uValue is unused. */
+
+static void countSnapshotBinding(const char *pcKey, size_t uValue,
+   void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+   (void)uValue;
+
+   ASSURE(strcmp(pcKey, "x") == 0 || strcmp(pcKey, "y") == 0);
+   (*(size_t*)pvExtra)++;
+}
+
+/* Write the uSize bytes of pcImage to the file named pcPath, with the
+   size_t at offset uWord replaced by uBad, and check that the image,
+   if it still opens, can be read without going outside of it.  It was
+   saved from a table that bound "x" and "y". */
+
+static void checkDamagedSnapshot(const char *pcPath,
+   const char *pcImage, size_t uSize, size_t uWord, size_t uBad)
+{
+   Snapshot_T oSnapshot;
+   FILE *psFile;
+   size_t uCount;
+
+   assert(pcPath != NULL);
+   assert(pcImage != NULL);
+   assert(uWord + sizeof(size_t) <= uSize);
+
+   psFile = fopen(pcPath, "wb");
+   ASSURE(psFile != NULL);
+   if (psFile == NULL)
+      return;
+   fwrite(pcImage, 1, uWord, psFile);
+   fwrite(&uBad, sizeof(size_t), 1, psFile);
+   fwrite(pcImage + uWord + sizeof(size_t), 1,
+      uSize - uWord - sizeof(size_t), psFile);
+   fclose(psFile);
+
+   oSnapshot = Snapshot_open(pcPath);
+   if (oSnapshot == NULL)
+      return;
+   (void)Snapshot_get(oSnapshot, "x", NULL);
+   (void)Snapshot_get(oSnapshot, "y", NULL);
+   ASSURE(! Snapshot_get(oSnapshot, "Jeter", NULL));
+   uCount = 0;
+   Snapshot_map(oSnapshot, countSnapshotBinding, &uCount);
+   ASSURE(uCount <= 2);
+   Snapshot_close(oSnapshot);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test saving a SymTable object to a file and mapping it back as a
+   Snapshot_T object. */
+
+static void testSnapshot(void)
+{
+   enum {BINDING_COUNT = 5000, KEY_SIZE = 16};
+
+   static const char acPath[] = "testsymtable.snapshot";
+   static int aiValues[BINDING_COUNT];
+   SymTable_T oSymTable;
+   Snapshot_T oSnapshot;
+   FILE *psFile;
+   char acKey[KEY_SIZE];
+   char *pcImage;
+   long lSize;
+   size_t uWord;
+   int iSuccessful;
+   size_t uValue;
+   size_t uCount;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a Snapshot_T object.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* An empty table makes an empty image. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   iSuccessful = Snapshot_save(oSymTable, acPath, NULL, NULL);
+   ASSURE(iSuccessful);
+   oSnapshot = Snapshot_open(acPath);
+   ASSURE(oSnapshot != NULL);
+   if (oSnapshot != NULL)
+   {
+      ASSURE(Snapshot_getLength(oSnapshot) == 0);
+      ASSURE(! Snapshot_get(oSnapshot, "Jeter", NULL));
+      Snapshot_close(oSnapshot);
+   }
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &aiValues[i]);
+      ASSURE(iSuccessful);
+   }
+   iSuccessful = SymTable_put(oSymTable, "", &aiValues[0]);
+   ASSURE(iSuccessful);
+
+   /* The values are saved as their indices in aiValues. */
+   iSuccessful = Snapshot_save(oSymTable, acPath, encodeIndex,
+      aiValues);
+   ASSURE(iSuccessful);
+   SymTable_free(oSymTable);
+
+   oSnapshot = Snapshot_open(acPath);
+   ASSURE(oSnapshot != NULL);
+   if (oSnapshot != NULL)
+   {
+      ASSURE(Snapshot_getLength(oSnapshot) ==
+         (size_t)BINDING_COUNT + 1);
+      for (i = 0; i < BINDING_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         uValue = 0;
+         iSuccessful = Snapshot_get(oSnapshot, acKey, &uValue);
+         ASSURE(iSuccessful);
+         ASSURE(uValue == (size_t)i);
+      }
+      uValue = 1;
+      ASSURE(Snapshot_get(oSnapshot, "", &uValue));
+      ASSURE(uValue == 0);
+      ASSURE(! Snapshot_get(oSnapshot, "Jeter", &uValue));
+      ASSURE(! Snapshot_get(oSnapshot, "50000", NULL));
+      uCount = 0;
+      Snapshot_map(oSnapshot, checkSnapshotBinding, &uCount);
+      ASSURE(uCount == (size_t)BINDING_COUNT + 1);
+      Snapshot_close(oSnapshot);
+   }
+
+   /* An image whose displacements or key offsets are damaged opens,
+      since opening doesn't read them, but is never read outside of
+      the file.  Every word of a small image is damaged in turn, with
+      a huge value and with the offset of the last byte. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_put(oSymTable, "x", &aiValues[0]);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "y", &aiValues[1]);
+   ASSURE(iSuccessful);
+   iSuccessful = Snapshot_save(oSymTable, acPath, NULL, NULL);
+   ASSURE(iSuccessful);
+   SymTable_free(oSymTable);
+   psFile = fopen(acPath, "rb");
+   ASSURE(psFile != NULL);
+   if (psFile != NULL)
+   {
+      fseek(psFile, 0, SEEK_END);
+      lSize = ftell(psFile);
+      rewind(psFile);
+      ASSURE(lSize > 0);
+      pcImage = (char*)malloc((size_t)lSize);
+      ASSURE(pcImage != NULL);
+      if (pcImage != NULL &&
+         fread(pcImage, 1, (size_t)lSize, psFile) == (size_t)lSize)
+      {
+         for (uWord = 0; uWord + sizeof(size_t) <= (size_t)lSize;
+            uWord += sizeof(size_t))
+         {
+            checkDamagedSnapshot(acPath, pcImage, (size_t)lSize, uWord,
+               (size_t)-1 / 4);
+            checkDamagedSnapshot(acPath, pcImage, (size_t)lSize, uWord,
+               (size_t)lSize - 1);
+         }
+      }
+      free(pcImage);
+      fclose(psFile);
+   }
+
+   /* Files that aren't images are refused. */
+   psFile = fopen(acPath, "w");
+   ASSURE(psFile != NULL);
+   if (psFile != NULL)
+   {
+      fputs("Jeter\tShortstop\n", psFile);
+      fclose(psFile);
+      ASSURE(Snapshot_open(acPath) == NULL);
+   }
+   remove(acPath);
+   ASSURE(Snapshot_open(acPath) == NULL);
+}
+
+/*--------------------------------------------------------------------*/
+
 /* Test the ability of a SymTable object to be large, that is, to
    contain iBindingCount bindings. Write the time consumed to stdout. */
 
@@ -953,13 +3200,62 @@ int main(int argc, char *argv[])
    testKeyComparison();
    testKeyOwnership();
    testRemove();
+   testPutOrGet();
    testMap();
    testEmptyTable();
    testEmptyKey();
    testNullValue();
    testLongKey();
+   testKeyLengths(0, "no flags");
+   testKeyLengths(SYMTABLE_TRANSPOSE, "SYMTABLE_TRANSPOSE");
+   testKeyLengths(SYMTABLE_MOVE_TO_FRONT | SYMTABLE_ARENA,
+      "SYMTABLE_MOVE_TO_FRONT | SYMTABLE_ARENA");
    testTableOfTables();
    testCollisions();
+   testFlags(SYMTABLE_ARENA, "SYMTABLE_ARENA");
+   testFlags(SYMTABLE_INCREMENTAL, "SYMTABLE_INCREMENTAL");
+   testFlags(SYMTABLE_ARENA | SYMTABLE_INCREMENTAL,
+      "SYMTABLE_ARENA | SYMTABLE_INCREMENTAL");
+   testFlags(SYMTABLE_MOVE_TO_FRONT, "SYMTABLE_MOVE_TO_FRONT");
+   testFlags(SYMTABLE_TRANSPOSE | SYMTABLE_ARENA,
+      "SYMTABLE_TRANSPOSE | SYMTABLE_ARENA");
+   testHash(HashFn_multiplicative, "HashFn_multiplicative");
+   testHash(HashFn_words, "HashFn_words");
+   testHash(constantHash, "a hash under which all keys collide");
+   testCapacity();
+   testBatch();
+   testNewFromArray();
+   testGeneric();
+   testGrowAndShrink(0, "no flags");
+   testGrowAndShrink(SYMTABLE_INCREMENTAL | SYMTABLE_ARENA,
+      "SYMTABLE_INCREMENTAL | SYMTABLE_ARENA");
+   testIncrementalResize();
+   testCompact(0, "no flags");
+   testCompact(SYMTABLE_INCREMENTAL, "SYMTABLE_INCREMENTAL");
+   testFreeze(NULL, 0, "the default hash function and no flags");
+   testFreeze(HashFn_words, SYMTABLE_ARENA | SYMTABLE_INCREMENTAL,
+      "HashFn_words and SYMTABLE_ARENA | SYMTABLE_INCREMENTAL");
+   testFreeze(constantHash, 0, "a hash under which all keys collide");
+   testGetStats(0, "no flags");
+   testGetStats(SYMTABLE_BORROWED | SYMTABLE_INCREMENTAL,
+      "SYMTABLE_BORROWED | SYMTABLE_INCREMENTAL");
+   testCounters();
+   testFlooding();
+   testIterator(0, "no flags");
+   testIterator(SYMTABLE_INCREMENTAL | SYMTABLE_ARENA,
+      "SYMTABLE_INCREMENTAL | SYMTABLE_ARENA");
+   testMapRange(0, "no flags");
+   testMapRange(SYMTABLE_ARENA | SYMTABLE_INCREMENTAL,
+      "SYMTABLE_ARENA | SYMTABLE_INCREMENTAL");
+   testMapParallel();
+   testBorrowed(0, "no other flags");
+   testBorrowed(SYMTABLE_ARENA | SYMTABLE_INCREMENTAL,
+      "SYMTABLE_ARENA | SYMTABLE_INCREMENTAL");
+   testInterned(0, "no other flags");
+   testInterned(SYMTABLE_ARENA | SYMTABLE_INCREMENTAL,
+      "SYMTABLE_ARENA | SYMTABLE_INCREMENTAL");
+   testScope();
+   testSnapshot();
    testLargeTable(iBindingCount);
 
 